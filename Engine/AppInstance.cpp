@@ -1205,10 +1205,11 @@ AppInstance::createNodeInternal(const CreateNodeArgsPtr& args)
     AddCreateNode_RAII creatingNode_raii(_imp.get(), node, args);
 
     {
-        // Furnace plug-ins don't handle using the thread pool
+        // Furnace plug-ins don't handle using the thread pool. Their multi-thread suite threads are not taken
+        // from the worker pool unless the user explicitly enabled it for the plug-in.
         SettingsPtr settings = appPTR->getCurrentSettings();
         if ( !isSilentCreation && boost::starts_with(foundPluginID, "uk.co.thefoundry.furnace") &&
-             ( settings->useGlobalThreadPool() || ( settings->getNumberOfParallelRenders() != 1) ) ) {
+             ( ( settings->useGlobalThreadPool() && plugin->isWorkerPoolEnabled() ) || ( settings->getNumberOfParallelRenders() != 1) ) ) {
             StandardButtonEnum reply = Dialogs::questionDialog(tr("Warning").toStdString(),
                                                                tr("The settings of the application are currently set to use "
                                                                   "the global thread-pool for rendering effects.\n"
@@ -100,6 +100,7 @@
 #include "Engine/ProcessHandler.h" // ProcessInputChannel
 #include "Engine/Project.h"
 #include "Engine/PrecompNode.h"
+#include "Engine/RamBufferPool.h"
 #include "Engine/ReadNode.h"
 #include "Engine/RotoPaint.h"
 #include "Engine/RotoShapeRenderNode.h"
@@ -232,7 +233,7 @@ setSigSegvSignal()
 void
 AppManager::saveCaches() const
 {
-    _imp->saveCaches();
+    _imp->saveCaches(false);
 }
 
 int
@@ -435,7 +436,7 @@ AppManager::~AppManager()
     _imp->_backgroundIPC.reset();
 
     try {
-        _imp->saveCaches();
+        _imp->saveCaches(true);
     } catch (std::runtime_error) {
         // ignore errors
     }
@@ -880,11 +881,15 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
         size_t maxCacheRAM = _imp->_settings->getRamMaximumPercent() * getSystemTotalRAM();
         U64 viewerCacheSize = _imp->_settings->getMaximumViewerDiskCacheSize();
         U64 maxDiskCacheNode = _imp->_settings->getMaximumDiskCacheNodeSize();
+        int nodeCacheShards = _imp->_settings->getNodeCacheNumShards();
 
-        _imp->_nodeCache.reset( new ImageCache("NodeCache", NATRON_CACHE_VERSION, maxCacheRAM, 1.) );
+        _imp->_nodeCache.reset( new ImageCache("NodeCache", NATRON_CACHE_VERSION, maxCacheRAM, 1., nodeCacheShards) );
+        RamBufferPool::getInstance()->setMaxRetainedBytes(maxCacheRAM * NATRON_RAM_BUFFER_POOL_RETAINED_FRACTION);
         _imp->_diskCache.reset( new ImageCache("DiskCache", NATRON_CACHE_VERSION, maxDiskCacheNode, 0.) );
         _imp->_viewerCache.reset( new FrameEntryCache("ViewerCache", NATRON_CACHE_VERSION, viewerCacheSize, 0.) );
         _imp->setViewerCacheTileSize();
+        setApplicationsCachesEvictionWatermarks( _imp->_settings->getCacheEvictionHighWatermark(), _imp->_settings->getCacheEvictionLowWatermark() );
+        setNodeCacheCostAwareEviction( _imp->_settings->isCostAwareCacheEvictionEnabled() );
     } catch (std::logic_error) {
         // ignore
     }
@@ -1193,6 +1198,9 @@ AppManager::clearNodeCache()
         (*it)->clearAllLastRenderedImages();
     }
     _imp->_nodeCache->clear();
+
+    // Give the memory of the freed images back to the system
+    RamBufferPool::getInstance()->trim();
 }
 
 void
@@ -1306,6 +1314,9 @@ AppManager::setApplicationsCachesMaximumMemoryPercent(double p)
 
     _imp->_nodeCache->setMaximumCacheSize(maxCacheRAM);
     _imp->_nodeCache->setMaximumInMemorySize(1);
+
+    // The buffers kept by the pool are not accounted by the cache, keep them to a fraction of its budget
+    RamBufferPool::getInstance()->setMaxRetainedBytes(maxCacheRAM * NATRON_RAM_BUFFER_POOL_RETAINED_FRACTION);
 }
 
 void
@@ -1320,6 +1331,27 @@ AppManager::setApplicationsCachesMaximumDiskSpace(unsigned long long size)
     _imp->_diskCache->setMaximumCacheSize(size);
 }
 
+void
+AppManager::setApplicationsCachesEvictionWatermarks(double highWatermark,
+                                                    double lowWatermark)
+{
+    _imp->_nodeCache->setEvictionWatermarks(highWatermark, lowWatermark);
+    _imp->_diskCache->setEvictionWatermarks(highWatermark, lowWatermark);
+    _imp->_viewerCache->setEvictionWatermarks(highWatermark, lowWatermark);
+}
+
+void
+AppManager::setNodeCacheCostAwareEviction(bool enabled)
+{
+    _imp->_nodeCache->setCostAwareEviction(enabled);
+}
+
+bool
+AppManager::isNodeCacheCostAwareEvictionEnabled() const
+{
+    return _imp->_nodeCache->isCostAwareEvictionEnabled();
+}
+
 void
 AppManager::loadAllPlugins()
 {
@@ -2332,6 +2364,25 @@ AppManager::printCacheMemoryStats() const
     reportStr += printAsRAM(totalRam);
     reportStr += QLatin1String(" Disk: ");
     reportStr += printAsRAM(totalDisk);
+    reportStr += QLatin1String("\n-------------------------------\n");
+
+    RamBufferPoolStats poolStats;
+    RamBufferPool::getInstance()->getStats(&poolStats);
+    reportStr += tr("RAM buffer pool");
+    reportStr += QLatin1String("--> ");
+    reportStr += tr("In use: ");
+    reportStr += printAsRAM(poolStats.inUseBytes);
+    reportStr += tr(" Retained: ");
+    reportStr += printAsRAM(poolStats.retainedBytes);
+    reportStr += QLatin1String(" / ");
+    reportStr += printAsRAM(poolStats.maxRetainedBytes);
+    reportStr += QString::fromUtf8(" (%1)").arg(poolStats.nRetainedBuffers);
+    reportStr += QLatin1String("\n");
+    reportStr += tr("Allocations: %1 reused, %2 new, %3 not pooled. Buffers released to the system: %4")
+                 .arg(poolStats.nHits)
+                 .arg(poolStats.nMisses)
+                 .arg(poolStats.nUnpooled)
+                 .arg(poolStats.nReleasedToSystem);
 
 
     appPTR->writeToErrorLog_mt_safe(tr("Cache Report"), QDateTime::currentDateTime(), reportStr);
@@ -2725,6 +2776,17 @@ AppManager::checkCacheFreeMemoryIsGoodEnough()
     size_t systemRAMToKeepFree = getSystemTotalRAM() * appPTR->getCurrentSettings()->getUnreachableRamPercent();
     size_t totalFreeRAM = getAmountFreePhysicalRAM();
 
+    if (totalFreeRAM <= systemRAMToKeepFree) {
+        // Freed buffers kept for reuse cost nothing to give back, unlike cached images: release them first
+        RamBufferPoolStats poolStats;
+        RamBufferPool::getInstance()->getStats(&poolStats);
+        U64 missingRAM = systemRAMToKeepFree - totalFreeRAM + 1;
+        if (poolStats.retainedBytes > 0) {
+            RamBufferPool::getInstance()->trim( (std::size_t)(poolStats.retainedBytes > missingRAM ? poolStats.retainedBytes - missingRAM : 0) );
+            totalFreeRAM = getAmountFreePhysicalRAM();
+        }
+    }
+
     while (totalFreeRAM <= systemRAMToKeepFree) {
 #ifdef NATRON_DEBUG_CACHE
         qDebug() << "Total system free RAM is below the threshold:" << printAsRAM(totalFreeRAM)
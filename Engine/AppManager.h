@@ -217,6 +217,12 @@ public:
 
     void setApplicationsCachesMaximumDiskSpace(unsigned long long size);
 
+    void setApplicationsCachesEvictionWatermarks(double highWatermark, double lowWatermark);
+
+    void setNodeCacheCostAwareEviction(bool enabled);
+
+    bool isNodeCacheCostAwareEvictionEnabled() const;
+
     /**
      * @brief Removes from the node cache the given image.
      **/
@@ -357,6 +363,7 @@ public:
 
     /**
      * @brief Called by the caches to check that there's enough free memory on the computer to perform the allocation.
+     * The freed buffers retained by the RamBufferPool are given back to the system first.
      * WARNING: This functin may remove some entries from the caches.
      **/
     void checkCacheFreeMemoryIsGoodEnough();
@@ -466,6 +473,10 @@ public:
     void setDiskCacheLocation(const QString& path);
     const QString& getDiskCacheLocation() const;
 
+    /**
+     * @brief Saves the table of contents of the caches while the application runs: it remains flagged dirty,
+     * only the save made when the application exits flags it clean.
+     **/
     void saveCaches() const;
 
     PyObject* getMainModule();
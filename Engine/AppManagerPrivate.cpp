@@ -48,6 +48,7 @@
 #include "Global/GLIncludes.h"
 
 #include "Engine/FStreamsSupport.h"
+#include "Engine/CacheTOC.h"
 #include "Engine/ExistenceCheckThread.h"
 #include "Engine/Format.h"
 #include "Engine/FrameEntry.h"
@@ -276,33 +277,36 @@ AppManagerPrivate::declareSettingsToPython()
 
 template <typename T>
 void
-saveCache(const boost::shared_ptr<Cache<T> >& cache)
+saveCache(const boost::shared_ptr<Cache<T> >& cache,
+          bool isShutdown)
 {
-    std::string cacheRestoreFilePath = cache->getRestoreFilePath();
-    FStreamsSupport::ofstream ofile;
-    FStreamsSupport::open(&ofile, cacheRestoreFilePath);
+    typename SERIALIZATION_NAMESPACE::CacheSerialization<T> toc;
+    cache->toSerialization(&toc);
 
-    if (!ofile) {
-        std::cerr << "Failed to save cache to " << cacheRestoreFilePath.c_str() << std::endl;
+    // Only the entries that changed since the last save are written to the binary table of contents
+    try {
+        CacheTOC tocFile( cache->getRestoreTOCFilePath(), cache->getRestoreTOCHeapFilePath() );
+        tocFile.open(true);
+        // The cache keeps changing after a save made while the application runs: the TOC must stay dirty
+        tocFile.update<T>(toc.cacheVersion, toc.entries, !isShutdown);
+    } catch (const std::exception & e) {
+        qDebug() << "Failed to save the cache table of contents:" << e.what();
 
         return;
     }
 
-
-    typename SERIALIZATION_NAMESPACE::CacheSerialization<T> toc;
-    cache->toSerialization(&toc);
-    try {
-        SERIALIZATION_NAMESPACE::write(ofile, toc);
-    } catch (const std::exception & e) {
-        qDebug() << "Failed to serialize the cache table of contents:" << e.what();
+    // The legacy YAML table of contents is superseded by the binary one
+    QFile legacyRestoreFile( QString::fromUtf8( cache->getRestoreFilePath().c_str() ) );
+    if ( legacyRestoreFile.exists() ) {
+        legacyRestoreFile.remove();
     }
 }
 
 void
-AppManagerPrivate::saveCaches()
+AppManagerPrivate::saveCaches(bool isShutdown)
 {
-    saveCache<FrameEntry>( _viewerCache );
-    saveCache<Image>( _diskCache );
+    saveCache<FrameEntry>(_viewerCache, isShutdown);
+    saveCache<Image>(_diskCache, isShutdown);
 } // saveCaches
 
 template <typename T>
@@ -311,34 +315,35 @@ restoreCache(AppManagerPrivate* p,
              const boost::shared_ptr<Cache<T> >& cache)
 {
     if ( p->checkForCacheDiskStructure( cache->getCachePath(), cache->isTileCache() ) ) {
-        std::string settingsFilePath = cache->getRestoreFilePath();
-        FStreamsSupport::ifstream ifile;
-        FStreamsSupport::open(&ifile, settingsFilePath);
-        if (!ifile) {
-            std::cerr << "Failure to open cache restore file at: " << settingsFilePath << std::endl;
+        typename SERIALIZATION_NAMESPACE::CacheSerialization<T> toc;
+        boost::shared_ptr<CacheTOC> tocFile;
+        if ( !readCacheTOC<T>(cache->getRestoreTOCFilePath(), cache->getRestoreTOCHeapFilePath(), cache->getRestoreFilePath(), &toc, &tocFile) ) {
+            std::cerr << "Failure to read the cache table of contents of " << cache->cacheName() << std::endl;
+            p->cleanUpCacheDiskStructure( cache->getCachePath(), cache->isTileCache() );
 
             return;
         }
-        typename SERIALIZATION_NAMESPACE::CacheSerialization<T> toc;
         try {
-            SERIALIZATION_NAMESPACE::read(ifile, &toc);
             //Only load caches with same version, otherwise wipe it!
             if ( toc.cacheVersion != (int)cache->cacheVersion() ) {
+                tocFile.reset();
                 p->cleanUpCacheDiskStructure( cache->getCachePath(), cache->isTileCache() );
             } else {
                 cache->fromSerialization(toc);
+
+                // The cache is now live and will diverge from the TOC until the next save
+                if (tocFile) {
+                    tocFile->setDirty(true);
+                }
             }
 
         } catch (const std::exception & e) {
             qDebug() << "Exception when reading disk cache TOC:" << e.what();
+            tocFile.reset();
             p->cleanUpCacheDiskStructure( cache->getCachePath(), cache->isTileCache() );
 
             return;
         }
-
-        QFile restoreFile( QString::fromUtf8( settingsFilePath.c_str() ) );
-        restoreFile.remove();
-
     }
 }
 
@@ -360,9 +365,9 @@ AppManagerPrivate::checkForCacheDiskStructure(const QString & cachePath, bool is
         settingsFilePath += QChar::fromLatin1('/');
     }
     settingsFilePath += QString::fromUtf8("restoreFile.");
-    settingsFilePath += QString::fromUtf8(NATRON_CACHE_FILE_EXT);
 
-    if ( !QFile::exists(settingsFilePath) ) {
+    if ( !QFile::exists( settingsFilePath + QString::fromUtf8(NATRON_CACHE_TOC_FILE_EXT) ) &&
+         !QFile::exists( settingsFilePath + QString::fromUtf8(NATRON_CACHE_FILE_EXT) ) ) {
         cleanUpCacheDiskStructure(cachePath, isTiled);
 
         return false;
@@ -197,7 +197,7 @@ public:
 
     void loadBuiltinFormats();
 
-    void saveCaches();
+    void saveCaches(bool isShutdown);
 
     void restoreCaches();
 
@@ -997,6 +997,8 @@ Bezier::dequeueGuiActions(bool force)
         }
     }
     if (mustCopy) {
+        // The internal curves changed: previous tessellations are useless now
+        _imp->tessellationCache.clear();
         invalidateCacheHashAndEvaluate(true, false);
     }
 }
@@ -2878,6 +2880,12 @@ Bezier::getFeatherPoints_mt_safe() const
     return _imp->featherPoints;
 }
 
+RotoBezierTessellationCache*
+Bezier::getTessellationCache() const
+{
+    return &_imp->tessellationCache;
+}
+
 std::pair<BezierCPPtr, BezierCPPtr >
 Bezier::isNearbyControlPoint(double x,
                              double y,
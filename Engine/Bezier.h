@@ -501,6 +501,13 @@ public:
      **/
     const std::list< BezierCPPtr > & getFeatherPoints() const;
     std::list< BezierCPPtr > getFeatherPoints_mt_safe() const;
+
+    /**
+     * @brief Returns the cache of the tessellations computed by RotoBezierTriangulation for this bezier.
+     * It is cleared whenever the curves are modified.
+     **/
+    RotoBezierTessellationCache* getTessellationCache() const;
+
     enum ControlPointSelectionPrefEnum
     {
         eControlPointSelectionPrefFeatherFirst = 0,
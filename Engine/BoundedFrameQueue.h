@@ -0,0 +1,199 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_BoundedFrameQueue_h
+#define Natron_Engine_BoundedFrameQueue_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <map>
+#include <cassert>
+
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+
+#include "Engine/Timer.h"
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief A bounded queue of frames between producer threads and consumer threads. Frames are identified by their
+ * index in the render order and are popped lowest index first.
+ * If ordered, frames are popped in strict index order starting at 0: a frame is only popped once all the previous
+ * indices were popped. The next index to pop is always accepted even if the queue is full, otherwise the consumers
+ * would wait for it forever.
+ **/
+template <typename FRAME>
+class BoundedFrameQueue
+{
+    struct QueuedFrame
+    {
+        FRAME frame;
+
+        // Number of frames in the queue once this frame was pushed
+        int queueDepth;
+
+        // Time in seconds the push of this frame waited for room in the queue
+        double stallTime;
+    };
+
+    typedef std::map<int, QueuedFrame> FramesMap;
+
+public:
+
+    BoundedFrameQueue(int maxFrames,
+                      bool ordered)
+        : _maxFrames(maxFrames)
+        , _ordered(ordered)
+        , _lock()
+        , _notFull()
+        , _notEmpty()
+        , _frames()
+        , _nextIndex(0)
+        , _aborted(false)
+        , _mustQuit(false)
+    {
+        assert(_maxFrames > 0);
+    }
+
+    /**
+     * @brief Queues the frame with the given index, waiting while the queue is full.
+     * @returns False if the queue was aborted or quit, in which case the frame is dropped
+     **/
+    bool push(int index,
+              const FRAME& frame)
+    {
+        TimeLapse timer;
+        bool stalled = false;
+        QMutexLocker k(&_lock);
+
+        while ( !_aborted && !_mustQuit && ( (int)_frames.size() >= _maxFrames ) && ( !_ordered || (index != _nextIndex) ) ) {
+            stalled = true;
+            _notFull.wait(&_lock);
+        }
+        if (_aborted || _mustQuit) {
+            return false;
+        }
+
+        QueuedFrame& queued = _frames[index];
+        queued.frame = frame;
+        queued.queueDepth = (int)_frames.size();
+        queued.stallTime = stalled ? timer.getTimeSinceCreation() : 0.;
+        _notEmpty.wakeAll();
+
+        return true;
+    }
+
+    /**
+     * @brief Removes the next frame to consume, waiting until it is queued.
+     * @param queueDepth If not NULL, set to the number of frames in the queue once this frame was pushed
+     * @param stallTime If not NULL, set to the time in seconds the push of this frame waited for room in the queue
+     * @returns False if the queue was aborted, or if it was quit and the next frame to consume is not queued
+     **/
+    bool pop(FRAME* frame,
+             int* queueDepth,
+             double* stallTime)
+    {
+        QMutexLocker k(&_lock);
+
+        while ( !_aborted && !canPop() ) {
+            if (_mustQuit) {
+                return false;
+            }
+            _notEmpty.wait(&_lock);
+        }
+        if (_aborted) {
+            return false;
+        }
+
+        typename FramesMap::iterator it = _frames.begin();
+        *frame = it->second.frame;
+        if (queueDepth) {
+            *queueDepth = it->second.queueDepth;
+        }
+        if (stallTime) {
+            *stallTime = it->second.stallTime;
+        }
+        _nextIndex = it->first + 1;
+        _frames.erase(it);
+        _notFull.wakeAll();
+
+        return true;
+    }
+
+    /**
+     * @brief Drops the queued frames: waiting and subsequent calls to push and pop return false.
+     **/
+    void abort()
+    {
+        QMutexLocker k(&_lock);
+
+        _aborted = true;
+        _frames.clear();
+        _notFull.wakeAll();
+        _notEmpty.wakeAll();
+    }
+
+    /**
+     * @brief Subsequent calls to push return false, pop returns false once no frame can be consumed anymore.
+     **/
+    void quit()
+    {
+        QMutexLocker k(&_lock);
+
+        _mustQuit = true;
+        _notFull.wakeAll();
+        _notEmpty.wakeAll();
+    }
+
+    int getNFrames() const
+    {
+        QMutexLocker k(&_lock);
+
+        return (int)_frames.size();
+    }
+
+private:
+
+    bool canPop() const
+    {
+        return !_frames.empty() && ( !_ordered || (_frames.begin()->first == _nextIndex) );
+    }
+
+    const int _maxFrames;
+    const bool _ordered;
+
+    // Protects all members below
+    mutable QMutex _lock;
+    QWaitCondition _notFull, _notEmpty;
+    FramesMap _frames;
+
+    // The index following the last popped frame
+    int _nextIndex;
+    bool _aborted, _mustQuit;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_BoundedFrameQueue_h
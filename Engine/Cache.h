@@ -48,9 +48,11 @@ GCC_DIAG_OFF(deprecated)
 #include <QtCore/QObject>
 #include <QtCore/QBuffer>
 #include <QtCore/QRunnable>
+#include <QtCore/QAtomicInt>
 GCC_DIAG_ON(deprecated)
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
+#include <boost/atomic.hpp>
 #include "Serialization/CacheSerialization.h"
 #endif
 
@@ -64,9 +66,19 @@ GCC_DIAG_ON(deprecated)
 #include "Engine/EngineFwd.h"
 
 
-//Beyond that percentage of occupation, the cache will start evicting LRU entries
+//Beyond that percentage of occupation, the cache will start evicting LRU entries (high watermark)
 #define NATRON_CACHE_LIMIT_PERCENT 0.9
 
+//Once eviction started, LRU entries are evicted until the occupation is back under that percentage (low watermark)
+#define NATRON_CACHE_EVICTION_TARGET_PERCENT 0.8
+
+//When cost-aware eviction is enabled, number of least recently used entries among which the one
+//with the lowest GreedyDual-Size priority is evicted
+#define NATRON_CACHE_COST_AWARE_EVICTION_CANDIDATES 16
+
+//The threads creating entries check the system free RAM each time the cache grew by that many bytes
+#define NATRON_CACHE_FREE_RAM_CHECK_BYTES 67108864
+
 #define NATRON_TILE_CACHE_FILE_SIZE_BYTES 2000000000
 
 ///When defined, number of opened files, memory size and disk size of the cache are printed whenever there's activity.
@@ -144,6 +156,8 @@ public:
         while (mustQuit) {
             mustQuitCond.wait(&mustQuitMutex);
         }
+        // run() released mustQuitMutex: wait for it to return so that the next request starts the thread again
+        wait();
     }
 
     bool isWorking() const
@@ -268,6 +282,7 @@ public:
         while (mustQuit) {
             mustQuitCond.wait(&mustQuitMutex);
         }
+        wait();
     }
 
     bool isWorking() const
@@ -316,6 +331,128 @@ private:
 };
 
 
+/**
+ * @brief The point of this thread is to evict the least recently used entries in the background once the cache
+ * occupation goes beyond its high watermark, until it gets back under its low watermark.
+ * This way threads creating new entries do not pay for the eviction, unless the cache is completely full.
+ * Requests are coalesced: requesting an eviction while one is pending does nothing.
+ **/
+class CacheEvictorThread
+        : public QThread
+{
+    mutable QMutex _requestMutex;
+    // Written under _requestMutex, read without it to coalesce the requests of the threads creating entries
+    boost::atomic<bool> _evictionRequested;
+    bool _quitRequested;
+    QWaitCondition _evictionRequestedCond;
+    CacheAPI* cache;
+    QMutex mustQuitMutex;
+    QWaitCondition mustQuitCond;
+    bool mustQuit;
+
+public:
+
+    CacheEvictorThread(CacheAPI* cache)
+        : QThread()
+        , _requestMutex()
+        , _evictionRequested(false)
+        , _quitRequested(false)
+        , _evictionRequestedCond()
+        , cache(cache)
+        , mustQuitMutex()
+        , mustQuitCond()
+        , mustQuit(false)
+    {
+        setObjectName( QString::fromUtf8("CacheEvictor") );
+    }
+
+    virtual ~CacheEvictorThread()
+    {
+    }
+
+    void requestEviction()
+    {
+        if (_evictionRequested) {
+            return;
+        }
+        {
+            QMutexLocker k(&_requestMutex);
+            if (_evictionRequested) {
+                return;
+            }
+            _evictionRequested = true;
+        }
+        if ( !isRunning() ) {
+            start();
+        } else {
+            QMutexLocker k(&_requestMutex);
+            _evictionRequestedCond.wakeOne();
+        }
+    }
+
+    void quitThread()
+    {
+        if ( !isRunning() ) {
+            return;
+        }
+        QMutexLocker k(&mustQuitMutex);
+        assert(!mustQuit);
+        mustQuit = true;
+
+        {
+            QMutexLocker k2(&_requestMutex);
+            _quitRequested = true;
+            _evictionRequestedCond.wakeOne();
+        }
+        while (mustQuit) {
+            mustQuitCond.wait(&mustQuitMutex);
+        }
+        wait();
+    }
+
+    bool isWorking() const
+    {
+        return _evictionRequested;
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        for (;; ) {
+            bool quit;
+            {
+                QMutexLocker k(&_requestMutex);
+                while (!_evictionRequested && !_quitRequested) {
+                    _evictionRequestedCond.wait(&_requestMutex);
+                }
+                quit = _quitRequested;
+                if (quit) {
+                    _quitRequested = false;
+                    _evictionRequested = false;
+                }
+            }
+
+            if (quit) {
+                QMutexLocker k(&mustQuitMutex);
+                assert(mustQuit);
+                mustQuit = false;
+                mustQuitCond.wakeOne();
+
+                return;
+            }
+
+            cache->evictToLowWatermark();
+
+            {
+                QMutexLocker k(&_requestMutex);
+                _evictionRequested = false;
+            }
+        }
+    }
+};
+
+
 class CacheSignalEmitter
         : public QObject
 {
@@ -465,24 +602,62 @@ public:
 
 private:
 
+    /**
+     * @brief A shard holds the portion of the entries of the cache whose hash maps to it.
+     * Each shard has its own LRU containers and locks, so that threads looking-up
+     * entries that do not belong to the same shard never contend.
+     * A cache created with a single shard behaves exactly like an unsharded cache.
+     **/
+    struct CacheShard
+    {
+        QMutex lock; //protects memoryCache & diskCache
+        QMutex getLock;  //prevents get() and getOrCreate() to be called simultaneously for entries of this shard
+        CacheContainer memoryCache;
+        CacheContainer diskCache;
+        double evictionInflation; //the GreedyDual-Size inflation value L of the memory portion, protected by lock
+
+        CacheShard()
+            : lock()
+            , getLock()
+            , memoryCache()
+            , diskCache()
+            , evictionInflation(0.)
+        {
+        }
+    };
+
+    typedef boost::shared_ptr<CacheShard> CacheShardPtr;
 
-    std::size_t _maximumInMemorySize;     // the maximum size of the in-memory portion of the cache.(in % of the maximum cache size)
-    std::size_t _maximumCacheSize;     // maximum size allowed for the cache
+    // Written under the _sizeLock so that they stay consistent with the eviction thresholds, read without it
+    boost::atomic<std::size_t> _maximumInMemorySize;     // the maximum size of the in-memory portion of the cache.(in % of the maximum cache size)
+    boost::atomic<std::size_t> _maximumCacheSize;     // maximum size allowed for the cache
 
     /*mutable because we need to change modify it in the sealEntryInternal function which
          is called by an external object that have a const ref to the cache.
+       These are shared by all shards and updated without taking any lock.
      */
-    mutable std::size_t _memoryCacheSize;     // current size of the cache in bytes
-    mutable std::size_t _diskCacheSize;
-    mutable QMutex _sizeLock; // protects _memoryCacheSize & _diskCacheSize & _maximumInMemorySize & _maximumCacheSize
-    mutable QMutex _lock; //protects _memoryCache & _diskCache
-    mutable QMutex _getLock;  //prevents get() and getOrCreate() to be called simultaneously
+    mutable boost::atomic<std::size_t> _memoryCacheSize;     // current size of the cache in bytes
+    mutable boost::atomic<std::size_t> _diskCacheSize;
+    mutable QMutex _sizeLock; // serializes the writes of the maximum sizes, protects _memoryFullCondition & the watermarks
 
+    // Occupation percentages beyond which the evictor thread starts evicting entries and under which it stops
+    double _evictionHighWatermark, _evictionLowWatermark;
 
-    /*These 2 are mutable because we need to modify the LRU list even
-         when we call get() and we want this function to be const.*/
-    mutable CacheContainer _memoryCache;
-    mutable CacheContainer _diskCache;
+    // The sizes of the memory and disk portions at the high watermark, so that the threads creating entries
+    // can tell whether the evictor thread must run without taking the _sizeLock, see updateEvictionThresholds()
+    boost::atomic<std::size_t> _evictionMemoryThreshold, _evictionDiskThreshold;
+
+    // The size of the cache when the system free RAM was last checked, see checkFreeRAMIfCacheGrew()
+    mutable boost::atomic<std::size_t> _cacheSizeAtLastFreeRAMCheck;
+
+    // When true, in-memory entries are evicted according to their render cost per byte rather than by recency only
+    boost::atomic<bool> _costAwareEviction;
+
+    // The shards of the cache, the vector itself never changes after construction
+    std::vector<CacheShardPtr> _shards;
+
+    // Used to visit the other shards in a round-robin fashion when the shard of an entry has nothing left to evict
+    mutable QAtomicInt _nextEvictionShard;
     const std::string _cacheName;
     const unsigned int _version;
 
@@ -496,6 +671,7 @@ private:
     mutable DeleterThread<EntryType> _deleterThread;
     mutable QWaitCondition _memoryFullCondition; //< protected by _sizeLock
     mutable CacheCleanerThread _cleanerThread;
+    mutable CacheEvictorThread _evictorThread;
 
     // If tiled, the cache will consist only of a few large files that each contain tiles of the same size.
     // This is useful to cache chunks of data that always have the same size.
@@ -509,27 +685,37 @@ private:
     // Used when the cache is tiled
     std::set<TileCacheFilePtr> _cacheFiles;
 
-    // When set these are used for fast search of a free tile
-    boost::weak_ptr<TileCacheFile> _nextAvailableCacheFile;
-    int _nextAvailableCacheFileIndex;
+    // The files in _cacheFiles that have at least one free tile
+    std::set<TileCacheFilePtr> _availableCacheFiles;
 public:
 
 
+    /**
+     * @brief Creates a new cache. If nShards is greater than 1, the cache is split into nShards shards:
+     * an entry always lives in the shard selected by its hash, and each shard is protected by its own locks.
+     * The LRU order is then maintained per shard: when the shard of an entry has nothing left to evict, the other
+     * shards are visited in turn, so that the cache never exceeds its budget.
+     **/
     Cache(const std::string & cacheName,
           unsigned int version,
           U64 maximumCacheSize,      // total size
-          double maximumInMemoryPercentage //how much should live in RAM
+          double maximumInMemoryPercentage, //how much should live in RAM
+          int nShards = 1
           )
         : CacheAPI()
-        , _maximumInMemorySize(maximumCacheSize * maximumInMemoryPercentage)
+        , _maximumInMemorySize( (std::size_t)(maximumCacheSize * maximumInMemoryPercentage) )
         , _maximumCacheSize(maximumCacheSize)
         , _memoryCacheSize(0)
         , _diskCacheSize(0)
         , _sizeLock()
-        , _lock()
-        , _getLock()
-        , _memoryCache()
-        , _diskCache()
+        , _evictionHighWatermark(NATRON_CACHE_LIMIT_PERCENT)
+        , _evictionLowWatermark(NATRON_CACHE_EVICTION_TARGET_PERCENT)
+        , _evictionMemoryThreshold(0)
+        , _evictionDiskThreshold(0)
+        , _cacheSizeAtLastFreeRAMCheck(0)
+        , _costAwareEviction(false)
+        , _shards()
+        , _nextEvictionShard()
         , _cacheName(cacheName)
         , _version(version)
         , _signalEmitter(new CacheSignalEmitter)
@@ -538,23 +724,34 @@ public:
         , _deleterThread(this)
         , _memoryFullCondition()
         , _cleanerThread(this)
+        , _evictorThread(this)
         , _tileCacheMutex()
         , _isTiled(false)
         , _tileByteSize(0)
         , _clearingCache(false)
         , _cacheFiles()
-        , _nextAvailableCacheFile()
-        , _nextAvailableCacheFileIndex(-1)
+        , _availableCacheFiles()
     {
+        nShards = std::max( 1, std::min(nShards, NATRON_CACHE_MAX_SHARDS) );
+        for (int i = 0; i < nShards; ++i) {
+            _shards.push_back( CacheShardPtr(new CacheShard) );
+        }
+        updateEvictionThresholds();
     }
 
     virtual ~Cache()
     {
-        QMutexLocker locker(&_lock);
-
         _tearingDown = true;
-        _memoryCache.clear();
-        _diskCache.clear();
+        for (typename std::vector<CacheShardPtr>::const_iterator it = _shards.begin(); it != _shards.end(); ++it) {
+            QMutexLocker locker(&(*it)->lock);
+            (*it)->memoryCache.clear();
+            (*it)->diskCache.clear();
+        }
+    }
+
+    int getNumShards() const
+    {
+        return (int)_shards.size();
     }
 
     virtual bool isTileCache() const OVERRIDE FINAL
@@ -584,6 +781,8 @@ public:
 
     void waitForDeleterThread()
     {
+        // The evictor feeds the deleter thread, stop it first
+        _evictorThread.quitThread();
         _deleterThread.quitThread();
         _cleanerThread.quitThread();
     }
@@ -602,17 +801,24 @@ public:
     bool get(const typename EntryType::key_type & key,
              std::list<EntryTypePtr>* returnValue) const
     {
+        CacheShard& shard = getShard( key.getHash() );
+
         ///Be atomic, so it cannot be created by another thread in the meantime
-        QMutexLocker getlocker(&_getLock);
+        QMutexLocker getlocker(&shard.getLock);
 
-        ///lock the cache before reading it.
-        QMutexLocker locker(&_lock);
+        ///lock the shard before reading it.
+        QMutexLocker locker(&shard.lock);
 
-        return getInternal(key, returnValue);
+        return getInternal(shard, key, returnValue);
     } // get
 
 private:
 
+    CacheShard& getShard(hash_type hash) const
+    {
+        return *_shards[hash % _shards.size()];
+    }
+
 
 
     virtual TileCacheFilePtr getTileCacheFile(const std::string& filepath, std::size_t dataOffset) OVERRIDE FINAL WARN_UNUSED_RETURN
@@ -628,8 +834,14 @@ private:
 
                 // The dataOffset should be a multiple of the tile size
                 assert(_tileByteSize * index == dataOffset);
-                assert(!(*it)->usedTiles[index]);
-                (*it)->usedTiles[index] = true;
+                assert( index >= 0 && index < (int)(*it)->usedTiles.size() );
+
+                // Another entry of the table of contents already claimed this tile: refuse it, otherwise freeing one
+                // of the entries would free the tile of the other
+                if ( (*it)->usedTiles.isUsed(index) ) {
+                    return TileCacheFilePtr();
+                }
+                setTileUsed(*it, index);
                 return *it;
             }
         }
@@ -639,15 +851,15 @@ private:
             TileCacheFilePtr ret(new TileCacheFile);
             ret->file.reset(new MemoryFile(filepath, MemoryFile::eFileOpenModeEnumIfExistsKeepElseFail) );
             std::size_t nTilesPerFile = std::floor( ( (double)NATRON_TILE_CACHE_FILE_SIZE_BYTES ) / _tileByteSize );
-            ret->usedTiles.resize(nTilesPerFile, false);
+            ret->usedTiles.resize(nTilesPerFile);
             int index = dataOffset / _tileByteSize;
 
             // The dataOffset should be a multiple of the tile size
             assert(_tileByteSize * index == dataOffset);
             assert(index >= 0 && index < (int)ret->usedTiles.size());
-            assert(!ret->usedTiles[index]);
-            ret->usedTiles[index] = true;
             _cacheFiles.insert(ret);
+            _availableCacheFiles.insert(ret);
+            setTileUsed(ret, index);
             return ret;
 
         }
@@ -671,39 +883,87 @@ private:
         if (!_isTiled) {
             throw std::logic_error("allocTile() but cache is not tiled!");
         }
-        // First, search for a file with available space.
+        return allocTileInternal(dataOffset);
+    }
+
+    virtual void allocTiles(std::size_t nTiles, std::vector<AllocatedTile>* tiles) OVERRIDE FINAL
+    {
+        QMutexLocker k(&_tileCacheMutex);
+
+        assert(_isTiled);
+        if (!_isTiled) {
+            throw std::logic_error("allocTiles() but cache is not tiled!");
+        }
+        tiles->reserve(tiles->size() + nTiles);
+        for (std::size_t i = 0; i < nTiles; ++i) {
+            AllocatedTile tile;
+            tile.file = allocTileInternal(&tile.dataOffset);
+            tiles->push_back(tile);
+        }
+    }
+
+    /**
+     * @brief Free a tile from the cache that was previously allocated with allocTile. It will be made available again for other entries.
+     **/
+    virtual void freeTile(const TileCacheFilePtr& file, std::size_t dataOffset) OVERRIDE FINAL
+    {
+        QMutexLocker k(&_tileCacheMutex);
+
+        assert(_isTiled);
+        if (!_isTiled) {
+            throw std::logic_error("allocTile() but cache is not tiled!");
+        }
+        freeTileInternal(file, dataOffset);
+    }
+
+    virtual void freeTiles(const std::vector<AllocatedTile>& tiles) OVERRIDE FINAL
+    {
+        QMutexLocker k(&_tileCacheMutex);
+
+        assert(_isTiled);
+        if (!_isTiled) {
+            throw std::logic_error("freeTiles() but cache is not tiled!");
+        }
+        for (std::vector<AllocatedTile>::const_iterator it = tiles.begin(); it != tiles.end(); ++it) {
+            freeTileInternal(it->file, it->dataOffset);
+        }
+    }
+
+    /**
+     * @brief Marks the given tile of the file as used and update the set of files with available tiles.
+     * The _tileCacheMutex must be locked.
+     **/
+    void setTileUsed(const TileCacheFilePtr& file, int index)
+    {
+        assert( !_tileCacheMutex.tryLock() );
+        assert( index >= 0 && index < (int)file->usedTiles.size() );
+        // A tile belongs to a single entry, see getTileCacheFile()
+        assert( !file->usedTiles.isUsed(index) );
+        if ( file->usedTiles.isUsed(index) ) {
+            return;
+        }
+        file->usedTiles.setUsed(index, true);
+        if ( file->usedTiles.isFull() ) {
+            _availableCacheFiles.erase(file);
+        }
+    }
+
+    TileCacheFilePtr allocTileInternal(std::size_t *dataOffset)
+    {
+        assert( !_tileCacheMutex.tryLock() );
+
+        // First, pick a file with available space: any file in _availableCacheFiles
+        // has at least a free tile.
         // If not found create one
         TileCacheFilePtr foundAvailableFile;
         int foundTileIndex = -1;
-        {
-            foundAvailableFile = _nextAvailableCacheFile.lock();
-            if (_nextAvailableCacheFileIndex != -1 && foundAvailableFile) {
-                foundTileIndex = _nextAvailableCacheFileIndex;
-                *dataOffset = foundTileIndex * _tileByteSize;
-                _nextAvailableCacheFileIndex = -1;
-                _nextAvailableCacheFile.reset();
-            } else {
-                foundTileIndex = -1;
-                foundAvailableFile.reset();
-            }
-        }
-        if (foundTileIndex == -1) {
-            for (std::set<TileCacheFilePtr>::iterator it = _cacheFiles.begin(); it != _cacheFiles.end(); ++it) {
-                for (std::size_t i = 0; i < (*it)->usedTiles.size(); ++i) {
-                    if (!(*it)->usedTiles[i])  {
-                        foundTileIndex = i;
-                        *dataOffset = i * _tileByteSize;
-                        break;
-                    }
-                }
-                if (foundTileIndex != -1) {
-                    foundAvailableFile = *it;
-                    break;
-                }
-            }
+        if ( !_availableCacheFiles.empty() ) {
+            foundAvailableFile = *_availableCacheFiles.begin();
+            foundTileIndex = foundAvailableFile->usedTiles.findFirstFree();
+            assert(foundTileIndex != -1);
         }
 
-        if (!foundAvailableFile) {
+        if (foundTileIndex == -1) {
             // Create a file if all space is taken
             foundAvailableFile.reset(new TileCacheFile());
             int nCacheFiles = (int)_cacheFiles.size();
@@ -715,30 +975,23 @@ private:
             std::size_t nTilesPerFile = std::floor(((double)NATRON_TILE_CACHE_FILE_SIZE_BYTES) / _tileByteSize);
             std::size_t cacheFileSize = nTilesPerFile * _tileByteSize;
             foundAvailableFile->file->resize(cacheFileSize);
-            foundAvailableFile->usedTiles.resize(nTilesPerFile, false);
-            *dataOffset = 0;
+            foundAvailableFile->usedTiles.resize(nTilesPerFile);
             foundTileIndex = 0;
             _cacheFiles.insert(foundAvailableFile);
-            _nextAvailableCacheFile = foundAvailableFile;
-            _nextAvailableCacheFileIndex = 1;
+            _availableCacheFiles.insert(foundAvailableFile);
         }
 
+        *dataOffset = foundTileIndex * _tileByteSize;
+
         // Notify the memory file that this portion of the file is valid
-        foundAvailableFile->usedTiles[foundTileIndex] = true;
+        setTileUsed(foundAvailableFile, foundTileIndex);
         return foundAvailableFile;
     }
 
-    /**
-             * @brief Free a tile from the cache that was previously allocated with allocTile. It will be made available again for other entries.
-             **/
-    virtual void freeTile(const TileCacheFilePtr& file, std::size_t dataOffset) OVERRIDE FINAL
+    void freeTileInternal(const TileCacheFilePtr& file, std::size_t dataOffset)
     {
-        QMutexLocker k(&_tileCacheMutex);
+        assert( !_tileCacheMutex.tryLock() );
 
-        assert(_isTiled);
-        if (!_isTiled) {
-            throw std::logic_error("allocTile() but cache is not tiled!");
-        }
         std::set<TileCacheFilePtr>::iterator foundTileFile = _cacheFiles.find(file);
         assert(foundTileFile != _cacheFiles.end());
         if (foundTileFile == _cacheFiles.end()) {
@@ -749,38 +1002,32 @@ private:
         // The dataOffset should be a multiple of the tile size
         assert(_tileByteSize * index == dataOffset);
         assert(index >= 0 && index < (int)(*foundTileFile)->usedTiles.size());
-        assert((*foundTileFile)->usedTiles[index]);
-        (*foundTileFile)->usedTiles[index] = false;
+        (*foundTileFile)->usedTiles.setUsed(index, false);
 
         // If the file does not have any tile associated, remove it
-        // A use_count of 2 means that the tile file is only referenced by the cache itself and the entry calling
-        // the freeTile() function, hence once its freed, no tile should be using it anymore
-        if ((*foundTileFile).use_count() <= 2) {
+        if ((*foundTileFile)->usedTiles.getNumUsedTiles() == 0) {
             // Do not remove the file except if we are clearing the cache
             if (_clearingCache) {
                 (*foundTileFile)->file->remove();
+                _availableCacheFiles.erase(*foundTileFile);
                 _cacheFiles.erase(foundTileFile);
+                return;
             } else {
                 // Invalidate this portion of the cache
                 (*foundTileFile)->file->flush(MemoryFile::eFlushTypeInvalidate, (*foundTileFile)->file->data() + dataOffset, _tileByteSize);
             }
-        } else {
-            _nextAvailableCacheFile = *foundTileFile;
-            _nextAvailableCacheFileIndex = index;
         }
+        _availableCacheFiles.insert(*foundTileFile);
     }
 
 
-    void createInternal(const typename EntryType::key_type & key,
+    void createInternal(CacheShard& shard,
+                        const typename EntryType::key_type & key,
                         const ParamsTypePtr & params,
                         ImageLockerHelper<EntryType>* entryLocker,
                         EntryTypePtr* returnValue) const
     {
-        //_lock must not be taken here
-
-        ///Before allocating the memory check that there's enough space to fit in memory
-        appPTR->checkCacheFreeMemoryIsGoodEnough();
-
+        //shard.lock must not be taken here
 
         ///Just in case, we don't allow more than X files to be removed at once.
         int safeCounter = 0;
@@ -795,38 +1042,20 @@ private:
             ++safeCounter;
         }
 
-        U64 memoryCacheSize, maximumInMemorySize;
-        {
-            QMutexLocker k(&_sizeLock);
-            memoryCacheSize = _memoryCacheSize;
-            maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
+        checkFreeRAMIfCacheGrew();
+
+        ///The evictor thread brings the cache back under its low watermark once it went beyond the high watermark
+        if ( (_memoryCacheSize > _evictionMemoryThreshold) || ( _isTiled && (_diskCacheSize > _evictionDiskThreshold) ) ) {
+            _evictorThread.requestEviction();
         }
+
         {
-            QMutexLocker locker(&_lock);
+            ///Only evict on this thread if the cache is completely full: the evictor thread could not keep up.
             std::list<EntryTypePtr> entriesToBeDeleted;
-            double occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
-            ///While the current cache size can't fit the new entry, erase the last recently used entries.
-            ///Also if the total free RAM is under the limit of the system free RAM to keep free, erase LRU entries.
-            while (occupationPercentage > NATRON_CACHE_LIMIT_PERCENT) {
-                std::list<EntryTypePtr> deleted;
-                if ( !tryEvictInMemoryEntry(deleted) ) {
-                    break;
-                }
-
-                //Refresh now memory cache size && maximum in memory size as they might have been changed
-                //in tryEvictEntry
-                {
-                    QMutexLocker k(&_sizeLock);
-                    memoryCacheSize = _memoryCacheSize;
-                    maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
-                }
-
-
-                for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
-                    entriesToBeDeleted.push_back(*it);
-                }
-
-                occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
+            evictInMemoryEntriesDownTo(1., &shard, entriesToBeDeleted);
+            if (_isTiled) {
+                // For tiled caches, we insert directly into the disk cache, so make sure there is room for it
+                evictDiskEntriesDownTo(1., &shard, entriesToBeDeleted);
             }
 
             if ( !entriesToBeDeleted.empty() ) {
@@ -838,54 +1067,20 @@ private:
                 entriesToBeDeleted.clear();
             }
         }
-        {
-            //If _maximumcacheSize == 0 we don't return 1 otherwise we would cause a deadlock
+        //Only take the _sizeLock when the cache is full
+        if ( getMemoryOccupation() >= 1. ) {
             QMutexLocker k(&_sizeLock);
-            double occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize / _maximumCacheSize;
+            double occupationPercentage = getMemoryOccupation();
 
             //_memoryCacheSize member will get updated while images are being destroyed by the parallel thread.
             //we wait for cache memory occupation to be < 100% to be sure we don't hit swap here
             while ( occupationPercentage >= 1. && _deleterThread.isWorking() ) {
                 _memoryFullCondition.wait(&_sizeLock);
-                occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize / _maximumCacheSize;
-            }
-        }
-        if (_isTiled) {
-
-            QMutexLocker locker(&_lock);
-            // For tiled caches, we insert directly into the disk cache, so make sure there is room for it
-            std::list<EntryTypePtr> entriesToBeDeleted;
-            U64 diskCacheSize, maximumDiskCacheSize;
-            {
-                QMutexLocker k(&_sizeLock);
-                diskCacheSize = _diskCacheSize;
-                maximumDiskCacheSize = std::max( (std::size_t)1, _maximumCacheSize - _maximumInMemorySize );
-            }
-            double diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
-            while (diskPercentage >= NATRON_CACHE_LIMIT_PERCENT) {
-                std::list<EntryTypePtr> deleted;
-                if ( !tryEvictDiskEntry(deleted) ) {
-                    break;
-                }
-
-                for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
-                    diskCacheSize -= (*it)->size();
-                    entriesToBeDeleted.push_back(*it);
-                }
-                diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
+                occupationPercentage = getMemoryOccupation();
             }
-            if ( !entriesToBeDeleted.empty() ) {
-                ///Launch a separate thread whose function will be to delete all the entries to be deleted
-                _deleterThread.appendToQueue(entriesToBeDeleted);
-
-                ///Clearing the list here will not delete the objects pointing to by the shared_ptr's because we made a copy
-                ///that the separate thread will delete
-                entriesToBeDeleted.clear();
-            }
-
         }
         {
-            QMutexLocker locker(&_lock);
+            QMutexLocker locker(&shard.lock);
 
             try {
                 returnValue->reset( new EntryType(key, params, this ) );
@@ -904,23 +1099,77 @@ private:
                 if (entryLocker) {
                     entryLocker->lock(*returnValue);
                 }
-                sealEntry(*returnValue, _isTiled ? false : true);
+                sealEntry(shard, *returnValue, _isTiled ? false : true);
             }
         }
     } // createInternal
 
+    /**
+     * @brief Evicts entries if the system free RAM is too low. This costs system calls, hence it is only done once
+     * the cache grew by NATRON_CACHE_FREE_RAM_CHECK_BYTES since the last check.
+     **/
+    void checkFreeRAMIfCacheGrew() const
+    {
+        // For tile caches, the entries live in the memory mapped files
+        std::size_t cacheSize = _isTiled ? _diskCacheSize : _memoryCacheSize;
+        std::size_t lastCheckSize = _cacheSizeAtLastFreeRAMCheck;
+
+        if (cacheSize < lastCheckSize) {
+            // The cache shrank, count the growth from there
+            _cacheSizeAtLastFreeRAMCheck.compare_exchange_strong(lastCheckSize, cacheSize);
+        } else if ( (cacheSize - lastCheckSize >= NATRON_CACHE_FREE_RAM_CHECK_BYTES) &&
+                    _cacheSizeAtLastFreeRAMCheck.compare_exchange_strong(lastCheckSize, cacheSize) ) {
+            // Only the thread that moved the reference size checks
+            appPTR->checkCacheFreeMemoryIsGoodEnough();
+        }
+    }
+
+    double getMemoryOccupation() const
+    {
+        //If _maximumcacheSize == 0 we don't return 1 otherwise we would cause a deadlock
+        std::size_t maximumCacheSize = _maximumCacheSize;
+
+        return maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize / maximumCacheSize;
+    }
+
+    /**
+     * @brief The maximum size of the disk portion of the cache. The maximum sizes are read without the _sizeLock:
+     * clamp in case they are being changed concurrently.
+     **/
+    std::size_t getMaximumDiskCacheSizeInternal() const
+    {
+        std::size_t maximumCacheSize = _maximumCacheSize;
+        std::size_t maximumInMemorySize = _maximumInMemorySize;
+
+        return maximumCacheSize > maximumInMemorySize ? maximumCacheSize - maximumInMemorySize : 0;
+    }
+
+    /**
+     * @brief Must be called with the _sizeLock held whenever the maximum sizes or the watermarks change.
+     **/
+    void updateEvictionThresholds()
+    {
+        // Same occupation as computed by evictToLowWatermark()
+        std::size_t maximumInMemorySize = std::max( (std::size_t)1, (std::size_t)_maximumInMemorySize );
+        std::size_t maximumDiskCacheSize = std::max( (std::size_t)1, getMaximumDiskCacheSizeInternal() );
+
+        _evictionMemoryThreshold = (std::size_t)(maximumInMemorySize * _evictionHighWatermark);
+        _evictionDiskThreshold = (std::size_t)(maximumDiskCacheSize * _evictionHighWatermark);
+    }
+
 public:
 
     void swapOrInsert(const EntryTypePtr& entryToBeEvicted,
                       const EntryTypePtr& newEntry)
     {
-        QMutexLocker locker(&_lock);
-
         const typename EntryType::key_type& key = entryToBeEvicted->getKey();
         typename EntryType::hash_type hash = entryToBeEvicted->getHashKey();
+        CacheShard& shard = getShard(hash);
+        QMutexLocker locker(&shard.lock);
+
         ///find a matching value in the internal memory container
-        CacheIterator memoryCached = _memoryCache(hash);
-        if ( memoryCached != _memoryCache.end() ) {
+        CacheIterator memoryCached = shard.memoryCache(hash);
+        if ( memoryCached != shard.memoryCache.end() ) {
             std::list<EntryTypePtr> & ret = getValueFromIterator(memoryCached);
             for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                 if ( ( (*it)->getKey() == key ) && ( (*it)->getParams() == entryToBeEvicted->getParams() ) ) {
@@ -932,8 +1181,8 @@ public:
             ret.push_back(newEntry);
         } else {
             ///Look in disk cache
-            CacheIterator diskCached = _diskCache(hash);
-            if ( diskCached != _diskCache.end() ) {
+            CacheIterator diskCached = shard.diskCache(hash);
+            if ( diskCached != shard.diskCache.end() ) {
                 ///Remove the old entry
                 std::list<EntryTypePtr> & ret = getValueFromIterator(diskCached);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
@@ -944,7 +1193,7 @@ public:
                 }
             }
             ///Insert in mem cache
-            _memoryCache.insert(hash, newEntry);
+            shard.memoryCache.insert(hash, newEntry);
         }
     }
 
@@ -984,13 +1233,15 @@ public:
         ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
 
         {
+            CacheShard& shard = getShard( key.getHash() );
+
             ///Be atomic, so it cannot be created by another thread in the meantime
-            QMutexLocker getlocker(&_getLock);
+            QMutexLocker getlocker(&shard.getLock);
             std::list<EntryTypePtr> entries;
             bool didGetSucceed;
             {
-                QMutexLocker locker(&_lock);
-                didGetSucceed = getInternal(key, &entries);
+                QMutexLocker locker(&shard.lock);
+                didGetSucceed = getInternal(shard, key, &entries);
             }
             if (didGetSucceed) {
                 for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
@@ -1002,7 +1253,7 @@ public:
                 }
             }
 
-            createInternal(key, params, locker, returnValue);
+            createInternal(shard, key, params, locker, returnValue);
 
             return false;
         } // getlocker
@@ -1024,13 +1275,15 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-        std::pair<hash_type, EntryTypePtr> evictedFromMemory = _memoryCache.evict();
-        while (evictedFromMemory.second) {
-            if ( !_isTiled && evictedFromMemory.second->isStoredOnDisk() ) {
-                evictedFromMemory.second->removeAnyBackingFile();
+        for (typename std::vector<CacheShardPtr>::const_iterator it = _shards.begin(); it != _shards.end(); ++it) {
+            QMutexLocker locker(&(*it)->lock);
+            std::pair<hash_type, EntryTypePtr> evictedFromMemory = (*it)->memoryCache.evict();
+            while (evictedFromMemory.second) {
+                if ( !_isTiled && evictedFromMemory.second->isStoredOnDisk() ) {
+                    evictedFromMemory.second->removeAnyBackingFile();
+                }
+                evictedFromMemory = (*it)->memoryCache.evict();
             }
-            evictedFromMemory = _memoryCache.evict();
         }
 
         if (_signalEmitter) {
@@ -1054,19 +1307,21 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-
-        /// An entry which has a use_count greater than 1 is not removable:
-        /// The backing file must not be removed because it might be read/written to
-        /// at the same time. The best we can do is just let it here in the cache.
-        std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
-        //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
-        //we'll let the user of these entries purge the extra entries left in the cache later on
-        while (evictedFromDisk.second) {
-            if (!_isTiled) {
-                evictedFromDisk.second->removeAnyBackingFile();
+        for (typename std::vector<CacheShardPtr>::const_iterator it = _shards.begin(); it != _shards.end(); ++it) {
+            QMutexLocker locker(&(*it)->lock);
+
+            /// An entry which has a use_count greater than 1 is not removable:
+            /// The backing file must not be removed because it might be read/written to
+            /// at the same time. The best we can do is just let it here in the cache.
+            std::pair<hash_type, EntryTypePtr> evictedFromDisk = (*it)->diskCache.evict();
+            //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
+            //we'll let the user of these entries purge the extra entries left in the cache later on
+            while (evictedFromDisk.second) {
+                if (!_isTiled) {
+                    evictedFromDisk.second->removeAnyBackingFile();
+                }
+                evictedFromDisk = (*it)->diskCache.evict();
             }
-            evictedFromDisk = _diskCache.evict();
         }
 
 
@@ -1083,51 +1338,47 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-        std::pair<hash_type, EntryTypePtr> evictedFromMemory = _memoryCache.evict();
-        while (evictedFromMemory.second) {
-            // Move back the entry on disk if it can be store on disk
-            // For tiled caches, the tile is sharing the same file with other entries
-            // so we cannot close it, just remove the entry
-            if ( evictedFromMemory.second->isStoredOnDisk() && !_isTiled) {
-                evictedFromMemory.second->deallocate();
-                /*insert it back into the disk portion */
-
-                U64 diskCacheSize, maximumCacheSize;
-                {
-                    QMutexLocker k(&_sizeLock);
-                    diskCacheSize = _diskCacheSize;
-                    maximumCacheSize = _maximumCacheSize;
-                }
-
-                /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
-                while (diskCacheSize + evictedFromMemory.second->size() >= maximumCacheSize) {
-                    {
-                        std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
-                        //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
-                        //we'll let the user of these entries purge the extra entries left in the cache later on
-                        if (!evictedFromDisk.second) {
-                            break;
+        for (typename std::vector<CacheShardPtr>::const_iterator it = _shards.begin(); it != _shards.end(); ++it) {
+            CacheShard& shard = **it;
+            QMutexLocker locker(&shard.lock);
+            std::pair<hash_type, EntryTypePtr> evictedFromMemory = shard.memoryCache.evict();
+            while (evictedFromMemory.second) {
+                // Move back the entry on disk if it can be store on disk
+                // For tiled caches, the tile is sharing the same file with other entries
+                // so we cannot close it, just remove the entry
+                if ( evictedFromMemory.second->isStoredOnDisk() && !_isTiled) {
+                    evictedFromMemory.second->deallocate();
+                    /*insert it back into the disk portion */
+
+                    U64 diskCacheSize = _diskCacheSize;
+                    U64 maximumCacheSize = _maximumCacheSize;
+
+                    /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
+                    while (diskCacheSize + evictedFromMemory.second->size() >= maximumCacheSize) {
+                        {
+                            std::pair<hash_type, EntryTypePtr> evictedFromDisk = shard.diskCache.evict();
+                            //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
+                            //we'll let the user of these entries purge the extra entries left in the cache later on
+                            if (!evictedFromDisk.second) {
+                                break;
+                            }
+                            ///Erase the file from the disk if we reach the limit.
+                            evictedFromDisk.second->removeAnyBackingFile();
                         }
-                        ///Erase the file from the disk if we reach the limit.
-                        evictedFromDisk.second->removeAnyBackingFile();
-                    }
-                    {
-                        QMutexLocker k(&_sizeLock);
                         diskCacheSize = _diskCacheSize;
                         maximumCacheSize = _maximumCacheSize;
                     }
-                }
 
-                /*update the disk cache size*/
-                CacheIterator existingDiskCacheEntry = _diskCache( evictedFromMemory.second->getHashKey() );
-                /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
-                if ( existingDiskCacheEntry == _diskCache.end() ) {
-                    _diskCache.insert(evictedFromMemory.second->getHashKey(), evictedFromMemory.second);
+                    /*update the disk cache size*/
+                    CacheIterator existingDiskCacheEntry = shard.diskCache( evictedFromMemory.second->getHashKey() );
+                    /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
+                    if ( existingDiskCacheEntry == shard.diskCache.end() ) {
+                        shard.diskCache.insert(evictedFromMemory.second->getHashKey(), evictedFromMemory.second);
+                    }
                 }
-            }
 
-            evictedFromMemory = _memoryCache.evict();
+                evictedFromMemory = shard.memoryCache.evict();
+            }
         }
 
         _signalEmitter->blockSignals(false);
@@ -1142,52 +1393,8 @@ public:
         ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
         std::list<EntryTypePtr> entriesToBeDeleted;
 
-        {
-            QMutexLocker locker(&_lock);
-            U64 memoryCacheSize, maximumInMemorySize;
-            {
-                QMutexLocker k(&_sizeLock);
-                memoryCacheSize = _memoryCacheSize;
-                maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
-            }
-            double occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
-            while (occupationPercentage >= NATRON_CACHE_LIMIT_PERCENT) {
-                std::list<EntryTypePtr> deleted;
-                if ( !tryEvictInMemoryEntry(deleted) ) {
-                    break;
-                }
-
-                for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
-                    if ( !(*it)->isStoredOnDisk() ) {
-                        memoryCacheSize -= (*it)->size();
-                    }
-                    entriesToBeDeleted.push_back(*it);
-                }
-                occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
-            }
-
-            U64 diskCacheSize, maximumDiskCacheSize;
-            {
-                QMutexLocker k(&_sizeLock);
-                diskCacheSize = _diskCacheSize;
-                maximumDiskCacheSize = std::max( (std::size_t)1, _maximumCacheSize - _maximumInMemorySize );
-            }
-            double diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
-            while (diskPercentage >= NATRON_CACHE_LIMIT_PERCENT) {
-                std::list<EntryTypePtr> deleted;
-                if ( !tryEvictDiskEntry(deleted) ) {
-                    break;
-                }
-
-                for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
-                    diskCacheSize -= (*it)->size();
-                    entriesToBeDeleted.push_back(*it);
-                }
-                diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
-            }
-            
-
-        }
+        evictInMemoryEntriesDownTo(NATRON_CACHE_LIMIT_PERCENT, 0, entriesToBeDeleted);
+        evictDiskEntriesDownTo(NATRON_CACHE_LIMIT_PERCENT, 0, entriesToBeDeleted);
     }
 
     /**
@@ -1197,15 +1404,17 @@ public:
      **/
     void getCopy(std::list<EntryTypePtr>* copy) const
     {
-        QMutexLocker locker(&_lock);
+        for (typename std::vector<CacheShardPtr>::const_iterator it = _shards.begin(); it != _shards.end(); ++it) {
+            QMutexLocker locker(&(*it)->lock);
 
-        for (CacheIterator it = _memoryCache.begin(); it != _memoryCache.end(); ++it) {
-            const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
-            copy->insert( copy->end(), entries.begin(), entries.end() );
-        }
-        for (CacheIterator it = _diskCache.begin(); it != _diskCache.end(); ++it) {
-            const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
-            copy->insert( copy->end(), entries.begin(), entries.end() );
+            for (CacheIterator it2 = (*it)->memoryCache.begin(); it2 != (*it)->memoryCache.end(); ++it2) {
+                const std::list<EntryTypePtr> & entries = getValueFromIterator(it2);
+                copy->insert( copy->end(), entries.begin(), entries.end() );
+            }
+            for (CacheIterator it2 = (*it)->diskCache.begin(); it2 != (*it)->diskCache.end(); ++it2) {
+                const std::list<EntryTypePtr> & entries = getValueFromIterator(it2);
+                copy->insert( copy->end(), entries.begin(), entries.end() );
+            }
         }
     }
 
@@ -1213,19 +1422,16 @@ public:
      * @brief Removes the last recently used entry from the in-memory cache.
      * This is expensive since it takes the lock. Returns false
      * if there's nothing left to evict.
+     * When the cache is sharded, this evicts the LRU entry of the first shard visited
+     * that has something to evict.
      **/
     bool evictLRUInMemoryEntry() const
     {
         ///Make sure the shared_ptrs live in this list and are destroyed not while under the lock
         ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
         std::list<EntryTypePtr> entriesToBeDeleted;
-        bool ret;
-        {
-            QMutexLocker locker(&_lock);
-            ret = tryEvictInMemoryEntry(entriesToBeDeleted);
-        }
 
-        return ret;
+        return tryEvictInMemoryEntryFromAnyShard(0, entriesToBeDeleted);
     }
 
     /**
@@ -1235,10 +1441,9 @@ public:
      **/
     bool evictLRUDiskEntry() const
     {
-
-        QMutexLocker locker(&_lock);
         std::list<EntryTypePtr> entriesToBeDeleted;
-        return tryEvictDiskEntry(entriesToBeDeleted);
+
+        return tryEvictDiskEntryFromAnyShard(0, entriesToBeDeleted);
     }
 
     /**
@@ -1248,19 +1453,14 @@ public:
     virtual void notifyEntrySizeChanged(std::size_t oldSize,
                                         std::size_t newSize) const OVERRIDE FINAL
     {
-        ///The entry has notified it's memory layout has changed, it must have been due to an action from the cache
-        QMutexLocker k(&_sizeLock);
-
         ///This function can only be called for RAM buffers or while a memory mapped file is mapped into the RAM, so
         ///we just have to modify the RAM size.
 
         ///Avoid overflows, _memoryCacheSize may not always fallback to 0
-        qint64 diff = (qint64)newSize - (qint64)oldSize;
-
-        if (diff < 0) {
-            _memoryCacheSize = diff > (qint64)_memoryCacheSize ? 0 : _memoryCacheSize + diff;
+        if (newSize < oldSize) {
+            subtractSize(_memoryCacheSize, oldSize - newSize);
         } else {
-            _memoryCacheSize += diff;
+            _memoryCacheSize += newSize - oldSize;
         }
 #ifdef NATRON_DEBUG_CACHE
         qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
@@ -1274,10 +1474,8 @@ public:
                                       std::size_t size,
                                       StorageModeEnum storage) const OVERRIDE FINAL
     {
-        ///The entry has notified it's memory layout has changed, it must have been due to an action from the cache, hence the
-        ///lock should already be taken.
-        QMutexLocker k(&_sizeLock);
-
+        ///The entry has notified it's memory layout has changed, it must have been due to an action from the cache.
+        ///The sizes are atomic, no lock is needed.
         if (storage == eStorageModeDisk) {
             if (_isTiled) {
                 // For tile caches, we do not control which portion of the cache is in memory, so just keep track of the disk portion
@@ -1305,15 +1503,13 @@ public:
                                       std::size_t size,
                                       StorageModeEnum storage) const OVERRIDE FINAL
     {
-        QMutexLocker k(&_sizeLock);
-
         if (storage == eStorageModeRAM) {
-            _memoryCacheSize = size > _memoryCacheSize ? 0 : _memoryCacheSize - size;
+            subtractSize(_memoryCacheSize, size);
 #ifdef NATRON_DEBUG_CACHE
             qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
 #endif
         } else if (storage == eStorageModeDisk) {
-            _diskCacheSize = size > _diskCacheSize ? 0 : _diskCacheSize - size;
+            subtractSize(_diskCacheSize, size);
 #ifdef NATRON_DEBUG_CACHE
             qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
 #endif
@@ -1330,6 +1526,37 @@ public:
         _memoryFullCondition.wakeAll();
     }
 
+    /**
+     * @brief Called by the evictor thread: if the cache occupation is beyond the high watermark,
+     * evict least recently used entries until it is back under the low watermark.
+     **/
+    virtual void evictToLowWatermark() OVERRIDE FINAL
+    {
+        ///Before allocating the memory check that there's enough space to fit in memory
+        appPTR->checkCacheFreeMemoryIsGoodEnough();
+
+        double highWatermark, lowWatermark;
+        std::size_t maximumInMemorySize, maximumDiskCacheSize;
+        {
+            QMutexLocker k(&_sizeLock);
+            highWatermark = _evictionHighWatermark;
+            lowWatermark = _evictionLowWatermark;
+        }
+        maximumInMemorySize = std::max( (std::size_t)1, (std::size_t)_maximumInMemorySize );
+        maximumDiskCacheSize = std::max( (std::size_t)1, getMaximumDiskCacheSizeInternal() );
+
+        std::list<EntryTypePtr> entriesToBeDeleted;
+        if ( (double)_memoryCacheSize / maximumInMemorySize > highWatermark ) {
+            evictInMemoryEntriesDownTo(lowWatermark, 0, entriesToBeDeleted);
+        }
+        if ( _isTiled && ( (double)_diskCacheSize / maximumDiskCacheSize > highWatermark ) ) {
+            evictDiskEntriesDownTo(lowWatermark, 0, entriesToBeDeleted);
+        }
+        if ( !entriesToBeDeleted.empty() ) {
+            _deleterThread.appendToQueue(entriesToBeDeleted);
+        }
+    }
+
     /**
      * @brief To be called whenever an entry is deallocated from memory and put back on disk or whenever
      * it is reallocated in the RAM.
@@ -1344,12 +1571,11 @@ public:
         if (_tearingDown) {
             return;
         }
-        QMutexLocker k(&_sizeLock);
 
         assert(oldStorage != newStorage);
         assert(newStorage != eStorageModeNone);
         if (oldStorage == eStorageModeRAM) {
-            _memoryCacheSize = size > _memoryCacheSize ? 0 : _memoryCacheSize - size;
+            subtractSize(_memoryCacheSize, size);
             _diskCacheSize += size;
 #ifdef NATRON_DEBUG_CACHE
             qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
@@ -1359,7 +1585,7 @@ public:
             appPTR->decreaseNCacheFilesOpened();
         } else if (oldStorage == eStorageModeDisk) {
             _memoryCacheSize += size;
-            _diskCacheSize = size > _diskCacheSize ? 0 : _diskCacheSize - size;
+            subtractSize(_diskCacheSize, size);
 #ifdef NATRON_DEBUG_CACHE
             qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
             qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
@@ -1419,45 +1645,101 @@ public:
         return newCachePath.toStdString();
     }
 
+    /**
+     * @brief The binary table of contents of the cache, see CacheTOC
+     **/
+    std::string getRestoreTOCFilePath() const
+    {
+        QString newCachePath( getCachePath() );
+        Global::ensureLastPathSeparator(newCachePath);
+
+        newCachePath.append( QString::fromUtf8("restoreFile." NATRON_CACHE_TOC_FILE_EXT) );
+
+        return newCachePath.toStdString();
+    }
+
+    std::string getRestoreTOCHeapFilePath() const
+    {
+        QString newCachePath( getCachePath() );
+        Global::ensureLastPathSeparator(newCachePath);
+
+        newCachePath.append( QString::fromUtf8("restoreFile." NATRON_CACHE_TOC_HEAP_FILE_EXT) );
+
+        return newCachePath.toStdString();
+    }
+
     void setMaximumCacheSize(U64 newSize)
     {
         QMutexLocker k(&_sizeLock);
 
         _maximumCacheSize = newSize;
+        updateEvictionThresholds();
     }
 
     void setMaximumInMemorySize(double percentage)
     {
         QMutexLocker k(&_sizeLock);
 
-        _maximumInMemorySize = _maximumCacheSize * percentage;
+        _maximumInMemorySize = (std::size_t)(_maximumCacheSize * percentage);
+        updateEvictionThresholds();
     }
 
-    std::size_t getMaximumSize() const
+    /**
+     * @brief Set the occupation percentages (in [0,1]) beyond which the evictor thread starts evicting least recently used
+     * entries and under which it stops. The low watermark is clamped to the high watermark.
+     **/
+    void setEvictionWatermarks(double highWatermark,
+                               double lowWatermark)
     {
         QMutexLocker k(&_sizeLock);
 
-        return _maximumCacheSize;
+        _evictionHighWatermark = std::max( 0., std::min(highWatermark, 1.) );
+        _evictionLowWatermark = std::max( 0., std::min(lowWatermark, _evictionHighWatermark) );
+        updateEvictionThresholds();
     }
 
-    std::size_t getMaximumMemorySize() const
+    /**
+     * @brief When enabled, the entry evicted from the memory portion is, among the
+     * NATRON_CACHE_COST_AWARE_EVICTION_CANDIDATES least recently used entries, the one with the lowest
+     * GreedyDual-Size priority, so that entries that were expensive to render survive longer than cheap ones.
+     * When disabled, the least recently used entry is evicted.
+     **/
+    void setCostAwareEviction(bool enabled)
+    {
+        _costAwareEviction = enabled;
+    }
+
+    bool isCostAwareEvictionEnabled() const
+    {
+        return _costAwareEviction;
+    }
+
+    void getEvictionWatermarks(double* highWatermark,
+                               double* lowWatermark) const
     {
         QMutexLocker k(&_sizeLock);
 
+        *highWatermark = _evictionHighWatermark;
+        *lowWatermark = _evictionLowWatermark;
+    }
+
+    std::size_t getMaximumSize() const
+    {
+        return _maximumCacheSize;
+    }
+
+    std::size_t getMaximumMemorySize() const
+    {
         return _maximumInMemorySize;
     }
 
     std::size_t getMemoryCacheSize() const
     {
-        QMutexLocker k(&_sizeLock);
-
         return _memoryCacheSize;
     }
 
     std::size_t getDiskCacheSize() const
     {
-        QMutexLocker k(&_sizeLock);
-
         return _diskCacheSize;
     }
 
@@ -1478,9 +1760,10 @@ public:
         std::list<EntryTypePtr> toRemove;
 
         {
-            QMutexLocker l(&_lock);
-            CacheIterator existingEntry = _memoryCache( entry->getHashKey() );
-            if ( existingEntry != _memoryCache.end() ) {
+            CacheShard& shard = getShard( entry->getHashKey() );
+            QMutexLocker l(&shard.lock);
+            CacheIterator existingEntry = shard.memoryCache( entry->getHashKey() );
+            if ( existingEntry != shard.memoryCache.end() ) {
                 std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                     if ( (*it)->getKey() == entry->getKey() ) {
@@ -1490,11 +1773,11 @@ public:
                     }
                 }
                 if ( ret.empty() ) {
-                    _memoryCache.erase(existingEntry);
+                    shard.memoryCache.erase(existingEntry);
                 }
             } else {
-                existingEntry = _diskCache( entry->getHashKey() );
-                if ( existingEntry != _diskCache.end() ) {
+                existingEntry = shard.diskCache( entry->getHashKey() );
+                if ( existingEntry != shard.diskCache.end() ) {
                     std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                     for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                         if ( (*it)->getKey() == entry->getKey() ) {
@@ -1504,11 +1787,11 @@ public:
                         }
                     }
                     if ( ret.empty() ) {
-                        _diskCache.erase(existingEntry);
+                        shard.diskCache.erase(existingEntry);
                     }
                 }
             }
-        } // QMutexLocker l(&_lock);
+        } // QMutexLocker l(&shard.lock);
         if ( !toRemove.empty() ) {
             _deleterThread.appendToQueue(toRemove);
 
@@ -1522,25 +1805,26 @@ public:
     {
         std::list<EntryTypePtr> toRemove;
         {
-            QMutexLocker l(&_lock);
-            CacheIterator existingEntry = _memoryCache( hash);
-            if ( existingEntry != _memoryCache.end() ) {
+            CacheShard& shard = getShard(hash);
+            QMutexLocker l(&shard.lock);
+            CacheIterator existingEntry = shard.memoryCache( hash);
+            if ( existingEntry != shard.memoryCache.end() ) {
                 std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                     toRemove.push_back(*it);
                 }
-                _memoryCache.erase(existingEntry);
+                shard.memoryCache.erase(existingEntry);
             } else {
-                existingEntry = _diskCache( hash );
-                if ( existingEntry != _diskCache.end() ) {
+                existingEntry = shard.diskCache( hash );
+                if ( existingEntry != shard.diskCache.end() ) {
                     std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                     for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                         toRemove.push_back(*it);
                     }
-                    _diskCache.erase(existingEntry);
+                    shard.diskCache.erase(existingEntry);
                 }
             }
-        } // QMutexLocker l(&_lock);
+        } // QMutexLocker l(&shard.lock);
 
         if ( !toRemove.empty() ) {
             _deleterThread.appendToQueue(toRemove);
@@ -1562,10 +1846,10 @@ public:
 
         clearInMemoryPortion(false);
         s->cacheVersion = cacheVersion();
-        {
-            QMutexLocker l(&_lock);     // must be locked
+        for (typename std::vector<CacheShardPtr>::const_iterator itShard = _shards.begin(); itShard != _shards.end(); ++itShard) {
+            QMutexLocker l(&(*itShard)->lock);     // must be locked
 
-            for (CacheIterator it = _diskCache.begin(); it != _diskCache.end(); ++it) {
+            for (CacheIterator it = (*itShard)->diskCache.begin(); it != (*itShard)->diskCache.end(); ++it) {
                 std::list<EntryTypePtr> & listOfValues  = getValueFromIterator(it);
                 for (typename std::list<EntryTypePtr>::const_iterator it2 = listOfValues.begin(); it2 != listOfValues.end(); ++it2) {
                     if ( (*it2)->isStoredOnDisk() ) {
@@ -1647,8 +1931,9 @@ public:
             const std::string& filePath = value->getFilePath();
             usedFilePaths.insert(QString::fromUtf8(filePath.c_str()));
             {
-                QMutexLocker locker(&_lock);
-                sealEntry(EntryTypePtr(value), false /*inMemory*/);
+                CacheShard& shard = getShard( value->getHashKey() );
+                QMutexLocker locker(&shard.lock);
+                sealEntry(shard, EntryTypePtr(value), false /*inMemory*/);
             }
         }
 
@@ -1659,6 +1944,10 @@ public:
             QString absolutePath = cacheFolder.absolutePath();
             QStringList etr = cacheFolder.entryList(QDir::NoDotAndDotDot);
             for (QStringList::iterator it = etr.begin(); it!=etr.end(); ++it) {
+                // Do not remove the table of contents itself
+                if ( it->startsWith( QString::fromUtf8("restoreFile.") ) ) {
+                    continue;
+                }
                 QString entryFilePath = absolutePath + QLatin1Char('/') + *it;
 
                 std::set<QString>::iterator foundUsed = usedFilePaths.find(entryFilePath);
@@ -1710,34 +1999,35 @@ public:
 
     void getMemoryStats(std::map<std::string, CacheEntryReportInfo>* infos) const
     {
+        for (typename std::vector<CacheShardPtr>::const_iterator itShard = _shards.begin(); itShard != _shards.end(); ++itShard) {
+            QMutexLocker locker(&(*itShard)->lock);
 
-        QMutexLocker locker(&_lock);
+            for (CacheIterator memIt = (*itShard)->memoryCache.begin(); memIt != (*itShard)->memoryCache.end(); ++memIt) {
+                std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
+                if ( !entries.empty() ) {
+                    const EntryTypePtr & front = entries.front();
 
-        for (CacheIterator memIt = _memoryCache.begin(); memIt != _memoryCache.end(); ++memIt) {
-            std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
-            if ( !entries.empty() ) {
-                const EntryTypePtr & front = entries.front();
+                    std::string plugID = front->getKey().getHolderPluginID();
+                    CacheEntryReportInfo& entryData = (*infos)[plugID];
+                    for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                        entryData.ramBytes += (*it)->size();
+                    }
 
-                std::string plugID = front->getKey().getHolderPluginID();
-                CacheEntryReportInfo& entryData = (*infos)[plugID];
-                for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
-                    entryData.ramBytes += (*it)->size();
                 }
-
             }
-        }
 
-        for (CacheIterator memIt = _diskCache.begin(); memIt != _diskCache.end(); ++memIt) {
-            std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
-            if ( !entries.empty() ) {
-                const EntryTypePtr & front = entries.front();
+            for (CacheIterator memIt = (*itShard)->diskCache.begin(); memIt != (*itShard)->diskCache.end(); ++memIt) {
+                std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
+                if ( !entries.empty() ) {
+                    const EntryTypePtr & front = entries.front();
 
-                std::string plugID = front->getKey().getHolderPluginID();
-                CacheEntryReportInfo& entryData = (*infos)[plugID];
-                for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
-                    entryData.diskBytes += (*it)->size();
+                    std::string plugID = front->getKey().getHolderPluginID();
+                    CacheEntryReportInfo& entryData = (*infos)[plugID];
+                    for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                        entryData.diskBytes += (*it)->size();
+                    }
+                    
                 }
-                
             }
         }
     }
@@ -1745,14 +2035,26 @@ public:
 
 private:
 
+    /**
+     * @brief Decrements the given size without ever going below 0: the sizes reported
+     * by the entries may not always exactly fallback to 0.
+     **/
+    static void subtractSize(boost::atomic<std::size_t>& value, std::size_t size)
+    {
+        std::size_t cur = value.load(boost::memory_order_relaxed);
+        while ( !value.compare_exchange_weak(cur, size > cur ? 0 : cur - size, boost::memory_order_relaxed) ) {
+        }
+    }
+
     virtual void removeAllEntriesForPluginPrivate(const std::string& pluginID, std::list<AbstractCacheEntryBasePtr> *removedEntriesList = 0) OVERRIDE FINAL
     {
         std::list<EntryTypePtr> toDelete;
-        CacheContainer newMemCache, newDiskCache;
-        {
-            QMutexLocker locker(&_lock);
+        for (typename std::vector<CacheShardPtr>::const_iterator itShard = _shards.begin(); itShard != _shards.end(); ++itShard) {
+            CacheShard& shard = **itShard;
+            CacheContainer newMemCache, newDiskCache;
+            QMutexLocker locker(&shard.lock);
 
-            for (CacheIterator memIt = _memoryCache.begin(); memIt != _memoryCache.end(); ++memIt) {
+            for (CacheIterator memIt = shard.memoryCache.begin(); memIt != shard.memoryCache.end(); ++memIt) {
                 std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
                 if ( !entries.empty() ) {
                     const EntryTypePtr & front = entries.front();
@@ -1768,7 +2070,7 @@ private:
                 }
             }
 
-            for (CacheIterator dIt = _diskCache.begin(); dIt != _diskCache.end(); ++dIt) {
+            for (CacheIterator dIt = shard.diskCache.begin(); dIt != shard.diskCache.end(); ++dIt) {
                 std::list<EntryTypePtr> & entries = getValueFromIterator(dIt);
                 if ( !entries.empty() ) {
                     const EntryTypePtr & front = entries.front();
@@ -1784,9 +2086,9 @@ private:
                 }
             }
 
-            _memoryCache = newMemCache;
-            _diskCache = newDiskCache;
-        } // QMutexLocker locker(&_lock);
+            shard.memoryCache = newMemCache;
+            shard.diskCache = newDiskCache;
+        } // for all shards
 
         if ( !toDelete.empty() ) {
             if (removedEntriesList) {
@@ -1803,21 +2105,23 @@ private:
         }
     } // removeAllEntriesWithDifferentNodeHashForHolderPrivate
 
-    bool getInternal(const typename EntryType::key_type & key,
+    bool getInternal(CacheShard& shard,
+                     const typename EntryType::key_type & key,
                      std::list<EntryTypePtr>* returnValue) const
     {
         ///Private should be locked
-        assert( !_lock.tryLock() );
+        assert( !shard.lock.tryLock() );
 
         ///find a matching value in the internal memory container
-        CacheIterator memoryCached = _memoryCache( key.getHash() );
+        CacheIterator memoryCached = shard.memoryCache( key.getHash() );
 
-        if ( memoryCached != _memoryCache.end() ) {
+        if ( memoryCached != shard.memoryCache.end() ) {
             ///we found something with a matching hash key. There may be several entries linked to
             ///this key, we need to find one with matching params
             std::list<EntryTypePtr> & ret = getValueFromIterator(memoryCached);
             for (typename std::list<EntryTypePtr>::const_iterator it = ret.begin(); it != ret.end(); ++it) {
                 if ( (*it)->getKey() == key ) {
+                    (*it)->setEvictionPriorityBase(shard.evictionInflation);
                     returnValue->push_back(*it);
 
                     ///Q_EMIT te added signal otherwise when first reading something that's already cached
@@ -1831,9 +2135,9 @@ private:
             return returnValue->size() > 0;
         } else {
             ///fallback on the disk cache internal container
-            CacheIterator diskCached = _diskCache( key.getHash() );
+            CacheIterator diskCached = shard.diskCache( key.getHash() );
 
-            if ( diskCached == _diskCache.end() ) {
+            if ( diskCached == shard.diskCache.end() ) {
                 /*the entry was neither in memory or disk, just allocate a new one*/
                 return false;
             } else {
@@ -1865,31 +2169,26 @@ private:
                             }
 
                             //put it back into the RAM
-                            _memoryCache.insert( (*it)->getHashKey(), *it );
+                            shard.memoryCache.insert( (*it)->getHashKey(), *it );
 
 
-                            U64 memoryCacheSize, maximumInMemorySize;
-                            {
-                                QMutexLocker k(&_sizeLock);
-                                memoryCacheSize = _memoryCacheSize;
-                                maximumInMemorySize = _maximumInMemorySize;
-                            }
+                            U64 memoryCacheSize = _memoryCacheSize;
+                            U64 maximumInMemorySize = _maximumInMemorySize;
                             std::list<EntryTypePtr> entriesToBeDeleted;
 
                             //now clear extra entries from the disk cache so it doesn't exceed the RAM limit.
+                            //Only the shard we hold the lock for can be evicted here.
                             while (memoryCacheSize > maximumInMemorySize) {
-                                if ( !tryEvictInMemoryEntry(entriesToBeDeleted) ) {
+                                if ( !tryEvictInMemoryEntry(shard, entriesToBeDeleted) ) {
                                     break;
                                 }
 
-                                {
-                                    QMutexLocker k(&_sizeLock);
-                                    memoryCacheSize = _memoryCacheSize;
-                                    maximumInMemorySize = _maximumInMemorySize;
-                                }
+                                memoryCacheSize = _memoryCacheSize;
+                                maximumInMemorySize = _maximumInMemorySize;
                             }
                         }
                         
+                        (*it)->setEvictionPriorityBase(shard.evictionInflation);
                         returnValue->push_back(*it);
                         ///Q_EMIT te added signal otherwise when first reading something that's already cached
                         ///the timeline wouldn't update
@@ -1902,7 +2201,7 @@ private:
                             ret.erase(it);
 
                             ///Remove it from the disk cache
-                            _diskCache.erase(diskCached);
+                            shard.diskCache.erase(diskCached);
                         }
 
                         return true;
@@ -1919,25 +2218,27 @@ private:
     /** @brief Inserts into the cache an entry that was previously allocated by the createInternal()
      * function. This is called directly by createInternal() if the allocation was successful
      **/
-    void sealEntry(const EntryTypePtr & entry,
+    void sealEntry(CacheShard& shard,
+                   const EntryTypePtr & entry,
                    bool inMemory) const
     {
-        assert( !_lock.tryLock() );   // must be locked
+        assert( !shard.lock.tryLock() );   // must be locked
         typename EntryType::hash_type hash = entry->getHashKey();
 
+        entry->setEvictionPriorityBase(shard.evictionInflation);
         if (inMemory) {
             /*if the entry doesn't exist on the memory cache,make a new list and insert it*/
-            CacheIterator existingEntry = _memoryCache(hash);
-            if ( existingEntry == _memoryCache.end() ) {
-                _memoryCache.insert(hash, entry);
+            CacheIterator existingEntry = shard.memoryCache(hash);
+            if ( existingEntry == shard.memoryCache.end() ) {
+                shard.memoryCache.insert(hash, entry);
             } else {
                 /*append to the existing list*/
                 getValueFromIterator(existingEntry).push_back(entry);
             }
         } else {
-            CacheIterator existingEntry = _diskCache(hash);
-            if ( existingEntry == _diskCache.end() ) {
-                _diskCache.insert(hash, entry);
+            CacheIterator existingEntry = shard.diskCache(hash);
+            if ( existingEntry == shard.diskCache.end() ) {
+                shard.diskCache.insert(hash, entry);
             } else {
                 /*append to the existing list*/
                 getValueFromIterator(existingEntry).push_back(entry);
@@ -1945,10 +2246,21 @@ private:
         }
     }
 
-    bool tryEvictInMemoryEntry(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    bool tryEvictInMemoryEntry(CacheShard& shard,
+                               std::list<EntryTypePtr> & entriesToBeDeleted) const
     {
-        assert( !_lock.tryLock() );
-        std::pair<hash_type, EntryTypePtr> evicted = _memoryCache.evict();
+        assert( !shard.lock.tryLock() );
+        std::pair<hash_type, EntryTypePtr> evicted;
+        if (_costAwareEviction) {
+            GreedyDualSizePriority priority;
+            evicted = shard.memoryCache.evictLowestPriority(priority, NATRON_CACHE_COST_AWARE_EVICTION_CANDIDATES);
+            if (evicted.second) {
+                // Age all remaining entries of the shard by inflating L to the priority of the evicted entry
+                shard.evictionInflation = std::max( shard.evictionInflation, priority(evicted.second) );
+            }
+        } else {
+            evicted = shard.memoryCache.evict();
+        }
         //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
         //we'll let the user of these entries purge the extra entries left in the cache later on
         if (!evicted.second) {
@@ -1969,17 +2281,12 @@ private:
 
             /*insert it back into the disk portion */
 
-            U64 diskCacheSize, maximumCacheSize, maximumInMemorySize;
-            {
-                QMutexLocker k(&_sizeLock);
-                diskCacheSize = _diskCacheSize;
-                maximumInMemorySize = _maximumInMemorySize;
-                maximumCacheSize = _maximumCacheSize;
-            }
+            U64 diskCacheSize = _diskCacheSize;
+            U64 maximumDiskCacheSize = getMaximumDiskCacheSizeInternal();
 
             /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
-            while ( ( diskCacheSize  + evicted.second->size() ) >= (maximumCacheSize - maximumInMemorySize) ) {
-                std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
+            while ( ( diskCacheSize  + evicted.second->size() ) >= maximumDiskCacheSize ) {
+                std::pair<hash_type, EntryTypePtr> evictedFromDisk = shard.diskCache.evict();
                 //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
                 //we'll let the user of these entries purge the extra entries left in the cache later on
                 if (!evictedFromDisk.second) {
@@ -1991,11 +2298,7 @@ private:
 
                 entriesToBeDeleted.push_back(evictedFromDisk.second);
 
-                {
-                    QMutexLocker k(&_sizeLock);
-                    maximumInMemorySize = _maximumInMemorySize;
-                    maximumCacheSize = _maximumCacheSize;
-                }
+                maximumDiskCacheSize = getMaximumDiskCacheSizeInternal();
 
                 //The entry is not yet deleted for real since it's done in a separate thread when this function
                 ///size() will return 0 at this point, we have to recompute it
@@ -2003,10 +2306,10 @@ private:
                 diskCacheSize -= fsize;
             }
 
-            CacheIterator existingDiskCacheEntry = _diskCache(evicted.first);
+            CacheIterator existingDiskCacheEntry = shard.diskCache(evicted.first);
             /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
-            if ( existingDiskCacheEntry == _diskCache.end() ) {
-                _diskCache.insert(evicted.first, evicted.second);
+            if ( existingDiskCacheEntry == shard.diskCache.end() ) {
+                shard.diskCache.insert(evicted.first, evicted.second);
             } else {   /*append to the existing list*/
                 getValueFromIterator(existingDiskCacheEntry).push_back(evicted.second);
             }
@@ -2015,11 +2318,12 @@ private:
         return true;
     } // tryEvictEntry
 
-    bool tryEvictDiskEntry(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    bool tryEvictDiskEntry(CacheShard& shard,
+                           std::list<EntryTypePtr> & entriesToBeDeleted) const
     {
 
-        assert( !_lock.tryLock() );
-        std::pair<hash_type, EntryTypePtr> evicted = _diskCache.evict();
+        assert( !shard.lock.tryLock() );
+        std::pair<hash_type, EntryTypePtr> evicted = shard.diskCache.evict();
         //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
         //we'll let the user of these entries purge the extra entries left in the cache later on
         if (!evicted.second) {
@@ -2033,6 +2337,118 @@ private:
         return true;
     }
 
+    /**
+     * @brief Evicts the LRU entry of the in-memory portion of preferredShard (if not NULL).
+     * If it has nothing left to evict, the other shards are visited in a round-robin fashion
+     * until one of them can evict an entry.
+     * No shard lock must be held by the caller: at most one shard is locked at a time.
+     * Returns false if there's nothing left to evict in any shard.
+     **/
+    bool tryEvictInMemoryEntryFromAnyShard(CacheShard* preferredShard,
+                                           std::list<EntryTypePtr> & entriesToBeDeleted) const
+    {
+        if (preferredShard) {
+            QMutexLocker locker(&preferredShard->lock);
+            if ( tryEvictInMemoryEntry(*preferredShard, entriesToBeDeleted) ) {
+                return true;
+            }
+        }
+        unsigned int nShards = (unsigned int)_shards.size();
+        unsigned int firstShard = (unsigned int)_nextEvictionShard.fetchAndAddRelaxed(1);
+        for (unsigned int i = 0; i < nShards; ++i) {
+            CacheShard& shard = *_shards[(firstShard + i) % nShards];
+            if (&shard == preferredShard) {
+                continue;
+            }
+            QMutexLocker locker(&shard.lock);
+            if ( tryEvictInMemoryEntry(shard, entriesToBeDeleted) ) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Same as tryEvictInMemoryEntryFromAnyShard() but for the disk portion of the cache.
+     **/
+    bool tryEvictDiskEntryFromAnyShard(CacheShard* preferredShard,
+                                       std::list<EntryTypePtr> & entriesToBeDeleted) const
+    {
+        if (preferredShard) {
+            QMutexLocker locker(&preferredShard->lock);
+            if ( tryEvictDiskEntry(*preferredShard, entriesToBeDeleted) ) {
+                return true;
+            }
+        }
+        unsigned int nShards = (unsigned int)_shards.size();
+        unsigned int firstShard = (unsigned int)_nextEvictionShard.fetchAndAddRelaxed(1);
+        for (unsigned int i = 0; i < nShards; ++i) {
+            CacheShard& shard = *_shards[(firstShard + i) % nShards];
+            if (&shard == preferredShard) {
+                continue;
+            }
+            QMutexLocker locker(&shard.lock);
+            if ( tryEvictDiskEntry(shard, entriesToBeDeleted) ) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Evicts least recently used entries from the in-memory portion of the cache until its occupation
+     * is at most targetPercent of the maximum in-memory size. Evicted entries are appended to entriesToBeDeleted.
+     **/
+    void evictInMemoryEntriesDownTo(double targetPercent,
+                                    CacheShard* preferredShard,
+                                    std::list<EntryTypePtr> & entriesToBeDeleted) const
+    {
+        std::size_t maximumInMemorySize = std::max( (std::size_t)1, (std::size_t)_maximumInMemorySize );
+
+        // Entries that are not backed by a file only release their memory once the deleter thread
+        // destroyed them: account for them so that we do not evict more than needed
+        std::size_t pendingDeletionSize = 0;
+        std::size_t memoryCacheSize = _memoryCacheSize;
+        while ( (double)memoryCacheSize / maximumInMemorySize > targetPercent ) {
+            std::list<EntryTypePtr> deleted;
+            if ( !tryEvictInMemoryEntryFromAnyShard(preferredShard, deleted) ) {
+                break;
+            }
+            for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
+                if ( !(*it)->isStoredOnDisk() ) {
+                    pendingDeletionSize += (*it)->size();
+                }
+                entriesToBeDeleted.push_back(*it);
+            }
+            memoryCacheSize = _memoryCacheSize;
+            memoryCacheSize = pendingDeletionSize > memoryCacheSize ? 0 : memoryCacheSize - pendingDeletionSize;
+        }
+    }
+
+    /**
+     * @brief Same as evictInMemoryEntriesDownTo() but for the disk portion of the cache.
+     **/
+    void evictDiskEntriesDownTo(double targetPercent,
+                                CacheShard* preferredShard,
+                                std::list<EntryTypePtr> & entriesToBeDeleted) const
+    {
+        std::size_t diskCacheSize = _diskCacheSize;
+        std::size_t maximumDiskCacheSize = std::max( (std::size_t)1, getMaximumDiskCacheSizeInternal() );
+        while ( (double)diskCacheSize / maximumDiskCacheSize > targetPercent ) {
+            std::list<EntryTypePtr> deleted;
+            if ( !tryEvictDiskEntryFromAnyShard(preferredShard, deleted) ) {
+                break;
+            }
+            for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
+                std::size_t entrySize = (*it)->size();
+                diskCacheSize = entrySize > diskCacheSize ? 0 : diskCacheSize - entrySize;
+                entriesToBeDeleted.push_back(*it);
+            }
+        }
+    }
+
 };
 
 typedef Cache<Image> ImageCache;
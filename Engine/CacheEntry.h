@@ -30,6 +30,7 @@
 #include <iostream>
 #include <cassert>
 #include <cstdio> // for std::remove
+#include <algorithm> // for std::min
 #include <cstring> // for std::memcpy
 #include <stdexcept>
 #include <vector>
@@ -52,6 +53,7 @@
 #include "Engine/Hash64.h"
 #include "Engine/MemoryFile.h"
 #include "Engine/NonKeyParams.h"
+#include "Engine/RamBufferPool.h"
 #include "Engine/Texture.h"
 #include <SequenceParsing.h> // for removePath
 #include "Engine/EngineFwd.h"
@@ -103,18 +105,12 @@ public:
         if (size == 0) {
             return;
         }
-        count = size;
         if (data) {
-            free(data);
+            RamBufferPool::getInstance()->deallocate( data, count * sizeof(T) );
             data = 0;
         }
-        if (count == 0) {
-            return;
-        }
-        data = (T*)malloc( size * sizeof(T) );
-        if (!data) {
-            throw std::bad_alloc();
-        }
+        count = size;
+        data = (T*)RamBufferPool::getInstance()->allocate( size * sizeof(T) );
     }
 
     void resizeAndPreserve(U64 size)
@@ -122,42 +118,195 @@ public:
         if (size == 0 || size == count) {
             return;
         }
-        count = size;
-        data = (T*)realloc(data,size * sizeof(T));
-        if (!data) {
-            throw std::bad_alloc();
+        if ( data && ( RamBufferPool::getCapacity(size * sizeof(T)) == RamBufferPool::getCapacity(count * sizeof(T)) ) ) {
+            // Same size class, the buffer is already big enough
+            count = size;
+
+            return;
         }
+        T* newData = (T*)RamBufferPool::getInstance()->allocate( size * sizeof(T) );
+        if (data) {
+            std::memcpy( newData, data, std::min(size, count) * sizeof(T) );
+            RamBufferPool::getInstance()->deallocate( data, count * sizeof(T) );
+        }
+        data = newData;
+        count = size;
     }
 
     void clear()
     {
-        count = 0;
         if (data) {
-            free(data);
+            RamBufferPool::getInstance()->deallocate( data, count * sizeof(T) );
             data = 0;
         }
+        count = 0;
     }
 
     ~RamBuffer()
     {
-        if (data) {
-            free(data);
-            data = 0;
+        clear();
+    }
+};
+
+/**
+ * @brief A fixed size bitset where each bit represents a tile of a tile cache file.
+ * A bit set to 1 means that the tile is used by a cache entry.
+ * A second level bitset has one bit per 64-tiles word of the first level which is set when all
+ * the tiles of that word are used, so that finding a free tile only has to look at a few words
+ * instead of scanning every tile of the file.
+ **/
+class TileBitmap
+{
+    // 1 bit per tile
+    std::vector<U64> _words;
+
+    // 1 bit per word of _words, set when the word is full
+    std::vector<U64> _fullWords;
+    std::size_t _nTiles;
+    std::size_t _nUsedTiles;
+
+public:
+
+    TileBitmap()
+        : _words()
+        , _fullWords()
+        , _nTiles(0)
+        , _nUsedTiles(0)
+    {
+    }
+
+    /**
+     * @brief Resize the bitset to hold nTiles, all of them free.
+     **/
+    void resize(std::size_t nTiles)
+    {
+        _nTiles = nTiles;
+        _nUsedTiles = 0;
+        _words.clear();
+        _words.resize( (nTiles + 63) / 64, 0 );
+        _fullWords.clear();
+        _fullWords.resize( (_words.size() + 63) / 64, 0 );
+
+        // Bits past the last tile are marked used so they are never returned by findFirstFree()
+        std::size_t nPaddingBits = _words.size() * 64 - nTiles;
+        if (nPaddingBits > 0) {
+            _words.back() = ~( (U64)-1 >> nPaddingBits );
+        }
+
+        // Words past the last word are marked full
+        std::size_t nPaddingWords = _fullWords.size() * 64 - _words.size();
+        if (nPaddingWords > 0) {
+            _fullWords.back() = ~( (U64)-1 >> nPaddingWords );
+        }
+    }
+
+    std::size_t size() const
+    {
+        return _nTiles;
+    }
+
+    std::size_t getNumUsedTiles() const
+    {
+        return _nUsedTiles;
+    }
+
+    bool isFull() const
+    {
+        return _nUsedTiles == _nTiles;
+    }
+
+    bool isUsed(std::size_t index) const
+    {
+        assert(index < _nTiles);
+
+        return (_words[index / 64] >> (index % 64) ) & 1;
+    }
+
+    void setUsed(std::size_t index,
+                 bool used)
+    {
+        assert(index < _nTiles);
+        std::size_t wordIndex = index / 64;
+        U64 bit = (U64)1 << (index % 64);
+        U64& word = _words[wordIndex];
+        U64 fullBit = (U64)1 << (wordIndex % 64);
+        if (used) {
+            assert( !(word & bit) );
+            word |= bit;
+            ++_nUsedTiles;
+            if ( word == (U64)-1 ) {
+                _fullWords[wordIndex / 64] |= fullBit;
+            }
+        } else {
+            assert(word & bit);
+            word &= ~bit;
+            --_nUsedTiles;
+            _fullWords[wordIndex / 64] &= ~fullBit;
+        }
+    }
+
+    /**
+     * @brief Returns the index of the first free tile, or -1 if all tiles are used.
+     **/
+    int findFirstFree() const
+    {
+        for (std::size_t i = 0; i < _fullWords.size(); ++i) {
+            if (_fullWords[i] == (U64)-1) {
+                continue;
+            }
+            std::size_t wordIndex = i * 64 + findFirstZeroBit(_fullWords[i]);
+            assert( wordIndex < _words.size() );
+
+            return (int)(wordIndex * 64 + findFirstZeroBit(_words[wordIndex]));
+        }
+
+        return -1;
+    }
+
+private:
+
+    static int findFirstZeroBit(U64 word)
+    {
+        assert( word != (U64)-1 );
+#if defined(__GNUC__)
+        return __builtin_ctzll(~word);
+#else
+        int i = 0;
+        while (word & 1) {
+            word >>= 1;
+            ++i;
         }
+
+        return i;
+#endif
     }
 };
 
 // This is a cache file with a fixed size that is a multiple of the tileByteSize.
 // A bitset represents the allocated tiles in the file.
-// A value of true means that a tile is used by a cache entry.
 struct TileCacheFile
 {
     boost::shared_ptr<MemoryFile> file;
-    std::vector<bool> usedTiles;
+    TileBitmap usedTiles;
 };
 
 typedef boost::shared_ptr<TileCacheFile> TileCacheFilePtr;
 
+// A tile allocated in a tile cache file, see CacheAPI::allocTiles
+struct AllocatedTile
+{
+    TileCacheFilePtr file;
+
+    // Offset in bytes of the tile from the start of the data of the file
+    std::size_t dataOffset;
+
+    AllocatedTile()
+        : file()
+        , dataOffset(0)
+    {
+    }
+};
+
 class AbstractCacheEntryBase : boost::noncopyable
 {
 public:
@@ -248,6 +397,12 @@ public:
      **/
     virtual void removeAllEntriesForPluginPrivate(const std::string& pluginID, std::list<AbstractCacheEntryBasePtr> *removedEntriesList = 0) = 0;
 
+    /**
+     * @brief Called by the evictor thread of the cache: evicts least recently used entries
+     * if the occupation of the cache is beyond its high watermark, until it is under its low watermark.
+     **/
+    virtual void evictToLowWatermark() = 0;
+
     /**
      * @brief Relevant only for tiled caches. This will allocate the memory required for a tile in the cache and lock it.
      * Note that the calling entry should have exactly the size of a tile in the cache.
@@ -259,7 +414,8 @@ public:
     virtual TileCacheFilePtr allocTile(std::size_t *dataOffset) = 0;
 
     /**
-     * @brief Return a pointer to the tile cache file from its filepath
+     * @brief Return a pointer to the tile cache file from its filepath and mark the tile at dataOffset as used.
+     * Returns NULL if the file does not exist or if the tile is already used by another entry.
      **/
     virtual TileCacheFilePtr getTileCacheFile(const std::string& filepath,std::size_t dataOffset) = 0;
 
@@ -268,6 +424,17 @@ public:
      **/
     virtual void freeTile(const TileCacheFilePtr& file, std::size_t dataOffset) = 0;
 
+    /**
+     * @brief Same as allocTile() but allocates nTiles at once, taking the lock only once.
+     * The allocated tiles are appended to the tiles list.
+     **/
+    virtual void allocTiles(std::size_t nTiles, std::vector<AllocatedTile>* tiles) = 0;
+
+    /**
+     * @brief Same as freeTile() for all the given tiles, taking the lock only once.
+     **/
+    virtual void freeTiles(const std::vector<AllocatedTile>& tiles) = 0;
+
 #ifdef DEBUG
     static bool checkFileNameMatchesHash(const std::string &originalFileName,
                                          U64 hash)
@@ -571,7 +738,7 @@ public:
         if (isTileCache) {
             _cacheFile = entry->getTileCacheFile(path, dataOffset);
             if (!_cacheFile) {
-                throw std::runtime_error("Unexisting file " + path);
+                throw std::runtime_error("Unexisting file or tile already in use " + path);
             }
             _cacheFileDataOffset = dataOffset;
         }
@@ -779,6 +946,9 @@ public:
         , _cache()
         , _entryLock(QReadWriteLock::Recursive)
         , _removeBackingFileBeforeDestruction(false)
+        , _renderCostLock()
+        , _renderCost(0.)
+        , _evictionPriorityBase(0.)
     {
     }
 
@@ -797,6 +967,9 @@ public:
         , _cache(cache)
         , _entryLock(QReadWriteLock::Recursive)
         , _removeBackingFileBeforeDestruction(false)
+        , _renderCostLock()
+        , _renderCost(0.)
+        , _evictionPriorityBase(0.)
     {
     }
 
@@ -1100,6 +1273,42 @@ public:
         return getElementsCountFromParams() * sizeof(DataType);
     }
 
+    /**
+     * @brief Accumulates the time (in seconds) spent rendering the content of this entry.
+     * An entry may be rendered by several threads at once (one per tile), hence this is thread-safe.
+     * This is used by the cost-aware eviction policy of the cache.
+     **/
+    void addRenderCost(double seconds)
+    {
+        QMutexLocker k(&_renderCostLock);
+
+        _renderCost += seconds;
+    }
+
+    /**
+     * @brief Returns the time (in seconds) spent rendering the content of this entry
+     **/
+    double getRenderCost() const
+    {
+        QMutexLocker k(&_renderCostLock);
+
+        return _renderCost;
+    }
+
+    /**
+     * @brief The cache inflation value when this entry was last accessed, used by the cost-aware eviction
+     * policy of the cache (see GreedyDualSizePriority). This is protected by the lock of the cache.
+     **/
+    double getEvictionPriorityBase() const
+    {
+        return _evictionPriorityBase;
+    }
+
+    void setEvictionPriorityBase(double base)
+    {
+        _evictionPriorityBase = base;
+    }
+
     virtual U64 getElementsCountFromParams() const OVERRIDE FINAL WARN_UNUSED_RETURN
     {
         const CacheEntryStorageInfo& info = _params->getStorageInfo();
@@ -1256,6 +1465,13 @@ protected:
     const CacheAPI* _cache;
     mutable QReadWriteLock _entryLock;
     bool _removeBackingFileBeforeDestruction;
+
+    // Time spent rendering this entry, in seconds
+    mutable QMutex _renderCostLock;
+    double _renderCost;
+
+    // Protected by the cache lock
+    double _evictionPriorityBase;
 };
 
 NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,513 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "CacheTOC.h"
+
+#include <algorithm>
+#include <cassert>
+
+// Number of records allocated when creating a new TOC
+#define CACHE_TOC_INITIAL_RECORDS 1024
+
+// Minimum number of bytes by which the heap file grows
+#define CACHE_TOC_HEAP_MIN_GROWTH 65536
+
+NATRON_NAMESPACE_ENTER;
+
+static void
+writeRectI(const SERIALIZATION_NAMESPACE::RectISerialization& r,
+           CacheTOCWriter* w)
+{
+    w->writePOD<int>(r.x1);
+    w->writePOD<int>(r.y1);
+    w->writePOD<int>(r.x2);
+    w->writePOD<int>(r.y2);
+}
+
+static void
+readRectI(CacheTOCReader* r,
+          SERIALIZATION_NAMESPACE::RectISerialization* rect)
+{
+    rect->x1 = r->readPOD<int>();
+    rect->y1 = r->readPOD<int>();
+    rect->x2 = r->readPOD<int>();
+    rect->y2 = r->readPOD<int>();
+}
+
+static void
+writeRectD(const SERIALIZATION_NAMESPACE::RectDSerialization& r,
+           CacheTOCWriter* w)
+{
+    w->writePOD<double>(r.x1);
+    w->writePOD<double>(r.y1);
+    w->writePOD<double>(r.x2);
+    w->writePOD<double>(r.y2);
+}
+
+static void
+readRectD(CacheTOCReader* r,
+          SERIALIZATION_NAMESPACE::RectDSerialization* rect)
+{
+    rect->x1 = r->readPOD<double>();
+    rect->y1 = r->readPOD<double>();
+    rect->x2 = r->readPOD<double>();
+    rect->y2 = r->readPOD<double>();
+}
+
+static void
+writeNonKeyParams(const SERIALIZATION_NAMESPACE::NonKeyParamsSerialization& s,
+                  CacheTOCWriter* w)
+{
+    w->writePOD<U64>(s.dataTypeSize);
+    w->writePOD<int>(s.nComps);
+    writeRectI(s.bounds, w);
+}
+
+static void
+readNonKeyParams(CacheTOCReader* r,
+                 SERIALIZATION_NAMESPACE::NonKeyParamsSerialization* s)
+{
+    s->dataTypeSize = (std::size_t)r->readPOD<U64>();
+    s->nComps = r->readPOD<int>();
+    readRectI(r, &s->bounds);
+}
+
+void
+writeCacheTOCBlob(const SERIALIZATION_NAMESPACE::ImageKeySerialization& s,
+                  CacheTOCWriter* w)
+{
+    w->writePOD<U64>(s.nodeHashKey);
+    w->writePOD<double>(s.time);
+    w->writePOD<int>(s.view);
+    w->writePOD<char>(s.draft);
+}
+
+void
+readCacheTOCBlob(CacheTOCReader* r,
+                 SERIALIZATION_NAMESPACE::ImageKeySerialization* s)
+{
+    s->nodeHashKey = r->readPOD<U64>();
+    s->time = r->readPOD<double>();
+    s->view = r->readPOD<int>();
+    s->draft = (bool)r->readPOD<char>();
+}
+
+void
+writeCacheTOCBlob(const SERIALIZATION_NAMESPACE::ImageParamsSerialization& s,
+                  CacheTOCWriter* w)
+{
+    writeNonKeyParams(s, w);
+    writeRectD(s.rod, w);
+    w->writePOD<double>(s.par);
+    w->writeString(s.components.layerName);
+    w->writeString(s.components.globalCompsName);
+    w->writePOD<U32>( (U32)s.components.channelNames.size() );
+    for (std::size_t i = 0; i < s.components.channelNames.size(); ++i) {
+        w->writeString(s.components.channelNames[i]);
+    }
+    w->writePOD<int>(s.bitdepth);
+    w->writePOD<int>(s.fielding);
+    w->writePOD<int>(s.premult);
+    w->writePOD<U32>(s.mipMapLevel);
+}
+
+void
+readCacheTOCBlob(CacheTOCReader* r,
+                 SERIALIZATION_NAMESPACE::ImageParamsSerialization* s)
+{
+    readNonKeyParams(r, s);
+    readRectD(r, &s->rod);
+    s->par = r->readPOD<double>();
+    s->components.layerName = r->readString();
+    s->components.globalCompsName = r->readString();
+    U32 nChannels = r->readPOD<U32>();
+    if (nChannels > 4) {
+        throw std::runtime_error("Corrupted cache table of contents");
+    }
+    s->components.channelNames.resize(nChannels);
+    for (U32 i = 0; i < nChannels; ++i) {
+        s->components.channelNames[i] = r->readString();
+    }
+    s->bitdepth = r->readPOD<int>();
+    s->fielding = r->readPOD<int>();
+    s->premult = r->readPOD<int>();
+    s->mipMapLevel = r->readPOD<U32>();
+}
+
+void
+writeCacheTOCBlob(const SERIALIZATION_NAMESPACE::FrameKeySerialization& s,
+                  CacheTOCWriter* w)
+{
+    w->writePOD<int>(s.frame);
+    w->writePOD<int>(s.view);
+    w->writePOD<U64>(s.treeHash);
+    w->writeString(s.bitdepth);
+    writeRectI(s.textureRect.rect, w);
+    w->writePOD<int>(s.textureRect.closestPo2);
+    w->writePOD<double>(s.textureRect.par);
+    w->writePOD<char>(s.draftMode);
+    w->writePOD<char>(s.useShader);
+}
+
+void
+readCacheTOCBlob(CacheTOCReader* r,
+                 SERIALIZATION_NAMESPACE::FrameKeySerialization* s)
+{
+    s->frame = r->readPOD<int>();
+    s->view = r->readPOD<int>();
+    s->treeHash = r->readPOD<U64>();
+    s->bitdepth = r->readString();
+    readRectI(r, &s->textureRect.rect);
+    s->textureRect.closestPo2 = r->readPOD<int>();
+    s->textureRect.par = r->readPOD<double>();
+    s->draftMode = (bool)r->readPOD<char>();
+    s->useShader = (bool)r->readPOD<char>();
+}
+
+void
+writeCacheTOCBlob(const SERIALIZATION_NAMESPACE::FrameParamsSerialization& s,
+                  CacheTOCWriter* w)
+{
+    writeNonKeyParams(s, w);
+    writeRectD(s.rod, w);
+}
+
+void
+readCacheTOCBlob(CacheTOCReader* r,
+                 SERIALIZATION_NAMESPACE::FrameParamsSerialization* s)
+{
+    readNonKeyParams(r, s);
+    readRectD(r, &s->rod);
+}
+
+CacheTOC::CacheTOC(const std::string& tocFilePath,
+                   const std::string& heapFilePath)
+    : _tocFilePath(tocFilePath)
+    , _heapFilePath(heapFilePath)
+    , _tocFile()
+    , _heapFile()
+    , _recordsIndex()
+    , _stringsIndex()
+{
+}
+
+CacheTOC::~CacheTOC()
+{
+}
+
+bool
+CacheTOC::open(bool create)
+{
+    MemoryFile::FileOpenModeEnum mode = create ? MemoryFile::eFileOpenModeEnumIfExistsKeepElseCreate : MemoryFile::eFileOpenModeEnumIfExistsKeepElseFail;
+
+    if (!create) {
+        try {
+            _tocFile.open(_tocFilePath, mode);
+            _heapFile.open(_heapFilePath, mode);
+        } catch (const std::exception& /*e*/) {
+            return false;
+        }
+    } else {
+        _tocFile.open(_tocFilePath, mode);
+        _heapFile.open(_heapFilePath, mode);
+    }
+
+    bool ok = isValid();
+    if (ok) {
+        try {
+            buildIndex();
+        } catch (const std::exception& /*e*/) {
+            ok = false;
+        }
+    }
+    if (!ok) {
+        if (!create) {
+            return false;
+        }
+        // The cache version is unknown: the next update() will rewrite everything
+        reset(0);
+    }
+
+    return true;
+}
+
+bool
+CacheTOC::isValid() const
+{
+    if ( !_tocFile.data() || (_tocFile.size() < sizeof(CacheTOCHeader)) ) {
+        return false;
+    }
+    const CacheTOCHeader* h = header();
+    if ( (std::memcmp(h->magic, NATRON_CACHE_TOC_MAGIC, sizeof(h->magic)) != 0) || (h->tocVersion != NATRON_CACHE_TOC_VERSION) ) {
+        return false;
+    }
+    if ( h->nRecords > (_tocFile.size() - sizeof(CacheTOCHeader)) / sizeof(CacheTOCRecord) ) {
+        return false;
+    }
+    if ( (h->nRemovedRecords > h->nRecords) || (h->heapGarbage > h->heapSize) ) {
+        return false;
+    }
+    if ( h->heapSize > 0 && ( !_heapFile.data() || (h->heapSize > _heapFile.size()) ) ) {
+        return false;
+    }
+
+    return true;
+}
+
+void
+CacheTOC::reset(int cacheVersion)
+{
+    // Also shrink the files back, they may have grown a lot before compaction
+    std::size_t minSize = sizeof(CacheTOCHeader) + CACHE_TOC_INITIAL_RECORDS * sizeof(CacheTOCRecord);
+    if ( !_tocFile.data() || (_tocFile.size() != minSize) ) {
+        _tocFile.resize(minSize);
+    }
+    if ( _heapFile.data() && (_heapFile.size() > CACHE_TOC_HEAP_MIN_GROWTH) ) {
+        _heapFile.resize(CACHE_TOC_HEAP_MIN_GROWTH);
+    }
+
+    CacheTOCHeader* h = header();
+    std::memset( h, 0, sizeof(CacheTOCHeader) );
+    std::memcpy( h->magic, NATRON_CACHE_TOC_MAGIC, sizeof(h->magic) );
+    h->tocVersion = NATRON_CACHE_TOC_VERSION;
+    h->cacheVersion = (U32)cacheVersion;
+
+    _recordsIndex.clear();
+    _stringsIndex.clear();
+}
+
+void
+CacheTOC::buildIndex()
+{
+    _recordsIndex.clear();
+    _stringsIndex.clear();
+
+    const CacheTOCRecord* recs = records();
+    const U64 nRecords = header()->nRecords;
+    for (U64 i = 0; i < nRecords; ++i) {
+        if (recs[i].flags & CACHE_TOC_RECORD_FLAG_REMOVED) {
+            continue;
+        }
+        _recordsIndex[RecordKey(recs[i].hash, recs[i].filePathOffset, recs[i].dataOffsetInFile)] = i;
+        _stringsIndex.insert( std::make_pair(readString(recs[i].filePathOffset), recs[i].filePathOffset) );
+        _stringsIndex.insert( std::make_pair(readString(recs[i].pluginIDOffset), recs[i].pluginIDOffset) );
+    }
+}
+
+bool
+CacheTOC::findRecord(U64 hash,
+                     const std::string& filePath,
+                     U64 dataOffsetInFile,
+                     U64* index) const
+{
+    // Strings are shared in the heap, hence a record of this file has the offset of the string
+    std::map<std::string, U64>::const_iterator foundPath = _stringsIndex.find(filePath);
+
+    if ( foundPath == _stringsIndex.end() ) {
+        return false;
+    }
+    std::map<RecordKey, U64>::const_iterator found = _recordsIndex.find( RecordKey(hash, foundPath->second, dataOffsetInFile) );
+    if ( found == _recordsIndex.end() ) {
+        return false;
+    }
+    *index = found->second;
+
+    return true;
+}
+
+bool
+CacheTOC::recordMatches(U64 index,
+                        U64 size,
+                        const std::string& pluginID) const
+{
+    const CacheTOCRecord& rec = records()[index];
+
+    if ( (rec.flags & CACHE_TOC_RECORD_FLAG_REMOVED) || (rec.size != size) ) {
+        return false;
+    }
+
+    std::map<std::string, U64>::const_iterator foundPlugin = _stringsIndex.find(pluginID);
+    if ( ( foundPlugin == _stringsIndex.end() ) || (foundPlugin->second != rec.pluginIDOffset) ) {
+        return false;
+    }
+
+    return true;
+}
+
+void
+CacheTOC::reserveRecords(U64 nRecords)
+{
+    std::size_t neededSize = sizeof(CacheTOCHeader) + nRecords * sizeof(CacheTOCRecord);
+
+    if (neededSize > _tocFile.size()) {
+        // Grow geometrically so that appending entries one save after another stays amortized
+        _tocFile.resize( std::max(neededSize, _tocFile.size() * 2) );
+    }
+}
+
+void
+CacheTOC::appendRecord(const CacheTOCRecord& rec)
+{
+    CacheTOCHeader* h = header();
+
+    assert(sizeof(CacheTOCHeader) + (h->nRecords + 1) * sizeof(CacheTOCRecord) <= _tocFile.size());
+    records()[h->nRecords] = rec;
+    _recordsIndex[RecordKey(rec.hash, rec.filePathOffset, rec.dataOffsetInFile)] = h->nRecords;
+    ++h->nRecords;
+}
+
+void
+CacheTOC::removeRecord(U64 index)
+{
+    CacheTOCRecord& rec = records()[index];
+
+    if (rec.flags & CACHE_TOC_RECORD_FLAG_REMOVED) {
+        return;
+    }
+    rec.flags |= CACHE_TOC_RECORD_FLAG_REMOVED;
+
+    CacheTOCHeader* h = header();
+    ++h->nRemovedRecords;
+    h->heapGarbage += rec.blobSize;
+
+    std::map<RecordKey, U64>::iterator found = _recordsIndex.find( RecordKey(rec.hash, rec.filePathOffset, rec.dataOffsetInFile) );
+    if ( ( found != _recordsIndex.end() ) && (found->second == index) ) {
+        _recordsIndex.erase(found);
+    }
+}
+
+U64
+CacheTOC::appendToHeap(const char* data,
+                       std::size_t size)
+{
+    CacheTOCHeader* h = header();
+    U64 offset = h->heapSize;
+    std::size_t neededSize = offset + size;
+
+    if ( !_heapFile.data() || (neededSize > _heapFile.size()) ) {
+        _heapFile.resize( std::max( neededSize, std::max(_heapFile.size() * 2, (std::size_t)CACHE_TOC_HEAP_MIN_GROWTH) ) );
+    }
+    if (size > 0) {
+        std::memcpy(_heapFile.data() + offset, data, size);
+    }
+    h->heapSize = neededSize;
+
+    return offset;
+}
+
+U64
+CacheTOC::appendString(const std::string& str)
+{
+    std::map<std::string, U64>::const_iterator found = _stringsIndex.find(str);
+
+    if ( found != _stringsIndex.end() ) {
+        return found->second;
+    }
+    CacheTOCWriter w;
+    w.writeString(str);
+    U64 offset = appendToHeap( w.data(), w.size() );
+    _stringsIndex.insert( std::make_pair(str, offset) );
+
+    return offset;
+}
+
+const char*
+CacheTOC::heapData(U64 offset,
+                   U64 size) const
+{
+    const U64 heapSize = header()->heapSize;
+
+    if ( (offset > heapSize) || (size > heapSize - offset) ) {
+        throw std::runtime_error("Corrupted cache table of contents");
+    }
+
+    return _heapFile.data() + offset;
+}
+
+std::string
+CacheTOC::readString(U64 offset) const
+{
+    const U64 heapSize = header()->heapSize;
+
+    if (offset > heapSize) {
+        throw std::runtime_error("Corrupted cache table of contents");
+    }
+    CacheTOCReader r(heapData(offset, heapSize - offset), heapSize - offset);
+
+    return r.readString();
+}
+
+bool
+CacheTOC::isDirty() const
+{
+    return header()->dirty != 0;
+}
+
+void
+CacheTOC::setDirty(bool dirty)
+{
+    header()->dirty = dirty ? 1 : 0;
+    _tocFile.flush( MemoryFile::eFlushTypeSync, header(), sizeof(CacheTOCHeader) );
+}
+
+int
+CacheTOC::getCacheVersion() const
+{
+    return (int)header()->cacheVersion;
+}
+
+std::size_t
+CacheTOC::getNumEntries() const
+{
+    const CacheTOCHeader* h = header();
+
+    return (std::size_t)(h->nRecords - h->nRemovedRecords);
+}
+
+std::size_t
+CacheTOC::getNumRecords() const
+{
+    return (std::size_t)header()->nRecords;
+}
+
+void
+CacheTOC::remove()
+{
+    _tocFile.remove();
+    _heapFile.remove();
+    _recordsIndex.clear();
+    _stringsIndex.clear();
+}
+
+void
+CacheTOC::sync()
+{
+    // Flush the heap first so that the records never point to data that did not reach the disk
+    if ( _heapFile.data() ) {
+        _heapFile.flush(MemoryFile::eFlushTypeSync, 0, 0);
+    }
+    _tocFile.flush(MemoryFile::eFlushTypeSync, 0, 0);
+}
+
+NATRON_NAMESPACE_EXIT;
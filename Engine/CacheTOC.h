@@ -0,0 +1,502 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_CACHETOC_H
+#define NATRON_ENGINE_CACHETOC_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <cstring>
+#include <stdexcept>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include <QtCore/QFile>
+#include <QtCore/QString>
+
+#include "Global/GlobalDefines.h"
+#include "Engine/FStreamsSupport.h"
+#include "Engine/MemoryFile.h"
+#include "Serialization/CacheSerialization.h"
+#include "Serialization/CacheSerializationImpl.h"
+#include "Serialization/ImageKeySerialization.h"
+#include "Serialization/ImageParamsSerialization.h"
+#include "Serialization/FrameKeySerialization.h"
+#include "Serialization/FrameParamsSerialization.h"
+#include "Serialization/SerializationIO.h"
+#include "Engine/EngineFwd.h"
+
+// Bump this whenever the layout of CacheTOCHeader, CacheTOCRecord or of the binary blobs changes
+#define NATRON_CACHE_TOC_VERSION 1
+#define NATRON_CACHE_TOC_MAGIC "NATRNTOC"
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief Header at the start of the table of contents file. All fields are in the native
+ * byte order: the TOC describes a local disk cache and is never shared across machines.
+ **/
+struct CacheTOCHeader
+{
+    char magic[8];
+    U32 tocVersion;
+    U32 cacheVersion;
+
+    // Set to 1 while the cache is running: if we find a dirty TOC at startup, the application
+    // did not exit cleanly and the TOC cannot be trusted.
+    U32 dirty;
+    U32 padding;
+
+    // Number of records (including removed ones)
+    U64 nRecords;
+    U64 nRemovedRecords;
+
+    // Number of bytes used in the heap file and how many of them belong to removed records
+    U64 heapSize;
+    U64 heapGarbage;
+};
+
+#define CACHE_TOC_RECORD_FLAG_REMOVED 0x1
+
+/**
+ * @brief Fixed-size record describing one cache entry.
+ * Strings (file path, plug-in ID) are shared in the heap file: all entries of the same plug-in, or all
+ * tiles of the same tile file, point to the same string.
+ * The key and the non-key parameters are stored in a binary blob in the heap file.
+ **/
+struct CacheTOCRecord
+{
+    U64 hash;
+    U64 dataOffsetInFile;
+    U64 size;
+    U64 filePathOffset;
+    U64 pluginIDOffset;
+    U64 blobOffset;
+    U32 blobSize;
+    U32 flags;
+};
+
+/**
+ * @brief Small helper to write plain data to a growing byte buffer
+ **/
+class CacheTOCWriter
+{
+public:
+
+    CacheTOCWriter()
+    : _buf()
+    {
+    }
+
+    void write(const void* data, std::size_t size)
+    {
+        const char* p = (const char*)data;
+        _buf.insert(_buf.end(), p, p + size);
+    }
+
+    template <typename T>
+    void writePOD(T v)
+    {
+        write(&v, sizeof(T));
+    }
+
+    void writeString(const std::string& str)
+    {
+        writePOD<U32>( (U32)str.size() );
+        write( str.data(), str.size() );
+    }
+
+    const char* data() const
+    {
+        return _buf.empty() ? 0 : &_buf[0];
+    }
+
+    std::size_t size() const
+    {
+        return _buf.size();
+    }
+
+private:
+
+    std::vector<char> _buf;
+};
+
+/**
+ * @brief Small helper to read plain data written by CacheTOCWriter.
+ * Throws std::runtime_error if reading past the end of the buffer.
+ **/
+class CacheTOCReader
+{
+public:
+
+    CacheTOCReader(const char* data, std::size_t size)
+    : _ptr(data)
+    , _end(data + size)
+    {
+    }
+
+    void read(void* data, std::size_t size)
+    {
+        if ( size > (std::size_t)(_end - _ptr) ) {
+            throw std::runtime_error("Corrupted cache table of contents");
+        }
+        std::memcpy(data, _ptr, size);
+        _ptr += size;
+    }
+
+    template <typename T>
+    T readPOD()
+    {
+        T v;
+        read(&v, sizeof(T));
+        return v;
+    }
+
+    std::string readString()
+    {
+        U32 len = readPOD<U32>();
+        if ( len > (std::size_t)(_end - _ptr) ) {
+            throw std::runtime_error("Corrupted cache table of contents");
+        }
+        std::string ret(_ptr, len);
+        _ptr += len;
+        return ret;
+    }
+
+private:
+
+    const char* _ptr;
+    const char* _end;
+};
+
+// Binary encoding of the keys and parameters of the cache entries. This is the binary
+// counterpart of the YAML encode/decode functions of the serialization classes.
+void writeCacheTOCBlob(const SERIALIZATION_NAMESPACE::ImageKeySerialization& s, CacheTOCWriter* w);
+void readCacheTOCBlob(CacheTOCReader* r, SERIALIZATION_NAMESPACE::ImageKeySerialization* s);
+void writeCacheTOCBlob(const SERIALIZATION_NAMESPACE::ImageParamsSerialization& s, CacheTOCWriter* w);
+void readCacheTOCBlob(CacheTOCReader* r, SERIALIZATION_NAMESPACE::ImageParamsSerialization* s);
+void writeCacheTOCBlob(const SERIALIZATION_NAMESPACE::FrameKeySerialization& s, CacheTOCWriter* w);
+void readCacheTOCBlob(CacheTOCReader* r, SERIALIZATION_NAMESPACE::FrameKeySerialization* s);
+void writeCacheTOCBlob(const SERIALIZATION_NAMESPACE::FrameParamsSerialization& s, CacheTOCWriter* w);
+void readCacheTOCBlob(CacheTOCReader* r, SERIALIZATION_NAMESPACE::FrameParamsSerialization* s);
+
+/**
+ * @brief A binary table of contents for the cache, memory mapped with MemoryFile.
+ * It is made of 2 files: the TOC file itself (a CacheTOCHeader followed by fixed-size CacheTOCRecord)
+ * and a heap file containing the strings and the encoded keys/parameters of the entries.
+ *
+ * Restoring the cache is a linear walk over the mapped records. When saving, only the entries that
+ * changed since the last save are appended and the ones that disappeared are flagged as removed;
+ * the files are compacted once more than half of their content is removed.
+ *
+ * This is not MT-safe.
+ **/
+class CacheTOC
+{
+public:
+
+    CacheTOC(const std::string& tocFilePath,
+             const std::string& heapFilePath);
+
+    ~CacheTOC();
+
+    /**
+     * @brief Map the files to memory. If create is false and the files do not exist or are not a valid TOC,
+     * this function returns false. If create is true, a fresh empty TOC is created if needed.
+     * This function might throw an exception if the files cannot be mapped.
+     **/
+    bool open(bool create);
+
+    bool isDirty() const;
+
+    /**
+     * @brief Flag the TOC as dirty. This should be called once the cache has been restored from the TOC
+     * since from now on the cache content may diverge from the TOC until the next call to update().
+     **/
+    void setDirty(bool dirty);
+
+    int getCacheVersion() const;
+
+    /**
+     * @brief Returns the number of entries that are not removed.
+     **/
+    std::size_t getNumEntries() const;
+
+    /**
+     * @brief Returns the number of records, including the removed ones that were not compacted yet.
+     **/
+    std::size_t getNumRecords() const;
+
+    /**
+     * @brief Removes the backing files.
+     **/
+    void remove();
+
+    /**
+     * @brief Synchronizes the TOC with the given entries: only new or changed entries are written.
+     * @param dirty Whether the TOC remains flagged dirty after this call: only the last save, once the cache
+     * no longer changes, may flag it clean.
+     **/
+    template <typename EntryType>
+    void update(int cacheVersion,
+                const std::list<SERIALIZATION_NAMESPACE::SerializedEntry<EntryType> >& entries,
+                bool dirty)
+    {
+        typedef std::list<SERIALIZATION_NAMESPACE::SerializedEntry<EntryType> > EntriesList;
+
+        bool mustRewrite = (int)header()->cacheVersion != cacheVersion;
+
+        std::vector<const SERIALIZATION_NAMESPACE::SerializedEntry<EntryType>*> toAppend;
+        std::vector<bool> seen;
+        if (!mustRewrite) {
+            seen.resize(header()->nRecords, false);
+            for (typename EntriesList::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+                U64 index;
+                if ( findRecord(it->hash, it->filePath, it->dataOffsetInFile, &index) && recordMatches(index, it->size, it->pluginID) ) {
+                    seen[index] = true;
+                } else {
+                    toAppend.push_back(&*it);
+                }
+            }
+
+            // Count the records that are no longer in the cache
+            U64 nStale = 0;
+            const CacheTOCRecord* recs = records();
+            for (U64 i = 0; i < seen.size(); ++i) {
+                if ( !seen[i] && !(recs[i].flags & CACHE_TOC_RECORD_FLAG_REMOVED) ) {
+                    ++nStale;
+                }
+            }
+
+            // Compact when more than half of the records would be garbage
+            U64 nRemovedAfter = header()->nRemovedRecords + nStale;
+            U64 nRecordsAfter = header()->nRecords + toAppend.size();
+            mustRewrite = nRemovedAfter * 2 > nRecordsAfter;
+        }
+
+        if (mustRewrite) {
+            reset(cacheVersion);
+            toAppend.clear();
+            for (typename EntriesList::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+                toAppend.push_back(&*it);
+            }
+        } else {
+            for (U64 i = 0; i < seen.size(); ++i) {
+                if (!seen[i]) {
+                    removeRecord(i);
+                }
+            }
+        }
+
+        reserveRecords(header()->nRecords + toAppend.size());
+        for (std::size_t i = 0; i < toAppend.size(); ++i) {
+            const SERIALIZATION_NAMESPACE::SerializedEntry<EntryType>& e = *toAppend[i];
+            CacheTOCWriter w;
+            writeCacheTOCBlob(e.key, &w);
+            writeCacheTOCBlob(e.params, &w);
+
+            CacheTOCRecord rec;
+            rec.hash = e.hash;
+            rec.dataOffsetInFile = e.dataOffsetInFile;
+            rec.size = e.size;
+            rec.filePathOffset = appendString(e.filePath);
+            rec.pluginIDOffset = appendString(e.pluginID);
+            rec.blobOffset = appendToHeap( w.data(), w.size() );
+            rec.blobSize = (U32)w.size();
+            rec.flags = 0;
+            appendRecord(rec);
+        }
+
+        header()->dirty = dirty ? 1 : 0;
+        sync();
+    } // update
+
+    /**
+     * @brief Reads all entries that are not removed from the TOC.
+     * Throws std::runtime_error if the TOC is corrupted.
+     **/
+    template <typename EntryType>
+    void read(SERIALIZATION_NAMESPACE::CacheSerialization<EntryType>* toc) const
+    {
+        toc->cacheVersion = getCacheVersion();
+
+        const CacheTOCRecord* recs = records();
+        const U64 nRecords = header()->nRecords;
+        for (U64 i = 0; i < nRecords; ++i) {
+            const CacheTOCRecord& rec = recs[i];
+            if (rec.flags & CACHE_TOC_RECORD_FLAG_REMOVED) {
+                continue;
+            }
+            SERIALIZATION_NAMESPACE::SerializedEntry<EntryType> e;
+            e.hash = rec.hash;
+            e.dataOffsetInFile = rec.dataOffsetInFile;
+            e.size = rec.size;
+            e.filePath = readString(rec.filePathOffset);
+            e.pluginID = readString(rec.pluginIDOffset);
+
+            CacheTOCReader r(heapData(rec.blobOffset, rec.blobSize), rec.blobSize);
+            readCacheTOCBlob(&r, &e.key);
+            readCacheTOCBlob(&r, &e.params);
+            toc->entries.push_back(e);
+        }
+    }
+
+private:
+
+    CacheTOCHeader* header() const
+    {
+        return (CacheTOCHeader*)_tocFile.data();
+    }
+
+    CacheTOCRecord* records() const
+    {
+        return (CacheTOCRecord*)(_tocFile.data() + sizeof(CacheTOCHeader));
+    }
+
+    bool isValid() const;
+
+    void reset(int cacheVersion);
+
+    void buildIndex();
+
+    bool findRecord(U64 hash, const std::string& filePath, U64 dataOffsetInFile, U64* index) const;
+
+    bool recordMatches(U64 index, U64 size, const std::string& pluginID) const;
+
+    void reserveRecords(U64 nRecords);
+
+    void appendRecord(const CacheTOCRecord& rec);
+
+    void removeRecord(U64 index);
+
+    U64 appendToHeap(const char* data, std::size_t size);
+
+    U64 appendString(const std::string& str);
+
+    const char* heapData(U64 offset, U64 size) const;
+
+    std::string readString(U64 offset) const;
+
+    void sync();
+
+    std::string _tocFilePath, _heapFilePath;
+    MemoryFile _tocFile, _heapFile;
+
+    // Identifies a live record: the hash alone is not enough, entries of different files or at different
+    // offsets in a tile file may have the same hash
+    struct RecordKey
+    {
+        U64 hash;
+        U64 filePathOffset;
+        U64 dataOffsetInFile;
+
+        RecordKey(U64 hash,
+                  U64 filePathOffset,
+                  U64 dataOffsetInFile)
+            : hash(hash)
+            , filePathOffset(filePathOffset)
+            , dataOffsetInFile(dataOffsetInFile)
+        {
+        }
+
+        bool operator<(const RecordKey& other) const
+        {
+            if (hash != other.hash) {
+                return hash < other.hash;
+            }
+            if (filePathOffset != other.filePathOffset) {
+                return filePathOffset < other.filePathOffset;
+            }
+
+            return dataOffsetInFile < other.dataOffsetInFile;
+        }
+    };
+
+    // key -> index of the live record
+    std::map<RecordKey, U64> _recordsIndex;
+
+    // string -> offset in the heap, to share strings across records
+    std::map<std::string, U64> _stringsIndex;
+};
+
+/**
+ * @brief Reads the table of contents of a cache: the binary TOC in tocFilePath and heapFilePath or, if it is missing
+ * or corrupted, the YAML one in legacyFilePath written by older versions. The YAML TOC is removed once read.
+ * Returns false if the cache content is unknown and the cache must be wiped: no TOC could be read, or the binary TOC
+ * is dirty because the application did not exit cleanly.
+ * If the binary TOC was read, it is returned opened in tocFile so that it can be flagged dirty once the cache is restored.
+ **/
+template <typename EntryType>
+bool
+readCacheTOC(const std::string& tocFilePath,
+             const std::string& heapFilePath,
+             const std::string& legacyFilePath,
+             SERIALIZATION_NAMESPACE::CacheSerialization<EntryType>* toc,
+             boost::shared_ptr<CacheTOC>* tocFile)
+{
+    boost::shared_ptr<CacheTOC> binaryTOC( new CacheTOC(tocFilePath, heapFilePath) );
+
+    try {
+        if ( binaryTOC->open(false) ) {
+            if ( binaryTOC->isDirty() ) {
+                return false;
+            }
+            binaryTOC->read<EntryType>(toc);
+            *tocFile = binaryTOC;
+
+            return true;
+        }
+    } catch (const std::exception& /*e*/) {
+        // Corrupted, fallback on the YAML TOC
+        toc->entries.clear();
+    }
+    binaryTOC.reset();
+
+    FStreamsSupport::ifstream ifile;
+    FStreamsSupport::open(&ifile, legacyFilePath);
+    if (!ifile) {
+        return false;
+    }
+    try {
+        SERIALIZATION_NAMESPACE::read(ifile, toc);
+    } catch (const std::exception& /*e*/) {
+        return false;
+    }
+    ifile.close();
+
+    QFile legacyFile( QString::fromUtf8( legacyFilePath.c_str() ) );
+    legacyFile.remove();
+
+    return true;
+} // readCacheTOC
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_CACHETOC_H
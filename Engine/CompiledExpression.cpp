@@ -0,0 +1,1173 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "CompiledExpression.h"
+
+#include <algorithm> // min, max
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/math/special_functions/fpclassify.hpp>
+#endif
+
+#include "Engine/Knob.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/PyExprUtils.h"
+
+// The largest magnitude for which all integers are represented exactly by a double: ints beyond are left to Python
+#define NATRON_COMPILED_EXPRESSION_MAX_INT 9007199254740992.
+
+// Expressions needing a deeper evaluation stack are left to Python
+#define NATRON_COMPILED_EXPRESSION_MAX_STACK 32
+
+NATRON_NAMESPACE_ENTER;
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+enum OpEnum
+{
+    eOpConstant = 0,
+    eOpFrame,
+    eOpView,
+    eOpDimension,
+    eOpNegate,
+    eOpAdd,
+    eOpSubtract,
+    eOpMultiply,
+    eOpDivide,
+    eOpFloorDivide,
+    eOpModulo,
+    eOpPower,
+    eOpCall,
+    eOpParam
+};
+
+enum FunctionEnum
+{
+    eFunctionSin = 0,
+    eFunctionCos,
+    eFunctionTan,
+    eFunctionAsin,
+    eFunctionAcos,
+    eFunctionAtan,
+    eFunctionAtan2,
+    eFunctionSinh,
+    eFunctionCosh,
+    eFunctionTanh,
+    eFunctionExp,
+    eFunctionLog,
+    eFunctionLog10,
+    eFunctionSqrt,
+    eFunctionPow,
+    eFunctionFabs,
+    eFunctionFmod,
+    eFunctionFloor,
+    eFunctionCeil,
+    eFunctionHypot,
+    eFunctionDegrees,
+    eFunctionRadians,
+    eFunctionAbs,
+    eFunctionMin,
+    eFunctionMax,
+    eFunctionInt,
+    eFunctionFloat,
+    eFunctionBoxstep,
+    eFunctionLinearstep,
+    eFunctionSmoothstep,
+    eFunctionGaussstep,
+    eFunctionRemap,
+    eFunctionMix,
+    eFunctionNoise
+};
+
+struct FunctionDescriptor
+{
+    const char* name;
+    FunctionEnum function;
+    int minArgs;
+    int maxArgs; // -1 for variadic
+};
+
+// Functions of the math module (imported with "from math import *") and builtins
+const FunctionDescriptor globalFunctions[] = {
+    { "sin", eFunctionSin, 1, 1 },
+    { "cos", eFunctionCos, 1, 1 },
+    { "tan", eFunctionTan, 1, 1 },
+    { "asin", eFunctionAsin, 1, 1 },
+    { "acos", eFunctionAcos, 1, 1 },
+    { "atan", eFunctionAtan, 1, 1 },
+    { "atan2", eFunctionAtan2, 2, 2 },
+    { "sinh", eFunctionSinh, 1, 1 },
+    { "cosh", eFunctionCosh, 1, 1 },
+    { "tanh", eFunctionTanh, 1, 1 },
+    { "exp", eFunctionExp, 1, 1 },
+    { "log", eFunctionLog, 1, 2 },
+    { "log10", eFunctionLog10, 1, 1 },
+    { "sqrt", eFunctionSqrt, 1, 1 },
+    { "pow", eFunctionPow, 2, 2 },
+    { "fabs", eFunctionFabs, 1, 1 },
+    { "fmod", eFunctionFmod, 2, 2 },
+    { "floor", eFunctionFloor, 1, 1 },
+    { "ceil", eFunctionCeil, 1, 1 },
+    { "hypot", eFunctionHypot, 2, 2 },
+    { "degrees", eFunctionDegrees, 1, 1 },
+    { "radians", eFunctionRadians, 1, 1 },
+    { "abs", eFunctionAbs, 1, 1 },
+    { "min", eFunctionMin, 2, -1 },
+    { "max", eFunctionMax, 2, -1 },
+    { "int", eFunctionInt, 1, 1 },
+    { "float", eFunctionFloat, 1, 1 },
+    { 0, eFunctionSin, 0, 0 }
+};
+
+// Functions of ExprUtils taking only numbers
+const FunctionDescriptor exprUtilsFunctions[] = {
+    { "boxstep", eFunctionBoxstep, 2, 2 },
+    { "linearstep", eFunctionLinearstep, 3, 3 },
+    { "smoothstep", eFunctionSmoothstep, 3, 3 },
+    { "gaussstep", eFunctionGaussstep, 3, 3 },
+    { "remap", eFunctionRemap, 5, 5 },
+    { "mix", eFunctionMix, 3, 3 },
+    { "noise", eFunctionNoise, 1, 1 },
+    { 0, eFunctionSin, 0, 0 }
+};
+
+const FunctionDescriptor*
+findFunction(const FunctionDescriptor* table,
+             const std::string& name)
+{
+    for (int i = 0; table[i].name; ++i) {
+        if (name == table[i].name) {
+            return &table[i];
+        }
+    }
+
+    return 0;
+}
+
+enum ParamKnobTypeEnum
+{
+    eParamKnobTypeDouble = 0,
+    eParamKnobTypeInt,
+    eParamKnobTypeBool
+};
+
+// Flags of the eOpParam instruction, telling which arguments are on the stack
+#define PARAM_HAS_TIME 0x1
+#define PARAM_HAS_DIMENSION 0x2
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+
+struct CompiledExpression::Instruction
+{
+    int op;
+
+    // The function or the index of the parameter
+    int index;
+
+    // The number of arguments of a function, or the flags of a parameter
+    int nArgs;
+    CompiledExpression::Value constant;
+};
+
+struct CompiledExpression::ParamRef
+{
+    KnobIWPtr knob;
+    int type;
+    int nDims;
+};
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+inline bool
+makeInt(double v,
+        CompiledExpression::Value* r)
+{
+    if ( !(std::fabs(v) < NATRON_COMPILED_EXPRESSION_MAX_INT) ) {
+        return false;
+    }
+    r->value = v;
+    r->isInt = true;
+
+    return true;
+}
+
+inline bool
+makeFloat(double v,
+          CompiledExpression::Value* r)
+{
+    // The interpreter raises an exception for most operations producing infinities or NaNs
+    if ( !(boost::math::isfinite)(v) ) {
+        return false;
+    }
+    r->value = v;
+    r->isInt = false;
+
+    return true;
+}
+
+// Same as float_divmod in the interpreter
+void
+floatDivMod(double vx,
+            double wx,
+            double* floordiv,
+            double* mod)
+{
+    double m = std::fmod(vx, wx);
+    double div = (vx - m) / wx;
+
+    if (m != 0.) {
+        if ( (wx < 0) != (m < 0) ) {
+            m += wx;
+            div -= 1.0;
+        }
+    } else {
+        m = wx < 0 ? -0. : 0.;
+    }
+    double fd;
+    if (div != 0.) {
+        fd = std::floor(div);
+        if (div - fd > 0.5) {
+            fd += 1.0;
+        }
+    } else {
+        fd = (vx / wx) < 0 ? -0. : 0.;
+    }
+    *floordiv = fd;
+    *mod = m;
+}
+
+bool
+binaryOp(int op,
+         const CompiledExpression::Value& a,
+         const CompiledExpression::Value& b,
+         CompiledExpression::Value* r)
+{
+    if (a.isInt && b.isInt) {
+        double x = a.value;
+        double y = b.value;
+        switch (op) {
+        case eOpAdd:
+
+            return makeInt(x + y, r);
+        case eOpSubtract:
+
+            return makeInt(x - y, r);
+        case eOpMultiply:
+
+            return makeInt(x * y, r);
+        case eOpDivide:
+#if PY_MAJOR_VERSION >= 3
+            if (y == 0.) {
+                return false;
+            }
+
+            return makeFloat(x / y, r);
+#endif
+        // Python 2 divides ints like //
+        case eOpFloorDivide: {
+            if (y == 0.) {
+                return false;
+            }
+            long long xi = (long long)x;
+            long long yi = (long long)y;
+            long long q = xi / yi;
+            if ( ( (xi % yi) != 0 ) && ( (xi < 0) != (yi < 0) ) ) {
+                --q;
+            }
+
+            return makeInt( (double)q, r );
+        }
+        case eOpModulo: {
+            if (y == 0.) {
+                return false;
+            }
+            long long xi = (long long)x;
+            long long yi = (long long)y;
+            long long m = xi % yi;
+            if ( (m != 0) && ( (m < 0) != (yi < 0) ) ) {
+                m += yi;
+            }
+
+            return makeInt( (double)m, r );
+        }
+        case eOpPower: {
+            if (y < 0) {
+                if (x == 0.) {
+                    return false;
+                }
+
+                return makeFloat(std::pow(x, y), r);
+            }
+            double p = 1.;
+            long long e = (long long)y;
+            double base = x;
+            while (e > 0) {
+                if (e & 1) {
+                    p *= base;
+                    if ( !(std::fabs(p) < NATRON_COMPILED_EXPRESSION_MAX_INT) ) {
+                        return false;
+                    }
+                }
+                e >>= 1;
+                if (e > 0) {
+                    base *= base;
+                    if ( !(std::fabs(base) < NATRON_COMPILED_EXPRESSION_MAX_INT) ) {
+                        return false;
+                    }
+                }
+            }
+
+            return makeInt(p, r);
+        }
+        default:
+
+            return false;
+        } // switch
+    }
+
+    double x = a.value;
+    double y = b.value;
+    switch (op) {
+    case eOpAdd:
+
+        return makeFloat(x + y, r);
+    case eOpSubtract:
+
+        return makeFloat(x - y, r);
+    case eOpMultiply:
+
+        return makeFloat(x * y, r);
+    case eOpDivide:
+        if (y == 0.) {
+            return false;
+        }
+
+        return makeFloat(x / y, r);
+    case eOpFloorDivide:
+    case eOpModulo: {
+        if (y == 0.) {
+            return false;
+        }
+        double fd, m;
+        floatDivMod(x, y, &fd, &m);
+
+        return makeFloat(op == eOpModulo ? m : fd, r);
+    }
+    case eOpPower:
+        if (y == 0.) {
+            return makeFloat(1., r);
+        }
+        if ( (x == 0.) && (y < 0.) ) {
+            return false;
+        }
+        if ( (x < 0.) && ( y != std::floor(y) ) ) {
+            return false;
+        }
+
+        return makeFloat(std::pow(x, y), r);
+    default:
+
+        return false;
+    }
+} // binaryOp
+
+bool
+callFunction(int function,
+             const CompiledExpression::Value* args,
+             int nArgs,
+             CompiledExpression::Value* r)
+{
+    switch (function) {
+    case eFunctionSin:
+
+        return makeFloat(std::sin(args[0].value), r);
+    case eFunctionCos:
+
+        return makeFloat(std::cos(args[0].value), r);
+    case eFunctionTan:
+
+        return makeFloat(std::tan(args[0].value), r);
+    case eFunctionAsin:
+
+        return makeFloat(std::asin(args[0].value), r);
+    case eFunctionAcos:
+
+        return makeFloat(std::acos(args[0].value), r);
+    case eFunctionAtan:
+
+        return makeFloat(std::atan(args[0].value), r);
+    case eFunctionAtan2:
+
+        return makeFloat(std::atan2(args[0].value, args[1].value), r);
+    case eFunctionSinh:
+
+        return makeFloat(std::sinh(args[0].value), r);
+    case eFunctionCosh:
+
+        return makeFloat(std::cosh(args[0].value), r);
+    case eFunctionTanh:
+
+        return makeFloat(std::tanh(args[0].value), r);
+    case eFunctionExp:
+
+        return makeFloat(std::exp(args[0].value), r);
+    case eFunctionLog:
+        if (args[0].value <= 0.) {
+            return false;
+        }
+        if (nArgs == 2) {
+            if (args[1].value <= 0.) {
+                return false;
+            }
+            double den = std::log(args[1].value);
+            if (den == 0.) {
+                return false;
+            }
+
+            return makeFloat(std::log(args[0].value) / den, r);
+        }
+
+        return makeFloat(std::log(args[0].value), r);
+    case eFunctionLog10:
+        if (args[0].value <= 0.) {
+            return false;
+        }
+
+        return makeFloat(std::log10(args[0].value), r);
+    case eFunctionSqrt:
+        if (args[0].value < 0.) {
+            return false;
+        }
+
+        return makeFloat(std::sqrt(args[0].value), r);
+    case eFunctionPow:
+
+        return makeFloat(std::pow(args[0].value, args[1].value), r);
+    case eFunctionFabs:
+
+        return makeFloat(std::fabs(args[0].value), r);
+    case eFunctionFmod:
+        if (args[1].value == 0.) {
+            return false;
+        }
+
+        return makeFloat(std::fmod(args[0].value, args[1].value), r);
+    case eFunctionFloor:
+#if PY_MAJOR_VERSION >= 3
+
+        return makeInt(std::floor(args[0].value), r);
+#else
+
+        return makeFloat(std::floor(args[0].value), r);
+#endif
+    case eFunctionCeil:
+#if PY_MAJOR_VERSION >= 3
+
+        return makeInt(std::ceil(args[0].value), r);
+#else
+
+        return makeFloat(std::ceil(args[0].value), r);
+#endif
+    case eFunctionHypot:
+
+        return makeFloat(std::sqrt(args[0].value * args[0].value + args[1].value * args[1].value), r);
+    case eFunctionDegrees:
+
+        return makeFloat(args[0].value * (180. / M_PI), r);
+    case eFunctionRadians:
+
+        return makeFloat(args[0].value * (M_PI / 180.), r);
+    case eFunctionAbs:
+        *r = args[0];
+        r->value = std::fabs(r->value);
+
+        return true;
+    case eFunctionMin:
+    case eFunctionMax: {
+        // Like the builtins, return the first of the extreme values with its type
+        int found = 0;
+        for (int i = 1; i < nArgs; ++i) {
+            if ( (function == eFunctionMin) ? (args[i].value < args[found].value) : (args[i].value > args[found].value) ) {
+                found = i;
+            }
+        }
+        *r = args[found];
+
+        return true;
+    }
+    case eFunctionInt:
+        if (args[0].value < 0.) {
+            return makeInt(std::ceil(args[0].value), r);
+        }
+
+        return makeInt(std::floor(args[0].value), r);
+    case eFunctionFloat:
+
+        return makeFloat(args[0].value, r);
+    case eFunctionBoxstep:
+
+        return makeFloat(NATRON_PYTHON_NAMESPACE::ExprUtils::boxstep(args[0].value, args[1].value), r);
+    case eFunctionLinearstep:
+
+        return makeFloat(NATRON_PYTHON_NAMESPACE::ExprUtils::linearstep(args[0].value, args[1].value, args[2].value), r);
+    case eFunctionSmoothstep:
+
+        return makeFloat(NATRON_PYTHON_NAMESPACE::ExprUtils::smoothstep(args[0].value, args[1].value, args[2].value), r);
+    case eFunctionGaussstep:
+
+        return makeFloat(NATRON_PYTHON_NAMESPACE::ExprUtils::gaussstep(args[0].value, args[1].value, args[2].value), r);
+    case eFunctionRemap:
+
+        return makeFloat(NATRON_PYTHON_NAMESPACE::ExprUtils::remap(args[0].value, args[1].value, args[2].value, args[3].value, args[4].value), r);
+    case eFunctionMix:
+
+        return makeFloat(NATRON_PYTHON_NAMESPACE::ExprUtils::mix(args[0].value, args[1].value, args[2].value), r);
+    case eFunctionNoise:
+
+        return makeFloat(NATRON_PYTHON_NAMESPACE::ExprUtils::noise(args[0].value), r);
+    default:
+
+        return false;
+    } // switch
+} // callFunction
+
+enum TokenTypeEnum
+{
+    eTokenEnd = 0,
+    eTokenNumber,
+    eTokenName,
+    eTokenOperator
+};
+
+struct Token
+{
+    TokenTypeEnum type;
+    std::string text;
+    CompiledExpression::Value number;
+};
+
+// Splits the expression in tokens. Returns false if it contains anything else than numbers, names and arithmetic operators.
+bool
+tokenize(const std::string& expr,
+         std::vector<Token>* tokens)
+{
+    std::size_t i = 0;
+    const std::size_t n = expr.size();
+
+    while (i < n) {
+        char c = expr[i];
+        if ( (c == ' ') || (c == '\t') ) {
+            ++i;
+            continue;
+        }
+        Token t;
+        t.number.value = 0.;
+        t.number.isInt = false;
+        if ( std::isdigit( (unsigned char)c ) || ( (c == '.') && (i + 1 < n) && std::isdigit( (unsigned char)expr[i + 1] ) ) ) {
+            std::size_t start = i;
+            bool isInt = true;
+            while ( i < n && std::isdigit( (unsigned char)expr[i] ) ) {
+                ++i;
+            }
+            if ( (i < n) && (expr[i] == '.') ) {
+                isInt = false;
+                ++i;
+                while ( i < n && std::isdigit( (unsigned char)expr[i] ) ) {
+                    ++i;
+                }
+            }
+            if ( ( i < n) && ( (expr[i] == 'e') || (expr[i] == 'E') ) ) {
+                isInt = false;
+                ++i;
+                if ( (i < n) && ( (expr[i] == '+') || (expr[i] == '-') ) ) {
+                    ++i;
+                }
+                if ( (i >= n) || !std::isdigit( (unsigned char)expr[i] ) ) {
+                    return false;
+                }
+                while ( i < n && std::isdigit( (unsigned char)expr[i] ) ) {
+                    ++i;
+                }
+            }
+            // Reject suffixes (long, complex), hexadecimal and octal literals
+            if ( (i < n) && ( std::isalnum( (unsigned char)expr[i] ) || (expr[i] == '_') ) ) {
+                return false;
+            }
+            std::string text = expr.substr(start, i - start);
+            if ( isInt && (text.size() > 1) && (text[0] == '0') ) {
+                return false;
+            }
+            t.type = eTokenNumber;
+            double v = std::strtod(text.c_str(), 0);
+            bool ok = isInt ? makeInt(v, &t.number) : makeFloat(v, &t.number);
+            if (!ok) {
+                return false;
+            }
+        } else if ( std::isalpha( (unsigned char)c ) || (c == '_') ) {
+            std::size_t start = i;
+            while ( i < n && ( std::isalnum( (unsigned char)expr[i] ) || (expr[i] == '_') ) ) {
+                ++i;
+            }
+            t.type = eTokenName;
+            t.text = expr.substr(start, i - start);
+        } else {
+            static const char* const operators[] = { "**", "//", "+", "-", "*", "/", "%", "(", ")", ",", ".", "[", "]", 0 };
+            int found = -1;
+            for (int o = 0; operators[o]; ++o) {
+                if (expr.compare(i, std::strlen(operators[o]), operators[o]) == 0) {
+                    found = o;
+                    break;
+                }
+            }
+            if (found == -1) {
+                return false;
+            }
+            t.type = eTokenOperator;
+            t.text = operators[found];
+            i += t.text.size();
+        }
+        tokens->push_back(t);
+    }
+    Token end;
+    end.type = eTokenEnd;
+    end.number.value = 0.;
+    end.number.isInt = false;
+    tokens->push_back(end);
+
+    return true;
+} // tokenize
+
+/**
+ * @brief Recursive descent parser following the precedence of the Python grammar, emitting instructions
+ * for a stack machine. Each parse function returns false if the input is outside of the supported subset.
+ **/
+class ExpressionParser
+{
+public:
+
+    ExpressionParser(const std::vector<Token>& tokens,
+                     const CompiledExpression::Resolver& resolver,
+                     std::vector<CompiledExpression::Instruction>* code,
+                     std::vector<CompiledExpression::ParamRef>* params)
+        : _tokens(tokens)
+        , _pos(0)
+        , _resolver(resolver)
+        , _code(code)
+        , _params(params)
+        , _depth(0)
+        , _maxDepth(0)
+    {
+    }
+
+    bool parse()
+    {
+        if ( !parseExpr() ) {
+            return false;
+        }
+
+        return peek().type == eTokenEnd && _depth == 1 && _maxDepth <= NATRON_COMPILED_EXPRESSION_MAX_STACK;
+    }
+
+private:
+
+    const Token& peek(int offset = 0) const
+    {
+        std::size_t i = std::min(_pos + offset, _tokens.size() - 1);
+
+        return _tokens[i];
+    }
+
+    bool isOperator(const char* op,
+                    int offset = 0) const
+    {
+        const Token& t = peek(offset);
+
+        return t.type == eTokenOperator && t.text == op;
+    }
+
+    bool accept(const char* op)
+    {
+        if ( isOperator(op) ) {
+            ++_pos;
+
+            return true;
+        }
+
+        return false;
+    }
+
+    void emit(int op,
+              int index = 0,
+              int nArgs = 0,
+              int stackDelta = 0)
+    {
+        CompiledExpression::Instruction ins;
+        ins.op = op;
+        ins.index = index;
+        ins.nArgs = nArgs;
+        ins.constant.value = 0.;
+        ins.constant.isInt = false;
+        _code->push_back(ins);
+        _depth += stackDelta;
+        _maxDepth = std::max(_maxDepth, _depth);
+    }
+
+    void emitConstant(const CompiledExpression::Value& v)
+    {
+        emit(eOpConstant, 0, 0, 1);
+        _code->back().constant = v;
+    }
+
+    // expr := term (('+'|'-') term)*
+    bool parseExpr()
+    {
+        if ( !parseTerm() ) {
+            return false;
+        }
+        for (;;) {
+            int op;
+            if ( accept("+") ) {
+                op = eOpAdd;
+            } else if ( accept("-") ) {
+                op = eOpSubtract;
+            } else {
+                return true;
+            }
+            if ( !parseTerm() ) {
+                return false;
+            }
+            emit(op, 0, 0, -1);
+        }
+    }
+
+    // term := factor (('*'|'/'|'//'|'%') factor)*
+    bool parseTerm()
+    {
+        if ( !parseFactor() ) {
+            return false;
+        }
+        for (;;) {
+            int op;
+            if ( accept("*") ) {
+                op = eOpMultiply;
+            } else if ( accept("//") ) {
+                op = eOpFloorDivide;
+            } else if ( accept("/") ) {
+                op = eOpDivide;
+            } else if ( accept("%") ) {
+                op = eOpModulo;
+            } else {
+                return true;
+            }
+            if ( !parseFactor() ) {
+                return false;
+            }
+            emit(op, 0, 0, -1);
+        }
+    }
+
+    // factor := ('+'|'-') factor | power
+    bool parseFactor()
+    {
+        if ( accept("+") ) {
+            return parseFactor();
+        }
+        if ( accept("-") ) {
+            if ( !parseFactor() ) {
+                return false;
+            }
+            emit(eOpNegate);
+
+            return true;
+        }
+
+        return parsePower();
+    }
+
+    // power := primary ['**' factor]
+    bool parsePower()
+    {
+        if ( !parsePrimary() ) {
+            return false;
+        }
+        if ( accept("**") ) {
+            if ( !parseFactor() ) {
+                return false;
+            }
+            emit(eOpPower, 0, 0, -1);
+        }
+
+        return true;
+    }
+
+    // Parses comma separated arguments up to the closing parenthesis, which was already opened
+    bool parseArguments(int* nArgs)
+    {
+        *nArgs = 0;
+        if ( accept(")") ) {
+            return true;
+        }
+        for (;;) {
+            if ( !parseExpr() ) {
+                return false;
+            }
+            ++(*nArgs);
+            if ( accept(")") ) {
+                return true;
+            }
+            if ( !accept(",") ) {
+                return false;
+            }
+        }
+    }
+
+    bool parsePrimary()
+    {
+        const Token& t = peek();
+
+        if (t.type == eTokenNumber) {
+            ++_pos;
+            emitConstant(t.number);
+
+            return true;
+        }
+        if ( accept("(") ) {
+            if ( !parseExpr() ) {
+                return false;
+            }
+
+            return accept(")");
+        }
+        if (t.type != eTokenName) {
+            return false;
+        }
+
+        std::vector<std::string> names;
+        names.push_back(t.text);
+        ++_pos;
+        while ( isOperator(".") && (peek(1).type == eTokenName) ) {
+            names.push_back(peek(1).text);
+            _pos += 2;
+        }
+
+        if ( !accept("(") ) {
+            return parseVariable(names);
+        }
+        if (names.size() == 1) {
+            return parseFunctionCall(globalFunctions, names[0]);
+        }
+        if ( (names.size() == 2) && (names[0] == "ExprUtils") ) {
+            return parseFunctionCall(exprUtilsFunctions, names[1]);
+        }
+        if ( (names.size() == 3) && (names[0] == NATRON_ENGINE_PYTHON_MODULE_NAME) && (names[1] == "ExprUtils") ) {
+            return parseFunctionCall(exprUtilsFunctions, names[2]);
+        }
+
+        return parseParamCall(names);
+    } // parsePrimary
+
+    bool parseVariable(const std::vector<std::string>& names)
+    {
+        if (names.size() != 1) {
+            return false;
+        }
+        const std::string& name = names[0];
+        CompiledExpression::Value v;
+        if (name == "frame") {
+            emit(eOpFrame, 0, 0, 1);
+        } else if (name == "view") {
+            emit(eOpView, 0, 0, 1);
+        } else if (name == "dimension") {
+            emit(eOpDimension, 0, 0, 1);
+        } else if (name == "pi") {
+            v.value = M_PI;
+            v.isInt = false;
+            emitConstant(v);
+        } else if (name == "e") {
+            v.value = M_E;
+            v.isInt = false;
+            emitConstant(v);
+        } else {
+            return false;
+        }
+
+        return true;
+    }
+
+    bool parseFunctionCall(const FunctionDescriptor* table,
+                           const std::string& name)
+    {
+        const FunctionDescriptor* desc = findFunction(table, name);
+
+        if (!desc) {
+            return false;
+        }
+        int nArgs;
+        if ( !parseArguments(&nArgs) ) {
+            return false;
+        }
+        if ( (nArgs < desc->minArgs) || ( (desc->maxArgs != -1) && (nArgs > desc->maxArgs) ) ) {
+            return false;
+        }
+        emit(eOpCall, desc->function, nArgs, 1 - nArgs);
+
+        return true;
+    }
+
+    // <param>.get([frame])[dimension], <param>.get([frame]).x, <param>.getValue([dimension]), <param>.getValueAtTime(frame[, dimension])
+    bool parseParamCall(const std::vector<std::string>& names)
+    {
+        const std::string& method = names.back();
+
+        if ( (method != "get") && (method != "getValue") && (method != "getValueAtTime") ) {
+            return false;
+        }
+        std::vector<std::string> paramNames( names.begin(), names.end() - 1 );
+        KnobIPtr knob = _resolver.resolveParam(paramNames);
+        if (!knob) {
+            return false;
+        }
+        CompiledExpression::ParamRef ref;
+        ref.knob = knob;
+        ref.nDims = knob->getDimension();
+        if ( toKnobParametric(knob) ) {
+            return false;
+        } else if ( dynamic_cast<KnobDoubleBase*>( knob.get() ) ) {
+            ref.type = eParamKnobTypeDouble;
+        } else if ( dynamic_cast<KnobIntBase*>( knob.get() ) ) {
+            ref.type = eParamKnobTypeInt;
+        } else if ( dynamic_cast<KnobBoolBase*>( knob.get() ) ) {
+            ref.type = eParamKnobTypeBool;
+        } else {
+            return false;
+        }
+
+        int nArgs;
+        if ( !parseArguments(&nArgs) ) {
+            return false;
+        }
+        int flags = 0;
+        if (method == "get") {
+            if (nArgs > 1) {
+                return false;
+            }
+            if (nArgs == 1) {
+                flags |= PARAM_HAS_TIME;
+            }
+            if (ref.nDims > 1) {
+                // get() returns a tuple for multi-dimensional parameters
+                if ( accept("[") ) {
+                    if ( !parseExpr() || !accept("]") ) {
+                        return false;
+                    }
+                    flags |= PARAM_HAS_DIMENSION;
+                } else if ( isOperator(".") && (peek(1).type == eTokenName) ) {
+                    static const char* const xyz = "xyz";
+                    static const char* const rgba = "rgba";
+                    const std::string& component = peek(1).text;
+                    const char* components = toKnobColor(knob) ? rgba : xyz;
+                    const char* found = component.size() == 1 ? std::strchr(components, component[0]) : 0;
+                    if ( !found || ( (found - components) >= ref.nDims ) ) {
+                        return false;
+                    }
+                    _pos += 2;
+                    CompiledExpression::Value v;
+                    v.value = (double)(found - components);
+                    v.isInt = true;
+                    emitConstant(v);
+                    flags |= PARAM_HAS_DIMENSION;
+                } else {
+                    return false;
+                }
+            }
+        } else if (method == "getValue") {
+            if (nArgs > 1) {
+                return false;
+            }
+            if (nArgs == 1) {
+                flags |= PARAM_HAS_DIMENSION;
+            }
+        } else {
+            if ( (nArgs < 1) || (nArgs > 2) ) {
+                return false;
+            }
+            flags |= PARAM_HAS_TIME;
+            if (nArgs == 2) {
+                flags |= PARAM_HAS_DIMENSION;
+            }
+        }
+        int nPopped = ( (flags & PARAM_HAS_TIME) ? 1 : 0 ) + ( (flags & PARAM_HAS_DIMENSION) ? 1 : 0 );
+        _params->push_back(ref);
+        emit(eOpParam, (int)_params->size() - 1, flags, 1 - nPopped);
+
+        return true;
+    } // parseParamCall
+
+    const std::vector<Token>& _tokens;
+    std::size_t _pos;
+    const CompiledExpression::Resolver& _resolver;
+    std::vector<CompiledExpression::Instruction>* _code;
+    std::vector<CompiledExpression::ParamRef>* _params;
+    int _depth;
+    int _maxDepth;
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+
+CompiledExpression::CompiledExpression()
+    : _code()
+    , _params()
+{
+}
+
+CompiledExpression::~CompiledExpression()
+{
+}
+
+CompiledExpressionPtr
+CompiledExpression::compile(const std::string& expression,
+                            const Resolver& resolver)
+{
+    std::vector<Token> tokens;
+
+    if ( !tokenize(expression, &tokens) ) {
+        return CompiledExpressionPtr();
+    }
+
+    boost::shared_ptr<CompiledExpression> ret( new CompiledExpression() );
+    ExpressionParser parser(tokens, resolver, &ret->_code, &ret->_params);
+    if ( !parser.parse() ) {
+        return CompiledExpressionPtr();
+    }
+
+    return ret;
+}
+
+bool
+CompiledExpression::evaluate(double time,
+                             ViewIdx view,
+                             int dimension,
+                             Value* result) const
+{
+    Value stack[NATRON_COMPILED_EXPRESSION_MAX_STACK];
+    int top = 0; // number of values on the stack
+
+    for (std::vector<Instruction>::const_iterator it = _code.begin(); it != _code.end(); ++it) {
+        switch (it->op) {
+        case eOpConstant:
+            stack[top++] = it->constant;
+            break;
+        case eOpFrame:
+            // The interpreter receives the time printed with operator<<, i.e: an int if it is integral
+            stack[top].value = time;
+            stack[top].isInt = ( time == std::floor(time) ) && (std::fabs(time) < 1e6);
+            ++top;
+            break;
+        case eOpView:
+            stack[top].value = (double)(int)view;
+            stack[top].isInt = true;
+            ++top;
+            break;
+        case eOpDimension:
+            stack[top].value = (double)dimension;
+            stack[top].isInt = true;
+            ++top;
+            break;
+        case eOpNegate:
+            stack[top - 1].value = -stack[top - 1].value;
+            break;
+        case eOpCall: {
+            Value r;
+            top -= it->nArgs;
+            if ( !callFunction(it->index, &stack[top], it->nArgs, &r) ) {
+                return false;
+            }
+            stack[top++] = r;
+            break;
+        }
+        case eOpParam: {
+            const ParamRef& ref = _params[it->index];
+            int dim = 0;
+            if (it->nArgs & PARAM_HAS_DIMENSION) {
+                const Value& d = stack[--top];
+                if ( !d.isInt || (d.value < 0) || (d.value >= ref.nDims) ) {
+                    return false;
+                }
+                dim = (int)d.value;
+            }
+            bool hasTime = (it->nArgs & PARAM_HAS_TIME) != 0;
+            double paramTime = hasTime ? stack[--top].value : 0.;
+            KnobIPtr knob = ref.knob.lock();
+            if (!knob) {
+                return false;
+            }
+            Value& v = stack[top++];
+            switch (ref.type) {
+            case eParamKnobTypeDouble: {
+                KnobDoubleBase* k = static_cast<KnobDoubleBase*>( knob.get() );
+                v.value = hasTime ? k->getValueAtTime(paramTime, dim) : k->getValue(dim);
+                v.isInt = false;
+                break;
+            }
+            case eParamKnobTypeInt: {
+                KnobIntBase* k = static_cast<KnobIntBase*>( knob.get() );
+                v.value = hasTime ? k->getValueAtTime(paramTime, dim) : k->getValue(dim);
+                v.isInt = true;
+                break;
+            }
+            case eParamKnobTypeBool:
+            default: {
+                KnobBoolBase* k = static_cast<KnobBoolBase*>( knob.get() );
+                v.value = ( hasTime ? k->getValueAtTime(paramTime, dim) : k->getValue(dim) ) ? 1. : 0.;
+                v.isInt = true;
+                break;
+            }
+            }
+            break;
+        }
+        default: {
+            Value r;
+            --top;
+            if ( !binaryOp(it->op, stack[top - 1], stack[top], &r) ) {
+                return false;
+            }
+            stack[top - 1] = r;
+            break;
+        }
+        } // switch
+    }
+    assert(top == 1);
+    *result = stack[0];
+
+    return true;
+} // CompiledExpression::evaluate
+
+NATRON_NAMESPACE_EXIT;
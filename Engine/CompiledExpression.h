@@ -0,0 +1,114 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_CompiledExpression_h
+#define Natron_Engine_CompiledExpression_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#endif
+
+#include "Engine/ViewIdx.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER;
+
+class CompiledExpression;
+typedef boost::shared_ptr<const CompiledExpression> CompiledExpressionPtr;
+
+/**
+ * @brief A single-line knob expression translated to native code, so that it can be evaluated
+ * concurrently by render threads without taking the Python GIL.
+ * Only a subset of Python is supported:
+ * - int and float literals, the frame, view and dimension variables, pi and e
+ * - the + - * / // % ** operators and parentheses, with the semantics of the interpreter (e.g: int division)
+ * - the functions of the math module, abs, min, max, int and float
+ * - the functions of ExprUtils taking only numbers
+ * - the get(), get(frame), getValue(dimension) and getValueAtTime(frame, dimension) functions of numeric parameters,
+ * with an optional subscript or x/y/z/r/g/b/a component
+ * Anything else (strings, random, multi-line expressions...) is not compiled and should be evaluated by Python.
+ **/
+class CompiledExpression
+{
+public:
+
+    /**
+     * @brief A number, remembering whether the interpreter would hold it as an int or a float.
+     **/
+    struct Value
+    {
+        double value;
+        bool isInt;
+    };
+
+    /**
+     * @brief Maps the dotted names of an expression to parameters, e.g: Blur1.size or thisNode.Group1.Blur1.size.
+     **/
+    class Resolver
+    {
+    public:
+
+        virtual ~Resolver() {}
+
+        /**
+         * @brief Returns the parameter designated by the given attribute names, or NULL if the names are unknown.
+         **/
+        virtual KnobIPtr resolveParam(const std::vector<std::string>& names) const = 0;
+    };
+
+    /**
+     * @brief Returns the compiled expression, or NULL if the expression uses something outside of the supported subset.
+     **/
+    static CompiledExpressionPtr compile(const std::string& expression, const Resolver& resolver);
+
+    /**
+     * @brief Evaluates the expression. This is thread-safe and does not take the Python GIL.
+     * @returns False if the interpreter would raise an exception (e.g: division by zero or math domain error),
+     * if the result is out of the range represented exactly, or if a parameter referenced by the expression
+     * no longer exists. The expression should then be evaluated by Python.
+     **/
+    bool evaluate(double time, ViewIdx view, int dimension, Value* result) const;
+
+    ~CompiledExpression();
+
+    struct Instruction;
+    struct ParamRef;
+
+private:
+
+    CompiledExpression();
+
+    std::vector<Instruction> _code;
+    std::vector<ParamRef> _params;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_CompiledExpression_h
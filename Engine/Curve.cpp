@@ -33,9 +33,13 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 #include <boost/math/special_functions/fpclassify.hpp>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #endif
+#include <QtCore/QAtomicInt>
+#include <QtCore/QThreadStorage>
+
 #include "Engine/AppManager.h"
 
 #include "Engine/CurvePrivate.h"
+#include "Engine/Hash64.h"
 #include "Engine/Interpolation.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/KnobFile.h"
@@ -72,6 +76,44 @@ private:
     double _t;
 };
 
+#define NATRON_CURVE_VALUE_CACHE_SIZE 64 // must be a power of 2
+
+// The last values computed by Curve::getValueAt on a thread, for all curves, and the position of the last
+// evaluated time among the keyframes. Being per-thread, it is read and written without any synchronization.
+struct CurveValueCache
+{
+    struct Entry
+    {
+        unsigned int snapshotId; // 0 if the entry is empty
+        double time;
+        double value;
+    };
+
+    Entry entries[NATRON_CURVE_VALUE_CACHE_SIZE];
+    unsigned int hintSnapshotId;
+    int hintIndex; // index of the first keyframe with a time greater than the last evaluated time
+
+    CurveValueCache()
+        : hintSnapshotId(0)
+        , hintIndex(0)
+    {
+        for (int i = 0; i < NATRON_CURVE_VALUE_CACHE_SIZE; ++i) {
+            entries[i].snapshotId = 0;
+            entries[i].time = 0.;
+            entries[i].value = 0.;
+        }
+    }
+
+    static int entryIndex(double time)
+    {
+        // Fibonacci hashing of the bits of the time, which is most often an integer frame
+        return (int)( (Hash64::toU64(time) * 0x9E3779B97F4A7C15ULL) >> 58 ) & (NATRON_CURVE_VALUE_CACHE_SIZE - 1);
+    }
+};
+
+QThreadStorage<CurveValueCache*> curveValueCaches;
+QAtomicInt curveSnapshotsCount;
+
 NATRON_NAMESPACE_ANONYMOUS_EXIT
 
 
@@ -283,6 +325,7 @@ Curve::clearKeyFrames()
     QMutexLocker l(&_imp->_lock);
 
     _imp->keyFrames.clear();
+    onCurveChanged();
 }
 
 bool
@@ -713,10 +756,12 @@ Curve::getKeyFrameWithTime(double time,
 
 /// compute interpolation parameters from keyframes and an iterator
 /// to the next keyframe (the first with time > t)
+/// KeyFrameContainer is either a KeyFrameSet or a vector of keyframes ordered by time
+template <typename KeyFrameContainer>
 static void
-interParams(const KeyFrameSet &keyFrames,
+interParams(const KeyFrameContainer &keyFrames,
             double t,
-            const KeyFrameSet::const_iterator &itup,
+            const typename KeyFrameContainer::const_iterator &itup,
             double *tcur,
             double *vcur,
             double *vcurDerivRight,
@@ -742,7 +787,7 @@ interParams(const KeyFrameSet &keyFrames,
     } else if ( itup == keyFrames.end() ) {
         //if we found no key that has a greater time
         // get the last keyframe
-        KeyFrameSet::const_reverse_iterator itlast = keyFrames.rbegin();
+        typename KeyFrameContainer::const_reverse_iterator itlast = keyFrames.rbegin();
         *tcur = itlast->getTime();
         *vcur = itlast->getValue();
         *vcurDerivRight = itlast->getRightDerivative();
@@ -754,7 +799,7 @@ interParams(const KeyFrameSet &keyFrames,
     } else {
         // between two keyframes
         // get the last keyframe with time <= t
-        KeyFrameSet::const_iterator itcur = itup;
+        typename KeyFrameContainer::const_iterator itcur = itup;
         --itcur;
         assert(itcur->getTime() <= t);
         *tcur = itcur->getTime();
@@ -768,24 +813,55 @@ interParams(const KeyFrameSet &keyFrames,
     }
 }
 
+CurvePrivate::SnapshotPtr
+CurvePrivate::getSnapshot() const
+{
+    SnapshotPtr ret = boost::atomic_load(&snapshot);
+
+    if (ret) {
+        return ret;
+    }
+
+    // The curve changed since the last evaluation: only one thread rebuilds the snapshot
+    QMutexLocker l(&_lock);
+    ret = snapshot;
+    if (!ret) {
+        boost::shared_ptr<Snapshot> newSnapshot(new Snapshot);
+        // 0 is the identifier of the empty entries of the thread value caches
+        do {
+            newSnapshot->id = (unsigned int)curveSnapshotsCount.fetchAndAddRelaxed(1) + 1;
+        } while (newSnapshot->id == 0);
+        newSnapshot->keyFrames.assign( keyFrames.begin(), keyFrames.end() );
+        newSnapshot->type = type;
+        newSnapshot->hasYRange = hasYRange;
+        ret = newSnapshot;
+        boost::atomic_store(&snapshot, ret);
+    }
+
+    return ret;
+}
+
 double
 Curve::getValueAt(double t,
                   bool doClamp) const
 {
-    QMutexLocker l(&_imp->_lock);
+    // This is called by all render threads for every animated parameter: it does not take _lock unless the curve changed
+    CurvePrivate::SnapshotPtr snapshot = _imp->getSnapshot();
+    const std::vector<KeyFrame>& keyFrames = snapshot->keyFrames;
 
-    if ( _imp->keyFrames.empty() ) {
+    if ( keyFrames.empty() ) {
         throw std::runtime_error("Curve has no control points!");
     }
 
+    if ( !curveValueCaches.hasLocalData() ) {
+        curveValueCaches.setLocalData(new CurveValueCache);
+    }
+    CurveValueCache* cache = curveValueCaches.localData();
+    CurveValueCache::Entry& cached = cache->entries[CurveValueCache::entryIndex(t)];
     double v;
-#ifdef NATRON_CURVE_USE_CACHE
-    std::map<double, double>::const_iterator foundCached = _imp->resultCache.find(t);
-    if ( foundCached != _imp->resultCache.end() ) {
-        v = foundCached->second;
-    } else
-#endif
-    {
+    if ( (cached.snapshotId == snapshot->id) && (cached.time == t) ) {
+        v = cached.value;
+    } else {
         // even when there is only one keyframe, there may be tangents!
         //if (_imp->keyFrames.size() == 1) {
         //    //if there's only 1 keyframe, don't bother interpolating
@@ -794,11 +870,27 @@ Curve::getValueAt(double t,
         double tcur, tnext;
         double vcurDerivRight, vnextDerivLeft, vcur, vnext;
         KeyframeTypeEnum interp, interpNext;
-        KeyFrame k(t, 0.);
-        // find the first keyframe with time greater than t
-        KeyFrameSet::const_iterator itup;
-        itup = _imp->keyFrames.upper_bound(k);
-        interParams(_imp->keyFrames,
+
+        // find the first keyframe with time greater than t, starting with the one found by the previous
+        // evaluation on this thread and the next one, since time is often accessed sequentially
+        const int nKeys = (int)keyFrames.size();
+        int up = -1;
+        if (cache->hintSnapshotId == snapshot->id) {
+            for (int i = cache->hintIndex; i <= cache->hintIndex + 1 && i <= nKeys; ++i) {
+                if ( ( (i == 0) || (keyFrames[i - 1].getTime() <= t) ) && ( (i == nKeys) || (t < keyFrames[i].getTime()) ) ) {
+                    up = i;
+                    break;
+                }
+            }
+        }
+        if (up == -1) {
+            up = std::upper_bound( keyFrames.begin(), keyFrames.end(), KeyFrame(t, 0.), KeyFrame_compare_time() ) - keyFrames.begin();
+        }
+        cache->hintSnapshotId = snapshot->id;
+        cache->hintIndex = up;
+
+        std::vector<KeyFrame>::const_iterator itup = keyFrames.begin() + up;
+        interParams(keyFrames,
                     t,
                     itup,
                     &tcur,
@@ -817,16 +909,16 @@ Curve::getValueAt(double t,
                                        t,
                                        interp,
                                        interpNext);
-#ifdef NATRON_CURVE_USE_CACHE
-        _imp->resultCache[t] = v;
-#endif
+        cached.snapshotId = snapshot->id;
+        cached.time = t;
+        cached.value = v;
     }
 
-    if ( doClamp && mustClamp() ) {
+    if ( doClamp && snapshot->hasYRange && _imp->owner.lock() ) {
         v = clampValueToCurveYRange(v);
     }
 
-    switch (_imp->type) {
+    switch (snapshot->type) {
     case CurvePrivate::eCurveTypeString:
     case CurvePrivate::eCurveTypeInt:
 
@@ -1103,6 +1195,27 @@ Curve::getKeyFrames_mt_safe() const
     return _imp->keyFrames;
 }
 
+U64
+Curve::getKeyFramesHash() const
+{
+    QMutexLocker l(&_imp->_lock);
+
+    if (!_imp->keyFramesHashValid) {
+        Hash64 hash;
+        for (KeyFrameSet::const_iterator it = _imp->keyFrames.begin(); it != _imp->keyFrames.end(); ++it) {
+            hash.append( it->getTime() );
+            hash.append( it->getValue() );
+            hash.append( it->getLeftDerivative() );
+            hash.append( it->getRightDerivative() );
+        }
+        hash.computeHash();
+        _imp->keyFramesHash = hash.value();
+        _imp->keyFramesHashValid = true;
+    }
+
+    return _imp->keyFramesHash;
+}
+
 KeyFrameSet::iterator
 Curve::setKeyFrameValueAndTimeNoUpdate(double value,
                                        double time,
@@ -1559,6 +1672,7 @@ Curve::setYRange(double yMin,
     _imp->yMin = yMin;
     _imp->yMax = yMax;
     _imp->hasYRange = true;
+    boost::atomic_store( &_imp->snapshot, CurvePrivate::SnapshotPtr() );
 }
 
 bool
@@ -1584,9 +1698,8 @@ Curve::onCurveChanged()
     if (owner) {
         owner->clearExpressionsResults(_imp->dimensionInOwner);
     }
-#ifdef NATRON_CURVE_USE_CACHE
-    _imp->resultCache.clear();
-#endif
+    _imp->keyFramesHashValid = false;
+    boost::atomic_store( &_imp->snapshot, CurvePrivate::SnapshotPtr() );
 }
 
 void
@@ -258,6 +258,12 @@ public:
 
     KeyFrameSet getKeyFrames_mt_safe() const WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Returns the hash of the time, value and derivatives of all keyframes.
+     * It is cached until the curve changes, so that knobs and items hashing their curves do not go through all keyframes.
+     **/
+    U64 getKeyFramesHash() const WARN_UNUSED_RETURN;
+
     void clearKeyFrames();
 
     /**
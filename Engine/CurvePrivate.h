@@ -27,6 +27,8 @@
 
 #include "Global/Macros.h"
 
+#include <vector>
+
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
 #endif
@@ -39,8 +41,6 @@
 #include "Engine/KnobFile.h"
 #include "Engine/EngineFwd.h"
 
-//#define NATRON_CURVE_USE_CACHE
-
 NATRON_NAMESPACE_ENTER;
 
 struct CurvePrivate
@@ -55,11 +55,28 @@ struct CurvePrivate
         // and times
     };
 
+    /**
+     * @brief An immutable copy of what getValueAt needs, published with boost::atomic_store so that render threads
+     * can evaluate the curve without taking _lock. It is released by onCurveChanged and rebuilt on the next evaluation.
+     **/
+    struct Snapshot
+    {
+        unsigned int id; // unique among all snapshots, identifies the values cached by getValueAt
+        std::vector<KeyFrame> keyFrames; // ordered by time
+        CurveTypeEnum type;
+        bool hasYRange;
+    };
+
+    typedef boost::shared_ptr<const Snapshot> SnapshotPtr;
+
     KeyFrameSet keyFrames;
 
-#ifdef NATRON_CURVE_USE_CACHE
-    std::map<double, double> resultCache; //< a cache for interpolations
-#endif
+    // Read and written with boost::atomic_load and boost::atomic_store. Only set while holding _lock
+    mutable SnapshotPtr snapshot;
+
+    // the hash of keyFrames, valid until the curve changes
+    mutable U64 keyFramesHash;
+    mutable bool keyFramesHashValid;
 
     KnobIWPtr owner;
     int dimensionInOwner;
@@ -73,9 +90,9 @@ struct CurvePrivate
 
     CurvePrivate()
         : keyFrames()
-#ifdef NATRON_CURVE_USE_CACHE
-        , resultCache()
-#endif
+        , snapshot()
+        , keyFramesHash(0)
+        , keyFramesHashValid(false)
         , owner()
         , dimensionInOwner(-1)
         , type(eCurveTypeDouble)
@@ -95,9 +112,17 @@ struct CurvePrivate
         *this = other;
     }
 
+    /**
+     * @brief Returns the snapshot of the curve, building it if the curve changed since the last call.
+     **/
+    SnapshotPtr getSnapshot() const;
+
     void operator=(const CurvePrivate & other)
     {
         keyFrames = other.keyFrames;
+        boost::atomic_store( &snapshot, SnapshotPtr() );
+        keyFramesHash = 0;
+        keyFramesHashValid = false;
         owner = other.owner;
         dimensionInOwner = other.dimensionInOwner;
         isParametric = other.isParametric;
@@ -1743,20 +1743,23 @@ EffectInstance::getImageFromCacheAndConvertIfNeeded(bool /*useCache*/,
         ///A ptr to a higher resolution of the image or an image with different comps/bitdepth
         ImagePtr imageToConvert;
 
+        // Floating point images may have been stored as half floats in the RAM cache, accept them if the project still wants it
+        bool acceptHalfForFloat = bitdepth == eImageBitDepthFloat && storage == eStorageModeRAM && getApp()->getProject()->isHalfFloatCacheEnabled();
+
         for (ImageList::iterator it = cachedImages.begin(); it != cachedImages.end(); ++it) {
             unsigned int imgMMlevel = (*it)->getMipMapLevel();
             const ImageComponents & imgComps = (*it)->getComponents();
             ImageBitDepthEnum imgDepth = (*it)->getBitDepth();
 
             bool convertible = imgComps.isConvertibleTo(components);
-            if ( (imgMMlevel == mipMapLevel) && convertible &&
-                 ( getSizeOfForBitDepth(imgDepth) >= getSizeOfForBitDepth(bitdepth) ) /* && imgComps == components && imgDepth == bitdepth*/ ) {
+            bool deepEnough = ( getSizeOfForBitDepth(imgDepth) >= getSizeOfForBitDepth(bitdepth) ) || (acceptHalfForFloat && imgDepth == eImageBitDepthHalf);
+            if ( (imgMMlevel == mipMapLevel) && convertible && deepEnough /* && imgComps == components && imgDepth == bitdepth*/ ) {
                 ///We found  a matching image
 
                 *image = *it;
                 break;
             } else {
-                if ( !convertible || ( getSizeOfForBitDepth(imgDepth) < getSizeOfForBitDepth(bitdepth) ) ) {
+                if ( !convertible || !deepEnough ) {
                     // not enough components or bit-depth is not as deep, don't use the image
                     continue;
                 }
@@ -2140,20 +2143,11 @@ EffectInstance::renderInputImagesForRoI(const FrameViewRequest* request,
 
 EffectInstance::RenderingFunctorRetEnum
 EffectInstance::Implementation::tiledRenderingFunctor(EffectInstance::Implementation::TiledRenderingFunctorArgs & args,
-                                                      const RectToRender & specificData,
-                                                      QThread* callingThread)
+                                                      const RectToRender & specificData)
 {
-    ///Make the thread-storage live as long as the render action is called if we're in a newly launched thread in eRenderSafetyFullySafeFrame mode
-    QThread* curThread = QThread::currentThread();
-
-    if (callingThread != curThread) {
-        ///We are in the case of host frame threading, see kOfxImageEffectPluginPropHostFrameThreading
-        ///We know that in the renderAction, TLS will be needed, so we do a deep copy of the TLS from the caller thread
-        ///to this thread
-        appPTR->getAppTLS()->copyTLS(callingThread, curThread);
-    }
-
-
+    ///We are in the case of host frame threading, see kOfxImageEffectPluginPropHostFrameThreading
+    ///The ThreadPoolTaskGroup copies the TLS of the calling thread to the threads helping it
+    ///and cleans it up once they are done
     EffectInstance::RenderingFunctorRetEnum ret = tiledRenderingFunctor(specificData,
                                                                         args.glContext,
                                                                         args.renderFullScaleThenDownscale,
@@ -2175,9 +2169,6 @@ EffectInstance::Implementation::tiledRenderingFunctor(EffectInstance::Implementa
                                                                         args.processChannels,
                                                                         args.planes);
 
-    //Exit of the host frame threading thread
-    appPTR->getAppTLS()->cleanupTLSForThread();
-
     return ret;
 }
 
@@ -2953,6 +2944,15 @@ EffectInstance::Implementation::renderHandlerPostProcess(const EffectDataTLSPtr&
                 }
                 it->second.downscaleImage->markForRendered(downscaledRectToRender);
             } // if (renderFullScaleThenDownscale) {
+
+            ///Accumulate the time spent rendering this tile in the cached images, for the cost-aware eviction of the cache
+            if (timeRecorder) {
+                double renderTime = timeRecorder->getTimeSinceCreation();
+                it->second.downscaleImage->addRenderCost(renderTime);
+                if (it->second.fullscaleImage != it->second.downscaleImage) {
+                    it->second.fullscaleImage->addRenderCost(renderTime);
+                }
+            }
         } // if (it->second.isAllocatedOnTheFly) {
 
         if ( frameArgs->stats && frameArgs->stats->isInDepthProfilingEnabled() ) {
@@ -2979,7 +2979,8 @@ EffectInstance::Implementation::setupRenderArgs(const EffectDataTLSPtr& tls,
 {
     const ParallelRenderArgsPtr& frameArgs = tls->frameArgs.back();
 
-    if (frameArgs->stats) {
+    // The render time is also used by the cost-aware eviction policy of the node cache
+    if ( frameArgs->stats || appPTR->isNodeCacheCostAwareEvictionEnabled() ) {
         timeRecorder->reset( new TimeLapse() );
     }
 
@@ -136,6 +136,17 @@ public:
     typedef std::map<int, std::vector<ImageComponents> > ComponentsNeededMap;
     typedef boost::shared_ptr<ComponentsNeededMap> ComponentsNeededMapPtr;
 
+    /**
+     * @brief Input images rendered ahead of a renderRoI call, see prefetchInputImages()
+     **/
+    struct PrefetchedInputImages
+    {
+        InputImagesMap images;
+        RoIMap inputsRoI;
+    };
+
+    typedef boost::shared_ptr<PrefetchedInputImages> PrefetchedInputImagesPtr;
+
     struct RenderRoIArgs
     {
         // Developper note: the fields were reordered to optimize packing.
@@ -166,6 +177,9 @@ public:
         // the time that was passed to the original renderRoI call of the caller node
         double callerRenderTime;
 
+        // If set, the input images are not rendered and these are used instead
+        PrefetchedInputImagesPtr prefetchedInputs;
+
         RenderRoIArgs()
             : time(0)
             , scale(1.)
@@ -182,6 +196,7 @@ public:
             , returnStorage(eStorageModeRAM)
             , allowGPURendering(true)
             , callerRenderTime(0.)
+            , prefetchedInputs()
         {
         }
 
@@ -214,6 +229,7 @@ public:
             , returnStorage(returnStorage)
             , allowGPURendering(true)
             , callerRenderTime(callerRenderTime)
+            , prefetchedInputs()
         {
         }
     };
@@ -570,6 +586,18 @@ public:
     RenderRoIRetCode renderRoI(const RenderRoIArgs & args,
                                std::map<ImageComponents, ImagePtr >* outputPlanes) WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Renders the input images this effect needs to render the given window at scale 1, exactly as
+     * renderRoI() would before calling the render action. Pass them in RenderRoIArgs::prefetchedInputs to a subsequent
+     * renderRoI() call with the same frame TLS so that it does not render them again.
+     * The frame TLS (ParallelRenderArgsSetter) must be set with this effect in the tree.
+     **/
+    RenderRoIRetCode prefetchInputImages(double time,
+                                         ViewIdx view,
+                                         const RectD& rod,
+                                         const EffectInstance::ComponentsNeededMap& neededComps,
+                                         PrefetchedInputImages* inputImages) WARN_UNUSED_RETURN;
+
 
     void getImageFromCacheAndConvertIfNeeded(bool useCache,
                                              bool isDuringPaintStroke,
@@ -2149,6 +2177,15 @@ private:
                                                                  ImagePremultiplicationEnum outputPremult,
                                                                  int channelForAlpha);
 
+    /**
+     * @brief Planes found in the cache are returned as is, except half float planes which are stored
+     * in place of float planes and must be converted back to the requested bit depth.
+     **/
+    static ImagePtr convertCachedHalfPlaneIfNeeded(const AppInstancePtr& app,
+                                                   const ImagePtr& cachedImage,
+                                                   const RectI& roi,
+                                                   ImageBitDepthEnum targetDepth);
+
 
 
 
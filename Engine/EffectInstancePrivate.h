@@ -453,7 +453,6 @@ public:
                                        const OSGLContextAttacherPtr& glContextLocker,
                                        const OSGLContextPtr& glRenderContext,
                                        ImageFieldingOrderEnum fieldingOrder,
-                                       ImageBitDepthEnum outputDepth,
                                        bool fillGrownBoundsWithZeroes,
                                        StorageModeEnum storage,
                                        const std::vector<ImageComponents>& outputComponents,
@@ -528,8 +527,7 @@ public:
     };
     
 
-    RenderingFunctorRetEnum tiledRenderingFunctor(TiledRenderingFunctorArgs & args,  const RectToRender & specificData,
-                                                  QThread* callingThread);
+    RenderingFunctorRetEnum tiledRenderingFunctor(TiledRenderingFunctorArgs & args,  const RectToRender & specificData);
 
     ///These are the image passed to the plug-in to render
     /// - fullscaleMappedImage is the fullscale image remapped to what the plugin can support (components/bitdepth)
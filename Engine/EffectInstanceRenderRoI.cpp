@@ -39,14 +39,13 @@
 #include <QtCore/QThreadPool>
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QCoreApplication>
-#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
-#include <QtConcurrentRun> // QtCore on Qt4, QtConcurrent on Qt5
 
 #if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 // /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
 #include <boost/bind.hpp>
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+#include <boost/function.hpp>
 #endif
 #include <SequenceParsing.h>
 
@@ -77,6 +76,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/RotoContext.h"
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/Settings.h"
+#include "Engine/ThreadPool.h"
 #include "Engine/Timer.h"
 #include "Engine/Transform.h"
 #include "Engine/ViewIdx.h"
@@ -87,6 +87,47 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 NATRON_NAMESPACE_ENTER;
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/*
+ * @brief A task of the ThreadPoolTaskGroup used for host frame threading: renders one of the rectangles.
+ * The rectangles that are not started yet are skipped as soon as one fails or is aborted.
+ */
+class TiledRenderingTask
+{
+public:
+
+    typedef boost::function<EffectInstance::RenderingFunctorRetEnum (const EffectInstance::RectToRender &)> RectFunctor;
+
+    TiledRenderingTask(const RectFunctor& func,
+                       const std::vector<EffectInstance::RectToRender>* rects,
+                       std::vector<EffectInstance::RenderingFunctorRetEnum>* results)
+        : _func(func)
+        , _rects(rects)
+        , _results(results)
+    {
+    }
+
+    bool operator()(int i) const
+    {
+        EffectInstance::RenderingFunctorRetEnum ret = _func( (*_rects)[i] );
+
+        (*_results)[i] = ret;
+
+        return (ret != EffectInstance::eRenderingFunctorRetFailed) &&
+               (ret != EffectInstance::eRenderingFunctorRetAborted) &&
+               (ret != EffectInstance::eRenderingFunctorRetOutOfGPUMemory);
+    }
+
+private:
+
+    RectFunctor _func;
+    const std::vector<EffectInstance::RectToRender>* _rects;
+    std::vector<EffectInstance::RenderingFunctorRetEnum>* _results;
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
 /*
  * @brief Split all rects to render in smaller rects and check if each one of them is identity.
  * For identity rectangles, we just call renderRoI again on the identity input in the tiledRenderingFunctor.
@@ -221,6 +262,19 @@ EffectInstance::convertPlanesFormatsIfNeeded(const AppInstancePtr& app,
     }
 } // EffectInstance::convertPlanesFormatsIfNeeded
 
+ImagePtr
+EffectInstance::convertCachedHalfPlaneIfNeeded(const AppInstancePtr& app,
+                                               const ImagePtr& cachedImage,
+                                               const RectI& roi,
+                                               ImageBitDepthEnum targetDepth)
+{
+    if ( (cachedImage->getBitDepth() != eImageBitDepthHalf) || (targetDepth == eImageBitDepthHalf) ) {
+        return cachedImage;
+    }
+
+    return convertPlanesFormatsIfNeeded(app, cachedImage, roi, cachedImage->getComponents(), targetDepth, false, cachedImage->getPremultiplication(), -1);
+}
+
 void
 EffectInstance::Implementation::determineRectsToRender(ImagePtr& isPlaneCached,
                                                        const ParallelRenderArgsPtr& frameArgs,
@@ -1201,7 +1255,7 @@ EffectInstance::Implementation::renderRoILookupCacheFirstTime(const EffectInstan
                         appPTR->removeFromNodeCache(plane.fullscaleImage);
                         plane.fullscaleImage.reset();
                     } else {
-                        outputPlanes->insert( std::make_pair(*it, plane.fullscaleImage) );
+                        outputPlanes->insert( std::make_pair(*it, convertCachedHalfPlaneIfNeeded(_publicInterface->getApp(), plane.fullscaleImage, roi, args.bitdepth) ) );
                         continue;
                     }
                 }
@@ -1221,7 +1275,7 @@ EffectInstance::Implementation::renderRoILookupCacheFirstTime(const EffectInstan
                                 it2->second.downscaleImage.reset();
                                 newPlanes.insert(*it2);
                             } else {
-                                outputPlanes->insert( std::make_pair(it2->first, it2->second.fullscaleImage) );
+                                outputPlanes->insert( std::make_pair(it2->first, convertCachedHalfPlaneIfNeeded(_publicInterface->getApp(), it2->second.fullscaleImage, roi, args.bitdepth) ) );
                             }
                         } else {
                             newPlanes.insert(*it2);
@@ -1304,7 +1358,12 @@ EffectInstance::Implementation::renderRoIRenderInputImages(const RenderRoIArgs &
             continue;
         }
         RenderRoIRetCode inputCode;
-        {
+        if (args.prefetchedInputs) {
+            // The prefetched images cover the whole window to render
+            it->imgs = args.prefetchedInputs->images;
+            it->inputRois = args.prefetchedInputs->inputsRoI;
+            inputCode = eRenderRoIRetCodeOk;
+        } else {
             RectD canonicalRoI;
             if (renderFullScaleThenDownscale) {
                 it->rect.toCanonical(0, par, rod, &canonicalRoI);
@@ -1467,6 +1526,11 @@ EffectInstance::Implementation::renderRoISecondCacheLookup(const RenderRoIArgs &
             if (it->isIdentity) {
                 continue;
             }
+            if (args.prefetchedInputs) {
+                it->imgs = args.prefetchedInputs->images;
+                it->inputRois = args.prefetchedInputs->inputsRoI;
+                continue;
+            }
 
             RectD canonicalRoI;
             if (renderFullScaleThenDownscale) {
@@ -1507,7 +1571,6 @@ EffectInstance::Implementation::renderRoIAllocateOutputPlanes(const RenderRoIArg
                                                               const OSGLContextAttacherPtr& glContextLocker,
                                                               const OSGLContextPtr& glRenderContext,
                                                               ImageFieldingOrderEnum fieldingOrder,
-                                                              ImageBitDepthEnum outputDepth,
                                                               bool fillGrownBoundsWithZeroes,
                                                               StorageModeEnum storage,
                                                               const std::vector<ImageComponents>& outputComponents,
@@ -1549,12 +1612,23 @@ EffectInstance::Implementation::renderRoIAllocateOutputPlanes(const RenderRoIArg
         RotoDrawableItemPtr rotoItem = _publicInterface->getNode()->getAttachedRotoItem();
         if (!it->second.fullscaleImage) {
             ///The image is not cached
+
+            /*
+             * If requested by the project, floating point images are stored as half floats in the RAM cache.
+             * The plug-in still renders in float in a temporary image (see renderHandlerInternal) and the result
+             * is converted back to float before being returned. Paint buffers are drawn into directly, keep them in float.
+             */
+            ImageBitDepthEnum allocatedDepth = args.bitdepth;
+            if ( createInCache && (args.bitdepth == eImageBitDepthFloat) && (storage == eStorageModeRAM) && !rotoItem &&
+                 !_publicInterface->isPaintingOverItselfEnabled() && _publicInterface->getApp()->getProject()->isHalfFloatCacheEnabled() ) {
+                allocatedDepth = eImageBitDepthHalf;
+            }
             _publicInterface->allocateImagePlane(*key,
                                rod,
                                downscaledImageBounds,
                                upscaledImageBounds,
                                *components,
-                               args.bitdepth,
+                               allocatedDepth,
                                planesToRender->outputPremult,
                                fieldingOrder,
                                par,
@@ -1646,7 +1720,7 @@ EffectInstance::Implementation::renderRoIAllocateOutputPlanes(const RenderRoIArg
                                                            downscaledImageBounds,
                                                            args.mipMapLevel,
                                                            it->second.fullscaleImage->getPixelAspectRatio(),
-                                                           outputDepth,
+                                                           it->second.fullscaleImage->getBitDepth(),
                                                            planesToRender->outputPremult,
                                                            fieldingOrder,
                                                            true) );
@@ -2193,7 +2267,7 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
     ////////////////////////////// Allocate planes in the cache ////////////////////////////////////////////////////////////
 
     if (hasSomethingToRender) {
-        _imp->renderRoIAllocateOutputPlanes(args, frameArgs, planesToRender, glContextLocker, glRenderContext, fieldingOrder, outputDepth, fillGrownBoundsWithZeroes, storage, *outputComponents, rod, upscaledImageBounds, downscaledImageBounds, lastStrokePixelRoD, par, renderFullScaleThenDownscale, createInCache, key);
+        _imp->renderRoIAllocateOutputPlanes(args, frameArgs, planesToRender, glContextLocker, glRenderContext, fieldingOrder, fillGrownBoundsWithZeroes, storage, *outputComponents, rod, upscaledImageBounds, downscaledImageBounds, lastStrokePixelRoD, par, renderFullScaleThenDownscale, createInCache, key);
     }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -2237,6 +2311,65 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
     return eRenderRoIRetCodeOk;
 } // renderRoI
 
+EffectInstance::RenderRoIRetCode
+EffectInstance::prefetchInputImages(double time,
+                                    ViewIdx view,
+                                    const RectD& rod,
+                                    const EffectInstance::ComponentsNeededMap& neededComps,
+                                    PrefetchedInputImages* inputImages)
+{
+    ParallelRenderArgsPtr frameArgs = getParallelRenderArgsTLS();
+
+    if (!frameArgs) {
+        return eRenderRoIRetCodeFailed;
+    }
+    const FrameViewRequest* requestPassData = 0;
+    if (frameArgs->request) {
+        requestPassData = frameArgs->request->getFrameViewRequest(time, view);
+    }
+    FramesNeededMap framesNeeded;
+    if (requestPassData) {
+        framesNeeded = requestPassData->globalData.frameViewsNeeded;
+    } else {
+        U64 hash;
+        framesNeeded = getFramesNeeded_public(time, view, &hash);
+    }
+
+    // Concatenate the same transforms as renderRoI() so that the images are those the render action fetches
+    InputMatrixMapPtr transformRedirections;
+    bool useTransforms;
+    if (requestPassData) {
+        transformRedirections.reset(new InputMatrixMap);
+        if (requestPassData->globalData.transforms) {
+            *transformRedirections = *requestPassData->globalData.transforms;
+        }
+        useTransforms = !transformRedirections->empty();
+    } else {
+        useTransforms = appPTR->getCurrentSettings()->isTransformConcatenationEnabled();
+        if (useTransforms) {
+            transformRedirections.reset(new InputMatrixMap);
+            tryConcatenateTransforms( time, view, RenderScale(1.), transformRedirections.get() );
+        }
+    }
+
+    return renderInputImagesForRoI(requestPassData,
+                                   useTransforms,
+                                   eStorageModeRAM,
+                                   time,
+                                   view,
+                                   rod,
+                                   rod,
+                                   transformRedirections,
+                                   0,
+                                   RenderScale(1.),
+                                   false /*useScaleOneInputImages*/,
+                                   false /*byPassCache*/,
+                                   framesNeeded,
+                                   neededComps,
+                                   &inputImages->images,
+                                   &inputImages->inputsRoI);
+}
+
 EffectInstance::RenderRoIStatusEnum
 EffectInstance::renderRoIInternal(const EffectInstancePtr& self,
                                   const U64 frameViewHash,
@@ -2367,7 +2500,6 @@ EffectInstance::renderRoIInternal(const EffectInstancePtr& self,
 
     if (renderStatus != eRenderingFunctorRetFailed) {
         if ( (safety == eRenderSafetyFullySafeFrame) && (planesToRender->rectsToRender.size() > 1) && !planesToRender->useOpenGL ) {
-            QThread* currentThread = QThread::currentThread();
             boost::scoped_ptr<Implementation::TiledRenderingFunctorArgs> tiledArgs(new Implementation::TiledRenderingFunctorArgs);
             tiledArgs->renderFullScaleThenDownscale = renderFullScaleThenDownscale;
             tiledArgs->isRenderResponseToUserInteraction = isRenderMadeInResponseToUserInteraction;
@@ -2393,23 +2525,25 @@ EffectInstance::renderRoIInternal(const EffectInstancePtr& self,
             std::vector<EffectInstance::RenderingFunctorRetEnum> ret( tiledData.size() );
             int i = 0;
             for (std::list<RectToRender>::const_iterator it = planesToRender->rectsToRender.begin(); it != planesToRender->rectsToRender.end(); ++it, ++i) {
-                ret[i] = self->_imp->tiledRenderingFunctor(tiledArgs,
-                                               *it,
-                                               currentThread);
+                ret[i] = self->_imp->tiledRenderingFunctor(*tiledArgs,
+                                               *it);
             }
             std::vector<EffectInstance::RenderingFunctorRetEnum>::const_iterator it2;
 
 #else
 
 
-            QFuture<RenderingFunctorRetEnum> ret = QtConcurrent::mapped( planesToRender->rectsToRender,
-                                                                         boost::bind(&EffectInstance::Implementation::tiledRenderingFunctor,
-                                                                                     self->_imp.get(),
-                                                                                     *tiledArgs,
-                                                                                     _1,
-                                                                                     currentThread) );
-            ret.waitForFinished();
-            QFuture<EffectInstance::RenderingFunctorRetEnum>::const_iterator it2;
+            std::vector<RectToRender> rects( planesToRender->rectsToRender.begin(), planesToRender->rectsToRender.end() );
+            std::vector<EffectInstance::RenderingFunctorRetEnum> ret(rects.size(), EffectInstance::eRenderingFunctorRetOK);
+            TiledRenderingTask task(boost::bind(&EffectInstance::Implementation::tiledRenderingFunctor,
+                                                self->_imp.get(),
+                                                *tiledArgs,
+                                                _1),
+                                    &rects,
+                                    &ret);
+            ThreadPoolTaskGroup tiles;
+            tiles.run( (int)rects.size(), task );
+            std::vector<EffectInstance::RenderingFunctorRetEnum>::const_iterator it2;
 
 #endif
             for (it2 = ret.begin(); it2 != ret.end(); ++it2) {
@@ -84,7 +84,9 @@ SOURCES += \
     BezierCP.cpp \
     BlockingBackgroundRender.cpp \
     Cache.cpp \
+    CacheTOC.cpp \
     CLArgs.cpp \
+    CompiledExpression.cpp \
     CoonsRegularization.cpp \
     ColorParser.cpp \
     CreateNodeArgs.cpp \
@@ -108,6 +110,7 @@ SOURCES += \
     GPUContextPool.cpp \
     GroupInput.cpp \
     GroupOutput.cpp \
+    Half.cpp \
     HashableObject.cpp \
     Hash64.cpp \
     HistogramCPU.cpp \
@@ -115,6 +118,7 @@ SOURCES += \
     Image.cpp \
     ImageConvert.cpp \
     ImageCopyChannels.cpp \
+    ImageDownscale.cpp \
     ImageComponents.cpp \
     ImageKey.cpp \
     ImageMaskMix.cpp \
@@ -129,6 +133,7 @@ SOURCES += \
     Lut.cpp \
     Markdown.cpp \
     MemoryFile.cpp \
+    MultiThreadWorkerPool.cpp \
     Node.cpp \
     NodeGroup.cpp \
     NodeMetadata.cpp \
@@ -153,6 +158,7 @@ SOURCES += \
     OutputEffectInstance.cpp \
     OutputSchedulerThread.cpp \
     ParallelRenderArgs.cpp \
+    ParallelRenderTuner.cpp \
     Plugin.cpp \
     PluginMemory.cpp \
     PrecompNode.cpp \
@@ -168,6 +174,7 @@ SOURCES += \
     PyRoto.cpp \
     PySideCompat.cpp \
     PyTracker.cpp \
+    RamBufferPool.cpp \
     ReadNode.cpp \
     RectD.cpp \
     RectI.cpp \
@@ -182,6 +189,7 @@ SOURCES += \
     RotoShapeRenderNode.cpp \
     RotoShapeRenderNodePrivate.cpp \
     RotoShapeRenderCairo.cpp \
+    RotoShapeRenderCPU.cpp \
     RotoShapeRenderGL.cpp \
     RotoStrokeItem.cpp \
     RotoUndoCommand.cpp \
@@ -202,6 +210,8 @@ SOURCES += \
     TrackerContext.cpp \
     TrackerContextPrivate.cpp \
     TrackerFrameAccessor.cpp \
+    TrackerFrameAccessorCache.cpp \
+    TrackerImageConversion.cpp \
     TrackMarker.cpp \
     TrackerNode.cpp \
     TrackerNodeInteract.cpp \
@@ -210,7 +220,9 @@ SOURCES += \
     Transform.cpp \
     Utils.cpp \
     ViewerInstance.cpp \
+    ViewerTextureConversion.cpp \
     ViewerNode.cpp \
+    ViewerSpeculativeRenderPlanner.cpp \
     WriteNode.cpp \
     ../Global/glad_source.c \
     ../Global/ProcInfo.cpp \
@@ -278,12 +290,15 @@ HEADERS += \
     BezierCP.h \
     BezierCPPrivate.h \
     BlockingBackgroundRender.h \
+    BoundedFrameQueue.h \
     BufferableObject.h \
     CLArgs.h \
     Cache.h \
     CacheEntry.h \
+    CacheTOC.h \
     CoonsRegularization.h \
     ColorParser.h \
+    CompiledExpression.h \
     CreateNodeArgs.h \
     Curve.h \
     CurvePrivate.h \
@@ -311,12 +326,14 @@ HEADERS += \
     GPUContextPool.h \
     GroupInput.h \
     GroupOutput.h \
+    Half.h \
     HashableObject.h \
     Hash64.h \
     HistogramCPU.h \
     HostOverlaySupport.h \
     Image.h \
     ImageComponents.h \
+    ImageDownscale.h \
     ImageKey.h \
     ImageLocker.h \
     ImageParams.h \
@@ -337,6 +354,7 @@ HEADERS += \
     Markdown.h \
     MemoryFile.h \
     MergingEnum.h \
+    MultiThreadWorkerPool.h \
     Node.h \
     Noise.h \
     NoiseTables.h \
@@ -366,6 +384,7 @@ HEADERS += \
     OutputSchedulerThread.h \
     OverlaySupport.h \
     ParallelRenderArgs.h \
+    ParallelRenderTuner.h \
     Plugin.h \
     PluginActionShortcut.h \
     PluginMemory.h \
@@ -383,6 +402,7 @@ HEADERS += \
     PyTracker.h \
     Pyside_Engine_Python.h \
     PyPanelI.h \
+    RamBufferPool.h \
     ReadNode.h \
     RectD.h \
     RectI.h \
@@ -399,6 +419,7 @@ HEADERS += \
     RotoShapeRenderNode.h \
     RotoShapeRenderNodePrivate.h \
     RotoShapeRenderCairo.h \
+    RotoShapeRenderCPU.h \
     RotoShapeRenderGL.h \
     RotoStrokeItem.h \
     RotoUndoCommand.h \
@@ -422,6 +443,8 @@ HEADERS += \
     TrackerContext.h \
     TrackerContextPrivate.h \
     TrackerFrameAccessor.h \
+    TrackerFrameAccessorCache.h \
+    TrackerImageConversion.h \
     TrackerNode.h \
     TrackerNodeInteract.h \
     TrackerUndoCommand.h \
@@ -435,9 +458,12 @@ HEADERS += \
     Variant.h \
     ViewerInstance.h \
     ViewerInstancePrivate.h \
+    ViewerTextureConversion.h \
     ViewerNode.h \
+    ViewerSpeculativeRenderPlanner.h \
     ViewIdx.h \
     WriteNode.h \
+    ../Global/CPUFeatures.h \
     ../Global/Enums.h \
     ../Global/GitVersion.h \
     ../Global/glad_include.h \
@@ -221,6 +221,7 @@ class RectI;
 class RenderEngine;
 class RenderStats;
 class RenderingFlagSetter;
+class RotoBezierTessellationCache;
 class RotoContext;
 class RotoDrawableItem;
 class RotoItem;
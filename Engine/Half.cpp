@@ -0,0 +1,131 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Half.h"
+
+#ifdef NATRON_HAS_AVX2
+#include <immintrin.h>
+#endif
+
+NATRON_NAMESPACE_ENTER;
+
+namespace HalfConversion {
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/////////////////////////// Scalar versions, these are the reference implementations
+
+void
+floatToHalfRow_scalar(const float* src,
+                      int n,
+                      Half* dst)
+{
+    for (int i = 0; i < n; ++i) {
+        dst[i] = Half(src[i]);
+    }
+}
+
+void
+halfToFloatRow_scalar(const Half* src,
+                      int n,
+                      float* dst)
+{
+    for (int i = 0; i < n; ++i) {
+        dst[i] = src[i];
+    }
+}
+
+/////////////////////////// F16C versions
+
+#ifdef NATRON_HAS_AVX2
+
+NATRON_TARGET_F16C
+void
+floatToHalfRow_f16c(const float* src,
+                    int n,
+                    Half* dst)
+{
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        _mm_storeu_si128( (__m128i*)(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT) );
+    }
+    floatToHalfRow_scalar(src + i, n - i, dst + i);
+}
+
+NATRON_TARGET_F16C
+void
+halfToFloatRow_f16c(const Half* src,
+                    int n,
+                    float* dst)
+{
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps( dst + i, _mm256_cvtph_ps( _mm_loadu_si128( (const __m128i*)(src + i) ) ) );
+    }
+    halfToFloatRow_scalar(src + i, n - i, dst + i);
+}
+
+#endif // NATRON_HAS_AVX2
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+floatToHalfRow(InstructionSetEnum instructionSet,
+               const float* src,
+               int n,
+               Half* dst)
+{
+#ifdef NATRON_HAS_AVX2
+    if ( (instructionSet == eInstructionSetAVX2) && cpuHasF16C() ) {
+        floatToHalfRow_f16c(src, n, dst);
+
+        return;
+    }
+#else
+    Q_UNUSED(instructionSet);
+#endif
+    floatToHalfRow_scalar(src, n, dst);
+}
+
+void
+halfToFloatRow(InstructionSetEnum instructionSet,
+               const Half* src,
+               int n,
+               float* dst)
+{
+#ifdef NATRON_HAS_AVX2
+    if ( (instructionSet == eInstructionSetAVX2) && cpuHasF16C() ) {
+        halfToFloatRow_f16c(src, n, dst);
+
+        return;
+    }
+#else
+    Q_UNUSED(instructionSet);
+#endif
+    halfToFloatRow_scalar(src, n, dst);
+}
+} // namespace HalfConversion
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,168 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_Half_h
+#define Natron_Engine_Half_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <cstring> // memcpy
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+#include "Global/CPUFeatures.h"
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief A 16-bit IEEE 754 floating point number, the pixel type of eImageBitDepthHalf images.
+ * It converts implicitly from and to float, so that it can be used as the PIX parameter of the image
+ * processing templates, with a maxValue of 1 as for float. Conversions round to nearest even and
+ * preserve infinities and NaNs. Use the functions of the HalfConversion namespace to convert whole rows.
+ **/
+class Half
+{
+public:
+
+    // Left uninitialized, as the built-in pixel types
+    Half() {}
+
+    Half(float f)
+        : _bits( floatToBits(f) )
+    {
+    }
+
+    operator float() const
+    {
+        return bitsToFloat(_bits);
+    }
+
+    unsigned short bits() const
+    {
+        return _bits;
+    }
+
+    static Half fromBits(unsigned short bits)
+    {
+        Half h;
+
+        h._bits = bits;
+
+        return h;
+    }
+
+    static unsigned short floatToBits(float f)
+    {
+        U32 x;
+
+        std::memcpy( &x, &f, sizeof(x) );
+
+        const unsigned short sign = (unsigned short)( (x >> 16) & 0x8000 );
+        x &= 0x7fffffff;
+        if (x >= 0x7f800000) {
+            // Infinity, or NaN which is made quiet
+            return sign | 0x7c00 | ( x > 0x7f800000 ? ( 0x200 | ( (x >> 13) & 0x3ff ) ) : 0 );
+        }
+        if (x >= 0x477ff000) {
+            // Rounds to a value larger than the largest half (65504)
+            return sign | 0x7c00;
+        }
+        if (x < 0x38800000) {
+            // Smaller than the smallest normalized half (2^-14): denormalized or zero
+            if (x < 0x33000000) {
+                return sign;
+            }
+            const int shift = 126 - (int)(x >> 23);
+            const U32 mantissa = (x & 0x7fffff) | 0x800000;
+            U32 h = mantissa >> shift;
+            const U32 remainder = mantissa & ( (1u << shift) - 1 );
+            const U32 halfway = 1u << (shift - 1);
+            if ( (remainder > halfway) || ( (remainder == halfway) && (h & 1) ) ) {
+                ++h;
+            }
+
+            return sign | (unsigned short)h;
+        }
+        // Rebias the exponent, then round the mantissa (a carry correctly increments the exponent)
+        U32 h = (x - 0x38000000) >> 13;
+        const U32 remainder = x & 0x1fff;
+        if ( (remainder > 0x1000) || ( (remainder == 0x1000) && (h & 1) ) ) {
+            ++h;
+        }
+
+        return sign | (unsigned short)h;
+    }
+
+    static float bitsToFloat(unsigned short h)
+    {
+        const U32 sign = (U32)(h & 0x8000) << 16;
+        U32 exponent = (h >> 10) & 0x1f;
+        U32 mantissa = h & 0x3ff;
+        U32 x;
+
+        if (exponent == 0) {
+            if (mantissa == 0) {
+                x = sign;
+            } else {
+                // Denormalized half, normalized float
+                exponent = 113;
+                while ( !(mantissa & 0x400) ) {
+                    mantissa <<= 1;
+                    --exponent;
+                }
+                x = sign | (exponent << 23) | ( (mantissa & 0x3ff) << 13 );
+            }
+        } else if (exponent == 0x1f) {
+            x = sign | 0x7f800000 | (mantissa << 13) | (mantissa ? 0x400000 : 0);
+        } else {
+            x = sign | ( (exponent + 112) << 23 ) | (mantissa << 13);
+        }
+        float f;
+        std::memcpy( &f, &x, sizeof(f) );
+
+        return f;
+    }
+
+private:
+
+    unsigned short _bits;
+};
+
+/**
+ * @brief Conversions of rows of pixels between float and half, using the F16C instructions when the
+ * instruction set is AVX2 and the CPU supports them. All instruction sets give the same results.
+ **/
+namespace HalfConversion {
+void floatToHalfRow(InstructionSetEnum instructionSet,
+                    const float* src,
+                    int n,
+                    Half* dst);
+
+void halfToFloatRow(InstructionSetEnum instructionSet,
+                    const Half* src,
+                    int n,
+                    float* dst);
+} // namespace HalfConversion
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_Half_h
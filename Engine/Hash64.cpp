@@ -24,13 +24,9 @@
 
 #include "Hash64.h"
 
-#include <algorithm>  // for std::for_each
 #include <cassert>
 #include <stdexcept>
 
-#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
-#include <boost/crc.hpp>
-#endif
 #include <QtCore/QString>
 
 #include "Engine/Node.h"
@@ -38,24 +34,95 @@
 
 NATRON_NAMESPACE_ENTER;
 
+// XXH64 constants and rounds
+#define NATRON_XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define NATRON_XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define NATRON_XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define NATRON_XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define NATRON_XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+static inline U64
+rotl64(U64 x,
+       int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline U64
+xxhRound(U64 acc,
+         U64 input)
+{
+    acc += input * NATRON_XXH_PRIME64_2;
+    acc = rotl64(acc, 31);
+
+    return acc * NATRON_XXH_PRIME64_1;
+}
+
+static inline U64
+xxhMergeRound(U64 acc,
+              U64 val)
+{
+    acc ^= xxhRound(0, val);
+
+    return acc * NATRON_XXH_PRIME64_1 + NATRON_XXH_PRIME64_4;
+}
+
+void
+Hash64::consumeStripe()
+{
+    for (int i = 0; i < 4; ++i) {
+        accumulators[i] = xxhRound(accumulators[i], stripe[i]);
+    }
+    nStripeLanes = 0;
+    nLanes += 4;
+}
+
 void
 Hash64::computeHash()
 {
-    if ( node_values.empty() ) {
+    const U64 totalLanes = nLanes + nStripeLanes;
+
+    if (totalLanes == 0) {
         return;
     }
 
-    const unsigned char* data = reinterpret_cast<const unsigned char*>( &node_values.front() );
-    boost::crc_optimal<64, 0x42F0E1EBA9EA3693ULL, 0, 0, false, false> crc_64;
-    crc_64 = std::for_each( data, data + node_values.size() * sizeof(node_values[0]), crc_64 );
-    hash = crc_64();
+    U64 h;
+    if (nLanes > 0) {
+        h = rotl64(accumulators[0], 1) + rotl64(accumulators[1], 7) + rotl64(accumulators[2], 12) + rotl64(accumulators[3], 18);
+        for (int i = 0; i < 4; ++i) {
+            h = xxhMergeRound(h, accumulators[i]);
+        }
+    } else {
+        h = NATRON_XXH_PRIME64_5;
+    }
+    h += totalLanes * sizeof(U64);
+
+    // the values of the incomplete stripe
+    for (int i = 0; i < nStripeLanes; ++i) {
+        h ^= xxhRound(0, stripe[i]);
+        h = rotl64(h, 27) * NATRON_XXH_PRIME64_1 + NATRON_XXH_PRIME64_4;
+    }
+
+    // avalanche
+    h ^= h >> 33;
+    h *= NATRON_XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= NATRON_XXH_PRIME64_3;
+    h ^= h >> 32;
+
+    hash = h;
 }
 
 void
 Hash64::reset()
 {
-    node_values.clear();
     hash = 0;
+    accumulators[0] = NATRON_XXH_PRIME64_1 + NATRON_XXH_PRIME64_2;
+    accumulators[1] = NATRON_XXH_PRIME64_2;
+    accumulators[2] = 0;
+    accumulators[3] = 0 - NATRON_XXH_PRIME64_1;
+    nStripeLanes = 0;
+    nLanes = 0;
 }
 
 void
@@ -69,14 +136,7 @@ Hash64::appendQString(const QString & str, Hash64* hash)
 void
 Hash64::appendCurve(const CurvePtr& curve, Hash64* hash)
 {
-    KeyFrameSet keys = curve->getKeyFrames_mt_safe();
-    for (KeyFrameSet::const_iterator it = keys.begin(); it!=keys.end(); ++it) {
-        hash->append(it->getTime());
-        hash->append(it->getValue());
-        hash->append(it->getLeftDerivative());
-        hash->append(it->getRightDerivative());
-    }
+    hash->append( curve->getKeyFramesHash() );
 }
 
-
 NATRON_NAMESPACE_EXIT;
@@ -27,7 +27,6 @@
 
 #include "Global/Macros.h"
 
-#include <vector>
 #include <string>
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/static_assert.hpp>
@@ -38,9 +37,13 @@
 
 NATRON_NAMESPACE_ENTER;
 
-/*The hash of a Node is the checksum of the vector of data containing:
+/*The hash of a Node is the checksum of the data containing:
     - the values of the current knob for this node + the name of the node
     - the hash values for the  tree upstream
+
+   The data is hashed while it is appended, with the 64-bit variant of xxHash (https://github.com/Cyan4973/xxHash),
+   without any memory allocation. The hash is the XXH64 (seed 0) of the appended values, each one stored as
+   8 little-endian bytes: it does not depend on the session and can be used to identify entries of the disk cache.
  */
 
 class Hash64
@@ -48,12 +51,11 @@ class Hash64
 public:
     Hash64()
     {
-        hash = 0;
+        reset();
     }
 
     ~Hash64()
     {
-        node_values.clear();
     }
 
     U64 value() const
@@ -61,6 +63,10 @@ public:
         return hash;
     }
 
+    /**
+     * @brief Sets value() to the hash of all the values appended since the last reset().
+     * More values may be appended afterwards, and the hash computed again.
+     **/
     void computeHash();
 
     void reset();
@@ -86,11 +92,14 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
     template<typename T>
     void append(T value)
     {
-        node_values.push_back( toU64(value) );
+        appendU64( toU64(value) );
     }
 
     static void appendQString(const QString & str, Hash64* hash);
 
+    /**
+     * @brief Appends the hash of the keyframes of the curve, which is cached by the curve.
+     **/
     static void appendCurve(const CurvePtr& curve, Hash64* hash);
 
     bool operator== (const Hash64 & h) const
@@ -119,8 +128,21 @@ private:
         };
     };
 
+    void appendU64(U64 lane)
+    {
+        stripe[nStripeLanes++] = lane;
+        if (nStripeLanes == 4) {
+            consumeStripe();
+        }
+    }
+
+    void consumeStripe();
+
     U64 hash;
-    std::vector<U64> node_values;
+    U64 accumulators[4]; // the state of the hash of the stripes of 4 values consumed so far
+    U64 stripe[4]; // the values of the stripe being appended
+    int nStripeLanes; // number of values in stripe
+    U64 nLanes; // number of values consumed in full stripes
 };
 
 
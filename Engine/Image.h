@@ -39,6 +39,7 @@ CLANG_DIAG_OFF(deprecated)
 CLANG_DIAG_ON(deprecated)
 #include <QtCore/QReadWriteLock>
 
+#include "Engine/Half.h"
 #include "Engine/ImageKey.h"
 #include "Engine/ImageComponents.h"
 #include "Engine/ImageParams.h"
@@ -882,6 +883,19 @@ private:
                                bool requiresUnpremult,
                                Image* dstImg) const;
 
+    /**
+     * @brief Conversions from or to a half-float image: same components and color-space conversions between half and float
+     * are done row by row with HalfConversion, other conversions go through a float image.
+     **/
+    void convertToFormatHalf(const RectI & renderWindow,
+                             ViewerColorSpaceEnum srcColorSpace,
+                             ViewerColorSpaceEnum dstColorSpace,
+                             int channelForAlpha,
+                             bool useAlpha0,
+                             bool copyBitMap,
+                             bool requiresUnpremult,
+                             Image* dstImg) const;
+
     template <typename PIX, bool doPremult>
     void premultInternal(const RectI& roi);
     template <bool doPremult>
@@ -1042,25 +1056,12 @@ private:
 
 
     /**
-     * @brief Halve the given roi of this image into output.
-     * If the RoI bounds are odd, the largest enclosing RoI with even bounds will be considered.
+     * @brief Downscales the given roi of this image by 2^levels into output in a single pass,
+     * levels being at most NATRON_IMAGE_DOWNSCALE_MAX_FUSED_LEVELS.
+     * If the RoI bounds are not multiples of 2^levels, the smallest enclosing RoI will be considered.
      **/
-    void halveRoI(const RectI & roi, bool copyBitMap,
-                  Image* output) const;
-
-
-    template <typename PIX, int maxValue>
-    void halveRoIForDepth(const RectI & roi,
-                          bool copyBitMap,
-                          Image* output) const;
-
-    /**
-     * @brief Same as halveRoI but for 1D only (either width == 1 or height == 1)
-     **/
-    void halve1DImage(const RectI & roi, Image* output) const;
-
-    template <typename PIX, int maxValue>
-    void halve1DImageForDepth(const RectI & roi, Image* output) const;
+    void downscaleRoI(const RectI & roi, unsigned int levels, bool copyBitMap,
+                      Image* output) const;
 
     template <typename PIX, int maxValue>
     void upscaleMipMapForDepth(const RectI & roi, unsigned int fromLevel, unsigned int toLevel, Image* output) const;
@@ -1122,6 +1123,10 @@ template<>
 inline float
 Image::clampIfInt(float v) { return v; }
 
+template<>
+inline Half
+Image::clampIfInt(float v) { return v; }
+
 NATRON_NAMESPACE_EXIT;
 
 #endif // NATRON_ENGINE_IMAGE_H
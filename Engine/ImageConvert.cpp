@@ -26,7 +26,9 @@
 
 #include <algorithm> // min, max
 #include <cassert>
+#include <cstring> // memcpy
 #include <stdexcept>
+#include <vector>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
@@ -162,7 +164,38 @@ Image::convertToFormatInternal_sameComps(const RectI & renderWindow,
     if ( intersection.isNull() ) {
         return;
     }
+
+    // Rows read from 8 or 16 bits in a color-space to linear float, and the table lookups of rows written from linear float
+    // to 8 bits in a color-space, are converted with the row functions of the Lut, which use SIMD instructions
+    const bool linearizeRows = srcLut && !dstLut && (dstDepth == eImageBitDepthFloat) &&
+                               (srcDepth == eImageBitDepthByte || srcDepth == eImageBitDepthShort);
+    const bool lookupRows = dstLut && !srcLut && (srcDepth == eImageBitDepthFloat) && (dstDepth == eImageBitDepthByte);
+    const int rowSize = intersection.width() * nComp;
+    std::vector<unsigned short> uint8xxRow(lookupRows ? rowSize : 0);
     for (int y = 0; y < intersection.height(); ++y) {
+        if (linearizeRows) {
+            const SRCPIX* srcRow = (const SRCPIX*)srcImg.pixelAt(intersection.x1, intersection.y1 + y);
+            float* dstRow = (float*)dstImg.pixelAt(intersection.x1, intersection.y1 + y);
+            if (srcDepth == eImageBitDepthByte) {
+                srcLut->fromColorSpaceUint8ToLinearFloatFast( (const unsigned char*)srcRow, rowSize, dstRow );
+            } else {
+                srcLut->fromColorSpaceUint16ToLinearFloatFast( (const unsigned short*)srcRow, rowSize, dstRow );
+            }
+            if (nComp == 4) {
+                // alpha is linear
+                for (int i = 3; i < rowSize; i += 4) {
+                    dstRow[i] = convertPixelDepth<SRCPIX, float>(srcRow[i]);
+                }
+            }
+            if (copyBitmap) {
+                dstImg.copyBitmapRowPortion(intersection.x1, intersection.x2, intersection.y1 + y, srcImg);
+            }
+            continue;
+        }
+        if (lookupRows) {
+            dstLut->toColorSpaceUint8xxFromLinearFloatFast( (const float*)srcImg.pixelAt(intersection.x1, intersection.y1 + y), rowSize, &uint8xxRow[0] );
+        }
+
         // coverity[dont_call]
         int start = rand() % intersection.width();
         const SRCPIX* srcPixels = (const SRCPIX*)srcImg.pixelAt(intersection.x1 + start, intersection.y1 + y);
@@ -202,8 +235,13 @@ Image::convertToFormatInternal_sameComps(const RectI & renderWindow,
 
                         if (dstDepth == eImageBitDepthByte) {
                             ///small increase in perf we use Luts. This should be anyway the most used case.
-                            error[k] = (error[k] & 0xff) + ( dstLut ? dstLut->toColorSpaceUint8xxFromLinearFloatFast(pixFloat) :
-                                                             Color::floatToInt<0xff01>(pixFloat) );
+                            unsigned short uint8xx;
+                            if (lookupRows) {
+                                uint8xx = uint8xxRow[x * nComp + k];
+                            } else {
+                                uint8xx = dstLut ? dstLut->toColorSpaceUint8xxFromLinearFloatFast(pixFloat) : Color::floatToInt<0xff01>(pixFloat);
+                            }
+                            error[k] = (error[k] & 0xff) + uint8xx;
                             pix = error[k] >> 8;
                         } else if (dstDepth == eImageBitDepthShort) {
                             pix = dstLut ? dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat) :
@@ -306,7 +344,21 @@ Image::convertToFormatInternalForColorSpace(const RectI & renderWindow,
     const Color::Lut* const srcLut = useColorspaces ? lutFromColorspace( (ViewerColorSpaceEnum)srcColorSpace ) : 0;
     const Color::Lut* const dstLut = useColorspaces ? lutFromColorspace( (ViewerColorSpaceEnum)dstColorSpace ) : 0;
 
+    // 8 and 16 bits rows in a color-space are converted to linear float beforehand by the row functions of the Lut,
+    // which use SIMD instructions
+    const bool linearizeRows = srcLut && !requiresUnpremult && (srcNComps > 1) && (dstNComps > 1) &&
+                               (srcMaxValue == 255 || srcMaxValue == 65535);
+    std::vector<float> linearRow(linearizeRows ? renderWindow.width() * srcNComps : 0);
+
     for (int y = 0; y < renderWindow.height(); ++y) {
+        if (linearizeRows) {
+            const SRCPIX* srcRow = (const SRCPIX*)srcImg.pixelAt(renderWindow.x1, renderWindow.y1 + y);
+            if (srcMaxValue == 255) {
+                srcLut->fromColorSpaceUint8ToLinearFloatFast( (const unsigned char*)srcRow, (int)linearRow.size(), &linearRow[0] );
+            } else {
+                srcLut->fromColorSpaceUint16ToLinearFloatFast( (const unsigned short*)srcRow, (int)linearRow.size(), &linearRow[0] );
+            }
+        }
         ///Start of the line for error diffusion
         // coverity[dont_call]
         int start = rand() % renderWindow.width();
@@ -403,6 +455,8 @@ Image::convertToFormatInternalForColorSpace(const RectI & renderWindow,
                                     if (srcLut) {
                                         pixFloat = srcLut->fromColorSpaceFloatToLinearFloat(pixFloat);
                                     }
+                                } else if (linearizeRows) {
+                                    pixFloat = linearRow[x * srcNComps + k];
                                 } else if (srcLut) {
                                     if (srcMaxValue == 255) {
                                         pixFloat = srcLut->fromColorSpaceUint8ToLinearFloatFast(sourcePixel);
@@ -664,6 +718,67 @@ Image::convertToFormatInternalForDepth(const RectI & renderWindow,
     } // switch
 } // Image::convertToFormatInternalForDepth
 
+void
+Image::convertToFormatHalf(const RectI & renderWindow,
+                           ViewerColorSpaceEnum srcColorSpace,
+                           ViewerColorSpaceEnum dstColorSpace,
+                           int channelForAlpha,
+                           bool useAlpha0,
+                           bool copyBitmap,
+                           bool requiresUnpremult,
+                           Image* dstImg) const
+{
+    const ImageBitDepthEnum srcDepth = getBitDepth();
+    const ImageBitDepthEnum dstDepth = dstImg->getBitDepth();
+
+    assert(srcDepth == eImageBitDepthHalf || dstDepth == eImageBitDepthHalf);
+    const bool floatingPoint = (srcDepth == eImageBitDepthHalf || srcDepth == eImageBitDepthFloat) &&
+                               (dstDepth == eImageBitDepthHalf || dstDepth == eImageBitDepthFloat);
+    if ( floatingPoint && ( dstImg->getComponentsCount() == getComponentsCount() ) &&
+         ( lutFromColorspace(srcColorSpace) == lutFromColorspace(dstColorSpace) ) ) {
+        QWriteLocker k(&dstImg->_entryLock);
+        QReadLocker k2(&_entryLock);
+
+        assert( _bounds.contains(renderWindow) &&  dstImg->_bounds.contains(renderWindow) );
+
+        RectI intersection;
+        if ( !renderWindow.intersect(_bounds, &intersection) ) {
+            return;
+        }
+        const InstructionSetEnum instructionSet = getBestInstructionSet();
+        const int rowElements = intersection.width() * (int)getComponentsCount();
+        for (int y = intersection.y1; y < intersection.y2; ++y) {
+            const unsigned char* srcRow = pixelAt(intersection.x1, y);
+            unsigned char* dstRow = dstImg->pixelAt(intersection.x1, y);
+            if (srcDepth == dstDepth) {
+                std::memcpy( dstRow, srcRow, rowElements * sizeof(Half) );
+            } else if (srcDepth == eImageBitDepthHalf) {
+                HalfConversion::halfToFloatRow( instructionSet, (const Half*)srcRow, rowElements, (float*)dstRow );
+            } else {
+                HalfConversion::floatToHalfRow( instructionSet, (const float*)srcRow, rowElements, (Half*)dstRow );
+            }
+            if (copyBitmap) {
+                dstImg->copyBitmapRowPortion(intersection.x1, intersection.x2, y, *this);
+            }
+        }
+
+        return;
+    }
+
+    // The half image is converted to or from a float image of the renderWindow, which is converted with the other image
+    if (srcDepth == eImageBitDepthHalf) {
+        Image tmp(getComponents(), getRoD(), renderWindow, getMipMapLevel(), getPixelAspectRatio(), eImageBitDepthFloat,
+                  getPremultiplication(), getFieldingOrder(), copyBitmap);
+        convertToFormatHalf(renderWindow, srcColorSpace, srcColorSpace, -1, false, copyBitmap, false, &tmp);
+        tmp.convertToFormatCommon(renderWindow, srcColorSpace, dstColorSpace, channelForAlpha, useAlpha0, copyBitmap, requiresUnpremult, dstImg);
+    } else {
+        Image tmp(dstImg->getComponents(), dstImg->getRoD(), renderWindow, dstImg->getMipMapLevel(), dstImg->getPixelAspectRatio(), eImageBitDepthFloat,
+                  dstImg->getPremultiplication(), dstImg->getFieldingOrder(), copyBitmap);
+        convertToFormatCommon(renderWindow, srcColorSpace, dstColorSpace, channelForAlpha, useAlpha0, copyBitmap, requiresUnpremult, &tmp);
+        tmp.convertToFormatHalf(renderWindow, dstColorSpace, dstColorSpace, -1, false, copyBitmap, false, dstImg);
+    }
+} // Image::convertToFormatHalf
+
 void
 Image::convertToFormatCommon(const RectI & renderWindow,
                              ViewerColorSpaceEnum srcColorSpace,
@@ -674,6 +789,12 @@ Image::convertToFormatCommon(const RectI & renderWindow,
                              bool requiresUnpremult,
                              Image* dstImg) const
 {
+    if ( (getBitDepth() == eImageBitDepthHalf) || (dstImg->getBitDepth() == eImageBitDepthHalf) ) {
+        convertToFormatHalf(renderWindow, srcColorSpace, dstColorSpace, channelForAlpha, useAlpha0, copyBitmap, requiresUnpremult, dstImg);
+
+        return;
+    }
+
     QWriteLocker k(&dstImg->_entryLock);
     QReadLocker k2(&_entryLock);
 
@@ -695,6 +816,7 @@ Image::convertToFormatCommon(const RectI & renderWindow,
                                                                                              dstColorSpace, copyBitmap);
                 break;
             case eImageBitDepthHalf:
+                assert(false);
                 break;
             case eImageBitDepthFloat:
                 convertToFormatInternal_sameComps<float, unsigned char, 1, 255>(renderWindow, *this, *dstImg,
@@ -721,6 +843,7 @@ Image::convertToFormatCommon(const RectI & renderWindow,
                                                                                                 dstColorSpace, copyBitmap);
                 break;
             case eImageBitDepthHalf:
+                assert(false);
                 break;
             case eImageBitDepthFloat:
                 convertToFormatInternal_sameComps<float, unsigned short, 1, 65535>(renderWindow, *this, *dstImg,
@@ -734,6 +857,7 @@ Image::convertToFormatCommon(const RectI & renderWindow,
         }
 
         case eImageBitDepthHalf:
+            assert(false);
             break;
 
         case eImageBitDepthFloat: {
@@ -749,6 +873,7 @@ Image::convertToFormatCommon(const RectI & renderWindow,
                                                                                    dstColorSpace, copyBitmap);
                 break;
             case eImageBitDepthHalf:
+                assert(false);
                 break;
             case eImageBitDepthFloat:
                 ///Same as a copy
@@ -786,6 +911,7 @@ Image::convertToFormatCommon(const RectI & renderWindow,
                                                                                            copyBitmap, requiresUnpremult);
                 break;
             case eImageBitDepthHalf:
+                assert(false);
                 break;
             case eImageBitDepthFloat:
                 convertToFormatInternalForDepth<float, unsigned char, 1, 255>(renderWindow, *this, *dstImg,
@@ -822,6 +948,7 @@ Image::convertToFormatCommon(const RectI & renderWindow,
 
                 break;
             case eImageBitDepthHalf:
+                assert(false);
                 break;
             case eImageBitDepthFloat:
                 convertToFormatInternalForDepth<float, unsigned short, 1, 65535>(renderWindow, *this, *dstImg,
@@ -837,6 +964,7 @@ Image::convertToFormatCommon(const RectI & renderWindow,
             break;
         }
         case eImageBitDepthHalf:
+            assert(false);
             break;
         case eImageBitDepthFloat: {
             switch ( getBitDepth() ) {
@@ -858,6 +986,7 @@ Image::convertToFormatCommon(const RectI & renderWindow,
 
                 break;
             case eImageBitDepthHalf:
+                assert(false);
                 break;
             case eImageBitDepthFloat:
                 convertToFormatInternalForDepth<float, float, 1, 1>(renderWindow, *this, *dstImg,
@@ -0,0 +1,553 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ImageDownscale.h"
+
+#include <cassert>
+#include <vector>
+#include <algorithm> // min, max
+
+#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
+
+#include <boost/bind.hpp>
+
+#ifdef NATRON_HAS_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef NATRON_HAS_AVX2
+#include <immintrin.h>
+#endif
+
+NATRON_NAMESPACE_ENTER;
+
+namespace ImageDownscale {
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/////////////////////////// Scalar versions, these are the reference implementations
+
+template <typename PIX, typename ACC>
+void
+accumulateRow_scalar(const PIX* src,
+                     int n,
+                     ACC* acc)
+{
+    for (int i = 0; i < n; ++i) {
+        acc[i] += src[i];
+    }
+}
+
+/////////////////////////// SSE2 versions
+
+#ifdef NATRON_HAS_SSE2
+
+void
+accumulateRowFloat_sse2(const float* src,
+                        int n,
+                        float* acc)
+{
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps( acc + i, _mm_add_ps( _mm_loadu_ps(acc + i), _mm_loadu_ps(src + i) ) );
+    }
+    accumulateRow_scalar(src + i, n - i, acc + i);
+}
+
+void
+accumulateRowShort_sse2(const unsigned short* src,
+                        int n,
+                        U32* acc)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i s = _mm_loadu_si128( (const __m128i*)(src + i) );
+        __m128i* a = (__m128i*)(acc + i);
+        _mm_storeu_si128( a, _mm_add_epi32( _mm_loadu_si128(a), _mm_unpacklo_epi16(s, zero) ) );
+        _mm_storeu_si128( a + 1, _mm_add_epi32( _mm_loadu_si128(a + 1), _mm_unpackhi_epi16(s, zero) ) );
+    }
+    accumulateRow_scalar(src + i, n - i, acc + i);
+}
+
+void
+accumulateRowByte_sse2(const unsigned char* src,
+                       int n,
+                       U32* acc)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i s = _mm_loadu_si128( (const __m128i*)(src + i) );
+        __m128i lo = _mm_unpacklo_epi8(s, zero);
+        __m128i hi = _mm_unpackhi_epi8(s, zero);
+        __m128i* a = (__m128i*)(acc + i);
+        _mm_storeu_si128( a, _mm_add_epi32( _mm_loadu_si128(a), _mm_unpacklo_epi16(lo, zero) ) );
+        _mm_storeu_si128( a + 1, _mm_add_epi32( _mm_loadu_si128(a + 1), _mm_unpackhi_epi16(lo, zero) ) );
+        _mm_storeu_si128( a + 2, _mm_add_epi32( _mm_loadu_si128(a + 2), _mm_unpacklo_epi16(hi, zero) ) );
+        _mm_storeu_si128( a + 3, _mm_add_epi32( _mm_loadu_si128(a + 3), _mm_unpackhi_epi16(hi, zero) ) );
+    }
+    accumulateRow_scalar(src + i, n - i, acc + i);
+}
+
+#endif // NATRON_HAS_SSE2
+
+/////////////////////////// AVX2 versions
+
+#ifdef NATRON_HAS_AVX2
+
+NATRON_TARGET_AVX2
+void
+accumulateRowFloat_avx2(const float* src,
+                        int n,
+                        float* acc)
+{
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps( acc + i, _mm256_add_ps( _mm256_loadu_ps(acc + i), _mm256_loadu_ps(src + i) ) );
+    }
+    accumulateRow_scalar(src + i, n - i, acc + i);
+}
+
+NATRON_TARGET_F16C
+void
+accumulateRowHalf_f16c(const Half* src,
+                       int n,
+                       float* acc)
+{
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256 s = _mm256_cvtph_ps( _mm_loadu_si128( (const __m128i*)(src + i) ) );
+        _mm256_storeu_ps( acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), s) );
+    }
+    accumulateRow_scalar(src + i, n - i, acc + i);
+}
+
+NATRON_TARGET_AVX2
+void
+accumulateRowShort_avx2(const unsigned short* src,
+                        int n,
+                        U32* acc)
+{
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i s = _mm256_cvtepu16_epi32( _mm_loadu_si128( (const __m128i*)(src + i) ) );
+        __m256i* a = (__m256i*)(acc + i);
+        _mm256_storeu_si256( a, _mm256_add_epi32(_mm256_loadu_si256(a), s) );
+    }
+    accumulateRow_scalar(src + i, n - i, acc + i);
+}
+
+NATRON_TARGET_AVX2
+void
+accumulateRowByte_avx2(const unsigned char* src,
+                       int n,
+                       U32* acc)
+{
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i s = _mm_loadu_si128( (const __m128i*)(src + i) );
+        __m256i lo = _mm256_cvtepu8_epi32(s);
+        __m256i hi = _mm256_cvtepu8_epi32( _mm_srli_si128(s, 8) );
+        __m256i* a = (__m256i*)(acc + i);
+        _mm256_storeu_si256( a, _mm256_add_epi32(_mm256_loadu_si256(a), lo) );
+        _mm256_storeu_si256( a + 1, _mm256_add_epi32(_mm256_loadu_si256(a + 1), hi) );
+    }
+    accumulateRow_scalar(src + i, n - i, acc + i);
+}
+
+#endif // NATRON_HAS_AVX2
+
+/////////////////////////// Reduction of the accumulated rows
+
+template <typename PIX>
+struct DownscaleTraits;
+
+template <>
+struct DownscaleTraits<float>
+{
+    typedef float AccumType;
+
+    static float average(float sum,
+                         int count)
+    {
+        return sum / count;
+    }
+};
+
+template <>
+struct DownscaleTraits<Half>
+{
+    typedef float AccumType;
+
+    static Half average(float sum,
+                        int count)
+    {
+        return sum / count;
+    }
+};
+
+template <>
+struct DownscaleTraits<unsigned short>
+{
+    typedef U32 AccumType;
+
+    static unsigned short average(U32 sum,
+                                  int count)
+    {
+        return (unsigned short)(sum / (U32)count);
+    }
+};
+
+template <>
+struct DownscaleTraits<unsigned char>
+{
+    typedef U32 AccumType;
+
+    static unsigned char average(U32 sum,
+                                 int count)
+    {
+        return (unsigned char)(sum / (U32)count);
+    }
+};
+
+struct DownscaleArgs
+{
+    InstructionSetEnum instructionSet;
+    ImageBitDepthEnum depth;
+    int nComps;
+    unsigned int levels;
+    RectI srcRoI;
+    RectI dstRoI;
+    const void* srcPixels;
+    const char* srcBitmap;
+    RectI srcBounds;
+    void* dstPixels;
+    char* dstBitmap;
+    RectI dstBounds;
+};
+
+// A band of destination rows
+struct DownscaleBand
+{
+    int y1, y2;
+};
+
+/**
+ * @brief Averages horizontally the blocks of the accumulated source rows of a destination row.
+ * acc holds the sum of rowsCount source rows, from column srcRoI.x1 to srcRoI.x2.
+ **/
+template <typename PIX, int nComps>
+void
+reduceRow(const DownscaleArgs& args,
+          const typename DownscaleTraits<PIX>::AccumType* acc,
+          int rowsCount,
+          PIX* dst)
+{
+    typedef typename DownscaleTraits<PIX>::AccumType ACC;
+    const int blockSize = 1 << args.levels;
+
+    for (int x = args.dstRoI.x1; x < args.dstRoI.x2; ++x, dst += nComps) {
+        const int c1 = std::max(x * blockSize, args.srcRoI.x1);
+        const int c2 = std::min( (x + 1) * blockSize, args.srcRoI.x2 );
+        const ACC* blockStart = acc + (c1 - args.srcRoI.x1) * nComps;
+        ACC sum[nComps];
+        for (int k = 0; k < nComps; ++k) {
+            sum[k] = 0;
+        }
+        for (int c = c1; c < c2; ++c, blockStart += nComps) {
+            for (int k = 0; k < nComps; ++k) {
+                sum[k] += blockStart[k];
+            }
+        }
+        const int count = (c2 - c1) * rowsCount;
+        assert(count > 0);
+        for (int k = 0; k < nComps; ++k) {
+            dst[k] = DownscaleTraits<PIX>::average(sum[k], count);
+        }
+    }
+}
+
+template <typename PIX, int nComps>
+void
+downscaleBandForComponents(const DownscaleArgs& args,
+                           const DownscaleBand& band)
+{
+    typedef typename DownscaleTraits<PIX>::AccumType ACC;
+    const int blockSize = 1 << args.levels;
+    const int srcRowElements = args.srcBounds.width() * nComps;
+    const int dstRowElements = args.dstBounds.width() * nComps;
+    const int accElements = args.srcRoI.width() * nComps;
+    const PIX* const srcRoIStart = (const PIX*)args.srcPixels + (args.srcRoI.y1 - args.srcBounds.y1) * srcRowElements + (args.srcRoI.x1 - args.srcBounds.x1) * nComps;
+    std::vector<ACC> acc(accElements);
+
+    for (int y = band.y1; y < band.y2; ++y) {
+        const int r1 = std::max(y * blockSize, args.srcRoI.y1);
+        const int r2 = std::min( (y + 1) * blockSize, args.srcRoI.y2 );
+        assert(r1 < r2);
+
+        std::fill(acc.begin(), acc.end(), ACC(0));
+        for (int r = r1; r < r2; ++r) {
+            accumulateRow(args.instructionSet, srcRoIStart + (r - args.srcRoI.y1) * srcRowElements, accElements, &acc[0]);
+        }
+
+        PIX* dst = (PIX*)args.dstPixels + (y - args.dstBounds.y1) * dstRowElements + (args.dstRoI.x1 - args.dstBounds.x1) * nComps;
+        reduceRow<PIX, nComps>(args, &acc[0], r2 - r1, dst);
+    }
+}
+
+void
+downscaleBitmapBand(const DownscaleArgs& args,
+                    const DownscaleBand& band)
+{
+    const int blockSize = 1 << args.levels;
+    const int srcRowSize = args.srcBounds.width();
+    const int dstRowSize = args.dstBounds.width();
+
+    for (int y = band.y1; y < band.y2; ++y) {
+        const int r1 = std::max(y * blockSize, args.srcRoI.y1);
+        const int r2 = std::min( (y + 1) * blockSize, args.srcRoI.y2 );
+        char* dst = args.dstBitmap + (y - args.dstBounds.y1) * dstRowSize + (args.dstRoI.x1 - args.dstBounds.x1);
+        for (int x = args.dstRoI.x1; x < args.dstRoI.x2; ++x, ++dst) {
+            const int c1 = std::max(x * blockSize, args.srcRoI.x1);
+            const int c2 = std::min( (x + 1) * blockSize, args.srcRoI.x2 );
+            // Same as halving one level at a time: the pixel is rendered only if all the pixels it covers are rendered.
+            // Pixels being rendered (PIXEL_UNAVAILABLE with the trimap) are considered as not rendered.
+            char rendered = 1;
+            for (int r = r1; r < r2 && rendered; ++r) {
+                const char* src = args.srcBitmap + (r - args.srcBounds.y1) * srcRowSize + (c1 - args.srcBounds.x1);
+                for (int c = c1; c < c2; ++c, ++src) {
+                    if (*src != 1) {
+                        rendered = 0;
+                        break;
+                    }
+                }
+            }
+            *dst = rendered;
+        }
+    }
+}
+
+template <typename PIX>
+void
+downscaleBandForDepth(const DownscaleArgs& args,
+                      const DownscaleBand& band)
+{
+    switch (args.nComps) {
+    case 1:
+        downscaleBandForComponents<PIX, 1>(args, band);
+        break;
+    case 2:
+        downscaleBandForComponents<PIX, 2>(args, band);
+        break;
+    case 3:
+        downscaleBandForComponents<PIX, 3>(args, band);
+        break;
+    case 4:
+        downscaleBandForComponents<PIX, 4>(args, band);
+        break;
+    default:
+        assert(false);
+        break;
+    }
+}
+
+void
+downscaleBand(const DownscaleArgs& args,
+              const DownscaleBand& band)
+{
+    switch (args.depth) {
+    case eImageBitDepthFloat:
+        downscaleBandForDepth<float>(args, band);
+        break;
+    case eImageBitDepthHalf:
+        downscaleBandForDepth<Half>(args, band);
+        break;
+    case eImageBitDepthShort:
+        downscaleBandForDepth<unsigned short>(args, band);
+        break;
+    case eImageBitDepthByte:
+        downscaleBandForDepth<unsigned char>(args, band);
+        break;
+    case eImageBitDepthNone:
+        assert(false);
+        break;
+    }
+    if (args.srcBitmap && args.dstBitmap) {
+        downscaleBitmapBand(args, band);
+    }
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+accumulateRow(InstructionSetEnum instructionSet,
+              const float* src,
+              int n,
+              float* acc)
+{
+    switch (instructionSet) {
+#ifdef NATRON_HAS_AVX2
+    case eInstructionSetAVX2:
+        accumulateRowFloat_avx2(src, n, acc);
+        break;
+#endif
+#ifdef NATRON_HAS_SSE2
+    case eInstructionSetSSE2:
+        accumulateRowFloat_sse2(src, n, acc);
+        break;
+#endif
+    default:
+        accumulateRow_scalar(src, n, acc);
+        break;
+    }
+}
+
+void
+accumulateRow(InstructionSetEnum instructionSet,
+              const Half* src,
+              int n,
+              float* acc)
+{
+#ifdef NATRON_HAS_AVX2
+    if ( (instructionSet == eInstructionSetAVX2) && cpuHasF16C() ) {
+        accumulateRowHalf_f16c(src, n, acc);
+
+        return;
+    }
+#else
+    Q_UNUSED(instructionSet);
+#endif
+    accumulateRow_scalar(src, n, acc);
+}
+
+void
+accumulateRow(InstructionSetEnum instructionSet,
+              const unsigned short* src,
+              int n,
+              U32* acc)
+{
+    switch (instructionSet) {
+#ifdef NATRON_HAS_AVX2
+    case eInstructionSetAVX2:
+        accumulateRowShort_avx2(src, n, acc);
+        break;
+#endif
+#ifdef NATRON_HAS_SSE2
+    case eInstructionSetSSE2:
+        accumulateRowShort_sse2(src, n, acc);
+        break;
+#endif
+    default:
+        accumulateRow_scalar(src, n, acc);
+        break;
+    }
+}
+
+void
+accumulateRow(InstructionSetEnum instructionSet,
+              const unsigned char* src,
+              int n,
+              U32* acc)
+{
+    switch (instructionSet) {
+#ifdef NATRON_HAS_AVX2
+    case eInstructionSetAVX2:
+        accumulateRowByte_avx2(src, n, acc);
+        break;
+#endif
+#ifdef NATRON_HAS_SSE2
+    case eInstructionSetSSE2:
+        accumulateRowByte_sse2(src, n, acc);
+        break;
+#endif
+    default:
+        accumulateRow_scalar(src, n, acc);
+        break;
+    }
+}
+
+void
+downscaleRoI(InstructionSetEnum instructionSet,
+             ImageBitDepthEnum depth,
+             int nComps,
+             unsigned int levels,
+             const RectI& srcRoI,
+             const void* srcPixels,
+             const char* srcBitmap,
+             const RectI& srcBounds,
+             void* dstPixels,
+             char* dstBitmap,
+             const RectI& dstBounds,
+             bool multiThreaded)
+{
+    assert(levels >= 1 && levels <= NATRON_IMAGE_DOWNSCALE_MAX_FUSED_LEVELS);
+    assert( srcBounds.contains(srcRoI) );
+
+    if ( srcRoI.isNull() ) {
+        return;
+    }
+
+    DownscaleArgs args;
+    args.instructionSet = instructionSet;
+    args.depth = depth;
+    args.nComps = nComps;
+    args.levels = levels;
+    args.srcRoI = srcRoI;
+    args.dstRoI = srcRoI.downscalePowerOfTwoSmallestEnclosing(levels);
+    args.srcPixels = srcPixels;
+    args.srcBitmap = srcBitmap;
+    args.srcBounds = srcBounds;
+    args.dstPixels = dstPixels;
+    args.dstBitmap = dstBitmap;
+    args.dstBounds = dstBounds;
+    assert( dstBounds.contains(args.dstRoI) );
+
+    // Each band reads about 64 source rows
+    const int bandHeight = std::max(1, 64 >> levels);
+    std::vector<DownscaleBand> bands;
+    for (int y = args.dstRoI.y1; y < args.dstRoI.y2; y += bandHeight) {
+        DownscaleBand band;
+        band.y1 = y;
+        band.y2 = std::min(y + bandHeight, args.dstRoI.y2);
+        bands.push_back(band);
+    }
+
+    if ( multiThreaded && (bands.size() > 1) && (srcRoI.area() >= NATRON_IMAGE_DOWNSCALE_MIN_PARALLEL_AREA) ) {
+        // Bands write to disjoint rows of the destination
+        QtConcurrent::blockingMap( bands, boost::bind(&downscaleBand, boost::cref(args), _1) );
+    } else {
+        for (std::size_t i = 0; i < bands.size(); ++i) {
+            downscaleBand(args, bands[i]);
+        }
+    }
+} // downscaleRoI
+} // namespace ImageDownscale
+
+NATRON_NAMESPACE_EXIT;
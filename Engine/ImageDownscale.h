@@ -0,0 +1,96 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_ImageDownscale_h
+#define Natron_Engine_ImageDownscale_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+#include "Global/CPUFeatures.h"
+
+#include "Engine/EngineFwd.h"
+#include "Engine/Half.h"
+#include "Engine/RectI.h"
+
+// Maximum number of mipmap levels computed in a single pass by ImageDownscale::downscaleRoI (16:1)
+#define NATRON_IMAGE_DOWNSCALE_MAX_FUSED_LEVELS 4
+
+// Below this number of source pixels the downscale is done on the calling thread only
+#define NATRON_IMAGE_DOWNSCALE_MIN_PARALLEL_AREA (256 * 256)
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief Box filter used to build mipmaps, computing several levels in a single pass over the source.
+ * Each destination pixel is the average of the 2^levels x 2^levels block of source pixels it covers, restricted
+ * to the source RoI. The source rows of a block are first summed with SIMD row kernels (selected at runtime),
+ * then each block is reduced horizontally. Bands of destination rows are processed in parallel.
+ **/
+namespace ImageDownscale {
+/**
+ * @brief Adds a row of n values to the accumulation buffer.
+ **/
+void accumulateRow(InstructionSetEnum instructionSet,
+                   const float* src,
+                   int n,
+                   float* acc);
+void accumulateRow(InstructionSetEnum instructionSet,
+                   const Half* src,
+                   int n,
+                   float* acc);
+void accumulateRow(InstructionSetEnum instructionSet,
+                   const unsigned short* src,
+                   int n,
+                   U32* acc);
+void accumulateRow(InstructionSetEnum instructionSet,
+                   const unsigned char* src,
+                   int n,
+                   U32* acc);
+
+/**
+ * @brief Downscales srcRoI (which must be inside srcBounds) by 2^levels into the destination, whose bounds must
+ * contain srcRoI.downscalePowerOfTwoSmallestEnclosing(levels).
+ * Pixels are packed buffers of nComps components starting at the bottom-left pixel of their bounds.
+ * Bitmaps, if not NULL, have the same bounds as their image: a destination pixel is marked as rendered if all the source pixels
+ * it covers are rendered.
+ * For byte and short images, the average is truncated as in halving one level at a time.
+ * @param levels Must be in [1, NATRON_IMAGE_DOWNSCALE_MAX_FUSED_LEVELS]
+ **/
+void downscaleRoI(InstructionSetEnum instructionSet,
+                  ImageBitDepthEnum depth,
+                  int nComps,
+                  unsigned int levels,
+                  const RectI& srcRoI,
+                  const void* srcPixels,
+                  const char* srcBitmap,
+                  const RectI& srcBounds,
+                  void* dstPixels,
+                  char* dstBitmap,
+                  const RectI& dstBounds,
+                  bool multiThreaded);
+} // namespace ImageDownscale
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_ImageDownscale_h
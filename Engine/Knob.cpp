@@ -46,6 +46,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 #include "Engine/AppInstance.h"
 #include "Engine/AppManager.h"
+#include "Engine/CompiledExpression.h"
 #include "Engine/Curve.h"
 #include "Engine/DockablePanelI.h"
 #include "Engine/Hash64.h"
@@ -238,8 +239,11 @@ struct Expr
 
     //PyObject* code;
 
+    ///The native version of the expression, if it is simple enough to be evaluated without Python
+    CompiledExpressionPtr compiled;
+
     Expr()
-        : expression(), originalExpression(), exprInvalid(), hasRet(false) /*, code(0)*/ {}
+        : expression(), originalExpression(), exprInvalid(), hasRet(false) /*, code(0)*/, compiled() {}
 };
 
 struct KnobHelperPrivate
@@ -511,6 +515,8 @@ struct KnobHelperPrivate
 
     std::string declarePythonVariables(bool addTab, int dimension);
 
+    CompiledExpressionPtr compileExpression(const std::string& expression);
+
     bool shouldUseGuiCurve() const
     {
         if (!holder.lock()) {
@@ -562,6 +568,41 @@ KnobHelper::decrementExpressionRecursionLevel() const
     --tls->expressionRecursionLevel;
 }
 
+void
+KnobHelper::clearExpressionsResults(int dimension)
+{
+    std::set<std::pair<KnobHelper*, int> > visited;
+
+    clearExpressionsResultsRecursive(dimension, &visited);
+}
+
+void
+KnobHelper::clearExpressionsResultsRecursive(int dimension,
+                                             std::set<std::pair<KnobHelper*, int> >* visited)
+{
+    // Expressions may depend on each other
+    if ( !visited->insert( std::make_pair(this, dimension) ).second ) {
+        return;
+    }
+    clearOwnExpressionsResults(dimension);
+
+    // The results of the expressions depending on this dimension are outdated as well
+    ListenerDimsMap listeners;
+    getListeners(listeners);
+    for (ListenerDimsMap::iterator it = listeners.begin(); it != listeners.end(); ++it) {
+        KnobHelperPtr listener = boost::dynamic_pointer_cast<KnobHelper>( it->first.lock() );
+        if (!listener) {
+            continue;
+        }
+        for (std::size_t i = 0; i < it->second.size(); ++i) {
+            const ListenerDim& listenerDim = it->second[i];
+            if ( listenerDim.isListening && listenerDim.isExpr && ( (listenerDim.targetDim == -1) || (listenerDim.targetDim == dimension) ) ) {
+                listener->clearExpressionsResultsRecursive(i, visited);
+            }
+        }
+    }
+}
+
 int
 KnobHelper::getExpressionRecursionLevel() const
 {
@@ -2705,6 +2746,128 @@ KnobHelper::setExpressionInvalid(int dimension,
     }
 } // KnobHelper::setExpressionInvalid
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/**
+ * @brief Resolves the names of an expression to parameters the same way the variables
+ * declared by declarePythonVariables() do.
+ **/
+class ExpressionParamResolver
+    : public CompiledExpression::Resolver
+{
+public:
+
+    ExpressionParamResolver(const NodePtr& node)
+        : _node(node)
+    {
+    }
+
+    virtual ~ExpressionParamResolver() {}
+
+    virtual KnobIPtr resolveParam(const std::vector<std::string>& names) const OVERRIDE FINAL
+    {
+        if ( names.size() < 2 ) {
+            return KnobIPtr();
+        }
+        NodeCollectionPtr collection = _node->getGroup();
+        if (!collection) {
+            return KnobIPtr();
+        }
+        NodePtr node;
+        const std::string& first = names[0];
+        std::size_t i = 1;
+        if (first == "thisNode") {
+            node = _node;
+        } else if (first == "thisGroup") {
+            NodeGroupPtr isParentGrp = toNodeGroup(collection);
+            if (isParentGrp) {
+                node = isParentGrp->getNode();
+            } else {
+                // thisGroup is the app: the next name is a top-level node
+                node = getChild(_node->getApp()->getProject(), names[1]);
+                i = 2;
+            }
+        } else if ( (first == "app") || ( first == _node->getApp()->getAppIDString() ) ) {
+            node = getChild(_node->getApp()->getProject(), names[1]);
+            i = 2;
+        } else {
+            node = getChild(collection, first);
+        }
+
+        // Every name but the last is a node inside a group
+        for (; node && i < names.size() - 1; ++i) {
+            node = getChild( toNodeGroup( node->getEffectInstance() ), names[i] );
+        }
+        if ( !node || (i != names.size() - 1) ) {
+            return KnobIPtr();
+        }
+
+        return node->getKnobByName( names.back() );
+    }
+
+private:
+
+    static NodePtr getChild(const NodeCollectionPtr& collection,
+                            const std::string& name)
+    {
+        if (!collection) {
+            return NodePtr();
+        }
+        NodePtr ret = collection->getNodeByName(name);
+        if ( !ret || !ret->isActivated() || ret->getParentMultiInstance() ) {
+            return NodePtr();
+        }
+
+        return ret;
+    }
+
+    NodePtr _node;
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+CompiledExpressionPtr
+KnobHelperPrivate::compileExpression(const std::string& expression)
+{
+    EffectInstancePtr effect = toEffectInstance( holder.lock() );
+
+    if (!effect) {
+        return CompiledExpressionPtr();
+    }
+    NodePtr node = effect->getNode();
+    if (!node) {
+        return CompiledExpressionPtr();
+    }
+    ExpressionParamResolver resolver(node);
+
+    return CompiledExpression::compile(expression, resolver);
+}
+
+bool
+KnobHelper::evaluateCompiledExpression(double time,
+                                       ViewIdx view,
+                                       int dimension,
+                                       double* value,
+                                       bool* isInt) const
+{
+    CompiledExpressionPtr compiled;
+    {
+        QMutexLocker k(&_imp->expressionMutex);
+        compiled = _imp->expressions[dimension].compiled;
+    }
+    if (!compiled) {
+        return false;
+    }
+    CompiledExpression::Value v;
+    if ( !compiled->evaluate(time, view, dimension, &v) ) {
+        return false;
+    }
+    *value = v.value;
+    *isInt = v.isInt;
+
+    return true;
+}
+
 void
 KnobHelper::setExpressionInternal(int dimension,
                                   const std::string& expression,
@@ -2740,10 +2903,18 @@ KnobHelper::setExpressionInternal(int dimension,
         }
     }
 
+    // Single-line expressions using only numbers and numeric parameters are also compiled, so that
+    // render threads can evaluate them without the GIL
+    CompiledExpressionPtr compiled;
+    if ( exprInvalid.empty() && !hasRetVariable && !dynamic_cast<KnobStringBase*>(this) ) {
+        compiled = _imp->compileExpression(expression);
+    }
+
     //Set internal fields
 
     {
         QMutexLocker k(&_imp->expressionMutex);
+        _imp->expressions[dimension].compiled = compiled;
         _imp->expressions[dimension].hasRet = hasRetVariable;
         _imp->expressions[dimension].expression = exprCpy;
         _imp->expressions[dimension].originalExpression = expression;
@@ -2841,6 +3012,7 @@ KnobHelper::clearExpression(int dimension,
         _imp->expressions[dimension].expression.clear();
         _imp->expressions[dimension].originalExpression.clear();
         _imp->expressions[dimension].exprInvalid.clear();
+        _imp->expressions[dimension].compiled.reset();
         //Py_XDECREF(_imp->expressions[dimension].code); //< new ref
         //_imp->expressions[dimension].code = 0;
     }
@@ -2848,7 +3020,8 @@ KnobHelper::clearExpression(int dimension,
     {
         std::list<std::pair<KnobIWPtr, int> > dependencies;
         {
-            QWriteLocker kk(&_imp->mastersMutex);
+            // Same lock as addListener()
+            QMutexLocker kk(&_imp->expressionMutex);
             dependencies = _imp->expressions[dimension].dependencies;
             _imp->expressions[dimension].dependencies.clear();
         }
@@ -676,7 +676,18 @@ public:
     virtual void replaceNodeNameInExpression(int dimension,
                                              const std::string& oldName,
                                              const std::string& newName) = 0;
+    /**
+     * @brief Clears the cached results of the expression of the given dimension and of all the expressions depending on it.
+     **/
     virtual void clearExpressionsResults(int dimension) = 0;
+
+    /**
+     * @brief Returns how many times the result of the expression of the given dimension was found in the cache (hits)
+     * and how many times the expression had to be evaluated (misses) since the last call to resetExpressionsResultsStats().
+     **/
+    virtual void getExpressionsResultsStats(int dimension, U64* hits, U64* misses) const = 0;
+    virtual void resetExpressionsResultsStats(int dimension) = 0;
+
     virtual void clearExpression(int dimension, bool clearResults) = 0;
     virtual std::string getExpression(int dimension) const = 0;
 
@@ -1480,6 +1491,13 @@ public:
 
 protected:
 
+    /**
+     * @brief Evaluates the native version of the expression of the given dimension, without taking the Python GIL.
+     * @returns False if the expression could not be compiled or if it must be evaluated by Python at this time,
+     * in which case executeExpression() should be used.
+     **/
+    bool evaluateCompiledExpression(double time, ViewIdx view, int dimension, double* value, bool* isInt) const WARN_UNUSED_RETURN;
+
     template <typename T>
     T pyObjectToType(PyObject* o) const;
 
@@ -1632,7 +1650,30 @@ public:
     virtual void removeListener(const KnobIPtr& listener, int listenerDimension) OVERRIDE FINAL;
     virtual void getAllExpressionDependenciesRecursive(std::set<NodePtr >& nodes) const OVERRIDE FINAL;
     virtual void getListeners(KnobI::ListenerDimsMap& listeners) const OVERRIDE FINAL;
-    virtual void clearExpressionsResults(int /*dimension*/) OVERRIDE {}
+    virtual void clearExpressionsResults(int dimension) OVERRIDE FINAL;
+
+    virtual void getExpressionsResultsStats(int /*dimension*/,
+                                            U64* hits,
+                                            U64* misses) const OVERRIDE
+    {
+        *hits = 0;
+        *misses = 0;
+    }
+
+    virtual void resetExpressionsResultsStats(int /*dimension*/) OVERRIDE {}
+
+protected:
+
+    /**
+     * @brief Clears the cached results of the expression of the given dimension only, see clearExpressionsResults()
+     **/
+    virtual void clearOwnExpressionsResults(int /*dimension*/) {}
+
+private:
+
+    void clearExpressionsResultsRecursive(int dimension, std::set<std::pair<KnobHelper*, int> >* visited);
+
+public:
 
     void incrementExpressionRecursionLevel() const;
 
@@ -1787,12 +1828,31 @@ public:
 
 
     /*
-       For each dimension, the results of the expressions at a given pair <frame, time> is stored so
+       For each dimension, the results of the expressions at a given pair <time, view> is stored so
        that we're able to get the same value again for the same render.
        Of course, this saved in the project to retrieve the same values between 2 runs of the project.
      */
-    typedef std::map<double, T> FrameValueMap;
-    typedef std::vector<FrameValueMap> ExprResults;
+    typedef std::map<std::pair<double, int>, T> FrameValueMap;
+
+    struct ExprResultsCache
+    {
+        // The results, before clamping
+        FrameValueMap results;
+
+        // Incremented whenever the results are cleared, so that a result computed meanwhile is not inserted
+        U64 generation;
+        U64 hits, misses;
+
+        ExprResultsCache()
+            : results()
+            , generation(0)
+            , hits(0)
+            , misses(0)
+        {
+        }
+    };
+
+    typedef std::vector<ExprResultsCache> ExprResults;
 
 protected: // derives from KnobI, parent of KnobInt, KnobBool
     // TODO: enable_shared_from_this
@@ -2108,7 +2168,7 @@ public:
     {
         QMutexLocker k(&_valueMutex);
 
-        map = _exprRes[dim];
+        map = _exprRes[dim].results;
     }
 
     T getValueFromMasterAt(double time, ViewSpec view, int dimension, const KnobIPtr& master);
@@ -2159,11 +2219,30 @@ private:
 
     void queueSetValue(const T& v, ViewSpec view, int dimension);
 
-    virtual void clearExpressionsResults(int dimension) OVERRIDE FINAL
+    virtual void clearOwnExpressionsResults(int dimension) OVERRIDE FINAL
+    {
+        QMutexLocker k(&_valueMutex);
+
+        _exprRes[dimension].results.clear();
+        ++_exprRes[dimension].generation;
+    }
+
+    virtual void getExpressionsResultsStats(int dimension,
+                                            U64* hits,
+                                            U64* misses) const OVERRIDE FINAL
     {
         QMutexLocker k(&_valueMutex);
 
-        _exprRes[dimension].clear();
+        *hits = _exprRes[dimension].hits;
+        *misses = _exprRes[dimension].misses;
+    }
+
+    virtual void resetExpressionsResultsStats(int dimension) OVERRIDE FINAL
+    {
+        QMutexLocker k(&_valueMutex);
+
+        _exprRes[dimension].hits = 0;
+        _exprRes[dimension].misses = 0;
     }
 
 
@@ -2181,6 +2260,13 @@ private:
 
     bool getValueFromExpression_pod(double time, ViewIdx view, int dimension, bool clamp, double* ret);
 
+    /**
+     * @brief Looks up the result of the expression in the cache.
+     * On a miss, generation is set to the value which should be passed to insertExpressionResult().
+     **/
+    bool findExpressionResult(double time, ViewIdx view, int dimension, T* ret, U64* generation);
+    void insertExpressionResult(double time, ViewIdx view, int dimension, const T& value, U64 generation);
+
     //////////////////////////////////////////////////////////////////////
     /////////////////////////////////// End implementation of KnobI
     //////////////////////////////////////////////////////////////////////
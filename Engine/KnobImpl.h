@@ -30,6 +30,7 @@
 #include "Knob.h"
 
 #include <cfloat>
+#include <climits>
 #include <stdexcept>
 #include <string>
 #include <algorithm> // min, max
@@ -419,6 +420,54 @@ hashFunction(unsigned int a)
     return a;
 }
 
+// Converts the result of a compiled expression the same way pyObjectToType() converts the Python object.
+// Returns false if the conversion must be left to Python.
+template <typename T>
+bool
+compiledExpressionValueToType(double /*v*/,
+                              bool /*isInt*/,
+                              T* /*ret*/)
+{
+    return false;
+}
+
+template <>
+inline bool
+compiledExpressionValueToType(double v,
+                              bool /*isInt*/,
+                              double* ret)
+{
+    *ret = v;
+
+    return true;
+}
+
+template <>
+inline bool
+compiledExpressionValueToType(double v,
+                              bool isInt,
+                              int* ret)
+{
+    // Converting a float to an int is version dependent in Python
+    if ( !isInt || (v < INT_MIN) || (v > INT_MAX) ) {
+        return false;
+    }
+    *ret = (int)v;
+
+    return true;
+}
+
+template <>
+inline bool
+compiledExpressionValueToType(double v,
+                              bool /*isInt*/,
+                              bool* ret)
+{
+    *ret = v != 0.;
+
+    return true;
+}
+
 template <typename T>
 bool
 Knob<T>::evaluateExpression(double time,
@@ -427,6 +476,15 @@ Knob<T>::evaluateExpression(double time,
                             T* value,
                             std::string* error)
 {
+    {
+        double compiledValue;
+        bool isInt;
+        if ( evaluateCompiledExpression(time, view, dimension, &compiledValue, &isInt) &&
+             compiledExpressionValueToType<T>(compiledValue, isInt, value) ) {
+            return true;
+        }
+    }
+
     PythonGILLocker pgl;
     PyObject *ret;
 
@@ -449,6 +507,18 @@ Knob<T>::evaluateExpression_pod(double time,
                                 double* value,
                                 std::string* error)
 {
+    {
+        double compiledValue;
+        bool isInt;
+        if ( evaluateCompiledExpression(time, view, dimension, &compiledValue, &isInt) &&
+             ( !isInt || ( (compiledValue >= INT_MIN) && (compiledValue <= INT_MAX) ) ) ) {
+            // Same conversion as for the Python objects below
+            *value = isInt ? (double)(int)compiledValue : compiledValue;
+
+            return true;
+        }
+    }
+
     PythonGILLocker pgl;
     PyObject *ret;
 
@@ -475,6 +545,46 @@ Knob<T>::evaluateExpression_pod(double time,
     return true;
 }
 
+template <typename T>
+bool
+Knob<T>::findExpressionResult(double time,
+                              ViewIdx view,
+                              int dimension,
+                              T* ret,
+                              U64* generation)
+{
+    QMutexLocker k(&_valueMutex);
+    ExprResultsCache& cache = _exprRes[dimension];
+    typename FrameValueMap::iterator found = cache.results.find( std::make_pair(time, (int)view) );
+    if ( found != cache.results.end() ) {
+        ++cache.hits;
+        *ret = found->second;
+
+        return true;
+    }
+    ++cache.misses;
+    *generation = cache.generation;
+
+    return false;
+}
+
+template <typename T>
+void
+Knob<T>::insertExpressionResult(double time,
+                                ViewIdx view,
+                                int dimension,
+                                const T& value,
+                                U64 generation)
+{
+    QMutexLocker k(&_valueMutex);
+    ExprResultsCache& cache = _exprRes[dimension];
+
+    // Do not cache a result computed while a dependency or the knob itself was changing
+    if (cache.generation == generation) {
+        cache.results.insert( std::make_pair(std::make_pair(time, (int)view), value) );
+    }
+}
+
 template <typename T>
 bool
 Knob<T>::getValueFromExpression(double time,
@@ -490,40 +600,31 @@ Knob<T>::getValueFromExpression(double time,
 
 
     ///Check first if a value was already computed:
+    U64 generation = 0;
+    if ( !findExpressionResult(time, view, dimension, ret, &generation) ) {
+        bool exprWasValid = isExpressionValid(dimension, 0);
+        {
+            EXPR_RECURSION_LEVEL();
+            std::string error;
+            bool exprOk = evaluateExpression(time, view,  dimension, ret, &error);
+            if (!exprOk) {
+                setExpressionInvalid(dimension, false, error);
 
-    {
-        QMutexLocker k(&_valueMutex);
-        typename FrameValueMap::iterator found = _exprRes[dimension].find(time);
-        if ( found != _exprRes[dimension].end() ) {
-            *ret = found->second;
-
-            return true;
-        }
-    }
-
-    bool exprWasValid = isExpressionValid(dimension, 0);
-    {
-        EXPR_RECURSION_LEVEL();
-        std::string error;
-        bool exprOk = evaluateExpression(time, view,  dimension, ret, &error);
-        if (!exprOk) {
-            setExpressionInvalid(dimension, false, error);
-
-            return false;
-        } else {
-            if (!exprWasValid) {
-                setExpressionInvalid(dimension, true, error);
+                return false;
+            } else {
+                if (!exprWasValid) {
+                    setExpressionInvalid(dimension, true, error);
+                }
             }
         }
+
+        insertExpressionResult(time, view, dimension, *ret, generation);
     }
 
     if (clamp) {
         *ret =  clampToMinMax(*ret, dimension);
     }
 
-    QMutexLocker k(&_valueMutex);
-    _exprRes[dimension].insert( std::make_pair(time, *ret) );
-
     return true;
 }
 
@@ -578,12 +679,10 @@ Knob<T>::getValueFromExpression_pod(double time,
 
 
     ///Check first if a value was already computed:
-
-
-    QMutexLocker k(&_valueMutex);
-    typename FrameValueMap::iterator found = _exprRes[dimension].find(time);
-    if ( found != _exprRes[dimension].end() ) {
-        *ret = found->second;
+    T cached;
+    U64 generation = 0;
+    if ( findExpressionResult(time, view, dimension, &cached, &generation) ) {
+        *ret = clamp ? clampToMinMax(cached, dimension) : cached;
 
         return true;
     }
@@ -605,13 +704,12 @@ Knob<T>::getValueFromExpression_pod(double time,
         }
     }
 
+    insertExpressionResult(time, view, dimension, (T)*ret, generation);
+
     if (clamp) {
         *ret =  clampToMinMax(*ret, dimension);
     }
 
-    //QWriteLocker k(&_valueMutex);
-    _exprRes[dimension].insert( std::make_pair(time, *ret) );
-
     return true;
 }
 
@@ -2666,22 +2764,27 @@ Knob<T>::cloneExpressionsResults(const KnobIPtr& other,
     if (!otherKnob) {
         return;
     }
+    // Pairs of <dimension, otherDimension>
+    std::vector<std::pair<int, int> > dims;
     if (dimension == -1) {
         int dimMin = std::min( getDimension(), other->getDimension() );
         for (int i = 0; i < dimMin; ++i) {
-            FrameValueMap results;
-            otherKnob->getExpressionResults(i, results);
-            QMutexLocker k(&_valueMutex);
-            _exprRes[i] = results;
+            dims.push_back( std::make_pair(i, i) );
         }
     } else {
         if (otherDimension == -1) {
             otherDimension = dimension;
         }
+        dims.push_back( std::make_pair(dimension, otherDimension) );
+    }
+    for (std::size_t i = 0; i < dims.size(); ++i) {
         FrameValueMap results;
-        otherKnob->getExpressionResults(otherDimension, results);
+        otherKnob->getExpressionResults(dims[i].second, results);
         QMutexLocker k(&_valueMutex);
-        _exprRes[dimension] = results;
+        ExprResultsCache& cache = _exprRes[dims[i].first];
+        cache.results = results;
+        // Results being computed concurrently are outdated
+        ++cache.generation;
     }
 }
 
@@ -45,6 +45,7 @@
 #include <map>
 #include <list>
 #include <utility>
+#include <algorithm>
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 CLANG_DIAG_OFF(unknown-pragmas)
 CLANG_DIAG_OFF(redeclared-class-member)
@@ -66,6 +67,73 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #define NATRON_CACHE_USE_BOOST
 
 
+/**
+ * @brief Priority used by the cost-aware eviction policy (GreedyDual-Size) with evictLowestPriority():
+ * the priority of an entry is the inflation value L of the cache when the entry was last accessed plus
+ * its render cost per MiB. Whenever an entry is evicted, L is raised to the priority of the evicted entry,
+ * so that expensive entries that are no longer accessed still end up being evicted.
+ * V must be a pointer to an object providing getEvictionPriorityBase(), getRenderCost() and size().
+ **/
+struct GreedyDualSizePriority
+{
+    template <typename V>
+    double operator()(const V& v) const
+    {
+        double sizeMiB = std::max( (double)v->size() / (1024. * 1024.), 1e-3 );
+
+        return v->getEvictionPriorityBase() + v->getRenderCost() / sizeMiB;
+    }
+};
+
+
+/**
+ * @brief The evictLowestPriority() function shared by the LRU caches below: visit the records from the least recently used
+ * one and, among the first nCandidates values that can be evicted (i.e: that are not referenced outside of the cache),
+ * purge the one with the lowest priority as returned by priority(value).
+ * LRUTable must provide the entry_type and record_iterator types, as well as lruBegin(), lruEnd(), getRecordKey(),
+ * getRecordValues() and eraseRecordValue().
+ **/
+template <typename LRUTable, typename PriorityFunctor>
+std::pair<typename LRUTable::key_type, typename LRUTable::entry_type>
+evictLowestPriorityFromLRUTable(LRUTable& table,
+                                const PriorityFunctor& priority,
+                                int nCandidates)
+{
+    typedef typename LRUTable::entry_type V;
+    typedef typename LRUTable::record_iterator RecordIterator;
+
+    bool found = false;
+    RecordIterator bestRecord = table.lruEnd();
+    typename std::list<V>::iterator bestValue;
+    double bestPriority = 0.;
+    int nVisited = 0;
+    for (RecordIterator record = table.lruBegin(); record != table.lruEnd() && nVisited < nCandidates; ++record) {
+        std::list<V>& values = table.getRecordValues(record);
+        for (typename std::list<V>::iterator it = values.begin();
+             it != values.end() && nVisited < nCandidates;
+             ++it) {
+            if ( (*it).use_count() == 1 ) {
+                double p = priority(*it);
+                if ( !found || (p < bestPriority) ) {
+                    found = true;
+                    bestRecord = record;
+                    bestValue = it;
+                    bestPriority = p;
+                }
+                ++nVisited;
+            }
+        }
+    }
+    if (!found) {
+        return std::make_pair( typename LRUTable::key_type(), V() );
+    }
+    std::pair<typename LRUTable::key_type, V> ret = std::make_pair( table.getRecordKey(bestRecord), *bestValue );
+    table.eraseRecordValue(bestRecord, bestValue);
+
+    return ret;
+}
+
+
 /**@brief 4 types of LRU caches are defined here:
  *
  *- STL with hashing : std::unordered_map
@@ -219,6 +287,53 @@ public:
         return std::make_pair( key_type(), V() );
     }
 
+    // Among the nCandidates least recently used elements that can be evicted, purge the one
+    // with the lowest priority as returned by priority(value)
+    template <typename PriorityFunctor>
+    std::pair<key_type, V> evictLowestPriority(const PriorityFunctor& priority,
+                                               int nCandidates)
+    {
+        return evictLowestPriorityFromLRUTable(*this, priority, nCandidates);
+    }
+
+    // The records in least recently used order, see evictLowestPriorityFromLRUTable()
+    typedef V entry_type;
+    typedef typename key_tracker_type::iterator record_iterator;
+
+    record_iterator lruBegin()
+    {
+        return _key_tracker.begin();
+    }
+
+    record_iterator lruEnd()
+    {
+        return _key_tracker.end();
+    }
+
+    key_type getRecordKey(record_iterator record) const
+    {
+        return *record;
+    }
+
+    std::list<V>& getRecordValues(record_iterator record)
+    {
+        return _key_to_value.find(*record)->second.first;
+    }
+
+    void eraseRecordValue(record_iterator record,
+                          typename std::list<V>::iterator value)
+    {
+        typename key_to_value_type::iterator it = _key_to_value.find(*record);
+
+        if (it->second.first.size() == 1) {
+            // Erase both elements to completely purge record
+            _key_to_value.erase(it);
+            _key_tracker.erase(record);
+        } else {
+            it->second.first.erase(value);
+        }
+    }
+
     unsigned int size()
     {
         return _container.size();
@@ -332,6 +447,49 @@ public:
         return std::make_pair( key_type(), V() );
     }
 
+    // Among the nCandidates least recently used elements that can be evicted, purge the one
+    // with the lowest priority as returned by priority(value)
+    template <typename PriorityFunctor>
+    std::pair<key_type, V> evictLowestPriority(const PriorityFunctor& priority,
+                                               int nCandidates)
+    {
+        return evictLowestPriorityFromLRUTable(*this, priority, nCandidates);
+    }
+
+    // The records in least recently used order, see evictLowestPriorityFromLRUTable()
+    typedef V entry_type;
+    typedef typename container_type::right_iterator record_iterator;
+
+    record_iterator lruBegin()
+    {
+        return _container.right.begin();
+    }
+
+    record_iterator lruEnd()
+    {
+        return _container.right.end();
+    }
+
+    key_type getRecordKey(record_iterator record) const
+    {
+        return record->second;
+    }
+
+    std::list<V>& getRecordValues(record_iterator record)
+    {
+        return record->first;
+    }
+
+    void eraseRecordValue(record_iterator record,
+                          typename std::list<V>::iterator value)
+    {
+        if (record->first.size() == 1) {
+            _container.right.erase(record);
+        } else {
+            record->first.erase(value);
+        }
+    }
+
     unsigned int size()
     {
         return _container.size();
@@ -453,6 +611,53 @@ public:
         return std::make_pair( key_type(), V() );
     }
 
+    // Among the nCandidates least recently used elements that can be evicted, purge the one
+    // with the lowest priority as returned by priority(value)
+    template <typename PriorityFunctor>
+    std::pair<key_type, V> evictLowestPriority(const PriorityFunctor& priority,
+                                               int nCandidates)
+    {
+        return evictLowestPriorityFromLRUTable(*this, priority, nCandidates);
+    }
+
+    // The records in least recently used order, see evictLowestPriorityFromLRUTable()
+    typedef V entry_type;
+    typedef typename key_tracker_type::iterator record_iterator;
+
+    record_iterator lruBegin()
+    {
+        return _key_tracker.begin();
+    }
+
+    record_iterator lruEnd()
+    {
+        return _key_tracker.end();
+    }
+
+    key_type getRecordKey(record_iterator record) const
+    {
+        return *record;
+    }
+
+    std::list<V>& getRecordValues(record_iterator record)
+    {
+        return _key_to_value.find(*record)->second.first;
+    }
+
+    void eraseRecordValue(record_iterator record,
+                          typename std::list<V>::iterator value)
+    {
+        typename key_to_value_type::iterator it = _key_to_value.find(*record);
+
+        if (it->second.first.size() == 1) {
+            // Erase both elements to completely purge record
+            _key_to_value.erase(it);
+            _key_tracker.erase(record);
+        } else {
+            it->second.first.erase(value);
+        }
+    }
+
     unsigned int size()
     {
         return _key_to_value.size();
@@ -560,6 +765,49 @@ public:
         return std::make_pair( key_type(), V() );
     }
 
+    // Among the nCandidates least recently used elements that can be evicted, purge the one
+    // with the lowest priority as returned by priority(value)
+    template <typename PriorityFunctor>
+    std::pair<key_type, V> evictLowestPriority(const PriorityFunctor& priority,
+                                               int nCandidates)
+    {
+        return evictLowestPriorityFromLRUTable(*this, priority, nCandidates);
+    }
+
+    // The records in least recently used order, see evictLowestPriorityFromLRUTable()
+    typedef V entry_type;
+    typedef typename container_type::right_iterator record_iterator;
+
+    record_iterator lruBegin()
+    {
+        return _container.right.begin();
+    }
+
+    record_iterator lruEnd()
+    {
+        return _container.right.end();
+    }
+
+    key_type getRecordKey(record_iterator record) const
+    {
+        return record->second;
+    }
+
+    std::list<V>& getRecordValues(record_iterator record)
+    {
+        return record->first;
+    }
+
+    void eraseRecordValue(record_iterator record,
+                          typename std::list<V>::iterator value)
+    {
+        if (record->first.size() == 1) {
+            _container.right.erase(record);
+        } else {
+            record->first.erase(value);
+        }
+    }
+
     unsigned int size()
     {
         return _container.size();
@@ -662,6 +910,49 @@ public:
         return std::make_pair( key_type(), V() );
     }
 
+    // Among the nCandidates least recently used elements that can be evicted, purge the one
+    // with the lowest priority as returned by priority(value)
+    template <typename PriorityFunctor>
+    std::pair<key_type, V> evictLowestPriority(const PriorityFunctor& priority,
+                                               int nCandidates)
+    {
+        return evictLowestPriorityFromLRUTable(*this, priority, nCandidates);
+    }
+
+    // The records in least recently used order, see evictLowestPriorityFromLRUTable()
+    typedef V entry_type;
+    typedef typename container_type::right_iterator record_iterator;
+
+    record_iterator lruBegin()
+    {
+        return _container.right.begin();
+    }
+
+    record_iterator lruEnd()
+    {
+        return _container.right.end();
+    }
+
+    key_type getRecordKey(record_iterator record) const
+    {
+        return record->second;
+    }
+
+    std::list<V>& getRecordValues(record_iterator record)
+    {
+        return record->first;
+    }
+
+    void eraseRecordValue(record_iterator record,
+                          typename std::list<V>::iterator value)
+    {
+        if (record->first.size() == 1) {
+            _container.right.erase(record);
+        } else {
+            record->first.erase(value);
+        }
+    }
+
     unsigned int size()
     {
         return _container.size();
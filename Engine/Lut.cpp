@@ -25,10 +25,17 @@
 #include "Lut.h"
 
 #include <cstring> // for std::memcpy
+#include <vector>
 #include <algorithm> // min, max
 #include <cassert>
 #include <stdexcept>
 
+#include "Global/CPUFeatures.h"
+
+#ifdef NATRON_HAS_AVX2
+#include <immintrin.h>
+#endif
+
 #include "Engine/RectI.h"
 
 /*
@@ -128,6 +135,80 @@ index_to_float(const unsigned short i)
     return tmp.f;
 }
 
+// Row conversions with SIMD instructions, used by the row versions of the Lut functions.
+// They compute exactly what hipart(), toColorSpaceUint8xxFromLinearFloatFast(), fromColorSpaceUint8ToLinearFloatFast()
+// and fromColorSpaceUint16ToLinearFloatFast() compute for each value, x86 being little-endian.
+// They only convert whole SIMD vectors and return the number of values converted: the caller converts the remaining ones.
+// Only AVX2 has gather instructions: without them, the table lookups are as fast with scalar code.
+#ifdef NATRON_HAS_AVX2
+NATRON_TARGET_AVX2
+static int
+toUint8xxRow_avx2(const unsigned short* table,
+                  const float* from,
+                  int n,
+                  unsigned short* to)
+{
+    const __m256i lowMask = _mm256_set1_epi32(0xffff);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i idx = _mm256_srli_epi32(_mm256_castps_si256( _mm256_loadu_ps(from + i) ), 16);
+        // Gather 32 bits at each entry and keep the lower half. For the last entry the upper half is the padding
+        // entry of the table.
+        __m256i v = _mm256_and_si256(_mm256_i32gather_epi32( (const int*)table, idx, 2 ), lowMask);
+        // packus interleaves the 128-bit lanes: put the 4 lower words of each lane back together
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0xd8);
+        _mm_storeu_si128( (__m128i*)(to + i), _mm256_castsi256_si128(packed) );
+    }
+
+    return i;
+}
+
+NATRON_TARGET_AVX2
+static int
+fromUint8Row_avx2(const float* table,
+                  const unsigned char* from,
+                  int n,
+                  float* to)
+{
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i idx = _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i*)(from + i) ) );
+        _mm256_storeu_ps( to + i, _mm256_i32gather_ps(table, idx, 4) );
+    }
+
+    return i;
+}
+
+NATRON_TARGET_AVX2
+static int
+fromUint16Row_avx2(const float* table,
+                   const unsigned short* from,
+                   int n,
+                   float* to)
+{
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i maxIndex = _mm256_set1_epi32(255);
+    const __m256 range = _mm256_set1_ps(257.f);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_cvtepu16_epi32( _mm_loadu_si128( (const __m128i*)(from + i) ) );
+        __m256i prev = _mm256_srli_epi32(_mm256_sub_epi32( v, _mm256_srli_epi32(v, 8) ), 8);
+        __m256i next = _mm256_min_epi32(_mm256_add_epi32(prev, one), maxIndex);
+        __m256 p = _mm256_i32gather_ps(table, prev, 4);
+        __m256 nx = _mm256_i32gather_ps(table, next, 4);
+        __m256i d = _mm256_sub_epi32( v, _mm256_add_epi32(_mm256_slli_epi32(prev, 8), prev) );
+        __m256 dv = _mm256_div_ps(_mm256_mul_ps( _mm256_cvtepi32_ps(d), _mm256_sub_ps(nx, p) ), range);
+        _mm256_storeu_ps( to + i, _mm256_add_ps(p, dv) );
+    }
+
+    return i;
+}
+
+#endif // NATRON_HAS_AVX2
+
 ///initialize the singleton
 LutManager LutManager::m_instance = LutManager();
 LutManager::LutManager()
@@ -319,6 +400,66 @@ Lut::fromColorSpaceUint16ToLinearFloatFast(unsigned short v) const
     return v32f_prev + (v - v16u_prev) * (v32f_next - v32f_prev) / (v16u_next - v16u_prev);
 }
 
+void
+Lut::toColorSpaceUint8xxFromLinearFloatFast(const float* from,
+                                            int n,
+                                            unsigned short* to,
+                                            InstructionSetEnum instructionSet) const
+{
+    assert(init_);
+    int i = 0;
+#ifdef NATRON_HAS_AVX2
+    if (instructionSet == eInstructionSetAVX2) {
+        i = toUint8xxRow_avx2(toFunc_hipart_to_uint8xx, from, n, to);
+    }
+#else
+    Q_UNUSED(instructionSet);
+#endif
+    for (; i < n; ++i) {
+        to[i] = toFunc_hipart_to_uint8xx[hipart(from[i])];
+    }
+}
+
+void
+Lut::fromColorSpaceUint8ToLinearFloatFast(const unsigned char* from,
+                                          int n,
+                                          float* to,
+                                          InstructionSetEnum instructionSet) const
+{
+    assert(init_);
+    int i = 0;
+#ifdef NATRON_HAS_AVX2
+    if (instructionSet == eInstructionSetAVX2) {
+        i = fromUint8Row_avx2(fromFunc_uint8_to_float, from, n, to);
+    }
+#else
+    Q_UNUSED(instructionSet);
+#endif
+    for (; i < n; ++i) {
+        to[i] = fromFunc_uint8_to_float[from[i]];
+    }
+}
+
+void
+Lut::fromColorSpaceUint16ToLinearFloatFast(const unsigned short* from,
+                                           int n,
+                                           float* to,
+                                           InstructionSetEnum instructionSet) const
+{
+    assert(init_);
+    int i = 0;
+#ifdef NATRON_HAS_AVX2
+    if (instructionSet == eInstructionSetAVX2) {
+        i = fromUint16Row_avx2(fromFunc_uint8_to_float, from, n, to);
+    }
+#else
+    Q_UNUSED(instructionSet);
+#endif
+    for (; i < n; ++i) {
+        to[i] = fromColorSpaceUint16ToLinearFloatFast(from[i]);
+    }
+}
+
 void
 Lut::fillTables() const
 {
@@ -331,6 +472,7 @@ Lut::fillTables() const
         float f = _toFunc(inp);
         toFunc_hipart_to_uint8xx[i] = Color::floatToInt<0xff01>(f);
     }
+    toFunc_hipart_to_uint8xx[0x10000] = 0;
     // fill fromFunc_uint8_to_float, and make sure that
     // the entries of toFunc_hipart_to_uint8xx corresponding
     // to the transform of each byte value contain the same value,
@@ -464,6 +606,13 @@ Lut::to_byte_packed(unsigned char* to,
 
     validate();
 
+    // The table lookups of a whole row are done first with SIMD instructions, then the error is diffused sequentially
+    const InstructionSetEnum instructionSet = getBestInstructionSet();
+    const bool premultRow = inputHasAlpha && premult;
+    const int rowFirst = rect.x1 * inPackingSize;
+    const int rowSize = (rect.x2 - rect.x1) * inPackingSize;
+    std::vector<float> premultPixels(premultRow ? rowSize : 0);
+    std::vector<unsigned short> uint8xxPixels(rowSize);
     for (int y = rect.y1; y < rect.y2; ++y) {
         // coverity[dont_call]
         int start = rand() % (rect.x2 - rect.x1) + rect.x1;
@@ -478,14 +627,26 @@ Lut::to_byte_packed(unsigned char* to,
         int dstY = dstBounds.y2 - y - 1;
         const float *src_pixels = from + (srcY * (srcBounds.x2 - srcBounds.x1) * inPackingSize);
         unsigned char *dst_pixels = to + (dstY * (dstBounds.x2 - dstBounds.x1) * outPackingSize);
+        const float *lut_input = src_pixels + rowFirst;
+        if (premultRow) {
+            for (int i = 0; i < rowSize; i += inPackingSize) {
+                const float a = lut_input[i + inAOffset];
+                for (int c = 0; c < inPackingSize; ++c) {
+                    premultPixels[i + c] = lut_input[i + c] * a;
+                }
+            }
+            lut_input = &premultPixels[0];
+        }
+        toColorSpaceUint8xxFromLinearFloatFast(lut_input, rowSize, &uint8xxPixels[0], instructionSet);
         /* go fowards from starting point to end of line: */
         for (int x = start; x < rect.x2; ++x) {
             int inCol = x * inPackingSize;
             int outCol = x * outPackingSize;
+            const unsigned short *uint8xx = &uint8xxPixels[inCol - rowFirst];
             float a = (inputHasAlpha && premult) ? src_pixels[inCol + inAOffset] : 1.f;
-            error_r = (error_r & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inROffset] * a)];
-            error_g = (error_g & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inGOffset] * a)];
-            error_b = (error_b & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inBOffset] * a)];
+            error_r = (error_r & 0xff) + uint8xx[inROffset];
+            error_g = (error_g & 0xff) + uint8xx[inGOffset];
+            error_b = (error_b & 0xff) + uint8xx[inBOffset];
             assert(error_r < 0x10000 && error_g < 0x10000 && error_b < 0x10000);
             dst_pixels[outCol + outROffset] = (unsigned char)(error_r >> 8);
             dst_pixels[outCol + outGOffset] = (unsigned char)(error_g >> 8);
@@ -500,10 +661,11 @@ Lut::to_byte_packed(unsigned char* to,
         for (int x = start - 1; x >= rect.x1; --x) {
             int inCol = x * inPackingSize;
             int outCol = x * outPackingSize;
+            const unsigned short *uint8xx = &uint8xxPixels[inCol - rowFirst];
             float a = (inputHasAlpha && premult) ? src_pixels[inCol + inAOffset] : 1.f;
-            error_r = (error_r & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inROffset] * a)];
-            error_g = (error_g & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inGOffset] * a)];
-            error_b = (error_b & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inBOffset] * a)];
+            error_r = (error_r & 0xff) + uint8xx[inROffset];
+            error_g = (error_g & 0xff) + uint8xx[inGOffset];
+            error_b = (error_b & 0xff) + uint8xx[inBOffset];
             assert(error_r < 0x10000 && error_g < 0x10000 && error_b < 0x10000);
             dst_pixels[outCol + outROffset] = (unsigned char)(error_r >> 8);
             dst_pixels[outCol + outGOffset] = (unsigned char)(error_g >> 8);
@@ -675,6 +837,13 @@ Lut::from_byte_packed(float* to,
     outPackingSize = outputHasAlpha ? 4 : 3;
 
     validate();
+
+    // Without premultiplication, the table lookups of a whole row are done with SIMD instructions
+    const InstructionSetEnum instructionSet = getBestInstructionSet();
+    const bool unpremultRow = inputHasAlpha && premult;
+    const int rowFirst = rect.x1 * inPackingSize;
+    const int rowSize = (rect.x2 - rect.x1) * inPackingSize;
+    std::vector<float> linearPixels(unpremultRow ? 0 : rowSize);
     for (int y = rect.y1; y < rect.y2; ++y) {
         int srcY = y;
         if (invertY) {
@@ -683,6 +852,21 @@ Lut::from_byte_packed(float* to,
 
         const unsigned char *src_pixels = from + (srcY * (srcBounds.x2 - srcBounds.x1) * inPackingSize);
         float *dst_pixels = to + (y * (dstBounds.x2 - dstBounds.x1) * outPackingSize);
+        if (!unpremultRow) {
+            fromColorSpaceUint8ToLinearFloatFast(src_pixels + rowFirst, rowSize, &linearPixels[0], instructionSet);
+            for (int x = rect.x1, inCol = rowFirst; x < rect.x2; ++x, inCol += inPackingSize) {
+                int outCol = x * outPackingSize;
+                const float *linear = &linearPixels[inCol - rowFirst];
+                dst_pixels[outCol + outROffset] = linear[inROffset];
+                dst_pixels[outCol + outGOffset] = linear[inGOffset];
+                dst_pixels[outCol + outBOffset] = linear[inBOffset];
+                if (outputHasAlpha) {
+                    // alpha is linear
+                    dst_pixels[outCol + outAOffset] = inputHasAlpha ? Color::intToFloat<256>(src_pixels[inCol + inAOffset]) : 1.f;
+                }
+            }
+            continue;
+        }
         for (int x = rect.x1; x < rect.x2; ++x) {
             int inCol = x * inPackingSize;
             int outCol = x * outPackingSize;
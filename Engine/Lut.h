@@ -40,6 +40,8 @@ CLANG_DIAG_OFF(deprecated)
 #include <QtCore/QMutex>
 CLANG_DIAG_ON(deprecated)
 
+#include "Global/CPUFeatures.h"
+
 #include "Engine/EngineFwd.h"
 
 #define NATRON_COLOR_HUE_CIRCLE 1. // if hue should be between 0 and 1
@@ -135,7 +137,8 @@ class Lut
 
     /// the fast lookup tables are mutable, because they are automatically initialized post-construction,
     /// and never change afterwards
-    mutable unsigned short toFunc_hipart_to_uint8xx[0x10000];         /// contains  2^16 = 65536 values between 0-255
+    /// contains  2^16 = 65536 values between 0-255, plus one padding entry so that 32-bit gathers of the last entry stay in the table
+    mutable unsigned short toFunc_hipart_to_uint8xx[0x10000 + 1];
     mutable float fromFunc_uint8_to_float[256];         /// values between 0-1.f
     mutable bool init_;         ///< false if the tables are not yet initialized
     mutable QMutex _lock;         ///< protects init_
@@ -228,6 +231,17 @@ public:
      */
     float fromColorSpaceUint16ToLinearFloatFast(unsigned short v) const;
 
+    /* @brief Row versions of the functions above: they convert n contiguous values and give exactly the same results,
+     * but use the gather instructions of AVX2, if the given instruction set has them, to look up the tables.
+     * The input and output buffers must not overlap.
+     */
+    void toColorSpaceUint8xxFromLinearFloatFast(const float* from, int n, unsigned short* to,
+                                                InstructionSetEnum instructionSet = getBestInstructionSet()) const;
+    void fromColorSpaceUint8ToLinearFloatFast(const unsigned char* from, int n, float* to,
+                                              InstructionSetEnum instructionSet = getBestInstructionSet()) const;
+    void fromColorSpaceUint16ToLinearFloatFast(const unsigned short* from, int n, float* to,
+                                               InstructionSetEnum instructionSet = getBestInstructionSet()) const;
+
 
     /////@TODO the following functions expects a float input buffer, one could extend it to cover all bitdepths.
 
@@ -0,0 +1,273 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "MultiThreadWorkerPool.h"
+
+#include <algorithm> // min, find
+#include <cassert>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include <QtCore/QThread>
+
+#include "Engine/ThreadPool.h"
+#include "Engine/Timer.h"
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief A call to MultiThreadWorkerPool::run()
+ **/
+struct MultiThreadWorkerPoolJob
+{
+    MultiThreadWorkerPool::ThreadFunction *func;
+    unsigned int nThreads;
+    void *customArg;
+    QThread* spawnerThread;
+
+    // See MultiThreadWorkerPool::onJobStarted(), only set if the job accepts helpers
+    QThread* snapshot;
+
+    // The following fields are protected by the pool lock
+
+    // The index of the next thread index to be claimed
+    unsigned int nextIndex;
+
+    // Number of pool threads that may still start working for this job
+    int nHelpersLeft;
+
+    // Number of pool threads currently working for this job
+    int nHelpersRunning;
+
+    // The first error returned by a thread
+    int status;
+
+    // Signaled when a pool thread stops working for this job
+    QWaitCondition helperFinishedCond;
+
+    MultiThreadWorkerPoolJob()
+        : func(0)
+        , nThreads(0)
+        , customArg(0)
+        , spawnerThread(0)
+        , snapshot(0)
+        , nextIndex(0)
+        , nHelpersLeft(0)
+        , nHelpersRunning(0)
+        , status(0)
+        , helperFinishedCond()
+    {
+    }
+};
+
+class MultiThreadWorker
+    : public QThread
+      , public AbortableThread
+{
+public:
+
+    MultiThreadWorker(MultiThreadWorkerPool* pool)
+        : QThread()
+        , AbortableThread(this)
+        , _pool(pool)
+    {
+        setThreadName("Multi-thread suite pool");
+    }
+
+    virtual ~MultiThreadWorker() {}
+
+    void run() OVERRIDE
+    {
+        _pool->workerLoop(this);
+    }
+
+private:
+
+    MultiThreadWorkerPool* _pool;
+};
+
+MultiThreadWorkerPool::MultiThreadWorkerPool(int maxWorkers)
+    : _maxWorkers(maxWorkers)
+    , _lock()
+    , _jobAddedCond()
+    , _jobs()
+    , _workers()
+    , _nIdleWorkers(0)
+    , _quit(false)
+{
+}
+
+MultiThreadWorkerPool::~MultiThreadWorkerPool()
+{
+    {
+        QMutexLocker k(&_lock);
+        assert( _jobs.empty() );
+        _quit = true;
+        _jobAddedCond.wakeAll();
+    }
+    for (std::list<MultiThreadWorker*>::iterator it = _workers.begin(); it != _workers.end(); ++it) {
+        (*it)->wait();
+        delete *it;
+    }
+}
+
+int
+MultiThreadWorkerPool::getNWorkers() const
+{
+    QMutexLocker k(&_lock);
+
+    return (int)_workers.size();
+}
+
+void
+MultiThreadWorkerPool::executeJob(MultiThreadWorkerPoolJob* job,
+                                  QMutexLocker& locker)
+{
+    while (job->nextIndex < job->nThreads) {
+        unsigned int threadIndex = job->nextIndex;
+        ++job->nextIndex;
+        locker.unlock();
+
+        int stat = executeThreadIndex(job->func, threadIndex, job->nThreads, job->customArg);
+
+        locker.relock();
+        if ( (stat != 0) && (job->status == 0) ) {
+            job->status = stat;
+        }
+    }
+}
+
+void
+MultiThreadWorkerPool::workerLoop(MultiThreadWorker* worker)
+{
+    QMutexLocker k(&_lock);
+
+    while (!_quit) {
+        if ( _jobs.empty() ) {
+            ++_nIdleWorkers;
+            _jobAddedCond.wait(&_lock);
+            --_nIdleWorkers;
+            continue;
+        }
+
+        MultiThreadWorkerPoolJob* job = _jobs.front();
+        assert(job->nHelpersLeft > 0);
+        if (--job->nHelpersLeft == 0) {
+            _jobs.pop_front();
+        }
+        ++job->nHelpersRunning;
+        k.unlock();
+
+        onHelperStarted(job->spawnerThread, job->snapshot, worker);
+
+        k.relock();
+        executeJob(job, k);
+        k.unlock();
+
+        onHelperFinished();
+
+        k.relock();
+        --job->nHelpersRunning;
+        job->helperFinishedCond.wakeAll();
+    }
+}
+
+int
+MultiThreadWorkerPool::run(ThreadFunction* func,
+                           unsigned int nThreads,
+                           void *customArg,
+                           unsigned int maxConcurrentThread,
+                           int* nThreadsSpawned,
+                           double* spawnTime)
+{
+    *nThreadsSpawned = 0;
+    *spawnTime = 0.;
+
+    MultiThreadWorkerPoolJob job;
+    job.func = func;
+    job.nThreads = nThreads;
+    job.customArg = customArg;
+    job.spawnerThread = QThread::currentThread();
+
+    // The calling thread executes thread indexes too
+    int nHelpers = (int)std::min(nThreads, maxConcurrentThread) - 1;
+
+    // Taken before the job is visible to the pool threads, so that they never start from the state of this thread
+    // while it executes thread indexes
+    boost::scoped_ptr<QThread> snapshot;
+    if (nHelpers > 0) {
+        snapshot.reset(new QThread);
+        job.snapshot = snapshot.get();
+        onJobStarted(job.spawnerThread, job.snapshot);
+    }
+
+    QMutexLocker k(&_lock);
+    if (nHelpers > 0) {
+        job.nHelpersLeft = nHelpers;
+        _jobs.push_back(&job);
+
+        int nToWake = std::min(nHelpers, _nIdleWorkers);
+        for (int i = 0; i < nToWake; ++i) {
+            _jobAddedCond.wakeOne();
+        }
+
+        // Past the maximum number of workers, the job is left in the queue for the workers that finish their current job
+        int nToSpawn = std::min( nHelpers - nToWake, _maxWorkers - (int)_workers.size() );
+        if (nToSpawn > 0) {
+            TimeLapse timer;
+            for (int i = 0; i < nToSpawn; ++i) {
+                MultiThreadWorker* worker = new MultiThreadWorker(this);
+                _workers.push_back(worker);
+                worker->start();
+            }
+            *nThreadsSpawned = nToSpawn;
+            *spawnTime = timer.getTimeSinceCreation();
+        }
+    }
+
+    executeJob(&job, k);
+
+    // No more helpers may start working for this job: remove it and wait for the running ones
+    if (job.nHelpersLeft > 0) {
+        std::list<MultiThreadWorkerPoolJob*>::iterator found = std::find(_jobs.begin(), _jobs.end(), &job);
+        if ( found != _jobs.end() ) {
+            _jobs.erase(found);
+        }
+        job.nHelpersLeft = 0;
+    }
+    while (job.nHelpersRunning > 0) {
+        job.helperFinishedCond.wait(&_lock);
+    }
+    k.unlock();
+
+    if (snapshot) {
+        onJobFinished(job.snapshot);
+    }
+
+    return job.status;
+} // MultiThreadWorkerPool::run
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,136 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_MultiThreadWorkerPool_h
+#define Natron_Engine_MultiThreadWorkerPool_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER;
+
+struct MultiThreadWorkerPoolJob;
+class MultiThreadWorker;
+
+/**
+ * @brief Threads kept alive across calls to run() so that callers splitting their work many times per frame
+ * (e.g: a plug-in calling the OpenFX multi-thread suite once per band of scan-lines) do not pay the cost of creating
+ * threads on each call. Threads are only created when there are not enough idle ones, and never more than
+ * the maximum number of workers given to the constructor: once it is reached, a call gets the helpers that
+ * become available while it runs and the calling thread executes the rest.
+ * Thread indexes are claimed one at a time by the threads working for a call, including the calling thread.
+ **/
+class MultiThreadWorkerPool
+{
+public:
+
+    // Same signature as the OpenFX OfxThreadFunctionV1
+    typedef void (ThreadFunction)(unsigned int threadIndex, unsigned int nThreads, void *customArg);
+
+    MultiThreadWorkerPool(int maxWorkers);
+
+    virtual ~MultiThreadWorkerPool();
+
+    /**
+     * @brief Calls func for all thread indexes in [0, nThreads), with at most maxConcurrentThread threads
+     * running at the same time, the calling thread being one of them.
+     * @param nThreadsSpawned[out] The number of threads that had to be created for this call
+     * @param spawnTime[out] The time spent creating them, in seconds
+     * @returns The first non-zero status returned by executeThreadIndex(), or 0
+     **/
+    int run(ThreadFunction* func,
+            unsigned int nThreads,
+            void *customArg,
+            unsigned int maxConcurrentThread,
+            int* nThreadsSpawned,
+            double* spawnTime);
+
+    /**
+     * @brief The number of threads created by the pool so far
+     **/
+    int getNWorkers() const;
+
+    /**
+     * @brief The loop of a pool thread: executes thread indexes of the pending jobs until the pool is destroyed.
+     **/
+    void workerLoop(MultiThreadWorker* worker);
+
+protected:
+
+    /**
+     * @brief Called on the calling thread before it executes any thread index of a call that pool threads may help with,
+     * and once they are all done.
+     * snapshot is a thread that is never started, on which the state of the calling thread (e.g: its TLS) may be copied
+     * so that the helpers start from it rather than from the calling thread, which modifies its state while they start.
+     **/
+    virtual void onJobStarted(QThread* /*spawnerThread*/,
+                              QThread* /*snapshot*/) {}
+
+    virtual void onJobFinished(QThread* /*snapshot*/) {}
+
+    /**
+     * @brief Called on a pool thread before it executes thread indexes of a call made from spawnerThread, and once it is done.
+     * snapshot is the one given to onJobStarted() for that call.
+     **/
+    virtual void onHelperStarted(QThread* /*spawnerThread*/,
+                                 QThread* /*snapshot*/,
+                                 QThread* /*worker*/) {}
+
+    virtual void onHelperFinished() {}
+
+    /**
+     * @brief Executes one thread index of a call, on the calling thread or a pool thread
+     * @returns 0 on success, any other value is returned by run()
+     **/
+    virtual int executeThreadIndex(ThreadFunction* func, unsigned int threadIndex, unsigned int nThreads, void *customArg) = 0;
+
+private:
+
+    // Must be called with the lock held, which is released while executing the thread function
+    void executeJob(MultiThreadWorkerPoolJob* job, QMutexLocker& locker);
+
+    const int _maxWorkers;
+
+    // Protects all fields below and the jobs
+    mutable QMutex _lock;
+
+    // Signaled when a job is added or when the pool quits
+    QWaitCondition _jobAddedCond;
+
+    // Jobs that still accept helpers
+    std::list<MultiThreadWorkerPoolJob*> _jobs;
+    std::list<MultiThreadWorker*> _workers;
+    int _nIdleWorkers;
+    bool _quit;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_MultiThreadWorkerPool_h
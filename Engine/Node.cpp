@@ -7017,8 +7017,10 @@ Node::makePreviewImage(SequenceTime time,
             renderPreviewForDepth<unsigned short, 65535>(*img, elemCount, width, height, convertToSrgb, buf);
             break;
         }
-        case eImageBitDepthHalf:
+        case eImageBitDepthHalf: {
+            renderPreviewForDepth<Half, 1>(*img, elemCount, width, height, convertToSrgb, buf);
             break;
+        }
         case eImageBitDepthFloat: {
             renderPreviewForDepth<float, 1>(*img, elemCount, width, height, convertToSrgb, buf);
             break;
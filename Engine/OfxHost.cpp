@@ -52,12 +52,8 @@ CLANG_DIAG_ON(uninitialized)
 #ifdef OFX_SUPPORTS_MULTITHREAD
 #include <QtCore/QThread>
 #include <QtCore/QThreadStorage>
-#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
-
-GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
-// /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
-#include <boost/bind.hpp>
-GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+#include <QtCore/QVector>
+#include <QtCore/QWaitCondition>
 #endif // OFX_SUPPORTS_MULTITHREAD
 CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
@@ -101,18 +97,22 @@ CLANG_DIAG_ON(unknown-pragmas)
 #include "Engine/CreateNodeArgs.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/LibraryBinary.h"
+#include "Engine/MultiThreadWorkerPool.h"
 #include "Engine/Node.h"
 #include "Engine/FStreamsSupport.h"
 #include "Engine/OfxEffectInstance.h"
 #include "Engine/OfxImageEffectInstance.h"
 #include "Engine/OutputSchedulerThread.h"
 #include "Engine/OfxMemory.h"
+#include "Engine/ParallelRenderArgs.h"
 #include "Engine/Plugin.h"
 #include "Engine/Project.h"
+#include "Engine/RenderStats.h"
 #include "Engine/Settings.h"
 #include "Engine/StandardPaths.h"
 #include "Engine/TLSHolder.h"
 #include "Engine/ThreadPool.h"
+#include "Engine/Timer.h"
 
 #include "Serialization/NodeSerialization.h"
 
@@ -153,6 +153,79 @@ string_format(const std::string fmt,
     return str;
 }
 
+#ifdef OFX_SUPPORTS_MULTITHREAD
+
+/**
+ * @brief The worker pool executing the calls to OfxHost::multiThread().
+ * The TLS of the spawner thread is copied once per call, before it executes any thread index, and each pool thread
+ * copies it once per call and re-uses it for all the thread indexes it executes during that call. It is cleaned-up
+ * at the end of the call, as the spawner TLS changes between calls.
+ **/
+class OfxMultiThreadWorkerPool
+    : public MultiThreadWorkerPool
+{
+public:
+
+    OfxMultiThreadWorkerPool()
+        : MultiThreadWorkerPool( QThread::idealThreadCount() )
+    {
+    }
+
+    virtual ~OfxMultiThreadWorkerPool() {}
+
+private:
+
+    virtual void onJobStarted(QThread* spawnerThread,
+                              QThread* snapshot) OVERRIDE FINAL
+    {
+        appPTR->getAppTLS()->copyTLS(spawnerThread, snapshot);
+    }
+
+    virtual void onJobFinished(QThread* snapshot) OVERRIDE FINAL
+    {
+        appPTR->getAppTLS()->cleanupTLSSnapshot(snapshot);
+    }
+
+    virtual void onHelperStarted(QThread* spawnerThread,
+                                 QThread* snapshot,
+                                 QThread* worker) OVERRIDE FINAL
+    {
+        appPTR->fetchAndAddNRunningThreads(1);
+        // The spawner may be writing its TLS (e.g: OfxClipInstance::getUnmappedComponents()), copy from the snapshot
+        appPTR->getAppTLS()->copyTLSFromSnapshot(snapshot, spawnerThread, worker);
+    }
+
+    virtual void onHelperFinished() OVERRIDE FINAL
+    {
+        appPTR->getAppTLS()->cleanupTLSForThread();
+        appPTR->fetchAndAddNRunningThreads(-1);
+    }
+
+    virtual int executeThreadIndex(ThreadFunction* func,
+                                   unsigned int threadIndex,
+                                   unsigned int nThreads,
+                                   void *customArg) OVERRIDE FINAL
+    {
+        OfxHost::OfxHostDataTLSPtr tls = appPTR->getOFXHost()->getTLSData();
+
+        tls->threadIndexes.push_back( (int)threadIndex );
+        OfxStatus stat = kOfxStatOK;
+        try {
+            func(threadIndex, nThreads, customArg);
+        } catch (const std::bad_alloc & ba) {
+            stat = kOfxStatErrMemory;
+        } catch (...) {
+            stat = kOfxStatFailed;
+        }
+        ///reset back the index otherwise it could mess up the indexes if the same thread is re-used
+        tls->threadIndexes.pop_back();
+
+        return stat;
+    }
+};
+
+#endif // OFX_SUPPORTS_MULTITHREAD
+
 struct OfxHostPrivate
 {
     boost::shared_ptr<OFX::Host::ImageEffect::PluginCache> imageEffectPluginCache;
@@ -165,6 +238,9 @@ struct OfxHostPrivate
     std::string loadingPluginID; // ID of the plugin being loaded
     int loadingPluginVersionMajor;
     int loadingPluginVersionMinor;
+#ifdef OFX_SUPPORTS_MULTITHREAD
+    boost::scoped_ptr<OfxMultiThreadWorkerPool> multiThreadPool;
+#endif
 
     OfxHostPrivate()
         : imageEffectPluginCache()
@@ -176,6 +252,9 @@ struct OfxHostPrivate
         , loadingPluginID()
         , loadingPluginVersionMajor(0)
         , loadingPluginVersionMinor(0)
+#ifdef OFX_SUPPORTS_MULTITHREAD
+        , multiThreadPool( new OfxMultiThreadWorkerPool() )
+#endif
     {
     }
 };
@@ -188,6 +267,11 @@ OfxHost::OfxHost()
 
 OfxHost::~OfxHost()
 {
+#ifdef OFX_SUPPORTS_MULTITHREAD
+    // Stop the pool threads before unloading the plug-ins
+    _imp->multiThreadPool.reset();
+#endif
+
     //Clean up, to be polite.
     OFX::Host::PluginCache::clearPluginCache();
 
@@ -1152,46 +1236,11 @@ OfxHost::setThreadAsActionCaller(OfxImageEffectInstance* instance,
 
 NATRON_NAMESPACE_ANONYMOUS_ENTER
 
-///Using QtConcurrent doesn't work with The Foundry Furnace plug-ins because they expect fresh threads
-///to be created. As QtConcurrent's thread-pool recycles thread, it seems to make Furnace crash.
-///We think this is because Furnace must keep an internal thread-local state that becomes then dirty
+///Plug-ins which do not support their threads being re-used (see Plugin::isPluginRequiringFreshThreads())
+///get fresh threads created for each multiThread call. The Foundry Furnace plug-ins crash when threads are recycled:
+///we think this is because Furnace must keep an internal thread-local state that becomes then dirty
 ///if we re-use the same thread.
 
-static OfxStatus
-threadFunctionWrapper(OfxThreadFunctionV1 func,
-                      unsigned int threadIndex,
-                      unsigned int threadMax,
-                      QThread* spawnerThread,
-                      void *customArg)
-{
-    assert(threadIndex < threadMax);
-    OfxHost::OfxHostDataTLSPtr tls = appPTR->getOFXHost()->getTLSData();
-    tls->threadIndexes.push_back( (int)threadIndex );
-
-    QThread* spawnedThread = QThread::currentThread();
-    if (spawnedThread != spawnerThread) {
-        appPTR->getAppTLS()->softCopy(spawnerThread, spawnedThread);
-    }
-
-    OfxStatus ret = kOfxStatOK;
-    try {
-        func(threadIndex, threadMax, customArg);
-    } catch (const std::bad_alloc & ba) {
-        ret =  kOfxStatErrMemory;
-    } catch (...) {
-        ret =  kOfxStatFailed;
-    }
-
-    ///reset back the index otherwise it could mess up the indexes if the same thread is re-used
-    tls->threadIndexes.pop_back();
-
-    if (spawnedThread != spawnerThread) {
-        appPTR->getAppTLS()->cleanupTLSForThread();
-    }
-
-    return ret;
-}
-
 class OfxThread
     : public QThread
       , public AbortableThread
@@ -1289,49 +1338,62 @@ OfxHost::multiThread(OfxThreadFunctionV1 func,
         }
     }
 
+    // Find the node calling multiThread to know whether its threads may be re-used and to report the spawn overhead
+    OfxEffectInstancePtr effect;
+    {
+        OfxHostDataTLSPtr tls = _imp->tlsData->getOrCreateTLSData();
+        if (tls->lastEffectCallingMainEntry) {
+            effect = tls->lastEffectCallingMainEntry->getOfxEffectInstance();
+        }
+    }
+    NodePtr node = effect ? effect->getNode() : NodePtr();
+    PluginPtr plugin = node ? node->getPlugin() : PluginPtr();
+    RenderStatsPtr stats;
+    if (effect) {
+        ParallelRenderArgsPtr frameArgs = effect->getParallelRenderArgsTLS();
+        if ( frameArgs && frameArgs->stats && frameArgs->stats->isInDepthProfilingEnabled() ) {
+            stats = frameArgs->stats;
+        }
+    }
+
     QThread* spawnerThread = QThread::currentThread();
-    bool useThreadPool = appPTR->getUseThreadPool();
+    bool useThreadPool = appPTR->getUseThreadPool() && (!plugin || plugin->isWorkerPoolEnabled());
 
     if (useThreadPool) {
-        std::vector<unsigned int> threadIndexes(nThreads);
-        for (unsigned int i = 0; i < nThreads; ++i) {
-            threadIndexes[i] = i;
+        int nThreadsSpawned;
+        double spawnTime;
+        OfxStatus stat = _imp->multiThreadPool->run(func, nThreads, customArg, maxConcurrentThread, &nThreadsSpawned, &spawnTime);
+        if (stats && nThreadsSpawned > 0) {
+            stats->addThreadsSpawnedForNode(node, nThreadsSpawned, spawnTime);
         }
-
-        /// DON'T set the maximum thread count, this is a global application setting, and see the documentation excerpt above
-        //QThreadPool::globalInstance()->setMaxThreadCount(nThreads);
-        QFuture<OfxStatus> future = QtConcurrent::mapped( threadIndexes, boost::bind(threadFunctionWrapper, func, _1, nThreads, spawnerThread, customArg) );
-        future.waitForFinished();
-        ///DON'T reset back to the original value the maximum thread count
-        //QThreadPool::globalInstance()->setMaxThreadCount(QThread::idealThreadCount());
-
-        for (QFuture<OfxStatus>::const_iterator it = future.begin(); it != future.end(); ++it) {
-            OfxStatus stat = *it;
-            if (stat != kOfxStatOK) {
-                return stat;
-            }
+        if (stat != kOfxStatOK) {
+            return stat;
         }
     } else {
         QVector<OfxStatus> status(nThreads); // vector for the return status of each thread
         status.fill(kOfxStatFailed); // by default, a thread fails
         {
             // at most maxConcurrentThread should be running at the same time
+            TimeLapse creationTimer;
             QVector<OfxThread*> threads(nThreads);
             for (unsigned int i = 0; i < nThreads; ++i) {
                 threads[i] = new OfxThread(func, i, nThreads, spawnerThread, customArg, &status[i]);
             }
+            double spawnTime = creationTimer.getTimeSinceCreation();
             unsigned int i = 0; // index of next thread to launch
             unsigned int running = 0; // number of running threads
             unsigned int j = 0; // index of first running thread. all threads before this one are finished running
             while (j < nThreads) {
                 // have no more than maxConcurrentThread threads launched at the same time
                 int threadsStarted = 0;
+                TimeLapse timer;
                 while (i < nThreads && running < maxConcurrentThread) {
                     threads[i]->start();
                     ++i;
                     ++running;
                     ++threadsStarted;
                 }
+                spawnTime += timer.getTimeSinceCreation();
 
                 ///We just started threadsStarted threads
                 appPTR->fetchAndAddNRunningThreads(threadsStarted);
@@ -1348,6 +1410,9 @@ OfxHost::multiThread(OfxThreadFunctionV1 func,
                 appPTR->fetchAndAddNRunningThreads(-1);
             }
             assert(running == 0);
+            if (stats) {
+                stats->addThreadsSpawnedForNode(node, nThreads, spawnTime);
+            }
         }
         // check the return status of each thread, return the first error found
         for (QVector<OfxStatus>::const_iterator it = status.begin(); it != status.end(); ++it) {
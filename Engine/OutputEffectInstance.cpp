@@ -513,6 +513,14 @@ OutputEffectInstance::reportStats(int time,
         ofile << "Nb cache miss: " << nbCacheMiss << std::endl;
         ofile << "Nb cache hit requiring mipmap downscaling: " << nbCacheHitButDownscaled << std::endl;
 
+        int writeQueueDepth;
+        double writeQueueStallTime;
+        it->second.getWriteQueueInfos(&writeQueueDepth, &writeQueueStallTime);
+        if ( (writeQueueDepth > 0) || (writeQueueStallTime > 0) ) {
+            ofile << "Frames waiting to be written: " << writeQueueDepth << std::endl;
+            ofile << "Time spent waiting for the write queue: " << Timer::printAsTime(writeQueueStallTime, false).toStdString() << std::endl;
+        }
+
         const std::set<std::string> & planes = it->second.getPlanesRendered();
         ofile << "Plane(s) rendered: ";
         for (std::set<std::string>::const_iterator it2 = planes.begin(); it2 != planes.end(); ++it2) {
@@ -38,10 +38,12 @@
 #include <QtCore/QMutex>
 #include <QtCore/QWaitCondition>
 #include <QtCore/QCoreApplication>
+#include <QtCore/QDateTime>
 #include <QtCore/QString>
 #include <QtCore/QThreadPool>
 #include <QtCore/QDebug>
 #include <QtCore/QTextStream>
+#include <QtCore/QTimer>
 #include <QtCore/QRunnable>
 
 #include "Global/MemoryInfo.h"
@@ -49,12 +51,14 @@
 #include "Engine/AbortableRenderInfo.h"
 #include "Engine/AppManager.h"
 #include "Engine/AppInstance.h"
+#include "Engine/BoundedFrameQueue.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/Image.h"
 #include "Engine/KnobFile.h"
 #include "Engine/Node.h"
 #include "Engine/OpenGLViewerI.h"
 #include "Engine/GenericSchedulerThreadWatcher.h"
+#include "Engine/ParallelRenderTuner.h"
 #include "Engine/Project.h"
 #include "Engine/RenderStats.h"
 #include "Engine/RotoContext.h"
@@ -89,6 +93,9 @@
 
 #define NATRON_SCHEDULER_ABORT_AFTER_X_UNSUCCESSFUL_ITERATIONS 5000
 
+// Maximum number of rendered frames waiting to be written, per writer thread
+#define NATRON_WRITE_QUEUE_MAX_FRAMES_PER_THREAD 2
+
 NATRON_NAMESPACE_ENTER;
 
 
@@ -239,6 +246,13 @@ struct OutputSchedulerThreadPrivate
     QMutex bufferedOutputMutex;
     int lastBufferedOutputSize;
 
+#ifndef NATRON_PLAYBACK_USES_THREAD_POOL
+    // Chooses the number of parallel renders from the measured throughput, see adjustNumberOfThreads()
+    QMutex parallelRenderTunerMutex;
+    ParallelRenderTuner parallelRenderTuner;
+    bool parallelRenderTunerUsed;
+#endif
+
 
     OutputSchedulerThreadPrivate(RenderEngine* engine,
                                  const OutputEffectInstancePtr& effect,
@@ -278,6 +292,11 @@ struct OutputSchedulerThreadPrivate
 #endif
         , bufferedOutputMutex()
         , lastBufferedOutputSize(0)
+#ifndef NATRON_PLAYBACK_USES_THREAD_POOL
+        , parallelRenderTunerMutex()
+        , parallelRenderTuner()
+        , parallelRenderTunerUsed(false)
+#endif
     {
     }
 
@@ -1060,6 +1079,14 @@ OutputSchedulerThread::startRender()
         nThreads = (int)_imp->renderThreads.size();
     }
 
+    {
+        // Start the search of the best number of parallel renders with half the cores, leaving threads for the tiles
+        int maxParallelRenders = appPTR->getHardwareIdealThreadCount();
+        QMutexLocker k(&_imp->parallelRenderTunerMutex);
+        _imp->parallelRenderTuner.reset(maxParallelRenders / 2, maxParallelRenders);
+        _imp->parallelRenderTunerUsed = false;
+    }
+
     ///Start with one thread if it doesn't exist
     if (nThreads == 0) {
         int lastNThreads;
@@ -1156,6 +1183,8 @@ OutputSchedulerThread::stopRender()
 #endif
     _imp->waitForRenderThreadsToQuit();
 
+    onRenderThreadsFinished( isBeingAborted() );
+
     ///If the output effect is sequential (only WriteFFMPEG for now)
     EffectInstancePtr effect = _imp->outputEffect.lock();
     WriteNodePtr isWrite = toWriteNode( effect );
@@ -1187,6 +1216,32 @@ OutputSchedulerThread::stopRender()
 
     bool wasAborted = isBeingAborted();
 
+#ifndef NATRON_PLAYBACK_USES_THREAD_POOL
+    ///Log the number of parallel renders chosen from the measured throughput
+    {
+        int nRenders, nChanges, nMemoryPressureChanges;
+        double framesPerSecond;
+        bool hasMeasure;
+        {
+            QMutexLocker k(&_imp->parallelRenderTunerMutex);
+            hasMeasure = _imp->parallelRenderTunerUsed && _imp->parallelRenderTuner.getBestConfiguration(&nRenders, &framesPerSecond);
+            _imp->parallelRenderTuner.getNumberOfChanges(&nChanges, &nMemoryPressureChanges);
+        }
+        if (hasMeasure) {
+            QString message = tr("%1 frames rendered in parallel (%2 fps), the other threads of the pool render the tiles of each frame. "
+                                 "Number of parallel renders changed %3 times, %4 times because of memory usage.")
+                              .arg(nRenders)
+                              .arg(framesPerSecond, 0, 'f', 2)
+                              .arg(nChanges)
+                              .arg(nMemoryPressureChanges);
+            QString context = QString::fromUtf8( _imp->outputEffect.lock()->getScriptName_mt_safe().c_str() );
+            if ( appPTR->isBackground() ) {
+                std::cout << context.toStdString() << ": " << message.toStdString() << std::endl;
+            }
+            appPTR->writeToErrorLog_mt_safe(context, QDateTime::currentDateTime(), message);
+        }
+    }
+#endif
 
     ///Notify everyone that the render is finished
     _imp->engine->s_renderFinished(wasAborted ? 1 : 0);
@@ -1473,6 +1528,8 @@ OutputSchedulerThread::onAbortRequested(bool /*keepOldestRender*/)
         }
     }
 
+    onRenderAbortRequested();
+
     ///If the scheduler is asleep waiting for the buffer to be filling up, we post a fake request
     ///that will not be processed anyway because the first thing it does is checking for abort
     {
@@ -1510,7 +1567,21 @@ OutputSchedulerThread::adjustNumberOfThreads(int* newNThreads,
 
     *lastNThreads = currentParallelRenders;
 
-    if (userSettingParallelThreads == 0) {
+    ///Playback at a given fps does not need to render faster: the throughput does not tell anything
+    bool useTuner = (userSettingParallelThreads == 0) && !isFPSRegulationNeeded();
+
+    if (useTuner) {
+        ///User wants it to be automatically computed: follow the number of parallel renders giving the best
+        ///frames/second so far, or the one being measured
+        double memoryPressure = 0.;
+        U64 totalRAM = getSystemTotalRAM_conditionnally();
+        if (totalRAM > 0) {
+            memoryPressure = (double)getCurrentRSS() / totalRAM;
+        }
+        QMutexLocker k(&_imp->parallelRenderTunerMutex);
+        optimalNThreads = _imp->parallelRenderTuner.update(memoryPressure);
+        _imp->parallelRenderTunerUsed = true;
+    } else if (userSettingParallelThreads == 0) {
         ///User wants it to be automatically computed, do a simple heuristic: launch as many parallel renders
         ///as there are cores
         optimalNThreads = appPTR->getHardwareIdealThreadCount();
@@ -1519,15 +1590,24 @@ OutputSchedulerThread::adjustNumberOfThreads(int* newNThreads,
     }
     optimalNThreads = std::max(1, optimalNThreads);
 
+    bool launchThread, stopThread;
+    if (useTuner) {
+        ///The measured throughput already accounts for the threads rendering tiles
+        launchThread = currentParallelRenders < optimalNThreads;
+        stopThread = currentParallelRenders > optimalNThreads;
+    } else {
+        launchThread = ( (runningThreads < optimalNThreads) && (currentParallelRenders < optimalNThreads) ) || (currentParallelRenders == 0);
+        stopThread = (runningThreads > optimalNThreads) && (currentParallelRenders > optimalNThreads);
+    }
 
-    if ( ( (runningThreads < optimalNThreads) && (currentParallelRenders < optimalNThreads) ) || (currentParallelRenders == 0) ) {
+    if (launchThread) {
         ////////
         ///Launch 1 thread
         QMutexLocker l(&_imp->renderThreadsMutex);
 
         _imp->appendRunnable( createRunnable() );
         *newNThreads = currentParallelRenders +  1;
-    } else if ( (runningThreads > optimalNThreads) && (currentParallelRenders > optimalNThreads) ) {
+    } else if (stopThread) {
         ////////
         ///Stop 1 thread
         stopRenderThreads(1);
@@ -1567,6 +1647,13 @@ OutputSchedulerThread::notifyFrameRendered(int frame,
     boost::shared_ptr<OutputSchedulerThreadStartArgs> runArgs = _imp->runArgs.lock();
     assert(runArgs);
 
+#ifndef NATRON_PLAYBACK_USES_THREAD_POOL
+    if (isLastView) {
+        QMutexLocker k(&_imp->parallelRenderTunerMutex);
+        _imp->parallelRenderTuner.notifyFrameRendered( _imp->renderTimer->getTimeSinceCreation() );
+    }
+#endif
+
     // If FFA all parallel renders call render on the Writer in their own thread,
     // otherwise the OutputSchedulerThread thread calls the render of the Writer.
     U64 nbTotalFrames;
@@ -2122,12 +2209,336 @@ RenderThreadTask::notifyIsRunning(bool running)
 //////////////////////// DefaultScheduler ////////////
 
 
+/**
+ * @brief Renders a view of a frame with the effect writing the output (the embedded writer of a Write node).
+ * If prefetchInputs is not NULL, only the input images of the effect are rendered and returned in it,
+ * the effect itself is rendered later on by a writer thread of the WriteQueue with these as prefetchedInputs.
+ **/
+static EffectInstance::RenderRoIRetCode
+renderOutputFrameView(const EffectInstancePtr& activeInputToRender,
+                      int time,
+                      ViewIdx view,
+                      const EffectInstance::PrefetchedInputImagesPtr& prefetchedInputs,
+                      EffectInstance::PrefetchedInputImages* prefetchInputs)
+{
+    // Writers always render at scale 1 (for now)
+    const int mipMapLevel = 0;
+    const RenderScale scale(1.);
+    const bool isRenderDueToRenderInteraction = false;
+    const bool isSequentialRender = true;
+
+    AbortableThread* isAbortableThread = dynamic_cast<AbortableThread*>( QThread::currentThread() );
+    NodePtr activeInputNode = activeInputToRender->getNode();
+
+    // Setup frame TLS args
+    AbortableRenderInfoPtr abortInfo = AbortableRenderInfo::create(true, 0);
+    if (isAbortableThread) {
+        isAbortableThread->setAbortInfo(isRenderDueToRenderInteraction, abortInfo, activeInputToRender);
+    }
+
+    ParallelRenderArgsSetter::CtorArgsPtr tlsArgs(new ParallelRenderArgsSetter::CtorArgs);
+    tlsArgs->time = time;
+    tlsArgs->view = view;
+    tlsArgs->isRenderUserInteraction = isRenderDueToRenderInteraction;
+    tlsArgs->isSequential = isSequentialRender;
+    tlsArgs->abortInfo = abortInfo;
+    tlsArgs->treeRoot = activeInputNode;
+    tlsArgs->textureIndex = 0;
+    tlsArgs->timeline = activeInputToRender->getApp()->getTimeLine();
+    tlsArgs->activeRotoPaintNode = NodePtr();
+    tlsArgs->activeRotoDrawableItem = RotoDrawableItemPtr();
+    tlsArgs->isDoingRotoNeatRender = false;
+    tlsArgs->isAnalysis = false;
+    tlsArgs->draftMode = false;
+    tlsArgs->stats = RenderStatsPtr();
+    boost::shared_ptr<ParallelRenderArgsSetter> frameRenderArgs;
+    try {
+        frameRenderArgs.reset(new ParallelRenderArgsSetter(tlsArgs));
+    } catch (...) {
+        return EffectInstance::eRenderRoIRetCodeFailed;
+    }
+
+    // Get the hash now that we applied TLS
+    U64 activeInputHash;
+    bool gotHash = activeInputToRender->getRenderHash(time, view, &activeInputHash);
+    assert(gotHash);
+    (void)gotHash;
+
+    // Call getRoD to know where to render
+    RectD rod;
+    StatusEnum stat = activeInputToRender->getRegionOfDefinition_public(activeInputHash, time, scale, view, &rod);
+    if (stat == eStatusFailed) {
+        return EffectInstance::eRenderRoIRetCodeFailed;
+    }
+
+
+    // Get layers to render
+    std::list<ImageComponents> components;
+    ImageBitDepthEnum imageDepth;
+
+    //Use needed components to figure out what we need to render
+    EffectInstance::ComponentsNeededMap neededComps;
+    bool processAll;
+    SequenceTime ptTime;
+    int ptView;
+    std::bitset<4> processChannels;
+    NodePtr ptInput;
+    activeInputToRender->getComponentsNeededAndProduced_public(true, true, time, view, &neededComps, &processAll, &ptTime, &ptView, &processChannels, &ptInput);
+
+
+    //Retrieve bitdepth only
+    imageDepth = activeInputToRender->getBitDepth(-1);
+
+    EffectInstance::ComponentsNeededMap::iterator foundOutput = neededComps.find(-1);
+    if ( foundOutput != neededComps.end() ) {
+        for (std::size_t j = 0; j < foundOutput->second.size(); ++j) {
+            components.push_back(foundOutput->second[j]);
+        }
+    }
+
+    // The render window is the RoD in pixel coordinates in our case
+    RectI renderWindow;
+    rod.toPixelEnclosing( scale, activeInputToRender->getAspectRatio(-1), &renderWindow );
+
+    // Optimize roi
+    stat = frameRenderArgs->computeRequestPass(mipMapLevel, rod);
+    if (stat == eStatusFailed) {
+        return EffectInstance::eRenderRoIRetCodeFailed;
+    }
+
+    if (prefetchInputs) {
+        return activeInputToRender->prefetchInputImages(time, view, rod, neededComps, prefetchInputs);
+    }
+
+    // Launch render
+    RenderingFlagSetter flagIsRendering(activeInputNode);
+    std::map<ImageComponents, ImagePtr> planes;
+    boost::scoped_ptr<EffectInstance::RenderRoIArgs> renderArgs( new EffectInstance::RenderRoIArgs(time, //< the time at which to render
+                                                                                                   scale, //< the scale at which to render
+                                                                                                   mipMapLevel, //< the mipmap level (redundant with the scale)
+                                                                                                   view, //< the view to render
+                                                                                                   false, //< byPassCache
+                                                                                                   renderWindow, //< the render window (in pixel coordinates)
+                                                                                                   rod, // < any precomputed rod ? in canonical coordinates
+                                                                                                   components,
+                                                                                                   imageDepth,
+                                                                                                   false,
+                                                                                                   activeInputToRender,
+                                                                                                   eStorageModeRAM,
+                                                                                                   time) );
+    renderArgs->prefetchedInputs = prefetchedInputs;
+
+    return activeInputToRender->renderRoI(*renderArgs, &planes);
+} // renderOutputFrameView
+
+static std::string
+getRenderFailureMessage(EffectInstance::RenderRoIRetCode retCode)
+{
+    if (retCode == EffectInstance::eRenderRoIRetCodeAborted) {
+        return "Render aborted";
+    }
+
+    return "Error caught while rendering";
+}
+
+class WriteQueue;
+class WriteQueueThread
+    : public QThread
+    , public AbortableThread
+{
+public:
+
+    WriteQueueThread(WriteQueue* queue)
+        : QThread()
+        , AbortableThread(this)
+        , _queue(queue)
+    {
+        setThreadName("Writer thread");
+    }
+
+    virtual ~WriteQueueThread()
+    {
+    }
+
+    virtual void run() OVERRIDE FINAL;
+
+private:
+
+    WriteQueue* _queue;
+};
+
+/**
+ * @brief Bounded queue between the render threads of a DefaultScheduler and writer threads, so that the encoding and
+ * writing of frames overlaps the rendering of the next ones.
+ * The render threads only render the input images of the writer and push them here with the frame.
+ * The writer threads then run the writer on these inputs. If the queue is full, the render threads wait.
+ * If ordered (for sequential writers), a single writer thread writes the frames in the order they were scheduled.
+ **/
+class WriteQueue
+{
+public:
+
+    struct Frame
+    {
+        int time;
+        std::vector<ViewIdx> viewsToRender;
+        RenderStatsPtr stats;
+
+        // For each view, the input images of the writer
+        std::vector<EffectInstance::PrefetchedInputImagesPtr> inputImages;
+
+        Frame()
+            : time(0)
+            , viewsToRender()
+            , stats()
+            , inputImages()
+        {
+        }
+    };
+
+    WriteQueue(DefaultScheduler* scheduler,
+               const EffectInstancePtr& writer,
+               int nThreads,
+               bool ordered,
+               const OutputSchedulerThreadStartArgs& args)
+        : _scheduler(scheduler)
+        , _writer(writer)
+        , _firstFrame(args.firstFrame)
+        , _lastFrame(args.lastFrame)
+        , _frameStep(args.frameStep)
+        , _direction(args.pushTimelineDirection)
+        , _frames(nThreads * NATRON_WRITE_QUEUE_MAX_FRAMES_PER_THREAD, ordered)
+        , _threads()
+    {
+        assert(nThreads > 0);
+        assert(!ordered || nThreads == 1);
+        for (int i = 0; i < nThreads; ++i) {
+            WriteQueueThread* thread = new WriteQueueThread(this);
+            _threads.push_back(thread);
+            thread->start();
+        }
+    }
+
+    ~WriteQueue()
+    {
+        stop(true);
+    }
+
+    const EffectInstancePtr& getWriter() const
+    {
+        return _writer;
+    }
+
+    /**
+     * @brief Called by a render thread once the inputs of the writer are rendered for all views of the frame.
+     * Waits while the queue is full.
+     * @returns False if the render was aborted while waiting
+     **/
+    bool push(const Frame& frame)
+    {
+        return _frames.push(getFrameIndex(frame.time), frame);
+    }
+
+    /**
+     * @brief Flags the frames being written as aborted and wakes up render threads waiting for room in the queue.
+     **/
+    void abortWrites()
+    {
+        for (std::list<WriteQueueThread*>::iterator it = _threads.begin(); it != _threads.end(); ++it) {
+            bool userInteraction;
+            AbortableRenderInfoPtr abortInfo;
+            EffectInstancePtr treeRoot;
+            (*it)->getAbortInfo(&userInteraction, &abortInfo, &treeRoot);
+            if (abortInfo) {
+                abortInfo->setAborted();
+            }
+        }
+        _frames.abort();
+    }
+
+    /**
+     * @brief Makes the writer threads quit once the queued frames are written, or right away if aborted,
+     * and waits for them.
+     **/
+    void stop(bool aborted)
+    {
+        if (aborted) {
+            abortWrites();
+        } else {
+            _frames.quit();
+        }
+        for (std::list<WriteQueueThread*>::iterator it = _threads.begin(); it != _threads.end(); ++it) {
+            (*it)->wait();
+            delete *it;
+        }
+        _threads.clear();
+    }
+
+    /**
+     * @brief The loop of the writer threads
+     **/
+    void runWriterThread()
+    {
+        Frame frame;
+        int queueDepth;
+        double stallTime;
+
+        while ( _frames.pop(&frame, &queueDepth, &stallTime) ) {
+            if ( frame.stats && frame.stats->isInDepthProfilingEnabled() ) {
+                frame.stats->addWriteQueueInfosForNode(_writer->getNode(), queueDepth, stallTime);
+            }
+            try {
+                for (std::size_t view = 0; view < frame.viewsToRender.size(); ++view) {
+                    EffectInstance::RenderRoIRetCode retCode = renderOutputFrameView(_writer, frame.time, frame.viewsToRender[view], frame.inputImages[view], 0);
+                    if (retCode != EffectInstance::eRenderRoIRetCodeOk) {
+                        _scheduler->notifyRenderFailure( getRenderFailureMessage(retCode) );
+                        break;
+                    }
+                    _scheduler->notifyFrameRendered(frame.time, frame.viewsToRender[view], frame.viewsToRender, frame.stats, eSchedulingPolicyFFA);
+                }
+            } catch (const std::exception& e) {
+                _scheduler->notifyRenderFailure( std::string("Error while rendering: ") + e.what() );
+            }
+
+            // Release the input images before waiting for the next frame
+            frame = Frame();
+            appPTR->getAppTLS()->cleanupTLSForThread();
+        }
+    }
+
+private:
+
+    int getFrameIndex(int time) const
+    {
+        if (_direction == eRenderDirectionForward) {
+            return (time - _firstFrame) / _frameStep;
+        } else {
+            return (_lastFrame - time) / _frameStep;
+        }
+    }
+
+    DefaultScheduler* _scheduler;
+    EffectInstancePtr _writer;
+    int _firstFrame, _lastFrame, _frameStep;
+    RenderDirectionEnum _direction;
+    BoundedFrameQueue<Frame> _frames;
+    std::list<WriteQueueThread*> _threads;
+};
+
+void
+WriteQueueThread::run()
+{
+    _queue->runWriterThread();
+}
+
 DefaultScheduler::DefaultScheduler(RenderEngine* engine,
                                    const OutputEffectInstancePtr& effect)
     : OutputSchedulerThread(engine, effect, eProcessFrameBySchedulerThread)
     , _effect(effect)
     , _currentTimeMutex()
     , _currentTime(0)
+    , _writeQueueMutex()
+    , _writeQueue()
 {
     engine->setPlaybackMode(ePlaybackModeOnce);
 }
@@ -2144,18 +2555,20 @@ public:
 
 #ifndef NATRON_PLAYBACK_USES_THREAD_POOL
     DefaultRenderFrameRunnable(const OutputEffectInstancePtr& writer,
-                               OutputSchedulerThread* scheduler)
+                               DefaultScheduler* scheduler)
         : RenderThreadTask(writer, scheduler)
+        , _defaultScheduler(scheduler)
     {
     }
 
 #else
     DefaultRenderFrameRunnable(const OutputEffectInstancePtr& writer,
-                               OutputSchedulerThread* scheduler,
+                               DefaultScheduler* scheduler,
                                const int time,
                                const bool useRenderStats,
                                const std::vector<int>& viewsToRender)
         : RenderThreadTask(writer, scheduler, time, useRenderStats, viewsToRender)
+        , _defaultScheduler(scheduler)
     {
     }
 
@@ -2235,8 +2648,6 @@ private:
             return;
         }
 
-        AbortableThread* isAbortableThread = dynamic_cast<AbortableThread*>( QThread::currentThread() );
-
         // Even if enableRenderStats is false, we at least profile the time spent rendering the frame when rendering with a Write node.
         // Though we don't enable render stats for sequential renders (e.g: WriteFFMPEG) since this is 1 file.
         RenderStatsPtr stats( new RenderStats(enableRenderStats) );
@@ -2247,12 +2658,6 @@ private:
         runBeforeFrameRenderCallback(outputNode);
 
         try {
-            // Writers always render at scale 1 (for now)
-            int mipMapLevel = 0;
-            RenderScale scale(1.);
-
-            RectD rod;
-
             EffectInstancePtr activeInputToRender = output;
 
             // If the output is a Write node, actually write is the internal write node encoder
@@ -2265,122 +2670,39 @@ private:
             }
             assert(activeInputToRender);
 
-            NodePtr activeInputNode = activeInputToRender->getNode();
-            const double par = activeInputToRender->getAspectRatio(-1);
-            const bool isRenderDueToRenderInteraction = false;
-            const bool isSequentialRender = true;
-
-            for (std::size_t view = 0; view < viewsToRender.size(); ++view) {
-
-
-                // Setup frame TLS args
-                AbortableRenderInfoPtr abortInfo = AbortableRenderInfo::create(true, 0);
-                if (isAbortableThread) {
-                    isAbortableThread->setAbortInfo(isRenderDueToRenderInteraction, abortInfo, activeInputToRender);
-                }
-
-                ParallelRenderArgsSetter::CtorArgsPtr tlsArgs(new ParallelRenderArgsSetter::CtorArgs);
-                tlsArgs->time = time;
-                tlsArgs->view = viewsToRender[view];
-                tlsArgs->isRenderUserInteraction = isRenderDueToRenderInteraction;
-                tlsArgs->isSequential = isSequentialRender;
-                tlsArgs->abortInfo = abortInfo;
-                tlsArgs->treeRoot = activeInputNode;
-                tlsArgs->textureIndex = 0;
-                tlsArgs->timeline = output->getApp()->getTimeLine();
-                tlsArgs->activeRotoPaintNode = NodePtr();
-                tlsArgs->activeRotoDrawableItem = RotoDrawableItemPtr();
-                tlsArgs->isDoingRotoNeatRender = false;
-                tlsArgs->isAnalysis = false;
-                tlsArgs->draftMode = false;
-                tlsArgs->stats = RenderStatsPtr();
-                boost::shared_ptr<ParallelRenderArgsSetter> frameRenderArgs;
-                try {
-                    frameRenderArgs.reset(new ParallelRenderArgsSetter(tlsArgs));
-                } catch (...) {
-                    _imp->scheduler->notifyRenderFailure("Error caught while rendering");
-
-                    return;
-
-                }
-
-                // Get the hash now that we applied TLS
-                U64 activeInputHash;
-                bool gotHash = activeInputToRender->getRenderHash(time, tlsArgs->view, &activeInputHash);
-                assert(gotHash);
-                (void)gotHash;
-                
-                // Call getRoD to know where to render
-                StatusEnum stat = activeInputToRender->getRegionOfDefinition_public(activeInputHash, time, scale, viewsToRender[view], &rod);
-                if (stat == eStatusFailed) {
-                    _imp->scheduler->notifyRenderFailure("Error caught while rendering");
-
-                    return;
-                }
-
-
-                // Get layers to render
-                std::list<ImageComponents> components;
-                ImageBitDepthEnum imageDepth;
-
-                //Use needed components to figure out what we need to render
-                EffectInstance::ComponentsNeededMap neededComps;
-                bool processAll;
-                SequenceTime ptTime;
-                int ptView;
-                std::bitset<4> processChannels;
-                NodePtr ptInput;
-                activeInputToRender->getComponentsNeededAndProduced_public(true, true, time, viewsToRender[view], &neededComps, &processAll, &ptTime, &ptView, &processChannels, &ptInput);
-
-
-                //Retrieve bitdepth only
-                imageDepth = activeInputToRender->getBitDepth(-1);
-                components.clear();
-
-                EffectInstance::ComponentsNeededMap::iterator foundOutput = neededComps.find(-1);
-                if ( foundOutput != neededComps.end() ) {
-                    for (std::size_t j = 0; j < foundOutput->second.size(); ++j) {
-                        components.push_back(foundOutput->second[j]);
+            // If frames are written by the writer threads, only render the inputs of the writer and queue the frame
+            WriteQueuePtr writeQueue;
+            {
+                QMutexLocker k(&_defaultScheduler->_writeQueueMutex);
+                writeQueue = _defaultScheduler->_writeQueue;
+            }
+            if (writeQueue) {
+                assert(writeQueue->getWriter() == activeInputToRender);
+                WriteQueue::Frame frame;
+                frame.time = time;
+                frame.viewsToRender = viewsToRender;
+                frame.stats = stats;
+                frame.inputImages.resize( viewsToRender.size() );
+                for (std::size_t view = 0; view < viewsToRender.size(); ++view) {
+                    frame.inputImages[view].reset(new EffectInstance::PrefetchedInputImages);
+                    EffectInstance::RenderRoIRetCode retCode = renderOutputFrameView(activeInputToRender, time, viewsToRender[view], EffectInstance::PrefetchedInputImagesPtr(), frame.inputImages[view].get());
+                    if (retCode != EffectInstance::eRenderRoIRetCodeOk) {
+                        _imp->scheduler->notifyRenderFailure( getRenderFailureMessage(retCode) );
+
+                        return;
                     }
                 }
-
-                // The render window is the RoD in pixel coordinates in our case
-                RectI renderWindow;
-                rod.toPixelEnclosing(scale, par, &renderWindow);
-
-                // Optimize roi
-                stat = frameRenderArgs->computeRequestPass(mipMapLevel, rod);
-                if (stat == eStatusFailed) {
-                    _imp->scheduler->notifyRenderFailure("Error caught while rendering");
-
-                    return;
+                if ( !writeQueue->push(frame) ) {
+                    _imp->scheduler->notifyRenderFailure("Render aborted");
                 }
 
-                // Launch render
-                RenderingFlagSetter flagIsRendering( activeInputToRender->getNode() );
-                std::map<ImageComponents, ImagePtr> planes;
-                boost::scoped_ptr<EffectInstance::RenderRoIArgs> renderArgs( new EffectInstance::RenderRoIArgs(time, //< the time at which to render
-                                                                                                               scale, //< the scale at which to render
-                                                                                                               mipMapLevel, //< the mipmap level (redundant with the scale)
-                                                                                                               viewsToRender[view], //< the view to render
-                                                                                                               false, //< byPassCache
-                                                                                                               renderWindow, //< the render window (in pixel coordinates)
-                                                                                                               rod, // < any precomputed rod ? in canonical coordinates
-                                                                                                               components,
-                                                                                                               imageDepth,
-                                                                                                               false,
-                                                                                                               activeInputToRender,
-                                                                                                               eStorageModeRAM,
-                                                                                                               time) );
-
-                EffectInstance::RenderRoIRetCode retCode = activeInputToRender->renderRoI(*renderArgs, &planes);
+                return;
+            }
 
+            for (std::size_t view = 0; view < viewsToRender.size(); ++view) {
+                EffectInstance::RenderRoIRetCode retCode = renderOutputFrameView(activeInputToRender, time, viewsToRender[view], EffectInstance::PrefetchedInputImagesPtr(), 0);
                 if (retCode != EffectInstance::eRenderRoIRetCodeOk) {
-                    if (retCode == EffectInstance::eRenderRoIRetCodeAborted) {
-                        _imp->scheduler->notifyRenderFailure("Render aborted");
-                    } else {
-                        _imp->scheduler->notifyRenderFailure("Error caught while rendering");
-                    }
+                    _imp->scheduler->notifyRenderFailure( getRenderFailureMessage(retCode) );
 
                     return;
                 }
@@ -2392,6 +2714,8 @@ private:
             _imp->scheduler->notifyRenderFailure( std::string("Error while rendering: ") + e.what() );
         }
     } // renderFrame
+
+    DefaultScheduler* _defaultScheduler;
 };
 
 #ifndef NATRON_PLAYBACK_USES_THREAD_POOL
@@ -2596,6 +2920,27 @@ DefaultScheduler::aboutToStartRender()
         isWrite->onSequenceRenderStarted();
     }
 
+    // Start the writer threads if frames are written separately from the render threads
+    {
+        EffectInstancePtr writer = effect;
+        if (isWrite) {
+            NodePtr embeddedWriter = isWrite->getEmbeddedWriter();
+            if (embeddedWriter) {
+                writer = embeddedWriter->getEffectInstance();
+            }
+        }
+        int nWriterThreads = appPTR->getCurrentSettings()->getNumberOfWriterThreads();
+        WriteQueuePtr writeQueue;
+        if ( (nWriterThreads > 0) && writer && writer->isWriter() ) {
+            // Sequential writers (e.g: WriteFFMPEG) encode a single file: write the frames one at a time, in order
+            SequentialPreferenceEnum pref = writer->getSequentialPreference();
+            bool ordered = (pref == eSequentialPreferenceOnlySequential) || (pref == eSequentialPreferencePreferSequential);
+            writeQueue.reset( new WriteQueue(this, writer, ordered ? 1 : nWriterThreads, ordered, *args) );
+        }
+        QMutexLocker k(&_writeQueueMutex);
+        _writeQueue.swap(writeQueue);
+    }
+
     std::string cb = effect->getNode()->getBeforeRenderCallback();
     if ( !cb.empty() ) {
         std::vector<std::string> args;
@@ -2715,6 +3060,30 @@ DefaultScheduler::onRenderStopped(bool aborted)
     }
 } // DefaultScheduler::onRenderStopped
 
+void
+DefaultScheduler::onRenderThreadsFinished(bool aborted)
+{
+    // Write the frames remaining in the queue before the writer is notified that the sequence ended
+    WriteQueuePtr writeQueue;
+    {
+        QMutexLocker k(&_writeQueueMutex);
+        writeQueue.swap(_writeQueue);
+    }
+    if (writeQueue) {
+        writeQueue->stop(aborted);
+    }
+}
+
+void
+DefaultScheduler::onRenderAbortRequested()
+{
+    QMutexLocker k(&_writeQueueMutex);
+
+    if (_writeQueue) {
+        _writeQueue->abortWrites();
+    }
+}
+
 ////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////
 //////////////////////// ViewerDisplayScheduler ////////////
@@ -2982,9 +3351,17 @@ struct RenderEnginePrivate
     mutable QMutex pbModeMutex;
     PlaybackModeEnum pbMode;
     ViewerCurrentFrameRequestScheduler* currentFrameScheduler;
+    ViewerSpeculativeRenderScheduler* speculativeScheduler;
+    ViewerSpeculativeRenderPlanner speculativePlanner;
+
+    // The time origin of speculativePlanner
+    TimeLapse speculativeClock;
 
     // Only used on the main-thread
     boost::scoped_ptr<RenderEngineWatcher> engineWatcher;
+
+    // Started each time the viewer displays a frame, renders ahead when it times out. Only used on the main-thread
+    QTimer speculativeRenderTimer;
     struct RefreshRequest
     {
         bool enableStats;
@@ -3007,8 +3384,22 @@ struct RenderEnginePrivate
         , pbModeMutex()
         , pbMode(ePlaybackModeLoop)
         , currentFrameScheduler(0)
+        , speculativeScheduler(0)
+        , speculativePlanner()
+        , speculativeClock()
+        , speculativeRenderTimer()
         , refreshQueue()
     {
+        speculativeRenderTimer.setSingleShot(true);
+        speculativeRenderTimer.setInterval(NATRON_VIEWER_SPECULATIVE_RENDER_IDLE_DELAY_MS);
+    }
+
+    void abortSpeculativeRender()
+    {
+        speculativePlanner.notifyUserInteraction();
+        if (speculativeScheduler) {
+            speculativeScheduler->abortThreadedTask();
+        }
     }
 };
 
@@ -3016,10 +3407,13 @@ RenderEngine::RenderEngine(const OutputEffectInstancePtr& output)
     : _imp( new RenderEnginePrivate(output) )
 {
     QObject::connect(this, SIGNAL(currentFrameRenderRequestPosted()), this, SLOT(onCurrentFrameRenderRequestPosted()), Qt::QueuedConnection);
+    QObject::connect( &_imp->speculativeRenderTimer, SIGNAL(timeout()), this, SLOT(onSpeculativeRenderTimerTimeout()) );
 }
 
 RenderEngine::~RenderEngine()
 {
+    delete _imp->speculativeScheduler;
+    _imp->speculativeScheduler = 0;
     delete _imp->currentFrameScheduler;
     _imp->currentFrameScheduler = 0;
     delete _imp->scheduler;
@@ -3048,6 +3442,7 @@ RenderEngine::renderFrameRange(bool isBlocking,
                                RenderDirectionEnum forward)
 {
     setPlaybackAutoRestartEnabled(true);
+    _imp->abortSpeculativeRender();
 
     {
         QMutexLocker k(&_imp->schedulerCreationLock);
@@ -3065,6 +3460,7 @@ RenderEngine::renderFromCurrentFrame(bool enableRenderStats,
                                      RenderDirectionEnum forward)
 {
     setPlaybackAutoRestartEnabled(true);
+    _imp->abortSpeculativeRender();
 
     {
         QMutexLocker k(&_imp->schedulerCreationLock);
@@ -3113,6 +3509,9 @@ RenderEngine::renderCurrentFrameNow(bool enableRenderStats,
         return;
     }
 
+    // The user interacts: frames rendered ahead may no longer be relevant and they would slow down this render
+    _imp->speculativeRenderTimer.stop();
+    _imp->abortSpeculativeRender();
 
     ///If the scheduler is already doing playback, continue it
     if (_imp->scheduler) {
@@ -3183,6 +3582,10 @@ RenderEngine::quitEngine(bool allowRestarts)
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->quitThread(allowRestarts);
     }
+
+    if (_imp->speculativeScheduler) {
+        _imp->speculativeScheduler->quitThread(allowRestarts);
+    }
 }
 
 void
@@ -3195,6 +3598,10 @@ RenderEngine::waitForEngineToQuit_not_main_thread()
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->waitForThreadToQuit_not_main_thread();
     }
+
+    if (_imp->speculativeScheduler) {
+        _imp->speculativeScheduler->waitForThreadToQuit_not_main_thread();
+    }
 }
 
 void
@@ -3217,6 +3624,10 @@ RenderEngine::waitForEngineToQuit_enforce_blocking()
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->waitForThreadToQuit_enforce_blocking();
     }
+
+    if (_imp->speculativeScheduler) {
+        _imp->speculativeScheduler->waitForThreadToQuit_enforce_blocking();
+    }
 }
 
 bool
@@ -3228,6 +3639,10 @@ RenderEngine::abortRenderingInternal(bool keepOldestRender)
         ret |= _imp->currentFrameScheduler->abortThreadedTask(keepOldestRender);
     }
 
+    if (_imp->speculativeScheduler) {
+        ret |= _imp->speculativeScheduler->abortThreadedTask();
+    }
+
     if ( _imp->scheduler && _imp->scheduler->isWorking() ) {
         //If any playback active, abort it
         ret |= _imp->scheduler->abortThreadedTask(keepOldestRender);
@@ -3264,6 +3679,9 @@ RenderEngine::waitForAbortToComplete_not_main_thread()
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->waitForAbortToComplete_not_main_thread();
     }
+    if (_imp->speculativeScheduler) {
+        _imp->speculativeScheduler->waitForAbortToComplete_not_main_thread();
+    }
     if (_imp->scheduler) {
         _imp->scheduler->waitForAbortToComplete_not_main_thread();
     }
@@ -3279,6 +3697,10 @@ RenderEngine::waitForAbortToComplete_enforce_blocking()
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->waitForAbortToComplete_enforce_blocking();
     }
+
+    if (_imp->speculativeScheduler) {
+        _imp->speculativeScheduler->waitForAbortToComplete_enforce_blocking();
+    }
 }
 
 void
@@ -3335,8 +3757,12 @@ RenderEngine::hasThreadsAlive() const
     if (_imp->currentFrameScheduler) {
         currentFrameSchedulerRunning = _imp->currentFrameScheduler->isRunning();
     }
+    bool speculativeSchedulerRunning = false;
+    if (_imp->speculativeScheduler) {
+        speculativeSchedulerRunning = _imp->speculativeScheduler->isRunning();
+    }
 
-    return schedulerRunning || currentFrameSchedulerRunning;
+    return schedulerRunning || currentFrameSchedulerRunning || speculativeSchedulerRunning;
 }
 
 bool
@@ -3403,6 +3829,69 @@ RenderEngine::notifyFrameProduced(const BufferableObjectList& frames,
     _imp->currentFrameScheduler->notifyFrameProduced(frames, stats, request);
 }
 
+void
+RenderEngine::scheduleSpeculativeRender()
+{
+    assert( QThread::currentThread() == qApp->thread() );
+    if ( !appPTR->getCurrentSettings()->isViewerSpeculativeRenderEnabled() ) {
+        return;
+    }
+    // Restart the timer: frames are only rendered ahead once the viewer stopped changing
+    _imp->speculativePlanner.notifyFrameDisplayed( _imp->speculativeClock.getTimeSinceCreation() );
+    _imp->speculativeRenderTimer.start();
+}
+
+void
+RenderEngine::onSpeculativeRenderTimerTimeout()
+{
+    assert( QThread::currentThread() == qApp->thread() );
+
+    ViewerInstancePtr viewer = toViewerInstance( _imp->output.lock() );
+    if ( !viewer || !viewer->getNode() || !viewer->isViewerUIVisible() ) {
+        return;
+    }
+    SettingsPtr settings = appPTR->getCurrentSettings();
+    if ( !settings->isViewerSpeculativeRenderEnabled() ) {
+        return;
+    }
+    double remainingIdleTime = _imp->speculativePlanner.getRemainingIdleTime( _imp->speculativeClock.getTimeSinceCreation() );
+    if (remainingIdleTime < 0) {
+        // The user interacted since the frame was displayed
+        return;
+    }
+    if (remainingIdleTime > 0) {
+        // The timer fired early
+        _imp->speculativeRenderTimer.start( (int)std::ceil(remainingIdleTime * 1000.) );
+
+        return;
+    }
+
+    // Only when nothing else renders in this viewer
+    if ( ( _imp->scheduler && _imp->scheduler->isWorking() ) || ( _imp->currentFrameScheduler && _imp->currentFrameScheduler->isWorking() ) ) {
+        return;
+    }
+
+    // Render in the direction of the last playback first, that is where the user is most likely to play next
+    RenderDirectionEnum direction = eRenderDirectionForward;
+    if (_imp->scheduler) {
+        std::vector<ViewIdx> lastViews;
+        _imp->scheduler->getLastRunArgs(&direction, &lastViews);
+    }
+
+    int firstFrame, lastFrame;
+    viewer->getTimelineBounds(&firstFrame, &lastFrame);
+    int viewsCount = viewer->getRenderViewsCount();
+    ViewIdx view = viewsCount > 0 ? viewer->getCurrentView() : ViewIdx(0);
+    std::size_t maxBytes = (std::size_t)(settings->getMaximumViewerDiskCacheSize() * NATRON_VIEWER_SPECULATIVE_RENDER_CACHE_FRACTION);
+
+    if (!_imp->speculativeScheduler) {
+        _imp->speculativeScheduler = new ViewerSpeculativeRenderScheduler(viewer);
+    }
+    ViewerSpeculativeRenderFramesPtr frames = _imp->speculativePlanner.start(viewer->getTimeline()->currentFrame(), direction == eRenderDirectionForward,
+                                                                            firstFrame, lastFrame, settings->getViewerSpeculativeRenderMaxFrames(), maxBytes);
+    _imp->speculativeScheduler->renderFrames(frames, view);
+}
+
 OutputSchedulerThread*
 ViewerRenderEngine::createScheduler(const OutputEffectInstancePtr& effect)
 {
@@ -3814,6 +4303,11 @@ ViewerCurrentFrameRequestSchedulerPrivate::processProducedFrame(const RenderStat
 
     ///At least redraw the viewer, we might be here when the user removed a node upstream of the viewer.
     viewer->redrawViewer();
+
+    RenderEnginePtr engine = viewer->getRenderEngine();
+    if (engine) {
+        engine->scheduleSpeculativeRender();
+    }
 }
 
 void
@@ -4066,6 +4560,106 @@ ViewerCurrentFrameRequestRendererBackup::threadLoopOnce(const ThreadStartArgsPtr
     return eThreadStateActive;
 }
 
+////////////////////////ViewerSpeculativeRenderScheduler////////////////////////
+
+class ViewerSpeculativeRenderStartArgs
+    : public GenericThreadStartArgs
+{
+public:
+
+    ViewerSpeculativeRenderFramesPtr frames;
+    ViewIdx view;
+
+    ViewerSpeculativeRenderStartArgs()
+        : GenericThreadStartArgs()
+        , frames()
+        , view(0)
+    {
+    }
+
+    virtual ~ViewerSpeculativeRenderStartArgs()
+    {
+    }
+};
+
+struct ViewerSpeculativeRenderSchedulerPrivate
+{
+    ViewerInstancePtr viewer;
+
+    ViewerSpeculativeRenderSchedulerPrivate(const ViewerInstancePtr& viewer)
+        : viewer(viewer)
+    {
+    }
+};
+
+ViewerSpeculativeRenderScheduler::ViewerSpeculativeRenderScheduler(const ViewerInstancePtr& viewer)
+    : GenericSchedulerThread()
+    , _imp( new ViewerSpeculativeRenderSchedulerPrivate(viewer) )
+{
+    setThreadName("ViewerSpeculativeRenderScheduler");
+}
+
+ViewerSpeculativeRenderScheduler::~ViewerSpeculativeRenderScheduler()
+{
+}
+
+void
+ViewerSpeculativeRenderScheduler::renderFrames(const ViewerSpeculativeRenderFramesPtr& frames,
+                                               ViewIdx view)
+{
+    boost::shared_ptr<ViewerSpeculativeRenderStartArgs> args(new ViewerSpeculativeRenderStartArgs);
+
+    args->frames = frames;
+    args->view = view;
+    startTask(args);
+}
+
+GenericSchedulerThread::TaskQueueBehaviorEnum
+ViewerSpeculativeRenderScheduler::tasksQueueBehaviour() const
+{
+    return eTaskQueueBehaviorSkipToMostRecent;
+}
+
+void
+ViewerSpeculativeRenderScheduler::onAbortRequested(bool /*keepOldestRender*/)
+{
+    _imp->viewer->abortSpeculativeRenders();
+}
+
+GenericSchedulerThread::ThreadStateEnum
+ViewerSpeculativeRenderScheduler::threadLoopOnce(const ThreadStartArgsPtr& inArgs)
+{
+    boost::shared_ptr<ViewerSpeculativeRenderStartArgs> args = boost::dynamic_pointer_cast<ViewerSpeculativeRenderStartArgs>(inArgs);
+
+    assert(args);
+
+    // Never compete with the renders the user is waiting for
+    if ( priority() != QThread::LowestPriority ) {
+        setPriority(QThread::LowestPriority);
+    }
+
+    int frame;
+    while ( args->frames->getNextFrame(&frame) ) {
+        ThreadStateEnum state = resolveState();
+        if ( (state == eThreadStateStopped) || (state == eThreadStateAborted) ) {
+            return state;
+        }
+        if ( !_imp->viewer->isViewerUIVisible() ) {
+            break;
+        }
+
+        std::size_t frameBytes = 0;
+        ViewerInstance::ViewerRenderRetCode stat = _imp->viewer->renderSpeculatively(frame, args->view, &frameBytes);
+        if (stat == ViewerInstance::eViewerRenderRetCodeFail) {
+            // Playback would fail at this frame too, do not insist
+            break;
+        }
+        args->frames->notifyFrameRendered(frameBytes);
+    }
+
+    return resolveState();
+} // ViewerSpeculativeRenderScheduler::threadLoopOnce
+
 NATRON_NAMESPACE_EXIT;
 
 NATRON_NAMESPACE_USING;
@@ -44,6 +44,7 @@
 #include "Engine/ViewIdx.h"
 #include "Engine/EngineFwd.h"
 #include "Engine/ThreadPool.h"
+#include "Engine/ViewerSpeculativeRenderPlanner.h"
 
 //#define NATRON_PLAYBACK_USES_THREAD_POOL
 
@@ -409,6 +410,16 @@ protected:
      **/
     virtual void onRenderStopped(bool /*aborted*/) {}
 
+    /**
+     * @brief Callback when all render threads have quit in stopRender(), before the output is notified that the sequence ended
+     **/
+    virtual void onRenderThreadsFinished(bool /*aborted*/) {}
+
+    /**
+     * @brief Callback when the render is aborted, after the render threads were flagged as aborted
+     **/
+    virtual void onRenderAbortRequested() {}
+
     RenderEngine* getEngine() const;
 
 private:
@@ -471,6 +482,9 @@ private:
 };
 
 
+class WriteQueue;
+typedef boost::shared_ptr<WriteQueue> WriteQueuePtr;
+
 class DefaultScheduler
     : public OutputSchedulerThread
 {
@@ -478,6 +492,8 @@ GCC_DIAG_SUGGEST_OVERRIDE_OFF
     Q_OBJECT
 GCC_DIAG_SUGGEST_OVERRIDE_ON
 
+    friend class DefaultRenderFrameRunnable;
+
 public:
 
     DefaultScheduler(RenderEngine* engine,
@@ -503,9 +519,17 @@ private:
     virtual SchedulingPolicyEnum getSchedulingPolicy() const OVERRIDE FINAL;
     virtual void aboutToStartRender() OVERRIDE FINAL;
     virtual void onRenderStopped(bool aborted) OVERRIDE FINAL;
+    virtual void onRenderThreadsFinished(bool aborted) OVERRIDE FINAL;
+    virtual void onRenderAbortRequested() OVERRIDE FINAL;
     boost::weak_ptr<OutputEffectInstance> _effect;
     mutable QMutex _currentTimeMutex;
     int _currentTime;
+
+    // Frames rendered by the render threads waiting to be written by the writer threads.
+    // NULL if the render threads write the frames themselves.
+    // Protected by _writeQueueMutex: the render threads hold a reference to it while they use it.
+    mutable QMutex _writeQueueMutex;
+    WriteQueuePtr _writeQueue;
 };
 
 
@@ -620,6 +644,39 @@ private:
     virtual ThreadStateEnum threadLoopOnce(const ThreadStartArgsPtr& inArgs) OVERRIDE FINAL WARN_UNUSED_RETURN;
 };
 
+/**
+ * @brief Single low priority thread rendering the frames around the current frame into the viewer cache while the viewer is idle,
+ * so that playback started afterwards finds them cached. Each task renders the frames returned by the given
+ * ViewerSpeculativeRenderFrames. Any abort request stops it at once.
+ **/
+struct ViewerSpeculativeRenderSchedulerPrivate;
+class ViewerSpeculativeRenderScheduler
+    : public GenericSchedulerThread
+{
+public:
+
+    ViewerSpeculativeRenderScheduler(const ViewerInstancePtr& viewer);
+
+    virtual ~ViewerSpeculativeRenderScheduler();
+
+    void renderFrames(const ViewerSpeculativeRenderFramesPtr& frames, ViewIdx view);
+
+private:
+
+    virtual void onAbortRequested(bool keepOldestRender) OVERRIDE FINAL;
+
+    /**
+     * @brief How to pick the task to process from the consumer thread
+     **/
+    virtual TaskQueueBehaviorEnum tasksQueueBehaviour() const OVERRIDE FINAL;
+
+    /**
+     * @brief Must be implemented to execute the work of the thread for 1 loop. This function will be called in a infinite loop by the thread
+     **/
+    virtual ThreadStateEnum threadLoopOnce(const ThreadStartArgsPtr& inArgs) OVERRIDE FINAL WARN_UNUSED_RETURN;
+    boost::scoped_ptr<ViewerSpeculativeRenderSchedulerPrivate> _imp;
+};
+
 
 /**
  * @brief This class manages multiple OutputThreadScheduler so that each render request gets processed as soon as possible.
@@ -766,6 +823,12 @@ public:
      **/
     bool isDoingSequentialRender() const;
 
+    /**
+     * @brief Called on the main-thread once the viewer displayed a frame rendered by renderCurrentFrame: if the viewer stays
+     * idle for a while, the frames around the current frame are rendered into the viewer cache in the background.
+     **/
+    void scheduleSpeculativeRender();
+
 public Q_SLOTS:
 
     void abortRendering_non_blocking()
@@ -791,6 +854,8 @@ public Q_SLOTS:
 
     void onWatcherEngineQuitEmitted();
 
+    void onSpeculativeRenderTimerTimeout();
+
 Q_SIGNALS:
 
     /**
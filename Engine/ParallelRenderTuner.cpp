@@ -0,0 +1,202 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ParallelRenderTuner.h"
+
+#include <algorithm> // min, max
+
+NATRON_NAMESPACE_ENTER;
+
+ParallelRenderTuner::ParallelRenderTuner()
+    : _nRenders(1)
+    , _maxRenders(1)
+    , _direction(1)
+    , _nFramesToSkip(0)
+    , _window()
+    , _bestNRenders(0)
+    , _bestFramesPerSecond(0.)
+    , _nHoldWindows(0)
+    , _memoryLimit(0)
+    , _nChanges(0)
+    , _nMemoryPressureChanges(0)
+{
+}
+
+void
+ParallelRenderTuner::reset(int initialRenders,
+                           int maxRenders)
+{
+    _maxRenders = std::max(1, maxRenders);
+    _nRenders = std::max( 1, std::min(initialRenders, _maxRenders) );
+    _direction = _nRenders < _maxRenders ? 1 : -1;
+    // The render threads are started one at a time: ignore the first frames
+    _nFramesToSkip = _nRenders;
+    _window.clear();
+    _bestNRenders = 0;
+    _bestFramesPerSecond = 0.;
+    _nHoldWindows = 0;
+    _memoryLimit = 0;
+    _nChanges = 0;
+    _nMemoryPressureChanges = 0;
+}
+
+void
+ParallelRenderTuner::notifyFrameRendered(double time)
+{
+    if (_nFramesToSkip > 0) {
+        --_nFramesToSkip;
+        if (_nFramesToSkip > 0) {
+            return;
+        }
+        // The last frame started with the previous configuration is the origin of the window
+        _window.clear();
+    }
+    _window.push_back(time);
+
+    const std::size_t windowFrames = std::max(NATRON_PARALLEL_RENDER_TUNER_MIN_WINDOW_FRAMES, 2 * _nRenders);
+    while (_window.size() > windowFrames + 1) {
+        _window.pop_front();
+    }
+}
+
+double
+ParallelRenderTuner::getWindowFramesPerSecond() const
+{
+    const std::size_t windowFrames = std::max(NATRON_PARALLEL_RENDER_TUNER_MIN_WINDOW_FRAMES, 2 * _nRenders);
+
+    if ( (_nFramesToSkip > 0) || (_window.size() < windowFrames + 1) ) {
+        return -1.;
+    }
+    const double elapsed = _window.back() - _window.front();
+    if (elapsed <= 0.) {
+        return -1.;
+    }
+
+    return (_window.size() - 1) / elapsed;
+}
+
+void
+ParallelRenderTuner::setNRenders(int nRenders)
+{
+    if (nRenders == _nRenders) {
+        return;
+    }
+    // Each render thread is rendering a frame started with the current configuration
+    _nFramesToSkip = _nRenders;
+    _window.clear();
+    _nRenders = nRenders;
+    ++_nChanges;
+}
+
+int
+ParallelRenderTuner::update(double memoryPressure)
+{
+    if (memoryPressure >= NATRON_PARALLEL_RENDER_TUNER_HIGH_MEMORY_PRESSURE) {
+        // Wait for the frames started with the previous configuration to finish before decreasing again,
+        // their memory takes time to be released
+        if ( (_nRenders > 1) && (_nFramesToSkip == 0) ) {
+            _memoryLimit = _nRenders - 1;
+            _direction = -1;
+            // The best configuration so far may not be usable anymore
+            _bestNRenders = 0;
+            setNRenders(_nRenders - 1);
+            ++_nMemoryPressureChanges;
+        }
+
+        return _nRenders;
+    }
+    if ( _memoryLimit && (memoryPressure < NATRON_PARALLEL_RENDER_TUNER_LOW_MEMORY_PRESSURE) ) {
+        _memoryLimit = 0;
+    }
+
+    const double framesPerSecond = getWindowFramesPerSecond();
+    if (framesPerSecond < 0) {
+        return _nRenders;
+    }
+
+    if ( (_bestNRenders != 0) && (_nRenders != _bestNRenders) ) {
+        // The probe of a neighbour of the best configuration is finished
+        if ( framesPerSecond <= _bestFramesPerSecond * (1. + NATRON_PARALLEL_RENDER_TUNER_MIN_IMPROVEMENT) ) {
+            // Go back to the best configuration and probe on the other side after a while
+            _direction = -_direction;
+            _nHoldWindows = NATRON_PARALLEL_RENDER_TUNER_HOLD_WINDOWS;
+            setNRenders(_bestNRenders);
+
+            return _nRenders;
+        }
+        // Better: keep climbing in the same direction
+        _bestNRenders = _nRenders;
+        _bestFramesPerSecond = framesPerSecond;
+    } else {
+        // (Re)measure the best configuration: the throughput changes with the content of the frames
+        _bestNRenders = _nRenders;
+        _bestFramesPerSecond = framesPerSecond;
+        if (_nHoldWindows > 0) {
+            --_nHoldWindows;
+            _window.clear();
+
+            return _nRenders;
+        }
+    }
+
+    // Probe the next configuration
+    const int maxRenders = _memoryLimit ? std::min(_memoryLimit, _maxRenders) : _maxRenders;
+    int next = _nRenders + _direction;
+    if ( (next < 1) || (next > maxRenders) ) {
+        _direction = -_direction;
+        next = _nRenders + _direction;
+    }
+    if ( (next >= 1) && (next <= maxRenders) ) {
+        setNRenders(next);
+    } else {
+        // Nothing to probe
+        _nHoldWindows = NATRON_PARALLEL_RENDER_TUNER_HOLD_WINDOWS;
+        _window.clear();
+    }
+
+    return _nRenders;
+} // ParallelRenderTuner::update
+
+bool
+ParallelRenderTuner::getBestConfiguration(int* nRenders,
+                                          double* framesPerSecond) const
+{
+    if (_bestNRenders == 0) {
+        return false;
+    }
+    *nRenders = _bestNRenders;
+    *framesPerSecond = _bestFramesPerSecond;
+
+    return true;
+}
+
+void
+ParallelRenderTuner::getNumberOfChanges(int* nChanges,
+                                        int* nMemoryPressureChanges) const
+{
+    *nChanges = _nChanges;
+    *nMemoryPressureChanges = _nMemoryPressureChanges;
+}
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,134 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_ParallelRenderTuner_h
+#define Natron_Engine_ParallelRenderTuner_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <deque>
+
+#include "Global/GlobalDefines.h"
+
+// Minimum number of frames over which the throughput of a configuration is measured
+#define NATRON_PARALLEL_RENDER_TUNER_MIN_WINDOW_FRAMES 4
+
+// A configuration must be faster than the best one by this fraction to be kept, to ignore measurement noise
+#define NATRON_PARALLEL_RENDER_TUNER_MIN_IMPROVEMENT 0.05
+
+// Number of measurement windows during which the best configuration is kept before probing its neighbours again
+#define NATRON_PARALLEL_RENDER_TUNER_HOLD_WINDOWS 4
+
+// Above this fraction of the physical RAM used by the process, the number of parallel renders is decreased
+#define NATRON_PARALLEL_RENDER_TUNER_HIGH_MEMORY_PRESSURE 0.85
+
+// Below this fraction of the physical RAM used by the process, the number of parallel renders may increase again
+#define NATRON_PARALLEL_RENDER_TUNER_LOW_MEMORY_PRESSURE 0.75
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief Chooses the number of frames a scheduler renders in parallel by measuring the throughput.
+ * Each configuration is measured over a sliding window of finished frames, ignoring the frames which were
+ * started with the previous configuration. The number of parallel renders then hill-climbs: it moves by one in
+ * the current direction as long as the frames/second improve, otherwise it goes back to the best configuration,
+ * holds it for a while and probes the other direction.
+ * Threads of the global thread pool not used by frame renders are used to render the tiles of the frames, so
+ * fewer parallel frame renders leave more threads to each frame.
+ * When the process uses too much of the physical RAM, the number of parallel renders is decreased regardless of
+ * the throughput, and is not increased until the memory pressure is low again.
+ * This class is not thread-safe. Times are in seconds since any origin.
+ **/
+class ParallelRenderTuner
+{
+public:
+
+    ParallelRenderTuner();
+
+    /**
+     * @brief Starts tuning a new render with the given number of parallel renders, in [1, maxRenders]
+     **/
+    void reset(int initialRenders, int maxRenders);
+
+    /**
+     * @brief Call when a frame is finished at the given time
+     **/
+    void notifyFrameRendered(double time);
+
+    /**
+     * @brief Updates and returns the number of frames to render in parallel.
+     * @param memoryPressure The fraction of the physical RAM used by the process
+     **/
+    int update(double memoryPressure);
+
+    int getNRenders() const
+    {
+        return _nRenders;
+    }
+
+    /**
+     * @brief Returns the configuration with the best throughput measured so far. Returns false if no
+     * configuration could be measured yet.
+     **/
+    bool getBestConfiguration(int* nRenders, double* framesPerSecond) const;
+
+    /**
+     * @brief Returns the number of times the number of parallel renders was changed, and how many of these
+     * changes were due to memory pressure
+     **/
+    void getNumberOfChanges(int* nChanges, int* nMemoryPressureChanges) const;
+
+private:
+
+    void setNRenders(int nRenders);
+
+    // Returns the frames/second over the window if it is complete, or a negative value
+    double getWindowFramesPerSecond() const;
+
+    int _nRenders, _maxRenders;
+
+    // +1 or -1: the direction of the next probe
+    int _direction;
+
+    // Frames started with the previous configuration which are still to finish
+    int _nFramesToSkip;
+
+    // Completion times of the frames rendered with the current configuration
+    std::deque<double> _window;
+
+    int _bestNRenders;
+    double _bestFramesPerSecond;
+
+    // Number of windows during which the best configuration is held before probing again
+    int _nHoldWindows;
+
+    // Maximum number of parallel renders while the memory pressure is high, 0 if unlimited
+    int _memoryLimit;
+
+    int _nChanges, _nMemoryPressureChanges;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_ParallelRenderTuner_h
@@ -75,6 +75,7 @@ Plugin::Plugin(LibraryBinary* binary,
 , _activated(true)
 , _renderScaleEnabled(true)
 , _multiThreadingEnabled(true)
+, _workerPoolEnabled( !isPluginRequiringFreshThreads(id) )
 , _openglActivated(true)
 , _openglRenderSupport(ePluginOpenGLRenderSupportNone)
 , _presetsFiles()
@@ -427,6 +428,36 @@ Plugin::setMultiThreadingEnabled(bool b)
     _multiThreadingEnabled = b;
 }
 
+bool
+Plugin::isWorkerPoolEnabled() const
+{
+    return _workerPoolEnabled;
+}
+
+void
+Plugin::setWorkerPoolEnabled(bool b)
+{
+    _workerPoolEnabled = b;
+}
+
+bool
+Plugin::isPluginRequiringFreshThreads(const QString& pluginID)
+{
+    // The Foundry Furnace plug-ins keep an internal thread-local state that becomes dirty if the same thread is re-used
+    static const char* const blacklist[] = {
+        "uk.co.thefoundry.furnace",
+        0
+    };
+
+    for (int i = 0; blacklist[i]; ++i) {
+        if ( pluginID.startsWith( QString::fromUtf8(blacklist[i]) ) ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 bool
 Plugin::isOpenGLEnabled() const
 {
@@ -165,6 +165,7 @@ class Plugin
     std::list<PluginActionShortcut> _shortcuts;
     bool _renderScaleEnabled;
     bool _multiThreadingEnabled;
+    bool _workerPoolEnabled;
     bool _openglActivated;
 
     PluginOpenGLRenderSupport _openglRenderSupport;
@@ -282,6 +283,19 @@ public:
     bool isMultiThreadingEnabled() const;
     void setMultiThreadingEnabled(bool b);
 
+    /**
+     * @brief If true, the threads launched by the plug-in through the OpenFX multi-thread suite are taken from a pool
+     * of threads kept alive across calls, otherwise fresh threads are created for each call.
+     * This is disabled by default for plug-ins known to keep thread-local state, see isPluginRequiringFreshThreads().
+     **/
+    bool isWorkerPoolEnabled() const;
+    void setWorkerPoolEnabled(bool b);
+
+    /**
+     * @brief Returns true if the given plug-in is known to misbehave when its multi-thread suite threads are re-used.
+     **/
+    static bool isPluginRequiringFreshThreads(const QString& pluginID);
+
     bool isActivated() const;
     void setActivated(bool b);
 
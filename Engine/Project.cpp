@@ -795,6 +795,17 @@ Project::initializeKnobs()
     bool autoPreviewEnabled = appPTR->getCurrentSettings()->isAutoPreviewOnForNewProjects();
     _imp->previewMode->setDefaultValue(autoPreviewEnabled, 0);
 
+    _imp->cacheHalfFloat = AppManager::createKnob<KnobBool>( shared_from_this(), tr("Half-Float Cache") );
+    _imp->cacheHalfFloat->setName("halfFloatCache");
+    _imp->cacheHalfFloat->setHintToolTip( tr("When checked, 32-bit floating point images rendered by the nodes are stored in the RAM cache "
+                                             "as 16-bit half floats, halving their memory usage so that more frames fit in the cache. "
+                                             "Plug-ins still render in 32-bit floating point and images are converted back when read "
+                                             "from the cache, at the cost of some precision.") );
+    _imp->cacheHalfFloat->setAnimationEnabled(false);
+    _imp->cacheHalfFloat->setEvaluateOnChange(false);
+    _imp->cacheHalfFloat->setDefaultValue(false);
+    page->addKnob(_imp->cacheHalfFloat);
+
 
     _imp->frameRange = AppManager::createKnob<KnobInt>(shared_from_this(), tr("Frame Range"), 2);
     _imp->frameRange->setDefaultValue(1, 0);
@@ -1429,6 +1440,12 @@ Project::toggleAutoPreview()
     _imp->previewMode->setValue( !_imp->previewMode->getValue() );
 }
 
+bool
+Project::isHalfFloatCacheEnabled() const
+{
+    return _imp->cacheHalfFloat->getValue();
+}
+
 TimeLinePtr Project::getTimeLine() const
 {
     return _imp->timeline;
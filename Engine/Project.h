@@ -187,6 +187,11 @@ public:
 
     void toggleAutoPreview();
 
+    /**
+     * @brief Returns true if 32-bit floating point images should be stored as half floats in the RAM cache
+     **/
+    bool isHalfFloatCacheEnabled() const;
+
     TimeLinePtr getTimeLine() const WARN_UNUSED_RETURN;
 
     int currentFrame() const WARN_UNUSED_RETURN;
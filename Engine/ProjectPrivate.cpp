@@ -72,6 +72,7 @@ ProjectPrivate::ProjectPrivate(Project* project)
     , formatKnob()
     , addFormatKnob()
     , previewMode()
+    , cacheHalfFloat()
     , colorSpace8u()
     , colorSpace16u()
     , colorSpace32f()
@@ -79,6 +79,7 @@ public:
     boost::shared_ptr<KnobLayers> defaultLayersList;
     KnobButtonPtr setupForStereoButton;
     KnobBoolPtr previewMode; //< auto or manual
+    KnobBoolPtr cacheHalfFloat; //< store float images as half in the RAM cache
     KnobChoicePtr colorSpace8u;
     KnobChoicePtr colorSpace16u;
     KnobChoicePtr colorSpace32f;
@@ -24,7 +24,9 @@
 
 #include "PyParameter.h"
 
+#include <algorithm> // min, max
 #include <cassert>
+#include <climits>
 #include <stdexcept>
 
 #include "Engine/EffectInstance.h"
@@ -591,6 +593,45 @@ AnimatedParam::getExpression(int dimension,
     return ret;
 }
 
+int
+AnimatedParam::getExpressionCacheHits(int dimension) const
+{
+    KnobIPtr knob = getInternalKnob();
+
+    if ( (dimension < 0) || ( dimension >= knob->getDimension() ) ) {
+        return 0;
+    }
+    U64 hits, misses;
+    knob->getExpressionsResultsStats(dimension, &hits, &misses);
+
+    return (int)std::min<U64>(hits, INT_MAX);
+}
+
+int
+AnimatedParam::getExpressionCacheMisses(int dimension) const
+{
+    KnobIPtr knob = getInternalKnob();
+
+    if ( (dimension < 0) || ( dimension >= knob->getDimension() ) ) {
+        return 0;
+    }
+    U64 hits, misses;
+    knob->getExpressionsResultsStats(dimension, &hits, &misses);
+
+    return (int)std::min<U64>(misses, INT_MAX);
+}
+
+void
+AnimatedParam::resetExpressionCacheStats(int dimension)
+{
+    KnobIPtr knob = getInternalKnob();
+
+    if ( (dimension < 0) || ( dimension >= knob->getDimension() ) ) {
+        return;
+    }
+    knob->resetExpressionsResultsStats(dimension);
+}
+
 ///////////// IntParam
 
 IntParam::IntParam(const KnobIntPtr& knob)
@@ -301,6 +301,23 @@ public:
     bool setExpression(const QString& expr, bool hasRetVariable, int dimension = 0);
     QString getExpression(int dimension, bool* hasRetVariable) const;
 
+    /**
+     * @brief Returns how many times the value of the expression of the given dimension was found in the cache
+     * instead of being evaluated, since the last call to resetExpressionCacheStats().
+     **/
+    int getExpressionCacheHits(int dimension = 0) const;
+
+    /**
+     * @brief Returns how many times the expression of the given dimension had to be evaluated
+     * since the last call to resetExpressionCacheStats().
+     **/
+    int getExpressionCacheMisses(int dimension = 0) const;
+
+    /**
+     * @brief Resets the counters returned by getExpressionCacheHits() and getExpressionCacheMisses().
+     **/
+    void resetExpressionCacheStats(int dimension = 0);
+
     bool setInterpolationAtTime(double time, NATRON_NAMESPACE::KeyframeTypeEnum interpolation, int dimension = 0);
 };
 
@@ -0,0 +1,266 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RamBufferPool.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <map>
+#include <new> // std::bad_alloc
+#include <vector>
+
+#ifdef __NATRON_WIN32__
+#include <malloc.h> // _aligned_malloc
+#endif
+#ifdef __NATRON_LINUX__
+#include <sys/mman.h> // madvise
+#endif
+
+#include <QtCore/QMutex>
+
+NATRON_NAMESPACE_ENTER;
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+void*
+systemAllocate(std::size_t bytes)
+{
+    const std::size_t alignment = bytes >= NATRON_RAM_BUFFER_POOL_HUGE_PAGE_SIZE ? NATRON_RAM_BUFFER_POOL_HUGE_PAGE_SIZE : NATRON_RAM_BUFFER_POOL_ALIGNMENT;
+
+#ifdef __NATRON_WIN32__
+
+    return _aligned_malloc(bytes, alignment);
+#else
+    void* ptr = 0;
+    if (posix_memalign(&ptr, alignment, bytes) != 0) {
+        return 0;
+    }
+#if defined(__NATRON_LINUX__) && defined(MADV_HUGEPAGE)
+    if (bytes >= NATRON_RAM_BUFFER_POOL_HUGE_PAGE_SIZE) {
+        // Only a hint: fails harmlessly if transparent huge pages are disabled
+        madvise(ptr, bytes, MADV_HUGEPAGE);
+    }
+#endif
+
+    return ptr;
+#endif
+}
+
+void
+systemFree(void* ptr)
+{
+#ifdef __NATRON_WIN32__
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+// Freed buffers per capacity
+typedef std::map<std::size_t, std::vector<void*> > FreeListsMap;
+
+struct RamBufferPoolPrivate
+{
+    mutable QMutex lock;
+    FreeListsMap freeLists;
+    RamBufferPoolStats stats;
+
+    RamBufferPoolPrivate()
+        : lock()
+        , freeLists()
+        , stats()
+    {
+    }
+
+    /**
+     * @brief Removes retained buffers, largest first, until at most maxRetainedBytes are retained.
+     * The removed buffers are appended to toFree, to be freed once the lock is released.
+     * Must be called with the lock held.
+     **/
+    void trimLocked(std::size_t maxRetainedBytes,
+                    std::vector<void*>* toFree)
+    {
+        while ( stats.retainedBytes > maxRetainedBytes && !freeLists.empty() ) {
+            FreeListsMap::iterator last = freeLists.end();
+            --last;
+            while ( !last->second.empty() && stats.retainedBytes > maxRetainedBytes ) {
+                toFree->push_back( last->second.back() );
+                last->second.pop_back();
+                stats.retainedBytes -= last->first;
+                --stats.nRetainedBuffers;
+                ++stats.nReleasedToSystem;
+            }
+            if ( last->second.empty() ) {
+                freeLists.erase(last);
+            }
+        }
+    }
+};
+
+RamBufferPool::RamBufferPool()
+    : _imp( new RamBufferPoolPrivate() )
+{
+}
+
+RamBufferPool::~RamBufferPool()
+{
+    trim(0);
+}
+
+RamBufferPool*
+RamBufferPool::getInstance()
+{
+    static RamBufferPool* instance = new RamBufferPool();
+
+    return instance;
+}
+
+std::size_t
+RamBufferPool::getCapacity(std::size_t bytes)
+{
+    if (bytes < NATRON_RAM_BUFFER_POOL_MIN_POOLED_SIZE) {
+        return bytes;
+    }
+    // Round up to a multiple of 1 / NATRON_RAM_BUFFER_POOL_CLASSES_PER_OCTAVE of the largest power of two below bytes.
+    // Since NATRON_RAM_BUFFER_POOL_MIN_POOLED_SIZE is a multiple of the page size, so are all capacities
+    std::size_t octave = NATRON_RAM_BUFFER_POOL_MIN_POOLED_SIZE;
+    while (octave <= bytes / 2) {
+        octave *= 2;
+    }
+    const std::size_t step = octave / NATRON_RAM_BUFFER_POOL_CLASSES_PER_OCTAVE;
+
+    return ( (bytes + step - 1) / step ) * step;
+}
+
+void*
+RamBufferPool::allocate(std::size_t bytes)
+{
+    assert(bytes > 0);
+    const std::size_t capacity = getCapacity(bytes);
+    if (capacity < NATRON_RAM_BUFFER_POOL_MIN_POOLED_SIZE) {
+        {
+            QMutexLocker k(&_imp->lock);
+            ++_imp->stats.nUnpooled;
+        }
+        void* ptr = systemAllocate(capacity);
+        if (!ptr) {
+            throw std::bad_alloc();
+        }
+
+        return ptr;
+    }
+
+    {
+        QMutexLocker k(&_imp->lock);
+        _imp->stats.inUseBytes += capacity;
+        FreeListsMap::iterator found = _imp->freeLists.find(capacity);
+        if ( ( found != _imp->freeLists.end() ) && !found->second.empty() ) {
+            void* ptr = found->second.back();
+            found->second.pop_back();
+            _imp->stats.retainedBytes -= capacity;
+            --_imp->stats.nRetainedBuffers;
+            ++_imp->stats.nHits;
+
+            return ptr;
+        }
+        ++_imp->stats.nMisses;
+    }
+
+    void* ptr = systemAllocate(capacity);
+    if (!ptr) {
+        // The retained buffers may be what is missing: give them back to the system and try again
+        trim(0);
+        ptr = systemAllocate(capacity);
+    }
+    if (!ptr) {
+        QMutexLocker k(&_imp->lock);
+        _imp->stats.inUseBytes -= capacity;
+        throw std::bad_alloc();
+    }
+
+    return ptr;
+}
+
+void
+RamBufferPool::deallocate(void* ptr,
+                          std::size_t bytes)
+{
+    if (!ptr) {
+        return;
+    }
+    const std::size_t capacity = getCapacity(bytes);
+    if (capacity >= NATRON_RAM_BUFFER_POOL_MIN_POOLED_SIZE) {
+        QMutexLocker k(&_imp->lock);
+        assert(_imp->stats.inUseBytes >= capacity);
+        _imp->stats.inUseBytes -= capacity;
+        if (_imp->stats.retainedBytes + capacity <= _imp->stats.maxRetainedBytes) {
+            _imp->freeLists[capacity].push_back(ptr);
+            _imp->stats.retainedBytes += capacity;
+            ++_imp->stats.nRetainedBuffers;
+
+            return;
+        }
+        ++_imp->stats.nReleasedToSystem;
+    }
+    systemFree(ptr);
+}
+
+void
+RamBufferPool::setMaxRetainedBytes(std::size_t bytes)
+{
+    std::vector<void*> toFree;
+    {
+        QMutexLocker k(&_imp->lock);
+        _imp->stats.maxRetainedBytes = bytes;
+        _imp->trimLocked(bytes, &toFree);
+    }
+    for (std::size_t i = 0; i < toFree.size(); ++i) {
+        systemFree(toFree[i]);
+    }
+}
+
+void
+RamBufferPool::trim(std::size_t maxRetainedBytes)
+{
+    std::vector<void*> toFree;
+    {
+        QMutexLocker k(&_imp->lock);
+        _imp->trimLocked(maxRetainedBytes, &toFree);
+    }
+    for (std::size_t i = 0; i < toFree.size(); ++i) {
+        systemFree(toFree[i]);
+    }
+}
+
+void
+RamBufferPool::getStats(RamBufferPoolStats* stats) const
+{
+    QMutexLocker k(&_imp->lock);
+
+    *stats = _imp->stats;
+}
+
+NATRON_NAMESPACE_EXIT;
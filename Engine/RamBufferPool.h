@@ -0,0 +1,151 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_RamBufferPool_h
+#define Natron_Engine_RamBufferPool_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+
+// All buffers returned by the pool are aligned on this many bytes, so that SIMD kernels can use aligned loads on rows starting at the buffer
+#define NATRON_RAM_BUFFER_POOL_ALIGNMENT 64
+
+// Buffers smaller than this are not pooled: the system allocator handles them well
+#define NATRON_RAM_BUFFER_POOL_MIN_POOLED_SIZE (64 * 1024)
+
+// Number of size classes per power of two, the rounding of a pooled buffer wastes at most 1 / this of its size
+#define NATRON_RAM_BUFFER_POOL_CLASSES_PER_OCTAVE 8
+
+// Buffers of at least this size are aligned on (transparent) huge pages
+#define NATRON_RAM_BUFFER_POOL_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// Default fraction of the RAM cache budget that freed buffers may keep
+#define NATRON_RAM_BUFFER_POOL_RETAINED_FRACTION 0.125
+
+NATRON_NAMESPACE_ENTER;
+
+struct RamBufferPoolStats
+{
+    // Number of pooled allocations served from a freed buffer / by the system
+    U64 nHits, nMisses;
+
+    // Number of allocations too small to be pooled
+    U64 nUnpooled;
+
+    // Number of freed buffers given back to the system because the pool was full or trimmed
+    U64 nReleasedToSystem;
+
+    // Bytes held by buffers currently in use (pooled classes only, including the rounding of their size)
+    U64 inUseBytes;
+
+    // Bytes held by freed buffers kept for reuse, and the maximum allowed
+    U64 retainedBytes, maxRetainedBytes;
+
+    // Number of freed buffers kept for reuse
+    U64 nRetainedBuffers;
+
+    RamBufferPoolStats()
+        : nHits(0)
+        , nMisses(0)
+        , nUnpooled(0)
+        , nReleasedToSystem(0)
+        , inUseBytes(0)
+        , retainedBytes(0)
+        , maxRetainedBytes(0)
+        , nRetainedBuffers(0)
+    {
+    }
+};
+
+/**
+ * @brief Allocator of the memory of RamBuffer, used for all images and cache entries living in RAM.
+ * Images are allocated and freed constantly as tiles and mipmaps are rendered, and most of them have the
+ * same few sizes. Instead of giving the memory back to the system, freed buffers are kept in free lists
+ * per size class so that the next allocation of a similar size reuses already mapped pages, avoiding page
+ * faults, zeroing by the kernel and the fragmentation of the heap.
+ *
+ * Sizes are rounded up to NATRON_RAM_BUFFER_POOL_CLASSES_PER_OCTAVE classes per power of two. Buffers are
+ * aligned on NATRON_RAM_BUFFER_POOL_ALIGNMENT bytes, large buffers on huge pages.
+ * The total size of the freed buffers kept is bounded by setMaxRetainedBytes(), which the AppManager ties to
+ * the RAM cache budget: when a freed buffer does not fit it is given back to the system.
+ * This class is thread-safe.
+ **/
+struct RamBufferPoolPrivate;
+class RamBufferPool
+{
+public:
+
+    RamBufferPool();
+
+    ~RamBufferPool();
+
+    /**
+     * @brief The pool used by RamBuffer. It is never destroyed, so that buffers can be freed at any time.
+     **/
+    static RamBufferPool* getInstance();
+
+    /**
+     * @brief Returns a buffer of at least the given number of bytes (which must not be 0)
+     * @throws std::bad_alloc if the memory could not be allocated
+     **/
+    void* allocate(std::size_t bytes);
+
+    /**
+     * @brief Frees a buffer returned by allocate() with the same number of bytes.
+     **/
+    void deallocate(void* ptr, std::size_t bytes);
+
+    /**
+     * @brief Returns the number of bytes actually held by a buffer allocated with the given number of bytes:
+     * a buffer can be resized in place within that capacity.
+     **/
+    static std::size_t getCapacity(std::size_t bytes);
+
+    /**
+     * @brief Set the maximum number of bytes of freed buffers kept for reuse, trimming the pool if needed.
+     **/
+    void setMaxRetainedBytes(std::size_t bytes);
+
+    /**
+     * @brief Gives freed buffers back to the system, largest first, until at most the given number of bytes are retained.
+     **/
+    void trim(std::size_t maxRetainedBytes = 0);
+
+    void getStats(RamBufferPoolStats* stats) const;
+
+private:
+
+    boost::scoped_ptr<RamBufferPoolPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_RamBufferPool_h
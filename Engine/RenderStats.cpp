@@ -24,6 +24,7 @@
 
 #include "RenderStats.h"
 
+#include <algorithm> // max
 #include <bitset>
 #include <cassert>
 #include <stdexcept>
@@ -65,6 +66,14 @@ struct NodeRenderStatsPrivate
     int nbCacheHit;
     int nbCacheHitButDownscaledImages;
 
+    //Multi-thread suite infos: the number of threads created and the time spent creating them
+    int nbThreadsSpawned;
+    double timeSpentSpawningThreads;
+
+    //Write queue infos: the number of frames waiting to be written and the time the render thread waited for room in the queue
+    int writeQueueDepth;
+    double writeQueueStallTime;
+
     //Is tile support enabled for this render
     bool tileSupportEnabled;
 
@@ -88,6 +97,10 @@ struct NodeRenderStatsPrivate
         , nbCacheMisses(0)
         , nbCacheHit(0)
         , nbCacheHitButDownscaledImages(0)
+        , nbThreadsSpawned(0)
+        , timeSpentSpawningThreads(0)
+        , writeQueueDepth(0)
+        , writeQueueStallTime(0)
         , tileSupportEnabled(false)
         , renderScaleSupportEnabled(false)
         , channelsEnabled()
@@ -127,6 +140,10 @@ NodeRenderStats::operator=(const NodeRenderStats& other)
     _imp->nbCacheMisses = other._imp->nbCacheMisses;
     _imp->nbCacheHit = other._imp->nbCacheHit;
     _imp->nbCacheHitButDownscaledImages = other._imp->nbCacheHitButDownscaledImages;
+    _imp->nbThreadsSpawned = other._imp->nbThreadsSpawned;
+    _imp->timeSpentSpawningThreads = other._imp->timeSpentSpawningThreads;
+    _imp->writeQueueDepth = other._imp->writeQueueDepth;
+    _imp->writeQueueStallTime = other._imp->writeQueueStallTime;
     _imp->tileSupportEnabled = other._imp->tileSupportEnabled;
     _imp->renderScaleSupportEnabled = other._imp->renderScaleSupportEnabled;
     for (int i = 0; i < 4; ++i) {
@@ -253,6 +270,38 @@ NodeRenderStats::getCacheAccessInfos(int* nbCacheMisses,
     *nbCacheHitButDownscaledImages = _imp->nbCacheHitButDownscaledImages;
 }
 
+void
+NodeRenderStats::addThreadsSpawned(int nbThreads,
+                                   double timeSpent)
+{
+    _imp->nbThreadsSpawned += nbThreads;
+    _imp->timeSpentSpawningThreads += timeSpent;
+}
+
+void
+NodeRenderStats::getThreadsSpawnedInfos(int* nbThreads,
+                                        double* timeSpent) const
+{
+    *nbThreads = _imp->nbThreadsSpawned;
+    *timeSpent = _imp->timeSpentSpawningThreads;
+}
+
+void
+NodeRenderStats::addWriteQueueInfos(int queueDepth,
+                                    double stallTime)
+{
+    _imp->writeQueueDepth = std::max(_imp->writeQueueDepth, queueDepth);
+    _imp->writeQueueStallTime += stallTime;
+}
+
+void
+NodeRenderStats::getWriteQueueInfos(int* queueDepth,
+                                    double* stallTime) const
+{
+    *queueDepth = _imp->writeQueueDepth;
+    *stallTime = _imp->writeQueueStallTime;
+}
+
 void
 NodeRenderStats::setTilesSupported(bool tilesSupported)
 {
@@ -414,6 +463,32 @@ RenderStats::addCacheInfosForNode(const NodePtr& node,
     stats.addCacheAccessInfo(isCacheMiss, hasDownscaled);
 }
 
+void
+RenderStats::addThreadsSpawnedForNode(const NodePtr& node,
+                                      int nbThreads,
+                                      double timeSpent)
+{
+    QMutexLocker k(&_imp->lock);
+
+    assert(_imp->doNodesProfiling);
+
+    NodeRenderStats& stats = _imp->findOrCreateNodeStats(node);
+    stats.addThreadsSpawned(nbThreads, timeSpent);
+}
+
+void
+RenderStats::addWriteQueueInfosForNode(const NodePtr& node,
+                                       int queueDepth,
+                                       double stallTime)
+{
+    QMutexLocker k(&_imp->lock);
+
+    assert(_imp->doNodesProfiling);
+
+    NodeRenderStats& stats = _imp->findOrCreateNodeStats(node);
+    stats.addWriteQueueInfos(queueDepth, stallTime);
+}
+
 void
 RenderStats::addRenderInfosForNode(const NodePtr& node,
                                    const NodePtr& identity,
@@ -87,6 +87,20 @@ public:
     void addCacheAccessInfo(bool isCacheMiss, bool hasDownscaled);
     void getCacheAccessInfos(int* nbCacheMisses, int* nbCacheHits, int* nbCacheHitButDownscaledImages) const;
 
+    /**
+     * @brief Threads created by the multi-thread suite on behalf of the node, and the time (in seconds) spent creating them.
+     * Threads taken from the warm worker pool are not counted.
+     **/
+    void addThreadsSpawned(int nbThreads, double timeSpent);
+    void getThreadsSpawnedInfos(int* nbThreads, double* timeSpent) const;
+
+    /**
+     * @brief For writers rendering asynchronously: the number of frames waiting to be written when this frame was queued,
+     * and the time (in seconds) the render thread waited for room in the write queue.
+     **/
+    void addWriteQueueInfos(int queueDepth, double stallTime);
+    void getWriteQueueInfos(int* queueDepth, double* stallTime) const;
+
     void setTilesSupported(bool tilesSupported);
     bool isTilesSupportEnabled() const;
 
@@ -136,6 +150,14 @@ public:
                               bool isCacheMiss,
                               bool hasDownscaled);
 
+    void addThreadsSpawnedForNode(const NodePtr& node,
+                                  int nbThreads,
+                                  double timeSpent);
+
+    void addWriteQueueInfosForNode(const NodePtr& node,
+                                   int queueDepth,
+                                   double stallTime);
+
     void addRenderInfosForNode(const NodePtr& node,
                                const NodePtr& identity,
                                const std::string& plane,
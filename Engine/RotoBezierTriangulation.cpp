@@ -26,6 +26,11 @@
 
 #include "libtess.h"
 
+#include "Engine/BezierCP.h"
+#include "Engine/Hash64.h"
+#include "Engine/Transform.h"
+#include "Engine/ViewIdx.h"
+
 NATRON_NAMESPACE_ENTER;
 
 NATRON_NAMESPACE_ANONYMOUS_ENTER;
@@ -364,6 +369,7 @@ RotoBezierTriangulation::computeTriangles(const Bezier * bezier, double time, un
 
     }
     outArgs->bezierPolygon.clear();
+    outArgs->bezierPolygonJoinedContourSize = outArgs->bezierPolygonJoined.size();
 
     outArgs->bezierPolygonIndices.resize(outArgs->bezierPolygonJoined.size());
 
@@ -391,4 +397,126 @@ RotoBezierTriangulation::computeTriangles(const Bezier * bezier, double time, un
     
 } // RotoBezierTriangulation::computeTriangles
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER;
+
+/**
+ * @brief Hash of everything that computeTriangles reads from the bezier at the given time.
+ **/
+static U64
+computeBezierGeometryHash(const Bezier* bezier, double time)
+{
+    Hash64 hash;
+
+    Transform::Matrix3x3 transform;
+    bezier->getTransformAtTime(time, &transform);
+    hash.append(transform.a);
+    hash.append(transform.b);
+    hash.append(transform.c);
+    hash.append(transform.d);
+    hash.append(transform.e);
+    hash.append(transform.f);
+    hash.append(transform.g);
+    hash.append(transform.h);
+    hash.append(transform.i);
+
+    hash.append(bezier->isCurveFinished());
+    hash.append(bezier->isFeatherPolygonClockwiseOriented(false, time));
+
+    BezierCPs cps = bezier->getControlPoints_mt_safe();
+    BezierCPs fps = bezier->getFeatherPoints_mt_safe();
+    for (int c = 0; c < 2; ++c) {
+        const BezierCPs& points = c == 0 ? cps : fps;
+        hash.append((U64)points.size());
+        for (BezierCPs::const_iterator it = points.begin(); it != points.end(); ++it) {
+            double x, y, lx, ly, rx, ry;
+            (*it)->getPositionAtTime(false, time, ViewIdx(0), &x, &y);
+            (*it)->getLeftBezierPointAtTime(false, time, ViewIdx(0), &lx, &ly);
+            (*it)->getRightBezierPointAtTime(false, time, ViewIdx(0), &rx, &ry);
+            hash.append(x);
+            hash.append(y);
+            hash.append(lx);
+            hash.append(ly);
+            hash.append(rx);
+            hash.append(ry);
+        }
+    }
+    hash.computeHash();
+
+    return hash.value();
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT;
+
+RotoBezierTriangulation::PolygonDataConstPtr
+RotoBezierTriangulation::getOrComputeTriangles(const Bezier * bezier, double time, unsigned int mipmapLevel, double featherDist)
+{
+    RotoBezierTessellationCache::Key key;
+    key.time = time;
+    key.mipmapLevel = mipmapLevel;
+    key.featherDist = featherDist;
+    key.geometryHash = computeBezierGeometryHash(bezier, time);
+
+    RotoBezierTessellationCache* cache = bezier->getTessellationCache();
+    PolygonDataConstPtr cached = cache->get(key);
+    if (cached) {
+        return cached;
+    }
+
+    PolygonDataPtr data(new PolygonData);
+    computeTriangles(bezier, time, mipmapLevel, featherDist, data.get());
+    if (!data->error) {
+        cache->insert(key, data);
+    }
+
+    return data;
+}
+
+RotoBezierTessellationCache::RotoBezierTessellationCache()
+    : _lock()
+    , _entries()
+{
+}
+
+RotoBezierTriangulation::PolygonDataConstPtr
+RotoBezierTessellationCache::get(const Key& key)
+{
+    QMutexLocker k(&_lock);
+    for (EntryList::iterator it = _entries.begin(); it != _entries.end(); ++it) {
+        if (it->first == key) {
+            // Move the entry to the front so that it is evicted last
+            if ( it != _entries.begin() ) {
+                _entries.splice(_entries.begin(), _entries, it);
+            }
+
+            return _entries.front().second;
+        }
+    }
+
+    return RotoBezierTriangulation::PolygonDataConstPtr();
+}
+
+void
+RotoBezierTessellationCache::insert(const Key& key, const RotoBezierTriangulation::PolygonDataConstPtr& data)
+{
+    QMutexLocker k(&_lock);
+    // Another render may have computed the same tessellation concurrently
+    for (EntryList::iterator it = _entries.begin(); it != _entries.end(); ++it) {
+        if (it->first == key) {
+            _entries.erase(it);
+            break;
+        }
+    }
+    _entries.push_front( std::make_pair(key, data) );
+    while ( (int)_entries.size() > NATRON_ROTO_TESSELLATION_CACHE_MAX_ENTRIES ) {
+        _entries.pop_back();
+    }
+}
+
+void
+RotoBezierTessellationCache::clear()
+{
+    QMutexLocker k(&_lock);
+    _entries.clear();
+}
+
 NATRON_NAMESPACE_EXIT;
\ No newline at end of file
@@ -30,9 +30,14 @@
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 #endif
 
+#include <list>
 #include <vector>
+
+#include <QtCore/QMutex>
+
 #include "Engine/EngineFwd.h"
 
 #include "Engine/Bezier.h"
@@ -81,6 +86,9 @@ public:
         // Union of all discretized bezier segments
         std::vector<ParametricPoint> bezierPolygonJoined;
 
+        // Number of vertices of the contour in bezierPolygonJoined: libtess appends intersection vertices after them
+        std::size_t bezierPolygonJoinedContourSize;
+
         // indices (from 0 to n) of the points in bezierPoygonJoined
         std::vector<unsigned int*> bezierPolygonIndices;
 
@@ -98,10 +106,71 @@ public:
         boost::scoped_ptr<RotoTriangleStrips> stripsBeingEdited;
         
         unsigned int error;
+
+        PolygonData()
+            : bezierPolygonJoinedContourSize(0)
+            , error(0)
+        {
+        }
     };
 
+    typedef boost::shared_ptr<PolygonData> PolygonDataPtr;
+    typedef boost::shared_ptr<const PolygonData> PolygonDataConstPtr;
+
     static void computeTriangles(const Bezier * bezier, double time, unsigned int mipmapLevel,  double featherDist, PolygonData* outArgs);
 
+    /**
+     * @brief Same as computeTriangles, except that the result is looked-up in the tessellation cache of the bezier first
+     * and stored there afterwards, so that shapes which did not change are not discretized and tessellated again.
+     * The returned data must not be modified, it may be shared by several renders.
+     **/
+    static PolygonDataConstPtr getOrComputeTriangles(const Bezier * bezier, double time, unsigned int mipmapLevel, double featherDist);
+
+};
+
+// Maximum number of tessellations kept by each Bezier: this should be enough to hold all motion-blur samples
+// of a frame at one mipmap level.
+#define NATRON_ROTO_TESSELLATION_CACHE_MAX_ENTRIES 16
+
+/**
+ * @brief Small cache owned by each Bezier holding its most recently used tessellations.
+ * Entries are keyed by the time, the mipmap level, the feather distance and a hash of the geometry of the shape at that time
+ * (control points, feather points and transform), so that a moved shape never hits a stale entry.
+ * The cache is cleared whenever the curves of the Bezier are modified.
+ **/
+class RotoBezierTessellationCache
+{
+public:
+
+    struct Key
+    {
+        double time;
+        unsigned int mipmapLevel;
+        double featherDist;
+        U64 geometryHash;
+
+        bool operator==(const Key& other) const
+        {
+            return time == other.time && mipmapLevel == other.mipmapLevel && featherDist == other.featherDist && geometryHash == other.geometryHash;
+        }
+    };
+
+    RotoBezierTessellationCache();
+
+    RotoBezierTriangulation::PolygonDataConstPtr get(const Key& key);
+
+    void insert(const Key& key, const RotoBezierTriangulation::PolygonDataConstPtr& data);
+
+    void clear();
+
+private:
+
+    typedef std::list<std::pair<Key, RotoBezierTriangulation::PolygonDataConstPtr> > EntryList;
+
+    QMutex _lock;
+
+    // Most recently used first
+    EntryList _entries;
 };
 
 NATRON_NAMESPACE_EXIT;
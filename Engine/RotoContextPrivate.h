@@ -56,6 +56,7 @@ CLANG_DIAG_ON(uninitialized)
 #include "Engine/AppManager.h"
 #include "Engine/BezierCP.h"
 #include "Engine/Bezier.h"
+#include "Engine/RotoBezierTriangulation.h"
 #include "Engine/Curve.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/Image.h"
@@ -404,6 +405,9 @@ struct BezierPrivate
     mutable QMutex guiCopyMutex;
     bool mustCopyGui;
 
+    // Tessellations of the internal curves, used by the renderers
+    mutable RotoBezierTessellationCache tessellationCache;
+
     BezierPrivate(bool isOpenBezier)
         : points()
         , featherPoints()
@@ -416,6 +420,7 @@ struct BezierPrivate
         , isOpenBezier(isOpenBezier)
         , guiCopyMutex()
         , mustCopyGui(false)
+        , tessellationCache()
     {
     }
 
@@ -0,0 +1,903 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RotoShapeRenderCPU.h"
+
+#include <algorithm> // min, max
+#include <cmath>
+#include <cassert>
+
+#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
+
+#include <boost/bind.hpp>
+
+#include "Engine/Bezier.h"
+#include "Engine/Half.h"
+#include "Engine/Image.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/RotoDrawableItem.h"
+#include "Engine/RotoShapeRenderNodePrivate.h"
+
+NATRON_NAMESPACE_ENTER;
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER;
+
+/**
+ * @brief Accumulates the signed area covered on the right of the line (x0,y0)-(x1,y1) in the accumulation buffer,
+ * assuming the line lies in [0, width] horizontally. The coverage of a pixel is then the sum of the values on its left in the row.
+ * This is the exact area coverage algorithm of font-rs / stb_truetype.
+ **/
+static void
+accumulateLineInside(double x0,
+                     double y0,
+                     double x1,
+                     double y1,
+                     int width,
+                     int height,
+                     int accStride,
+                     float* acc)
+{
+    double dir = 1.;
+    if (y0 > y1) {
+        dir = -1.;
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+    }
+    if ( (y1 <= 0) || (y0 >= height) ) {
+        return;
+    }
+    const double dxdy = (x1 - x0) / (y1 - y0);
+    double x = x0;
+    if (y0 < 0) {
+        x -= y0 * dxdy;
+        y0 = 0;
+    }
+    if (y1 > height) {
+        y1 = height;
+    }
+
+    const int yStart = (int)std::floor(y0);
+    const int yEnd = (int)std::ceil(y1);
+    for (int y = yStart; y < yEnd; ++y) {
+        float* row = acc + y * accStride;
+        const double dy = std::min( (double)(y + 1), y1 ) - std::max( (double)y, y0 );
+        // Clamp to avoid rounding errors making us write outside of the row
+        const double xnext = std::max( 0., std::min( (double)width, x + dxdy * dy ) );
+        const double d = dy * dir;
+        const double xa = std::min(x, xnext);
+        const double xb = std::max(x, xnext);
+        const double xaFloor = std::floor(xa);
+        const int xai = (int)xaFloor;
+        const double xbCeil = std::ceil(xb);
+        const int xbi = (int)xbCeil;
+        if (xbi <= xai + 1) {
+            // The line crosses a single pixel on this row
+            const double xmf = 0.5 * (x + xnext) - xaFloor;
+            row[xai] += (float)(d - d * xmf);
+            row[xai + 1] += (float)(d * xmf);
+        } else {
+            const double s = 1. / (xb - xa);
+            const double xaf = xa - xaFloor;
+            const double a0 = 0.5 * s * (1. - xaf) * (1. - xaf);
+            const double xbf = xb - xbCeil + 1.;
+            const double am = 0.5 * s * xbf * xbf;
+            row[xai] += (float)(d * a0);
+            if (xbi == xai + 2) {
+                row[xai + 1] += (float)( d * (1. - a0 - am) );
+            } else {
+                const double a1 = s * (1.5 - xaf);
+                row[xai + 1] += (float)( d * (a1 - a0) );
+                for (int xi = xai + 2; xi < xbi - 1; ++xi) {
+                    row[xi] += (float)(d * s);
+                }
+                const double a2 = a1 + (xbi - xai - 3) * s;
+                row[xbi - 1] += (float)( d * (1. - a2 - am) );
+            }
+            row[xbi] += (float)(d * am);
+        }
+        x = xnext;
+    }
+} // accumulateLineInside
+
+/**
+ * @brief Same as accumulateLineInside, except that the parts of the line outside of [0, width] are collapsed
+ * onto the borders: they still cover (or not) all the pixels on their right.
+ **/
+static void
+accumulateLine(double x0,
+               double y0,
+               double x1,
+               double y1,
+               int width,
+               int height,
+               int accStride,
+               float* acc)
+{
+    if (y0 == y1) {
+        return;
+    }
+    const double borders[2] = {0., (double)width};
+    for (int i = 0; i < 2; ++i) {
+        const double b = borders[i];
+        if ( ( (x0 < b) && (x1 > b) ) || ( (x0 > b) && (x1 < b) ) ) {
+            const double yb = y0 + (b - x0) * (y1 - y0) / (x1 - x0);
+            accumulateLine(x0, y0, b, yb, width, height, accStride, acc);
+            accumulateLine(b, yb, x1, y1, width, height, accStride, acc);
+
+            return;
+        }
+    }
+    x0 = std::max( 0., std::min( (double)width, x0 ) );
+    x1 = std::max( 0., std::min( (double)width, x1 ) );
+    accumulateLineInside(x0, y0, x1, y1, width, height, accStride, acc);
+}
+
+/**
+ * @brief The fall-off of the feather as rendered by renderFeather_cairo: each feather triangle is a coons patch whose
+ * edges from the inner to the outer vertices are cubic beziers with control points at c1 and c2 (relative to the edge),
+ * and cairo interpolates the alpha linearly along the bezier parameter u. The ramp at a relative distance d from the
+ * inner edge is then 1 - u where bezier(u) = d.
+ **/
+struct FeatherFallOff
+{
+    double c1, c2;
+
+    explicit FeatherFallOff(double fallOff)
+    {
+        // Same control points as renderFeather_cairo
+        const double fallOffInverse = 1. / fallOff;
+        c1 = fallOffInverse / (fallOff * 2. + fallOffInverse);
+        c2 = 2. * fallOffInverse / (fallOff + 2. * fallOffInverse);
+    }
+
+    double apply(double t) const
+    {
+        const double d = 1. - t;
+        if ( (d <= 0.) || (d >= 1.) ) {
+            return t;
+        }
+        // The bezier is increasing since 0 < c1 < c2 < 1: Newton iterations kept inside a bisection bracket
+        double lo = 0., hi = 1., u = d;
+        for (int i = 0; i < 20; ++i) {
+            const double v = 1. - u;
+            const double b = 3. * v * v * u * c1 + 3. * v * u * u * c2 + u * u * u - d;
+            if (std::abs(b) < 1e-7) {
+                break;
+            }
+            if (b > 0.) {
+                hi = u;
+            } else {
+                lo = u;
+            }
+            const double db = 3. * ( v * v * c1 + 2. * v * u * (c2 - c1) + u * u * (1. - c2) );
+            const double next = (db > 0.) ? u - b / db : lo;
+            u = ( (next > lo) && (next < hi) ) ? next : (lo + hi) / 2.;
+        }
+
+        return 1. - u;
+    }
+};
+
+static inline double
+applyFeatherRamp(RampTypeEnum type,
+                 double t,
+                 const FeatherFallOff& fallOff)
+{
+    // The ramp types are those of the rotoRamp_FragmentShader of the OpenGL implementation (cairo only has the linear ramp),
+    // the fall-off is the one of cairo
+    switch (type) {
+    case eRampTypeLinear:
+        break;
+    case eRampTypePLinear:
+        t = t * t * t;
+        break;
+    case eRampTypeEaseIn:
+        t = t * t * (2. - t);
+        break;
+    case eRampTypeEaseOut:
+        t = t * (1. + t * (1. - t));
+        break;
+    case eRampTypeSmooth:
+        t = t * t * (3. - 2. * t);
+        break;
+    }
+
+    return fallOff.apply(t);
+}
+
+struct RotoShapeRenderCPUSample
+{
+    RotoBezierTriangulation::PolygonDataConstPtr data;
+    double fallOff;
+};
+
+// The destination image, shared by all tiles
+struct RotoShapeRenderCPUOutput
+{
+    double shapeColor[3];
+    double opacity;
+    ImageBitDepthEnum depth;
+    int nComps;
+    RectI bounds;
+    unsigned char* dstPixels;
+};
+
+struct RotoShapeRenderCPUArgs
+{
+    std::vector<RotoShapeRenderCPUSample> samples;
+    RampTypeEnum rampType;
+    RotoShapeRenderCPUOutput output;
+};
+
+template <typename PIX, int maxValue, int dstNComps>
+static void
+writeMaskToImageForComponents(const RotoShapeRenderCPUOutput& args,
+                              const RectI& tile,
+                              const float* mask)
+{
+    // Same conversion as convertCairoImageToNatronImage_noColor
+    const double r = args.shapeColor[0] * args.opacity;
+    const double g = args.shapeColor[1] * args.opacity;
+    const double b = args.shapeColor[2] * args.opacity;
+    const int width = tile.width();
+
+    for (int y = tile.y1; y < tile.y2; ++y, mask += width) {
+        PIX* dstPix = (PIX*)Image::pixelAtStatic(tile.x1, y, args.bounds, dstNComps, sizeof(PIX), args.dstPixels);
+        assert(dstPix);
+        for (int x = 0; x < width; ++x, dstPix += dstNComps) {
+            const float m = mask[x] * maxValue;
+            switch (dstNComps) {
+            case 4:
+                dstPix[0] = PIX(m * r);
+                dstPix[1] = PIX(m * g);
+                dstPix[2] = PIX(m * b);
+                dstPix[3] = PIX(m * args.opacity);
+                break;
+            case 1:
+                dstPix[0] = PIX(m * args.opacity);
+                break;
+            case 3:
+                dstPix[0] = PIX(m * r);
+                dstPix[1] = PIX(m * g);
+                dstPix[2] = PIX(m * b);
+                break;
+            case 2:
+                dstPix[0] = PIX(m * r);
+                dstPix[1] = PIX(m * g);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+template <typename PIX, int maxValue>
+static void
+writeMaskToImageForDepth(const RotoShapeRenderCPUOutput& args,
+                         const RectI& tile,
+                         const float* mask)
+{
+    switch (args.nComps) {
+    case 1:
+        writeMaskToImageForComponents<PIX, maxValue, 1>(args, tile, mask);
+        break;
+    case 2:
+        writeMaskToImageForComponents<PIX, maxValue, 2>(args, tile, mask);
+        break;
+    case 3:
+        writeMaskToImageForComponents<PIX, maxValue, 3>(args, tile, mask);
+        break;
+    case 4:
+        writeMaskToImageForComponents<PIX, maxValue, 4>(args, tile, mask);
+        break;
+    default:
+        break;
+    }
+}
+
+static void
+writeMaskToImage(const RotoShapeRenderCPUOutput& args,
+                 const RectI& tile,
+                 const float* mask)
+{
+    switch (args.depth) {
+    case eImageBitDepthFloat:
+        writeMaskToImageForDepth<float, 1>(args, tile, mask);
+        break;
+    case eImageBitDepthByte:
+        writeMaskToImageForDepth<unsigned char, 255>(args, tile, mask);
+        break;
+    case eImageBitDepthShort:
+        writeMaskToImageForDepth<unsigned short, 65535>(args, tile, mask);
+        break;
+    case eImageBitDepthHalf:
+        writeMaskToImageForDepth<Half, 1>(args, tile, mask);
+        break;
+    case eImageBitDepthNone:
+        assert(false);
+        break;
+    }
+}
+
+static void
+renderBezierTile(const RotoShapeRenderCPUArgs& args,
+                 const RectI& tile)
+{
+    const std::size_t nPixels = tile.width() * tile.height();
+    std::vector<float> mask(nPixels, 0.f);
+    std::vector<float> coverage(nPixels);
+
+    for (std::vector<RotoShapeRenderCPUSample>::const_iterator it = args.samples.begin(); it != args.samples.end(); ++it) {
+        const RotoBezierTriangulation::PolygonData& data = *it->data;
+
+        RotoShapeRenderCPU::renderPolygonCoverage_cpu(data.bezierPolygonJoined, data.bezierPolygonJoinedContourSize, tile, &coverage[0]);
+        RotoShapeRenderCPU::renderFeatherRamp_cpu(data.featherMesh, args.rampType, it->fallOff, tile, &coverage[0]);
+
+        // Motion blur samples are composited with the OVER operator, as with cairo
+        for (std::size_t i = 0; i < nPixels; ++i) {
+            mask[i] = mask[i] + coverage[i] - mask[i] * coverage[i];
+        }
+    }
+
+    writeMaskToImage(args.output, tile, &mask[0]);
+}
+
+template <typename PIX, int maxValue, int srcNComps>
+static void
+readMaskFromImageForComponents(const RotoShapeRenderCPUOutput& args,
+                               const RectI& tile,
+                               float* mask)
+{
+    // Inverse of writeMaskToImageForComponents without opacity: strokes write the mask in the alpha channel
+    // and the mask multiplied by the color in the other channels
+    int colorIndex = -1;
+    for (int c = 0; c < std::min(srcNComps, 3); ++c) {
+        if (args.shapeColor[c] != 0) {
+            colorIndex = c;
+            break;
+        }
+    }
+    const int width = tile.width();
+
+    for (int y = tile.y1; y < tile.y2; ++y, mask += width) {
+        const PIX* srcPix = (const PIX*)Image::pixelAtStatic(tile.x1, y, args.bounds, srcNComps, sizeof(PIX), args.dstPixels);
+        assert(srcPix);
+        for (int x = 0; x < width; ++x, srcPix += srcNComps) {
+            switch (srcNComps) {
+            case 1:
+                mask[x] = (float)srcPix[0] / maxValue;
+                break;
+            case 4:
+                mask[x] = (float)srcPix[3] / maxValue;
+                break;
+            default:
+                mask[x] = colorIndex == -1 ? 0.f : (float)( srcPix[colorIndex] / (maxValue * args.shapeColor[colorIndex]) );
+                break;
+            }
+        }
+    }
+}
+
+template <typename PIX, int maxValue>
+static void
+readMaskFromImageForDepth(const RotoShapeRenderCPUOutput& args,
+                          const RectI& tile,
+                          float* mask)
+{
+    switch (args.nComps) {
+    case 1:
+        readMaskFromImageForComponents<PIX, maxValue, 1>(args, tile, mask);
+        break;
+    case 2:
+        readMaskFromImageForComponents<PIX, maxValue, 2>(args, tile, mask);
+        break;
+    case 3:
+        readMaskFromImageForComponents<PIX, maxValue, 3>(args, tile, mask);
+        break;
+    case 4:
+        readMaskFromImageForComponents<PIX, maxValue, 4>(args, tile, mask);
+        break;
+    default:
+        break;
+    }
+}
+
+static void
+readMaskFromImage(const RotoShapeRenderCPUOutput& args,
+                  const RectI& tile,
+                  float* mask)
+{
+    switch (args.depth) {
+    case eImageBitDepthFloat:
+        readMaskFromImageForDepth<float, 1>(args, tile, mask);
+        break;
+    case eImageBitDepthByte:
+        readMaskFromImageForDepth<unsigned char, 255>(args, tile, mask);
+        break;
+    case eImageBitDepthShort:
+        readMaskFromImageForDepth<unsigned short, 65535>(args, tile, mask);
+        break;
+    case eImageBitDepthHalf:
+        readMaskFromImageForDepth<Half, 1>(args, tile, mask);
+        break;
+    case eImageBitDepthNone:
+        assert(false);
+        break;
+    }
+}
+
+struct RotoShapeRenderCPUDot
+{
+    Point center;
+    double pressure;
+    double externalRadius;
+};
+
+struct RotoShapeRenderCPUStrokeArgs
+{
+    // Brush parameters, as given by renderStroke_generic
+    double brushSizePixel;
+    double brushSpacing;
+    double brushHardness;
+    bool pressureAffectsOpacity;
+    bool pressureAffectsHardness;
+    bool pressureAffectsSize;
+    bool buildUp;
+    double opacity;
+
+    // All dots of the strokes, in rendering order
+    std::vector<RotoShapeRenderCPUDot> dots;
+    bool isDuringPainting;
+    RotoShapeRenderCPUOutput output;
+};
+
+struct RotoShapeRenderCPUStrokeTile
+{
+    RectI rect;
+
+    // Indices of the dots overlapping the tile, in rendering order
+    std::vector<std::size_t> dots;
+};
+
+static void
+renderStrokeBegin_cpu(RotoShapeRenderNodePrivate::RenderStrokeDataPtr userData,
+                      double brushSizePixel,
+                      double brushSpacing,
+                      double brushHardness,
+                      bool pressureAffectsOpacity,
+                      bool pressureAffectsHardness,
+                      bool pressureAffectsSize,
+                      bool buildUp,
+                      double shapeColor[3],
+                      double opacity)
+{
+    RotoShapeRenderCPUStrokeArgs* myData = (RotoShapeRenderCPUStrokeArgs*)userData;
+
+    myData->brushSizePixel = brushSizePixel;
+    myData->brushSpacing = brushSpacing;
+    myData->brushHardness = brushHardness;
+    myData->pressureAffectsOpacity = pressureAffectsOpacity;
+    myData->pressureAffectsHardness = pressureAffectsHardness;
+    myData->pressureAffectsSize = pressureAffectsSize;
+    myData->buildUp = buildUp;
+    myData->opacity = opacity;
+    for (int c = 0; c < 3; ++c) {
+        myData->output.shapeColor[c] = shapeColor[c];
+    }
+}
+
+static void
+renderStrokeEnd_cpu(RotoShapeRenderNodePrivate::RenderStrokeDataPtr /*userData*/)
+{
+}
+
+static bool
+renderStrokeRenderDot_cpu(RotoShapeRenderNodePrivate::RenderStrokeDataPtr userData,
+                          const Point &/*prevCenter*/,
+                          const Point &center,
+                          double pressure,
+                          double* spacing)
+{
+    // Only record the dot: dots are composited later on, tile by tile
+    RotoShapeRenderCPUStrokeArgs* myData = (RotoShapeRenderCPUStrokeArgs*)userData;
+    double internalDotRadius;
+    RotoShapeRenderCPUDot dot;
+
+    RotoShapeRenderNodePrivate::getRenderDotParams(myData->opacity, myData->brushSizePixel, myData->brushHardness, myData->brushSpacing, pressure, myData->pressureAffectsOpacity, myData->pressureAffectsSize, myData->pressureAffectsHardness, &internalDotRadius, &dot.externalRadius, spacing, 0);
+    dot.center = center;
+    dot.pressure = pressure;
+    myData->dots.push_back(dot);
+
+    return true;
+}
+
+/**
+ * @brief Evaluates the radial gradient of a dot with the given stops, as cairo does with the EXTEND_PAD mode
+ **/
+static inline double
+evaluateDotOpacityStops(const std::vector<std::pair<double, double> >& opacityStops,
+                        double t)
+{
+    assert( !opacityStops.empty() );
+    if ( t <= opacityStops.front().first ) {
+        return opacityStops.front().second;
+    }
+    for (std::size_t i = 1; i < opacityStops.size(); ++i) {
+        if (t <= opacityStops[i].first) {
+            const std::pair<double, double>& prev = opacityStops[i - 1];
+            const std::pair<double, double>& next = opacityStops[i];
+            double range = next.first - prev.first;
+            if (range <= 0.) {
+                return next.second;
+            }
+
+            return prev.second + (next.second - prev.second) * (t - prev.first) / range;
+        }
+    }
+
+    return opacityStops.back().second;
+}
+
+static void
+renderDotInTile(const RotoShapeRenderCPUStrokeArgs& args,
+                const RotoShapeRenderCPUDot& dot,
+                const RectI& tile,
+                std::vector<std::pair<double, double> >* opacityStops,
+                float* mask)
+{
+    double internalDotRadius, externalDotRadius, spacing;
+
+    RotoShapeRenderNodePrivate::getRenderDotParams(args.opacity, args.brushSizePixel, args.brushHardness, args.brushSpacing, dot.pressure, args.pressureAffectsOpacity, args.pressureAffectsSize, args.pressureAffectsHardness, &internalDotRadius, &externalDotRadius, &spacing, opacityStops);
+    RotoShapeRenderCPU::renderDot_cpu(dot.center, internalDotRadius, externalDotRadius, *opacityStops, args.opacity, args.buildUp, tile, mask);
+}
+
+static void
+renderStrokeTile(const RotoShapeRenderCPUStrokeArgs& args,
+                 const RotoShapeRenderCPUStrokeTile& tile)
+{
+    std::vector<float> mask(tile.rect.width() * tile.rect.height(), 0.f);
+
+    if (args.isDuringPainting) {
+        readMaskFromImage(args.output, tile.rect, &mask[0]);
+    }
+
+    std::vector<std::pair<double, double> > opacityStops;
+    for (std::vector<std::size_t>::const_iterator it = tile.dots.begin(); it != tile.dots.end(); ++it) {
+        renderDotInTile(args, args.dots[*it], tile.rect, &opacityStops, &mask[0]);
+    }
+
+    writeMaskToImage(args.output, tile.rect, &mask[0]);
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT;
+
+void
+RotoShapeRenderCPU::renderDot_cpu(const Point& center,
+                                  double internalDotRadius,
+                                  double externalDotRadius,
+                                  const std::vector<std::pair<double, double> >& opacityStops,
+                                  double opacity,
+                                  bool buildUp,
+                                  const RectI& tile,
+                                  float* mask)
+{
+    const int xStart = std::max( tile.x1, (int)std::floor(center.x - externalDotRadius) );
+    const int xEnd = std::min( tile.x2, (int)std::ceil(center.x + externalDotRadius) + 1 );
+    const int yStart = std::max( tile.y1, (int)std::floor(center.y - externalDotRadius) );
+    const int yEnd = std::min( tile.y2, (int)std::ceil(center.y + externalDotRadius) + 1 );
+    const double sqExternalRadius = externalDotRadius * externalDotRadius;
+    const double rampLength = externalDotRadius - internalDotRadius;
+    const int width = tile.width();
+
+    for (int y = yStart; y < yEnd; ++y) {
+        const double dy = y + 0.5 - center.y;
+        float* row = mask + (y - tile.y1) * width - tile.x1;
+        for (int x = xStart; x < xEnd; ++x) {
+            const double dx = x + 0.5 - center.x;
+            const double sqDist = dx * dx + dy * dy;
+            if (sqDist >= sqExternalRadius) {
+                continue;
+            }
+            double value;
+            if ( opacityStops.empty() ) {
+                value = opacity;
+            } else {
+                double t = rampLength > 0. ? (std::sqrt(sqDist) - internalDotRadius) / rampLength : 0.;
+                value = evaluateDotOpacityStops(opacityStops, t);
+            }
+            if (buildUp) {
+                // OVER
+                row[x] = (float)( value + row[x] * (1. - value) );
+            } else {
+                // LIGHTEN
+                row[x] = std::max( row[x], (float)value );
+            }
+        }
+    }
+} // RotoShapeRenderCPU::renderDot_cpu
+
+void
+RotoShapeRenderCPU::binDotsByTile_cpu(const std::vector<std::pair<Point, double> >& dots,
+                                      const RectI& renderWindow,
+                                      std::vector<RectI>* tiles,
+                                      std::vector<std::vector<std::size_t> >* tileDots)
+{
+    tiles->clear();
+    for (int y = renderWindow.y1; y < renderWindow.y2; y += NATRON_ROTO_CPU_RENDER_TILE_SIZE) {
+        tiles->push_back( RectI( renderWindow.x1, y, renderWindow.x2, std::min(y + NATRON_ROTO_CPU_RENDER_TILE_SIZE, renderWindow.y2) ) );
+    }
+    tileDots->clear();
+    tileDots->resize( tiles->size() );
+
+    // Since dots are visited in order, each tile keeps the rendering order of the stroke
+    for (std::size_t i = 0; i < dots.size(); ++i) {
+        const Point& center = dots[i].first;
+        const double radius = dots[i].second;
+        if ( (center.x + radius < renderWindow.x1) || (center.x - radius > renderWindow.x2) ) {
+            continue;
+        }
+        int y1 = std::max( renderWindow.y1, (int)std::floor(center.y - radius) );
+        int y2 = std::min( renderWindow.y2 - 1, (int)std::ceil(center.y + radius) );
+        if (y1 > y2) {
+            continue;
+        }
+        int firstTile = (y1 - renderWindow.y1) / NATRON_ROTO_CPU_RENDER_TILE_SIZE;
+        int lastTile = (y2 - renderWindow.y1) / NATRON_ROTO_CPU_RENDER_TILE_SIZE;
+        for (int t = firstTile; t <= lastTile; ++t) {
+            (*tileDots)[t].push_back(i);
+        }
+    }
+} // RotoShapeRenderCPU::binDotsByTile_cpu
+
+void
+RotoShapeRenderCPU::renderPolygonCoverage_cpu(const std::vector<ParametricPoint>& polygon,
+                                              std::size_t nbVertices,
+                                              const RectI& tile,
+                                              float* coverage)
+{
+    const int width = tile.width();
+    const int height = tile.height();
+
+    assert( nbVertices <= polygon.size() );
+    if ( (width <= 0) || (height <= 0) ) {
+        return;
+    }
+
+    // One extra column is needed on the right by the accumulation
+    const int accStride = width + 2;
+    std::vector<float> acc(accStride * height, 0.f);
+
+    for (std::size_t i = 0; i < nbVertices; ++i) {
+        const ParametricPoint& p0 = polygon[i];
+        const ParametricPoint& p1 = polygon[(i + 1) % nbVertices];
+        accumulateLine(p0.x - tile.x1, p0.y - tile.y1, p1.x - tile.x1, p1.y - tile.y1, width, height, accStride, &acc[0]);
+    }
+
+    for (int y = 0; y < height; ++y) {
+        const float* accRow = &acc[y * accStride];
+        float* dstRow = coverage + y * width;
+        float sum = 0.f;
+        for (int x = 0; x < width; ++x) {
+            sum += accRow[x];
+            // Non-zero winding: any winding number, positive or negative, fills the pixel
+            dstRow[x] = std::min(1.f, std::abs(sum));
+        }
+    }
+} // RotoShapeRenderCPU::renderPolygonCoverage_cpu
+
+void
+RotoShapeRenderCPU::renderFeatherRamp_cpu(const std::vector<RotoBezierTriangulation::RotoFeatherVertex>& featherMesh,
+                                          RampTypeEnum type,
+                                          double fallOff,
+                                          const RectI& tile,
+                                          float* ramp)
+{
+    assert(featherMesh.size() % 3 == 0);
+    const int width = tile.width();
+    const FeatherFallOff featherFallOff(fallOff);
+
+    for (std::size_t i = 0; i + 2 < featherMesh.size(); i += 3) {
+        const RotoBezierTriangulation::RotoFeatherVertex& a = featherMesh[i];
+        const RotoBezierTriangulation::RotoFeatherVertex& b = featherMesh[i + 1];
+        const RotoBezierTriangulation::RotoFeatherVertex& c = featherMesh[i + 2];
+
+        const double area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        if (std::abs(area) < 1e-10) {
+            continue;
+        }
+
+        // Pixels whose center is in the triangle
+        const int xMin = std::max( tile.x1, (int)std::ceil(std::min( a.x, std::min(b.x, c.x) ) - 0.5) );
+        const int xMax = std::min( tile.x2 - 1, (int)std::floor(std::max( a.x, std::max(b.x, c.x) ) - 0.5) );
+        const int yMin = std::max( tile.y1, (int)std::ceil(std::min( a.y, std::min(b.y, c.y) ) - 0.5) );
+        const int yMax = std::min( tile.y2 - 1, (int)std::floor(std::max( a.y, std::max(b.y, c.y) ) - 0.5) );
+        if ( (xMin > xMax) || (yMin > yMax) ) {
+            continue;
+        }
+
+        const double va = a.isInner ? 1. : 0.;
+        const double vb = b.isInner ? 1. : 0.;
+        const double vc = c.isInner ? 1. : 0.;
+        const double invArea = 1. / area;
+
+        for (int y = yMin; y <= yMax; ++y) {
+            const double py = y + 0.5;
+            float* dstRow = ramp + (y - tile.y1) * width - tile.x1;
+            for (int x = xMin; x <= xMax; ++x) {
+                const double px = x + 0.5;
+                // Barycentric coordinates
+                const double wa = ( (b.x - px) * (c.y - py) - (b.y - py) * (c.x - px) ) * invArea;
+                const double wb = ( (c.x - px) * (a.y - py) - (c.y - py) * (a.x - px) ) * invArea;
+                const double wc = 1. - wa - wb;
+                if ( (wa < -1e-9) || (wb < -1e-9) || (wc < -1e-9) ) {
+                    continue;
+                }
+                const double t = std::max( 0., std::min(1., wa * va + wb * vb + wc * vc) );
+                const float v = (float)applyFeatherRamp(type, t, featherFallOff);
+                if (v > dstRow[x]) {
+                    dstRow[x] = v;
+                }
+            }
+        }
+    }
+} // RotoShapeRenderCPU::renderFeatherRamp_cpu
+
+void
+RotoShapeRenderCPU::renderBezier_cpu(const Bezier* bezier,
+                                     const RectI& roi,
+                                     double opacity,
+                                     double time,
+                                     double startTime,
+                                     double endTime,
+                                     double mbFrameStep,
+                                     unsigned int mipmapLevel,
+                                     const ImagePtr& dstImage)
+{
+    // Read all parameters on the calling thread: the tiles are rendered in threads without any TLS
+    RotoShapeRenderCPUArgs args;
+    args.rampType = (RampTypeEnum)bezier->getFallOffRampTypeKnob()->getValue();
+    bezier->getColor(time, args.output.shapeColor);
+    args.output.opacity = opacity;
+    args.output.depth = dstImage->getBitDepth();
+    args.output.nComps = (int)dstImage->getComponentsCount();
+    args.output.bounds = dstImage->getBounds();
+
+    for (double t = startTime; t <= endTime; t += mbFrameStep) {
+        double featherDist = bezier->getFeatherDistance(t);
+
+        ///Adjust the feather distance so it takes the mipmap level into account
+        if (mipmapLevel != 0) {
+            featherDist /= (1 << mipmapLevel);
+        }
+
+        RotoShapeRenderCPUSample sample;
+        sample.fallOff = bezier->getFeatherFallOff(t);
+        sample.data = RotoBezierTriangulation::getOrComputeTriangles(bezier, t, mipmapLevel, featherDist);
+        args.samples.push_back(sample);
+    }
+
+    RectI renderWindow;
+    if ( !roi.intersect(args.output.bounds, &renderWindow) ) {
+        return;
+    }
+
+    Image::WriteAccess acc = dstImage->getWriteRights();
+    args.output.dstPixels = acc.pixelAt(args.output.bounds.x1, args.output.bounds.y1);
+    assert(args.output.dstPixels);
+
+    std::vector<RectI> tiles;
+    for (int y = renderWindow.y1; y < renderWindow.y2; y += NATRON_ROTO_CPU_RENDER_TILE_SIZE) {
+        tiles.push_back( RectI( renderWindow.x1, y, renderWindow.x2, std::min(y + NATRON_ROTO_CPU_RENDER_TILE_SIZE, renderWindow.y2) ) );
+    }
+
+    if ( (tiles.size() > 1) && (renderWindow.area() >= NATRON_ROTO_CPU_RENDER_MIN_PARALLEL_AREA) ) {
+        // The write lock is held by this thread for the whole render, tiles write to disjoint rows
+        QtConcurrent::blockingMap( tiles, boost::bind(&renderBezierTile, boost::cref(args), _1) );
+    } else {
+        for (std::size_t i = 0; i < tiles.size(); ++i) {
+            renderBezierTile(args, tiles[i]);
+        }
+    }
+} // RotoShapeRenderCPU::renderBezier_cpu
+
+bool
+RotoShapeRenderCPU::renderStroke_cpu(const RotoDrawableItem* stroke,
+                                     const RectI& roi,
+                                     const std::list<std::list<std::pair<Point, double> > >& strokes,
+                                     double distToNextIn,
+                                     const Point& lastCenterPointIn,
+                                     bool doBuildUp,
+                                     double opacity,
+                                     double time,
+                                     unsigned int mipmapLevel,
+                                     bool isDuringPainting,
+                                     const ImagePtr& dstImage,
+                                     double* distToNextOut,
+                                     Point* lastCenterPointOut)
+{
+    RotoShapeRenderCPUStrokeArgs args;
+    args.brushSizePixel = args.brushSpacing = args.brushHardness = 0.;
+    args.pressureAffectsOpacity = args.pressureAffectsHardness = args.pressureAffectsSize = false;
+    args.buildUp = doBuildUp;
+    args.opacity = opacity;
+    args.isDuringPainting = isDuringPainting;
+    stroke->getColor(time, args.output.shapeColor);
+    // The opacity is already applied on each dot
+    args.output.opacity = 1.;
+    args.output.depth = dstImage->getBitDepth();
+    args.output.nComps = (int)dstImage->getComponentsCount();
+    args.output.bounds = dstImage->getBounds();
+
+    // Evaluate the dots positions on the calling thread, this reads knobs and follows the whole stroke anyway
+    bool hasRenderedDot = RotoShapeRenderNodePrivate::renderStroke_generic( (RotoShapeRenderNodePrivate::RenderStrokeDataPtr)&args,
+                                                                           renderStrokeBegin_cpu,
+                                                                           renderStrokeRenderDot_cpu,
+                                                                           renderStrokeEnd_cpu,
+                                                                           strokes,
+                                                                           distToNextIn,
+                                                                           lastCenterPointIn,
+                                                                           stroke,
+                                                                           doBuildUp,
+                                                                           opacity,
+                                                                           time,
+                                                                           mipmapLevel,
+                                                                           distToNextOut,
+                                                                           lastCenterPointOut );
+    RectI renderWindow;
+    if ( !roi.intersect(args.output.bounds, &renderWindow) ) {
+        return hasRenderedDot;
+    }
+
+    Image::WriteAccess acc = dstImage->getWriteRights();
+    args.output.dstPixels = acc.pixelAt(args.output.bounds.x1, args.output.bounds.y1);
+    assert(args.output.dstPixels);
+
+    std::vector<std::pair<Point, double> > dots( args.dots.size() );
+    for (std::size_t i = 0; i < args.dots.size(); ++i) {
+        dots[i] = std::make_pair(args.dots[i].center, args.dots[i].externalRadius);
+    }
+    std::vector<RectI> tileRects;
+    std::vector<std::vector<std::size_t> > tileDots;
+    binDotsByTile_cpu(dots, renderWindow, &tileRects, &tileDots);
+
+    std::vector<RotoShapeRenderCPUStrokeTile> tiles( tileRects.size() );
+    for (std::size_t i = 0; i < tiles.size(); ++i) {
+        tiles[i].rect = tileRects[i];
+        tiles[i].dots.swap(tileDots[i]);
+    }
+
+    if ( (tiles.size() > 1) && (renderWindow.area() >= NATRON_ROTO_CPU_RENDER_MIN_PARALLEL_AREA) ) {
+        // The write lock is held by this thread for the whole render, tiles read and write disjoint rows
+        QtConcurrent::blockingMap( tiles, boost::bind(&renderStrokeTile, boost::cref(args), _1) );
+    } else {
+        for (std::size_t i = 0; i < tiles.size(); ++i) {
+            renderStrokeTile(args, tiles[i]);
+        }
+    }
+
+    return hasRenderedDot;
+} // RotoShapeRenderCPU::renderStroke_cpu
+
+NATRON_NAMESPACE_EXIT;
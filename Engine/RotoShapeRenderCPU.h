@@ -0,0 +1,147 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef ROTOSHAPERENDERCPU_H
+#define ROTOSHAPERENDERCPU_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <list>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+#include "Engine/RectI.h"
+#include "Engine/RotoBezierTriangulation.h"
+#include "Engine/RotoShapeRenderGL.h"
+
+// Number of rows of the RoI rendered by each task of the CPU rasterizer
+#define NATRON_ROTO_CPU_RENDER_TILE_SIZE 64
+
+// Below this number of pixels the RoI is rendered on the calling thread only
+#define NATRON_ROTO_CPU_RENDER_MIN_PARALLEL_AREA (256 * 256)
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief Native scanline rasterizer used to render closed beziers on CPU.
+ * Unlike the cairo implementation it writes directly into the Natron image, without going through an intermediate
+ * 8-bit surface, and the RoI is split in tiles of rows which are rendered in parallel.
+ * The internal shape is rendered with analytic anti-aliasing (non-zero winding rule) and the feather
+ * ramp is evaluated analytically with the ramp types of the OpenGL implementation and the fall-off of cairo.
+ * Strokes are rendered by binning their dots by tile: each tile composites the dots overlapping it
+ * in the order of the stroke, so that tiles are independent and can be rendered in parallel.
+ **/
+class RotoShapeRenderCPU
+{
+public:
+
+    RotoShapeRenderCPU()
+    {
+    }
+
+    /**
+     * @brief Low level: computes the anti-aliased coverage of the polygon formed by the nbVertices first vertices of the given
+     * vector, using the non-zero winding rule. Coordinates are in pixels.
+     * @param coverage A buffer of tile.width() * tile.height() values where the coverage of each pixel of the tile is written.
+     **/
+    static void renderPolygonCoverage_cpu(const std::vector<ParametricPoint>& polygon,
+                                          std::size_t nbVertices,
+                                          const RectI& tile,
+                                          float* coverage);
+
+    /**
+     * @brief Low level: evaluates the feather ramp of the given feather mesh (as computed by RotoBezierTriangulation)
+     * at the center of each pixel of the tile. The value of each pixel is the maximum of its current value and of the ramp.
+     * The fall-off bends the ramp as renderFeather_cairo does with the control points of its patches.
+     * @param ramp A buffer of tile.width() * tile.height() values.
+     **/
+    static void renderFeatherRamp_cpu(const std::vector<RotoBezierTriangulation::RotoFeatherVertex>& featherMesh,
+                                      RampTypeEnum type,
+                                      double fallOff,
+                                      const RectI& tile,
+                                      float* ramp);
+
+    /**
+     * @brief Low level: composites a dot into the mask of the tile, OVER if buildUp is true, LIGHTEN otherwise.
+     * The opacity of the dot follows the radial opacityStops between internalDotRadius and externalDotRadius,
+     * as computed by RotoShapeRenderNodePrivate::getRenderDotParams, or is the given opacity if there is none.
+     * Dots are not anti-aliased: a pixel belongs to the dot if its center is inside the circle. Coordinates are in pixels.
+     * @param mask A buffer of tile.width() * tile.height() values.
+     **/
+    static void renderDot_cpu(const Point& center,
+                              double internalDotRadius,
+                              double externalDotRadius,
+                              const std::vector<std::pair<double, double> >& opacityStops,
+                              double opacity,
+                              bool buildUp,
+                              const RectI& tile,
+                              float* mask);
+
+    /**
+     * @brief Low level: splits the render window in tiles of NATRON_ROTO_CPU_RENDER_TILE_SIZE rows and bins the given dots
+     * (center and external radius, in pixels) by tile: each tile gets the indices of the dots overlapping it, in the
+     * order of the stroke, so that tiles can be composited independently.
+     **/
+    static void binDotsByTile_cpu(const std::vector<std::pair<Point, double> >& dots,
+                                  const RectI& renderWindow,
+                                  std::vector<RectI>* tiles,
+                                  std::vector<std::vector<std::size_t> >* tileDots);
+
+    /**
+     * @brief High level: renders the given closed bezier with motion blur into the RoI of the supplied image.
+     **/
+    static void renderBezier_cpu(const Bezier* bezier,
+                                 const RectI& roi,
+                                 double opacity,
+                                 double time,
+                                 double startTime,
+                                 double endTime,
+                                 double mbFrameStep,
+                                 unsigned int mipmapLevel,
+                                 const ImagePtr& dstImage);
+
+    /**
+     * @brief High level: renders the dots of the given strokes into the RoI of the supplied image, with the same
+     * compositing as renderStroke_cairo (OVER for build-up, LIGHTEN otherwise).
+     * When isDuringPainting is true, the dots are composited onto the current content of dstImage.
+     * @returns True if at least one dot was rendered
+     **/
+    static bool renderStroke_cpu(const RotoDrawableItem* stroke,
+                                 const RectI& roi,
+                                 const std::list<std::list<std::pair<Point, double> > >& strokes,
+                                 double distToNextIn,
+                                 const Point& lastCenterPointIn,
+                                 bool doBuildUp,
+                                 double opacity,
+                                 double time,
+                                 unsigned int mipmapLevel,
+                                 bool isDuringPainting,
+                                 const ImagePtr& dstImage,
+                                 double* distToNextOut,
+                                 Point* lastCenterPointOut);
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // ROTOSHAPERENDERCPU_H
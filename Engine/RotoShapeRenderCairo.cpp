@@ -45,6 +45,10 @@
 //This will enable correct evaluation of beziers
 //#define ROTO_USE_MESH_PATTERN_ONLY
 
+// Render beziers from the triangles of RotoBezierTriangulation, which are shared with the other renderers
+// through the tessellation cache of the bezier, instead of discretizing them again
+#define ROTO_CAIRO_RENDER_TRIANGLES_ONLY
+
 
 NATRON_NAMESPACE_ENTER;
 
@@ -658,71 +662,6 @@ RotoShapeRenderCairo::bezulate(double time,
 
 
 
-static inline
-double
-hardnessGaussLookup(double f)
-{
-    //2 hyperbolas + 1 parabola to approximate a gauss function
-    if (f < -0.5) {
-        f = -1. - f;
-
-        return (2. * f * f);
-    }
-
-    if (f < 0.5) {
-        return (1. - 2. * f * f);
-    }
-    f = 1. - f;
-
-    return (2. * f * f);
-}
-
-
-static void
-getRenderDotParams(double alpha,
-                   double brushSizePixel,
-                   double brushHardness,
-                   double brushSpacing,
-                   double pressure,
-                   bool pressureAffectsOpacity,
-                   bool pressureAffectsSize,
-                   bool pressureAffectsHardness,
-                   double* internalDotRadius,
-                   double* externalDotRadius,
-                   double * spacing,
-                   std::vector<std::pair<double, double> >* opacityStops)
-{
-    if (pressureAffectsSize) {
-        brushSizePixel *= pressure;
-    }
-    if (pressureAffectsHardness) {
-        brushHardness *= pressure;
-    }
-    if (pressureAffectsOpacity) {
-        alpha *= pressure;
-    }
-
-    *internalDotRadius = std::max(brushSizePixel * brushHardness, 1.) / 2.;
-    *externalDotRadius = std::max(brushSizePixel, 1.) / 2.;
-    *spacing = *externalDotRadius * 2. * brushSpacing;
-
-    if (opacityStops) {
-        opacityStops->clear();
-
-        double exp = brushHardness != 1.0 ?  0.4 / (1.0 - brushHardness) : 0.;
-        const int maxStops = 8;
-        double incr = 1. / maxStops;
-
-        if (brushHardness != 1.) {
-            for (double d = 0; d <= 1.; d += incr) {
-                double o = hardnessGaussLookup( std::pow(d, exp) );
-                opacityStops->push_back( std::make_pair(d, o * alpha) );
-            }
-        }
-    }
-}
-
-
 bool
 RotoShapeRenderCairo::allocateAndRenderSingleDotStroke_cairo(int brushSizePixel,
                                                        double brushHardness,
@@ -757,7 +696,7 @@ RotoShapeRenderCairo::allocateAndRenderSingleDotStroke_cairo(int brushSizePixel,
     const double pressure = 1.;
     const double brushspacing = 0.;
 
-    getRenderDotParams(alpha, brushSizePixel, brushHardness, brushspacing, pressure, false, false, false, &internalDotRadius, &externalDotRadius, &spacing, &opacityStops);
+    RotoShapeRenderNodePrivate::getRenderDotParams(alpha, brushSizePixel, brushHardness, brushspacing, pressure, false, false, false, &internalDotRadius, &externalDotRadius, &spacing, &opacityStops);
     renderDot_cairo(wrapper.ctx, 0, p, internalDotRadius, externalDotRadius, pressure, true, opacityStops, alpha);
     
     return true;
@@ -891,7 +830,7 @@ renderStrokeRenderDot_cairo(RotoShapeRenderNodePrivate::RenderStrokeDataPtr user
     RenderStrokeCairoData* myData = (RenderStrokeCairoData*)userData;
     double internalDotRadius, externalDotRadius;
     std::vector<std::pair<double,double> > opacityStops;
-    getRenderDotParams(myData->opacity, myData->brushSizePixel, myData->brushHardness, myData->brushSpacing, pressure, myData->pressureAffectsOpacity, myData->pressureAffectsSize, myData->pressureAffectsHardness, &internalDotRadius, &externalDotRadius, spacing, &opacityStops);
+    RotoShapeRenderNodePrivate::getRenderDotParams(myData->opacity, myData->brushSizePixel, myData->brushHardness, myData->brushSpacing, pressure, myData->pressureAffectsOpacity, myData->pressureAffectsSize, myData->pressureAffectsHardness, &internalDotRadius, &externalDotRadius, spacing, &opacityStops);
     RotoShapeRenderCairo::renderDot_cairo(myData->cr, myData->dotPatterns, center, internalDotRadius, externalDotRadius, pressure, myData->buildUp, opacityStops, myData->opacity);
     return true;
 }
@@ -1055,7 +994,7 @@ renderSmearRenderDot_cairo(RotoShapeRenderNodePrivate::RenderStrokeDataPtr userD
 {
     RenderSmearCairoData* myData = (RenderSmearCairoData*)userData;
     double internalRadius, externalRadius;
-    getRenderDotParams(myData->opacity, myData->brushSizePixel, myData->brushHardness, myData->brushSpacing, pressure, myData->pressureAffectsOpacity, myData->pressureAffectsSize, myData->pressureAffectsHardness, &internalRadius, &externalRadius, spacing, 0);
+    RotoShapeRenderNodePrivate::getRenderDotParams(myData->opacity, myData->brushSizePixel, myData->brushHardness, myData->brushSpacing, pressure, myData->pressureAffectsOpacity, myData->pressureAffectsSize, myData->pressureAffectsHardness, &internalRadius, &externalRadius, spacing, 0);
     if (prevCenter.x == INT_MIN || prevCenter.y == INT_MIN) {
         return false;
     }
@@ -1147,8 +1086,8 @@ RotoShapeRenderCairo::renderBezier_cairo(cairo_t* cr,
 
 
 #ifdef ROTO_CAIRO_RENDER_TRIANGLES_ONLY
-        PolygonData data;
-        computeTriangles(bezier, t, mipmapLevel, featherDist, &data);
+        RotoBezierTriangulation::PolygonDataConstPtr dataPtr = RotoBezierTriangulation::getOrComputeTriangles(bezier, t, mipmapLevel, featherDist);
+        const RotoBezierTriangulation::PolygonData& data = *dataPtr;
         renderFeather_cairo(data, shapeColor, fallOff, mesh);
         renderInternalShape_cairo(data, shapeColor, mesh);
         Q_UNUSED(opacity);
@@ -670,8 +670,8 @@ RotoShapeRenderGL::renderBezier_gl(const OSGLContextPtr& glContext,
             featherDist /= (1 << mipmapLevel);
         }
 
-        RotoBezierTriangulation::PolygonData data;
-        RotoBezierTriangulation::computeTriangles(bezier, t, mipmapLevel, featherDist, &data);
+        RotoBezierTriangulation::PolygonDataConstPtr dataPtr = RotoBezierTriangulation::getOrComputeTriangles(bezier, t, mipmapLevel, featherDist);
+        const RotoBezierTriangulation::PolygonData& data = *dataPtr;
 
         if (glContext->isGPUContext()) {
             setupTexParams<GL_GPU>(target);
@@ -38,10 +38,15 @@
 #include "Engine/RotoStrokeItem.h"
 #include "Engine/RotoShapeRenderNodePrivate.h"
 #include "Engine/RotoShapeRenderCairo.h"
+#include "Engine/RotoShapeRenderCPU.h"
 #include "Engine/RotoShapeRenderGL.h"
 #include "Engine/ParallelRenderArgs.h"
 
 
+// Define to render on CPU with the cairo renderer instead of RotoShapeRenderCPU, e.g. to compare their output.
+// Smear is always rendered with cairo on CPU.
+//#define ROTO_SHAPE_RENDER_CPU_USE_CAIRO
+
 NATRON_NAMESPACE_ENTER;
 
 enum RotoShapeRenderTypeEnum
@@ -227,18 +232,6 @@ StatusEnum
 RotoShapeRenderNode::render(const RenderActionArgs& args)
 {
 
-#if !defined(ROTO_SHAPE_RENDER_ENABLE_CAIRO) && !defined(HAVE_OSMESA)
-    setPersistentMessage(eMessageTypeError, tr("Roto requires either OSMesa (CONFIG += enable-osmesa) or Cairo (CONFIG += enable-cairo) in order to render on CPU").toStdString());
-    return eStatusFailed;
-#endif
-
-#if !defined(ROTO_SHAPE_RENDER_ENABLE_CAIRO)
-    if (!args.useOpenGL) {
-        setPersistentMessage(eMessageTypeError, tr("An OpenGL context is required to draw with the Roto node. This might be because you are trying to render an image too big for OpenGL.").toStdString());
-        return eStatusFailed;
-    }
-#endif
-
     RotoDrawableItemPtr rotoItem = getNode()->getAttachedRotoItem();
     assert(rotoItem);
     if (!rotoItem) {
@@ -254,6 +247,14 @@ RotoShapeRenderNode::render(const RenderActionArgs& args)
         return eStatusFailed;
     }
 
+#if !defined(ROTO_SHAPE_RENDER_ENABLE_CAIRO)
+    // Solid shapes and strokes are rasterized on CPU by RotoShapeRenderCPU, but smear needs OpenGL or Cairo
+    if ( (type == eRotoShapeRenderTypeSmear) && !args.useOpenGL ) {
+        setPersistentMessage(eMessageTypeError, tr("An OpenGL context is required to draw smear strokes with the Roto node. This might be because you are trying to render an image too big for OpenGL.").toStdString());
+        return eStatusFailed;
+    }
+#endif
+
     // Check that the item is really activated... it should have been caught in isIdentity otherwise.
     assert(rotoItem->isActivated(args.time) && (!isBezier || (isBezier->isCurveFinished() && ( isBezier->getControlPointsCount() > 1 ))));
 
@@ -374,14 +375,26 @@ RotoShapeRenderNode::render(const RenderActionArgs& args)
             }
 #endif
 
-#ifdef ROTO_SHAPE_RENDER_ENABLE_CAIRO
             if (!args.useOpenGL) {
+#if defined(ROTO_SHAPE_RENDER_ENABLE_CAIRO) && defined(ROTO_SHAPE_RENDER_CPU_USE_CAIRO)
                 RotoShapeRenderCairo::renderMaskInternal_cairo(rotoItem, args.roi, outputPlane.first, startTime, endTime, mbFrameStep, args.time, outputPlane.second->getBitDepth(), mipmapLevel, isDuringPainting, distNextIn, lastCenterIn, strokes, outputPlane.second, &distToNextOut, &lastCenterOut);
                 if (isDuringPainting) {
                     getApp()->updateStrokeData(lastCenterOut, distToNextOut);
                 }
-            }
+#else
+                if ( isBezier && !isBezier->isOpenBezier() ) {
+                    // Closed beziers are rasterized natively, directly into the output image
+                    RotoShapeRenderCPU::renderBezier_cpu(isBezier, args.roi, rotoItem->getOpacity(args.time), args.time, startTime, endTime, mbFrameStep, mipmapLevel, outputPlane.second);
+                } else {
+                    // Strokes and open beziers: dots are binned by tile and composited in parallel
+                    bool doBuildUp = rotoItem->getBuildupKnob()->getValueAtTime(args.time);
+                    RotoShapeRenderCPU::renderStroke_cpu(rotoItem.get(), args.roi, strokes, distNextIn, lastCenterIn, doBuildUp, rotoItem->getOpacity(args.time), args.time, mipmapLevel, isDuringPainting, outputPlane.second, &distToNextOut, &lastCenterOut);
+                    if (isDuringPainting) {
+                        getApp()->updateStrokeData(lastCenterOut, distToNextOut);
+                    }
+                }
 #endif
+            }
             if (args.useOpenGL) {
                 double shapeColor[3];
                 rotoItem->getColor(args.time, shapeColor);
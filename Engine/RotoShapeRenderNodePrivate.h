@@ -26,6 +26,7 @@
 // ***** END PYTHON BLOCK *****
 #include <map>
 #include <list>
+#include <vector>
 #include "Engine/EngineFwd.h"
 #include "Global/GlobalDefines.h"
 #include "Engine/OSGLContext.h"
@@ -110,6 +111,29 @@ public:
     // If we were to copy exactly the portion in prevCenter, the smear would leave traces
     // too long. To dampen the effect of the smear, we clamp the spacing
     static Point dampenSmearEffect(const Point& prevCenter, const Point& center, const double spacing);
+
+    /**
+     * @brief Approximation of a gauss function used to compute the opacity of the dots of a stroke given its hardness
+     **/
+    static double hardnessGaussLookup(double f);
+
+    /**
+     * @brief Computes the radii and spacing of a dot of a stroke with the given brush parameters.
+     * If the brush is not fully hard, opacityStops is filled with the (distance, opacity) stops of the radial gradient
+     * going from the internal radius to the external radius.
+     **/
+    static void getRenderDotParams(double alpha,
+                                   double brushSizePixel,
+                                   double brushHardness,
+                                   double brushSpacing,
+                                   double pressure,
+                                   bool pressureAffectsOpacity,
+                                   bool pressureAffectsSize,
+                                   bool pressureAffectsHardness,
+                                   double* internalDotRadius,
+                                   double* externalDotRadius,
+                                   double * spacing,
+                                   std::vector<std::pair<double, double> >* opacityStops);
 };
 
 NATRON_NAMESPACE_EXIT;
@@ -333,6 +333,8 @@ Settings::initializeKnobsThreading()
     _numberOfParallelRenders->setHintToolTip( tr("Controls the number of parallel frame that will be rendered at the same time by the renderer."
                                                  "A value of 0 indicate that %1 should automatically determine "
                                                  "the best number of parallel renders to launch given your CPU activity. "
+                                                 "When rendering to disk, the number of parallel renders is then adjusted during the render to "
+                                                 "the one giving the most frames per second, and lowered if %1 uses too much memory. "
                                                  "Setting a value different than 0 should be done only if you know what you're doing and can lead "
                                                  "in some situations to worse performances. Overall to get the best performances you should have your "
                                                  "CPU at 100% activity without idle times.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
@@ -342,16 +344,28 @@ Settings::initializeKnobsThreading()
     _threadingPage->addKnob(_numberOfParallelRenders);
 #endif
 
+    _numberOfWriterThreads = AppManager::createKnob<KnobInt>( shared_from_this(), tr("Number of writer threads (0=write in render threads)") );
+    _numberOfWriterThreads->setHintToolTip( tr("When rendering to disk, the frames are rendered by the render threads and then queued to be encoded "
+                                               "and written by this many separate threads, so that slow file compression or storage do not "
+                                               "stall the rendering. Writers that need frames in order, such as video encoders, always use a single "
+                                               "writer thread that writes frames in order. The number of frames waiting in the queue is bounded "
+                                               "to limit the memory used. A value of 0 encodes and writes each frame in the render thread that "
+                                               "rendered it, which is the default.") );
+    _numberOfWriterThreads->setName("nWriterThreads");
+    _numberOfWriterThreads->setMinimum(0);
+    _numberOfWriterThreads->disableSlider();
+    _threadingPage->addKnob(_numberOfWriterThreads);
+
     _useThreadPool = AppManager::createKnob<KnobBool>( shared_from_this(), tr("Effects use thread-pool") );
     _useThreadPool->setName("useThreadPool");
-    _useThreadPool->setHintToolTip( tr("When checked, all effects will use a global thread-pool to do their processing instead of launching "
+    _useThreadPool->setHintToolTip( tr("When checked, all effects will use a pool of threads kept alive across renders to do their processing instead of launching "
                                        "their own threads. "
                                        "This suppresses the overhead created by the operating system creating new threads on demand for "
                                        "each rendering of a special effect. As a result of this, the rendering might be faster on systems "
                                        "with a lot of cores (>= 8). \n"
-                                       "WARNING: This is known not to work when using The Foundry's Furnace plug-ins (and potentially "
-                                       "some other plug-ins that the dev team hasn't not tested against it). When using these plug-ins, "
-                                       "make sure to uncheck this option first otherwise it will crash %1.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
+                                       "Plug-ins which do not work when their threads are re-used, such as The Foundry's Furnace plug-ins, "
+                                       "always launch their own threads. This can be changed for each plug-in with the \"Pool\" column "
+                                       "of the Plug-ins tab. If a plug-in crashes %1 when this option is checked, uncheck it for that plug-in.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
     _threadingPage->addKnob(_useThreadPool);
 
     _nThreadsPerEffect = AppManager::createKnob<KnobInt>( shared_from_this(), tr("Max threads usable per effect (0=\"guess\")") );
@@ -1330,6 +1344,64 @@ Settings::initializeKnobsCaching()
     _maxDiskCacheNodeGB->setHintToolTip( tr("The maximum size that may be used by the DiskCache node on disk (in GiB)") );
     _cachingTab->addKnob(_maxDiskCacheNodeGB);
 
+    _nodeCacheShards = AppManager::createKnob<KnobInt>( shared_from_this(), tr("Number of node cache shards") );
+    _nodeCacheShards->setName("nodeCacheShards");
+    _nodeCacheShards->disableSlider();
+    _nodeCacheShards->setMinimum(1);
+    _nodeCacheShards->setMaximum(NATRON_CACHE_MAX_SHARDS);
+    _nodeCacheShards->setHintToolTip( tr("WARNING: Changing this parameter requires a restart of the application. \n"
+                                         "The number of independent parts the node cache is split into. Each part has its own locks, "
+                                         "so that render threads looking-up different images do not wait for each other. "
+                                         "Increasing this value helps on computers with many cores, at the expense of a less "
+                                         "accurate least-recently-used eviction order. A value of 1 disables sharding.") );
+    _cachingTab->addKnob(_nodeCacheShards);
+
+    _cacheEvictionHighWatermark = AppManager::createKnob<KnobInt>( shared_from_this(), tr("Start cache eviction at (% of cache size)") );
+    _cacheEvictionHighWatermark->setName("cacheEvictionHighWatermark");
+    _cacheEvictionHighWatermark->disableSlider();
+    _cacheEvictionHighWatermark->setMinimum(10);
+    _cacheEvictionHighWatermark->setMaximum(100);
+    _cacheEvictionHighWatermark->setHintToolTip( tr("When a cache is filled beyond this percentage of its maximum size, least recently used "
+                                                    "entries start being evicted in the background, without slowing down rendering.") );
+    _cacheEvictionHighWatermark->setAddNewLine(false);
+    _cachingTab->addKnob(_cacheEvictionHighWatermark);
+
+    _cacheEvictionLowWatermark = AppManager::createKnob<KnobInt>( shared_from_this(), tr("Stop cache eviction at (% of cache size)") );
+    _cacheEvictionLowWatermark->setName("cacheEvictionLowWatermark");
+    _cacheEvictionLowWatermark->disableSlider();
+    _cacheEvictionLowWatermark->setMinimum(0);
+    _cacheEvictionLowWatermark->setMaximum(100);
+    _cacheEvictionLowWatermark->setHintToolTip( tr("Once background eviction started, least recently used entries are evicted until the cache "
+                                                   "is filled under this percentage of its maximum size. This value cannot be greater than "
+                                                   "the percentage at which eviction starts. A lower value frees more memory at once "
+                                                   "so that eviction happens less often.") );
+    _cachingTab->addKnob(_cacheEvictionLowWatermark);
+
+    _costAwareCacheEviction = AppManager::createKnob<KnobBool>( shared_from_this(), tr("Cost-aware node cache eviction") );
+    _costAwareCacheEviction->setName("costAwareCacheEviction");
+    _costAwareCacheEviction->setHintToolTip( tr("When checked, the node cache evicts first the images that were the cheapest to render "
+                                                "relative to their size, instead of the least recently used ones. Images produced by "
+                                                "expensive nodes stay longer in the cache, which avoids re-rendering them when scrubbing "
+                                                "back and forth in a heavy graph.") );
+    _cachingTab->addKnob(_costAwareCacheEviction);
+
+    _viewerSpeculativeRender = AppManager::createKnob<KnobBool>( shared_from_this(), tr("Render ahead when the viewer is idle") );
+    _viewerSpeculativeRender->setName("viewerSpeculativeRender");
+    _viewerSpeculativeRender->setHintToolTip( tr("When checked, once the viewer has displayed the current frame and nothing else is rendering, "
+                                                 "the frames around it are rendered in the background at a low priority and stored in the viewer cache, "
+                                                 "in the direction of the last playback first, so that starting playback does not need to render them. "
+                                                 "These renders are aborted as soon as the user interacts.") );
+    _viewerSpeculativeRender->setAddNewLine(false);
+    _cachingTab->addKnob(_viewerSpeculativeRender);
+
+    _viewerSpeculativeRenderFrames = AppManager::createKnob<KnobInt>( shared_from_this(), tr("Frames rendered ahead") );
+    _viewerSpeculativeRenderFrames->setName("viewerSpeculativeRenderFrames");
+    _viewerSpeculativeRenderFrames->disableSlider();
+    _viewerSpeculativeRenderFrames->setMinimum(1);
+    _viewerSpeculativeRenderFrames->setHintToolTip( tr("Maximum number of frames rendered ahead around the current frame when the viewer is idle. "
+                                                       "Rendering ahead also stops once the rendered frames fill half of the viewer cache.") );
+    _cachingTab->addKnob(_viewerSpeculativeRenderFrames);
+
 
     _diskCachePath = AppManager::createKnob<KnobPath>( shared_from_this(), tr("Disk cache path (empty = default)") );
     _diskCachePath->setName("diskCachePath");
@@ -1509,6 +1581,7 @@ Settings::setDefaultValues()
 #ifndef NATRON_PLAYBACK_USES_THREAD_POOL
     _numberOfParallelRenders->setDefaultValue(0, 0);
 #endif
+    _numberOfWriterThreads->setDefaultValue(0);
     _nOpenGLContexts->setDefaultValue(2);
     _enableOpenGL->setDefaultValue((int)eEnableOpenGLEnabled);
     _useThreadPool->setDefaultValue(true);
@@ -1551,6 +1624,12 @@ Settings::setDefaultValues()
     _unreachableRAMPercent->setDefaultValue(5);
     _maxViewerDiskCacheGB->setDefaultValue(5, 0);
     _maxDiskCacheNodeGB->setDefaultValue(10, 0);
+    _nodeCacheShards->setDefaultValue(1, 0);
+    _cacheEvictionHighWatermark->setDefaultValue(90, 0);
+    _cacheEvictionLowWatermark->setDefaultValue(80, 0);
+    _costAwareCacheEviction->setDefaultValue(false);
+    _viewerSpeculativeRender->setDefaultValue(false);
+    _viewerSpeculativeRenderFrames->setDefaultValue(50);
     setCachingLabels();
     _autoScroll->setDefaultValue(false);
     _autoTurbo->setDefaultValue(false);
@@ -1864,6 +1943,14 @@ Settings::restorePluginSettings()
                     settings.setValue( mtKey, plugin->isMultiThreadingEnabled() );
                 }
 
+                QString wpKey = pluginIDKey + QString::fromUtf8("_wp");
+                if ( settings.contains(wpKey) ) {
+                    bool workerPoolEnabled = settings.value(wpKey).toBool();
+                    plugin->setWorkerPoolEnabled(workerPoolEnabled);
+                } else {
+                    settings.setValue( wpKey, plugin->isWorkerPoolEnabled() );
+                }
+
                 QString glKey = pluginIDKey + QString::fromUtf8("_gl");
                 if (settings.contains(glKey)) {
                     bool openglEnabled = settings.value(glKey).toBool();
@@ -1900,6 +1987,9 @@ Settings::savePluginsSettings()
             QString mtKey = pluginID + QString::fromUtf8("_mt");
             settings.setValue(mtKey, plugin->isMultiThreadingEnabled());
 
+            QString wpKey = pluginID + QString::fromUtf8("_wp");
+            settings.setValue( wpKey, plugin->isWorkerPoolEnabled() );
+
             QString glKey = pluginID + QString::fromUtf8("_gl");
             settings.setValue(glKey, plugin->isOpenGLEnabled());
 
@@ -2242,6 +2332,14 @@ Settings::onKnobValueChanged(const KnobIPtr& k,
         if (!_restoringSettings) {
             appPTR->setApplicationsCachesMaximumDiskSpace( getMaximumDiskCacheNodeSize() );
         }
+    } else if ( ( k == _cacheEvictionHighWatermark ) || ( k == _cacheEvictionLowWatermark ) ) {
+        if (!_restoringSettings) {
+            appPTR->setApplicationsCachesEvictionWatermarks( getCacheEvictionHighWatermark(), getCacheEvictionLowWatermark() );
+        }
+    } else if ( k == _costAwareCacheEviction ) {
+        if (!_restoringSettings) {
+            appPTR->setNodeCacheCostAwareEviction( isCostAwareCacheEvictionEnabled() );
+        }
     } else if ( k == _maxRAMPercent ) {
         if (!_restoringSettings) {
             appPTR->setApplicationsCachesMaximumMemoryPercent( getRamMaximumPercent() );
@@ -2485,6 +2583,42 @@ Settings::getMaximumDiskCacheNodeSize() const
     return (U64)( _maxDiskCacheNodeGB->getValue() ) * std::pow(1024., 3.);
 }
 
+int
+Settings::getNodeCacheNumShards() const
+{
+    return _nodeCacheShards->getValue();
+}
+
+double
+Settings::getCacheEvictionHighWatermark() const
+{
+    return (double)_cacheEvictionHighWatermark->getValue() / 100.;
+}
+
+double
+Settings::getCacheEvictionLowWatermark() const
+{
+    return (double)_cacheEvictionLowWatermark->getValue() / 100.;
+}
+
+bool
+Settings::isCostAwareCacheEvictionEnabled() const
+{
+    return _costAwareCacheEviction->getValue();
+}
+
+bool
+Settings::isViewerSpeculativeRenderEnabled() const
+{
+    return _viewerSpeculativeRender->getValue();
+}
+
+int
+Settings::getViewerSpeculativeRenderMaxFrames() const
+{
+    return _viewerSpeculativeRenderFrames->getValue();
+}
+
 ///////////////////////////////////////////////////
 
 double
@@ -3006,6 +3140,12 @@ Settings::setNumberOfParallelRenders(int nb)
 #endif
 }
 
+int
+Settings::getNumberOfWriterThreads() const
+{
+    return _numberOfWriterThreads->getValue();
+}
+
 bool
 Settings::areRGBPixelComponentsSupported() const
 {
@@ -118,6 +118,18 @@ public:
 
     U64 getMaximumDiskCacheNodeSize() const;
 
+    int getNodeCacheNumShards() const;
+
+    double getCacheEvictionHighWatermark() const;
+
+    double getCacheEvictionLowWatermark() const;
+
+    bool isCostAwareCacheEvictionEnabled() const;
+
+    bool isViewerSpeculativeRenderEnabled() const;
+
+    int getViewerSpeculativeRenderMaxFrames() const;
+
     double getUnreachableRamPercent() const;
 
     bool getColorPickerLinear() const;
@@ -130,6 +142,8 @@ public:
 
     void setNumberOfParallelRenders(int nb);
 
+    int getNumberOfWriterThreads() const;
+
     int getNumberOfThreadsPerEffect() const;
 
     bool useGlobalThreadPool() const;
@@ -435,6 +449,7 @@ private:
     KnobPagePtr _threadingPage;
     KnobIntPtr _numberOfThreads;
     KnobIntPtr _numberOfParallelRenders;
+    KnobIntPtr _numberOfWriterThreads;
     KnobBoolPtr _useThreadPool;
     KnobIntPtr _nThreadsPerEffect;
     KnobBoolPtr _renderInSeparateProcess;
@@ -512,6 +527,12 @@ private:
     ///The total disk space allowed for all Natron's caches
     KnobIntPtr _maxViewerDiskCacheGB;
     KnobIntPtr _maxDiskCacheNodeGB;
+    KnobIntPtr _nodeCacheShards;
+    KnobIntPtr _cacheEvictionHighWatermark;
+    KnobIntPtr _cacheEvictionLowWatermark;
+    KnobBoolPtr _costAwareCacheEviction;
+    KnobBoolPtr _viewerSpeculativeRender;
+    KnobIntPtr _viewerSpeculativeRenderFrames;
     KnobPathPtr _diskCachePath;
     KnobButtonPtr _wipeDiskCache;
 
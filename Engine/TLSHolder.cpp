@@ -102,6 +102,16 @@ AppTLS::copyTLS(QThread* fromThread,
     }
 }
 
+void
+AppTLS::copyTLSFromSnapshot(QThread* snapshot,
+                            QThread* spawnerThread,
+                            QThread* toThread)
+{
+    copyTLS(snapshot, toThread);
+    // The snapshot is not an AbortableThread: the abort info is protected by a mutex and can be copied from the spawner
+    copyAbortInfo(spawnerThread, toThread);
+}
+
 void
 AppTLS::softCopy(QThread* fromThread,
                  QThread* toThread)
@@ -138,6 +148,18 @@ AppTLS::cleanupTLSForThread()
             return;
         }
     }
+    cleanupPerThreadData(curThread);
+} // AppTLS::cleanupTLSForThread
+
+void
+AppTLS::cleanupTLSSnapshot(const QThread* snapshot)
+{
+    cleanupPerThreadData(snapshot);
+}
+
+void
+AppTLS::cleanupPerThreadData(const QThread* thread)
+{
     std::list<boost::shared_ptr<const TLSHolderBase> > objectsToClean;
     {
         QReadLocker k (&_objectMutex);
@@ -147,7 +169,7 @@ AppTLS::cleanupTLSForThread()
              ++it) {
             boost::shared_ptr<const TLSHolderBase> p = (*it).lock();
             if (p) {
-                if ( p->canCleanupPerThreadData(curThread) ) {
+                if ( p->canCleanupPerThreadData(thread) ) {
                     objectsToClean.push_back(p);
                 }
             }
@@ -161,7 +183,7 @@ AppTLS::cleanupTLSForThread()
         for (std::list<boost::shared_ptr<const TLSHolderBase> >::iterator it = objectsToClean.begin();
              it != objectsToClean.end();
              ++it) {
-            if ( (*it)->cleanupPerThreadData(curThread) ) {
+            if ( (*it)->cleanupPerThreadData(thread) ) {
                 TLSObjects::iterator found = _object->objects.find(*it);
                 if ( found != _object->objects.end() ) {
                     _object->objects.erase(found);
@@ -176,7 +198,7 @@ AppTLS::cleanupTLSForThread()
              it != _object->objects.end(); ++it) {
             boost::shared_ptr<const TLSHolderBase> p = (*it).lock();
             if (p) {
-                if ( !p->cleanupPerThreadData(curThread) ) {
+                if ( !p->cleanupPerThreadData(thread) ) {
                     //The TLSHolder still has TLS on it for another thread and is still alive,
                     //then leave it in the set
                     newObjects.insert(p);
@@ -186,7 +208,7 @@ AppTLS::cleanupTLSForThread()
         _object->objects = newObjects;
 #endif
     }
-} // AppTLS::cleanupTLSForThread
+} // AppTLS::cleanupPerThreadData
 
 template class TLSHolder<EffectInstance::EffectTLSData>;
 template class TLSHolder<NATRON_NAMESPACE::OfxHost::OfxHostTLSData>;
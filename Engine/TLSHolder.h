@@ -149,8 +149,22 @@ public:
      **/
     void cleanupTLSForThread();
 
+    /**
+     * @brief Copy all the TLS from snapshot to toThread, along with the abort info of spawnerThread.
+     * snapshot is a thread that is never started, holding a copy of the TLS of spawnerThread made with copyTLS(), so that
+     * threads helping spawnerThread do not copy its TLS while it modifies it.
+     **/
+    void copyTLSFromSnapshot(QThread* snapshot, QThread* spawnerThread, QThread* toThread);
+
+    /**
+     * @brief Cleanup the TLS copied to snapshot with copyTLS(), once no thread copies it anymore
+     **/
+    void cleanupTLSSnapshot(const QThread* snapshot);
+
 private:
 
+    void cleanupPerThreadData(const QThread* thread);
+
     template <typename T>
     boost::shared_ptr<T> copyTLSFromSpawnerThreadInternal(const TLSHolderBase* holder,
                                                           const QThread* curThread,
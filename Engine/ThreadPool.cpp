@@ -31,9 +31,13 @@
 #include <QtCore/QMutex>
 #include <QtCore/QThread>
 #include <QtCore/QThreadPool>
+#include <QtCore/QRunnable>
+#include <QtCore/QWaitCondition>
 
 #include "Engine/AbortableRenderInfo.h"
+#include "Engine/AppManager.h"
 #include "Engine/Node.h"
+#include "Engine/TLSHolder.h"
 
 NATRON_NAMESPACE_ENTER;
 
@@ -173,6 +177,181 @@ AbortableThread::getAbortInfo(bool* isRenderResponseToUserInteraction,
     return true;
 }
 
+struct ThreadPoolTaskGroupPrivate
+{
+    // Protects all fields below
+    QMutex lock;
+
+    // Signaled whenever a task finishes
+    QWaitCondition taskFinishedCond;
+    ThreadPoolTaskGroup::TaskFunctor func;
+    int nTasks;
+
+    // The index of the next task to be claimed
+    int nextTask;
+
+    // Number of tasks claimed but not finished yet
+    int nRunning;
+    bool canceled;
+
+    QThread* spawnerThread;
+
+    // A thread that is never started, holding the copy of the TLS of the thread calling run() taken before it starts
+    // executing tasks: the helpers copy their TLS from it while the calling thread modifies its own TLS.
+    // It is valid as long as a task is running.
+    QThread* tlsSnapshot;
+
+    ThreadPoolTaskGroupPrivate()
+        : lock()
+        , taskFinishedCond()
+        , func()
+        , nTasks(0)
+        , nextTask(0)
+        , nRunning(0)
+        , canceled(false)
+        , spawnerThread(0)
+        , tlsSnapshot(0)
+    {
+    }
+
+    // Must be called with lock held
+    bool claimTask(int* index)
+    {
+        if ( canceled || (nextTask >= nTasks) ) {
+            return false;
+        }
+        *index = nextTask;
+        ++nextTask;
+        ++nRunning;
+
+        return true;
+    }
+
+    // Must be called without lock held
+    void executeTask(int index)
+    {
+        bool ok = func(index);
+        QMutexLocker k(&lock);
+
+        --nRunning;
+        if (!ok) {
+            canceled = true;
+        }
+        taskFinishedCond.wakeAll();
+    }
+};
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+// Executes tasks of a group on a thread of the pool until there is none left to claim
+class ThreadPoolTaskGroupRunnable
+    : public QRunnable
+{
+    boost::shared_ptr<ThreadPoolTaskGroupPrivate> _group;
+
+public:
+
+    ThreadPoolTaskGroupRunnable(const boost::shared_ptr<ThreadPoolTaskGroupPrivate>& group)
+        : QRunnable()
+        , _group(group)
+    {
+    }
+
+    virtual ~ThreadPoolTaskGroupRunnable() {}
+
+    virtual void run() OVERRIDE FINAL
+    {
+        bool copiedTLS = false;
+
+        for (;;) {
+            int index;
+            {
+                QMutexLocker k(&_group->lock);
+                if ( !_group->claimTask(&index) ) {
+                    break;
+                }
+            }
+            if (!copiedTLS) {
+                // The snapshot is valid since this task is running
+                appPTR->getAppTLS()->copyTLSFromSnapshot( _group->tlsSnapshot, _group->spawnerThread, QThread::currentThread() );
+                copiedTLS = true;
+            }
+            _group->executeTask(index);
+        }
+
+        if (copiedTLS) {
+            appPTR->getAppTLS()->cleanupTLSForThread();
+        }
+    }
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+
+ThreadPoolTaskGroup::ThreadPoolTaskGroup()
+    : _imp( new ThreadPoolTaskGroupPrivate() )
+{
+}
+
+ThreadPoolTaskGroup::~ThreadPoolTaskGroup()
+{
+}
+
+bool
+ThreadPoolTaskGroup::run(int nTasks,
+                         const TaskFunctor& func)
+{
+    if (nTasks <= 0) {
+        return true;
+    }
+    {
+        QMutexLocker k(&_imp->lock);
+        assert(_imp->nTasks == 0);
+        _imp->func = func;
+        _imp->nTasks = nTasks;
+    }
+
+    // Copy the TLS of this thread once before it starts executing tasks, so that the helpers do not copy it
+    // while it is being modified
+    QThread tlsSnapshot;
+    _imp->spawnerThread = QThread::currentThread();
+    _imp->tlsSnapshot = &tlsSnapshot;
+    appPTR->getAppTLS()->copyTLS(_imp->spawnerThread, &tlsSnapshot);
+
+    // Request at most one helper per task beyond the first one, which is executed by this thread,
+    // but only among the threads of the pool that are idle.
+    QThreadPool* pool = QThreadPool::globalInstance();
+    for (int i = 1; i < nTasks; ++i) {
+        ThreadPoolTaskGroupRunnable* helper = new ThreadPoolTaskGroupRunnable(_imp);
+        if ( !pool->tryStart(helper) ) {
+            delete helper;
+            break;
+        }
+    }
+
+    // Help executing pending tasks, then wait for the ones executed by the helpers
+    QMutexLocker k(&_imp->lock);
+    for (;;) {
+        int index;
+        if ( _imp->claimTask(&index) ) {
+            k.unlock();
+            _imp->executeTask(index);
+            k.relock();
+        } else if (_imp->nRunning > 0) {
+            _imp->taskFinishedCond.wait(&_imp->lock);
+        } else {
+            break;
+        }
+    }
+    k.unlock();
+
+    // No task is running anymore: the helpers that did not copy the snapshot yet will not claim any task
+    appPTR->getAppTLS()->cleanupTLSSnapshot(&tlsSnapshot);
+    _imp->tlsSnapshot = 0;
+
+    return !_imp->canceled;
+}
+
 // We patched Qt to be able to derive QThreadPool to control the threads that are spawned to improve performances
 // of the EffectInstance::aborted() function
 #ifdef QT_CUSTOM_THREADPOOL
@@ -29,6 +29,8 @@
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
 #endif
 
 #include <QtCore/QThreadPool> // defines QT_CUSTOM_THREADPOOL (or not)
@@ -112,6 +114,42 @@ private:
         } \
     } \
 
+/**
+ * @brief A set of tasks executed concurrently on the global thread pool, used for host frame threading
+ * (eRenderSafetyFullySafeFrame) instead of QtConcurrent::mapped() + waitForFinished().
+ * Tasks are the indices in [0, nTasks): each thread participating to the group claims the next pending index,
+ * so that pool threads take work from the group as soon as they become available.
+ * The thread calling run() does not idle while waiting: it executes pending tasks of the group too.
+ * Helper threads are only taken from the pool if they are idle, so that nested groups (e.g: a tile
+ * whose render triggers a render of the input) never oversubscribe the pool: when it is busy, the tasks
+ * are all executed by the calling thread.
+ * The helper threads get a copy of the TLS of the calling thread taken when run() is called, along with its abort info,
+ * and their TLS is cleaned up once they are done with the group.
+ **/
+struct ThreadPoolTaskGroupPrivate;
+class ThreadPoolTaskGroup
+{
+public:
+
+    // A task returns false to cancel the tasks of the group that are not started yet, e.g: if the render was aborted
+    typedef boost::function<bool (int)> TaskFunctor;
+
+    ThreadPoolTaskGroup();
+
+    ~ThreadPoolTaskGroup();
+
+    /**
+     * @brief Runs func(i) for all i in [0, nTasks) and returns once they are all finished.
+     * This may be called only once per group.
+     * @returns False if a task returned false, in which case the tasks that were not started at that time were skipped.
+     **/
+    bool run(int nTasks, const TaskFunctor& func);
+
+private:
+
+    boost::shared_ptr<ThreadPoolTaskGroupPrivate> _imp;
+};
+
 // We patched Qt to be able to derive QThreadPool to control the threads that are spawned to improve performances
 // of the EffectInstance::aborted() function. This is done by enabling QThreadPoolThread* to derive AbortableThread.
 #ifdef QT_CUSTOM_THREADPOOL
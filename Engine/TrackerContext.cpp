@@ -24,6 +24,7 @@
 
 #include "TrackerContext.h"
 
+#include <map>
 #include <set>
 #include <sstream>
 
@@ -1276,6 +1277,11 @@ TrackerContext::solveTransformParams()
     _imp->lastSolveRequest.keyframes = keyframes;
     _imp->lastSolveRequest.robustModel = robustModel;
     _imp->lastSolveRequest.maxFittingError = maxFittingError;
+    if (jitterPeriod > 1) {
+        _imp->lastSolveRequest.jitterCenters = TrackerContextPrivate::getMarkersCentersForJitter(keyframes, markers, jitterPeriod);
+    } else {
+        _imp->lastSolveRequest.jitterCenters.reset();
+    }
 
     switch (transformType) {
     case eTrackerTransformNodeTransform:
@@ -1699,6 +1705,12 @@ TrackArgs::getLibMVAutoTrack() const
     return _imp->libmvAutotrack;
 }
 
+boost::shared_ptr<TrackerFrameAccessor>
+TrackArgs::getFrameAccessor() const
+{
+    return _imp->fa;
+}
+
 void
 TrackArgs::getEnabledChannels(bool* r,
                               bool* g,
@@ -1741,6 +1753,42 @@ TrackArgs::getRedrawAreasNeeded(int time,
     }
 }
 
+void
+TrackArgs::getPrefetchAreas(int time,
+                            int framesAhead,
+                            std::list<RectI>* rois) const
+{
+    for (std::vector<TrackMarkerAndOptionsPtr >::const_iterator it = _imp->tracks.begin(); it != _imp->tracks.end(); ++it) {
+        // Pattern-matching tracks render their own images
+        if ( toTrackMarkerPM( (*it)->natronMarker ) || !(*it)->natronMarker->isEnabled(time) ) {
+            continue;
+        }
+        KnobDoublePtr searchBtmLeft = (*it)->natronMarker->getSearchWindowBottomLeftKnob();
+        KnobDoublePtr searchTopRight = (*it)->natronMarker->getSearchWindowTopRightKnob();
+        KnobDoublePtr centerKnob = (*it)->natronMarker->getCenterKnob();
+        KnobDoublePtr offsetKnob = (*it)->natronMarker->getOffsetKnob();
+        Point offset, center;
+        offset.x = offsetKnob->getValueAtTime(time, 0);
+        offset.y = offsetKnob->getValueAtTime(time, 1);
+
+        center.x = centerKnob->getValueAtTime(time, 0);
+        center.y = centerKnob->getValueAtTime(time, 1);
+
+        RectD searchWindow;
+        searchWindow.x1 = searchBtmLeft->getValueAtTime(time, 0) + center.x + offset.x;
+        searchWindow.y1 = searchBtmLeft->getValueAtTime(time, 1) + center.y + offset.y;
+        searchWindow.x2 = searchTopRight->getValueAtTime(time, 0) + center.x + offset.x;
+        searchWindow.y2 = searchTopRight->getValueAtTime(time, 1) + center.y + offset.y;
+
+        RectI roi;
+        TrackerFrameAccessor::getPrefetchRoI(searchWindow, framesAhead, &roi);
+        if ( roi.isNull() ) {
+            continue;
+        }
+        rois->push_back(roi);
+    }
+}
+
 struct TrackSchedulerPrivate
 {
     TrackerParamsProvider* paramsProvider;
@@ -1764,6 +1812,13 @@ struct TrackSchedulerPrivate
      * @param time The time at which to track. The reference frame is held in the args and can be different for each track
      */
     static bool trackStepFunctor(int trackIndex, const TrackArgs& args, int time);
+
+    /*
+     * @brief Called on a thread of the global thread pool to render the search windows of the upcoming frames
+     * while the current frame is being tracked.
+     * @param roisPerFrame For each frame to prefetch, the regions to render in pixel coordinates.
+     */
+    static void prefetchFrames(const boost::shared_ptr<TrackerFrameAccessor>& fa, const std::map<int, std::list<RectI> >& roisPerFrame);
 };
 
 TrackScheduler::TrackScheduler(TrackerParamsProvider* paramsProvider,
@@ -1811,6 +1866,17 @@ TrackSchedulerPrivate::trackStepFunctor(int trackIndex,
     return ret;
 }
 
+void
+TrackSchedulerPrivate::prefetchFrames(const boost::shared_ptr<TrackerFrameAccessor>& fa,
+                                      const std::map<int, std::list<RectI> >& roisPerFrame)
+{
+    for (std::map<int, std::list<RectI> >::const_iterator it = roisPerFrame.begin(); it != roisPerFrame.end(); ++it) {
+        fa->prefetchImages(it->first, it->second);
+    }
+
+    appPTR->getAppTLS()->cleanupTLSForThread();
+}
+
 NATRON_NAMESPACE_ANONYMOUS_ENTER
 
 class IsTrackingFlagSetter_RAII
@@ -1900,6 +1966,16 @@ TrackScheduler::threadLoopOnce(const ThreadStartArgsPtr& inArgs)
     timeval lastProgressUpdateTime;
     gettimeofday(&lastProgressUpdateTime, 0);
 
+    // Frames are prefetched only for tracks using libmv, the pattern-matching ones render their own images
+    boost::shared_ptr<TrackerFrameAccessor> fa;
+    for (std::size_t i = 0; i < tracks.size(); ++i) {
+        if ( !toTrackMarkerPM(tracks[i]->natronMarker) ) {
+            fa = args->getFrameAccessor();
+            break;
+        }
+    }
+    QFuture<void> prefetchFuture;
+
     bool allTrackFailed = false;
     {
         ///Use RAII style for setting the isDoingPartialUpdates flag so we're sure it gets removed
@@ -1912,6 +1988,29 @@ TrackScheduler::threadLoopOnce(const ThreadStartArgsPtr& inArgs)
 
 
         while (cur != end) {
+            // While the tracks are stepping on this frame, render the search windows of the next frames
+            // so that libmv finds them in the frame accessor cache.
+            // Only launch a new prefetch once the previous one is done so that it does not lag behind the tracker.
+            if ( fa && ( !prefetchFuture.isStarted() || prefetchFuture.isFinished() ) ) {
+                std::map<int, std::list<RectI> > roisPerFrame;
+                for (int i = 1; i <= NATRON_TRACKER_PREFETCH_FRAMES; ++i) {
+                    int frame = cur + i * frameStep;
+                    if ( (frameStep > 0) ? (frame >= end) : (frame <= end) ) {
+                        break;
+                    }
+                    std::list<RectI> rois;
+                    // The tracks are known at the reference frame of this step
+                    args->getPrefetchAreas(cur - frameStep, i + 1, &rois);
+                    if ( rois.empty() ) {
+                        break;
+                    }
+                    roisPerFrame[frame] = rois;
+                }
+                if ( !roisPerFrame.empty() ) {
+                    prefetchFuture = QtConcurrent::run(&TrackSchedulerPrivate::prefetchFrames, fa, roisPerFrame);
+                }
+            }
+
             ///Launch parallel thread for each track using the global thread pool
             QFuture<bool> future = QtConcurrent::mapped( trackIndexes,
                                                          boost::bind(&TrackSchedulerPrivate::trackStepFunctor,
@@ -1995,6 +2094,9 @@ TrackScheduler::threadLoopOnce(const ThreadStartArgsPtr& inArgs)
                 break;
             }
         } // while (cur != end) {
+
+        // The frame accessor must not be used once the tracking is finished
+        prefetchFuture.waitForFinished();
     } // IsTrackingFlagSetter_RAII
     TrackerContext* isContext = dynamic_cast<TrackerContext*>(_imp->paramsProvider);
     if (isContext) {
@@ -480,11 +480,18 @@ public:
     int getNumTracks() const;
     const std::vector<TrackMarkerAndOptionsPtr >& getTracks() const;
     boost::shared_ptr<mv::AutoTrack> getLibMVAutoTrack() const;
+    boost::shared_ptr<TrackerFrameAccessor> getFrameAccessor() const;
 
     void getEnabledChannels(bool* r, bool* g, bool* b) const;
 
     void getRedrawAreasNeeded(int time, std::list<RectD>* canonicalRects) const;
 
+    /**
+     * @brief Returns the search windows of the tracks using libmv at the given time, in pixel coordinates,
+     * expanded by a margin accounting for the motion of the tracks over framesAhead frames.
+     **/
+    void getPrefetchAreas(int time, int framesAhead, std::list<RectI>* rois) const;
+
 private:
 
     boost::scoped_ptr<TrackArgsPrivate> _imp;
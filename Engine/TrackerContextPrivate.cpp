@@ -1631,13 +1631,16 @@ searchForModel(const bool dataSetIsManual,
             }
         }
     } else {
+        // Score the hypotheses of several samples at once on the thread pool
         ProsacReturnCodeEnum ret = prosac(kernel, foundModel
 #ifdef DEBUG
                                           , inliers
 #else
                                           , 0
 #endif
-                                          , RMS);
+                                          , RMS
+                                          , ProsacParallelEvaluator<KernelType>()
+                                          , NATRON_TRACKER_PROSAC_SAMPLES_PER_BATCH);
         throwProsacError( ret, KernelType::MinimumSamples() );
     }
 }
@@ -1759,12 +1762,62 @@ PointWithErrorCompareLess(const PointWithError& lhs,
     return lhs.error < rhs.error;
 }
 
+static Point
+getMarkerCenterAtTime(const TrackMarker* marker,
+                      const KnobDoublePtr& centerKnob,
+                      double time,
+                      const TrackerContextPrivate::MarkersCenterValues* jitterCenters)
+{
+    if (jitterCenters) {
+        TrackerContextPrivate::MarkersCenterValues::const_iterator foundMarker = jitterCenters->find(marker);
+        if ( foundMarker != jitterCenters->end() ) {
+            TrackerContextPrivate::CenterValues::const_iterator foundTime = foundMarker->second.find(time);
+            if ( foundTime != foundMarker->second.end() ) {
+                return foundTime->second;
+            }
+        }
+    }
+    Point p;
+    p.x = centerKnob->getValueAtTime(time, 0);
+    p.y = centerKnob->getValueAtTime(time, 1);
+
+    return p;
+}
+
+TrackerContextPrivate::MarkersCenterValuesPtr
+TrackerContextPrivate::getMarkersCentersForJitter(const std::set<double>& keyframes,
+                                                  const std::vector<TrackMarkerPtr>& markers,
+                                                  int jitterPeriod)
+{
+    boost::shared_ptr<MarkersCenterValues> ret(new MarkersCenterValues);
+    int halfJitter = std::max(0, jitterPeriod / 2);
+
+    for (std::size_t i = 0; i < markers.size(); ++i) {
+        KnobDoublePtr centerKnob = markers[i]->getCenterKnob();
+        CenterValues& values = (*ret)[markers[i].get()];
+        for (std::set<double>::const_iterator it = keyframes.begin(); it != keyframes.end(); ++it) {
+            // Same frames as in extractSortedPointsFromMarkers
+            for (double t = *it - halfJitter; t <= *it + halfJitter; t += 1.) {
+                if ( values.find(t) != values.end() ) {
+                    continue;
+                }
+                Point& p = values[t];
+                p.x = centerKnob->getValueAtTime(t, 0);
+                p.y = centerKnob->getValueAtTime(t, 1);
+            }
+        }
+    }
+
+    return ret;
+}
+
 void
 TrackerContextPrivate::extractSortedPointsFromMarkers(double refTime,
                                                       double time,
                                                       const std::vector<TrackMarkerPtr>& markers,
                                                       int jitterPeriod,
                                                       bool jitterAdd,
+                                                      const MarkersCenterValues* jitterCenters,
                                                       std::vector<Point>* x1,
                                                       std::vector<Point>* x2)
 {
@@ -1796,10 +1849,7 @@ TrackerContextPrivate::extractSortedPointsFromMarkers(double refTime,
             std::vector<Point> x2PointJitter;
 
             for (double t = time - halfJitter; t <= time + halfJitter; t += 1.) {
-                Point p;
-                p.x = centerKnob->getValueAtTime(t, 0);
-                p.y = centerKnob->getValueAtTime(t, 1);
-                x2PointJitter.push_back(p);
+                x2PointJitter.push_back( getMarkerCenterAtTime(markers[i].get(), centerKnob, t, jitterCenters) );
             }
             Point x2avg = {0, 0};
             for (std::size_t i = 0; i < x2PointJitter.size(); ++i) {
@@ -1811,16 +1861,13 @@ TrackerContextPrivate::extractSortedPointsFromMarkers(double refTime,
                 x2avg.y /= x2PointJitter.size();
             }
             if (!jitterAdd) {
-                perr.p1.x = centerKnob->getValueAtTime(time, 0);
-                perr.p1.y = centerKnob->getValueAtTime(time, 1);
+                perr.p1 = getMarkerCenterAtTime(markers[i].get(), centerKnob, time, jitterCenters);
                 perr.p2.x = x2avg.x;
                 perr.p2.y = x2avg.y;
             } else {
                 Point highFreqX2;
 
-                Point x2;
-                x2.x = centerKnob->getValueAtTime(time, 0);
-                x2.y = centerKnob->getValueAtTime(time, 1);
+                Point x2 = getMarkerCenterAtTime(markers[i].get(), centerKnob, time, jitterCenters);
                 highFreqX2.x = x2.x - x2avg.x;
                 highFreqX2.y = x2.y - x2avg.y;
 
@@ -1853,6 +1900,7 @@ TrackerContextPrivate::computeTransformParamsFromTracksAtTime(double refTime,
                                                               int jitterPeriod,
                                                               bool jitterAdd,
                                                               bool robustModel,
+                                                              const MarkersCenterValuesPtr& jitterCenters,
                                                               const std::vector<TrackMarkerPtr>& allMarkers)
 {
 
@@ -1876,7 +1924,7 @@ TrackerContextPrivate::computeTransformParamsFromTracksAtTime(double refTime,
     data.valid = true;
     assert( !markers.empty() );
     std::vector<Point> x1, x2;
-    extractSortedPointsFromMarkers(refTime, time, markers, jitterPeriod, jitterAdd, &x1, &x2);
+    extractSortedPointsFromMarkers(refTime, time, markers, jitterPeriod, jitterAdd, jitterCenters.get(), &x1, &x2);
     assert( x1.size() == x2.size() );
     if ( x1.empty() ) {
         data.valid = false;
@@ -1915,6 +1963,7 @@ TrackerContextPrivate::computeCornerPinParamsFromTracksAtTime(double refTime,
                                                               int jitterPeriod,
                                                               bool jitterAdd,
                                                               bool robustModel,
+                                                              const MarkersCenterValuesPtr& jitterCenters,
                                                               const std::vector<TrackMarkerPtr>& allMarkers)
 {
     RectD rodRef = getInputRoDAtTime(refTime);
@@ -1938,7 +1987,7 @@ TrackerContextPrivate::computeCornerPinParamsFromTracksAtTime(double refTime,
     data.valid = true;
     assert( !markers.empty() );
     std::vector<Point> x1, x2;
-    extractSortedPointsFromMarkers(refTime, time, markers, jitterPeriod, jitterAdd, &x1, &x2);
+    extractSortedPointsFromMarkers(refTime, time, markers, jitterPeriod, jitterAdd, jitterCenters.get(), &x1, &x2);
     assert( x1.size() == x2.size() );
     if ( x1.empty() ) {
         data.valid = false;
@@ -2378,7 +2427,7 @@ TrackerContextPrivate::computeCornerParamsFromTracks()
     lastSolveRequest.cpWatcher.reset( new QFutureWatcher<TrackerContextPrivate::CornerPinData>() );
     QObject::connect( lastSolveRequest.cpWatcher.get(), SIGNAL(finished()), this, SLOT(onCornerPinSolverWatcherFinished()) );
     QObject::connect( lastSolveRequest.cpWatcher.get(), SIGNAL(progressValueChanged(int)), this, SLOT(onCornerPinSolverWatcherProgress(int)) );
-    lastSolveRequest.cpWatcher->setFuture( QtConcurrent::mapped( lastSolveRequest.keyframes, boost::bind(&TrackerContextPrivate::computeCornerPinParamsFromTracksAtTime, this, lastSolveRequest.refTime, _1, lastSolveRequest.jitterPeriod, lastSolveRequest.jitterAdd, lastSolveRequest.robustModel, lastSolveRequest.allMarkers) ) );
+    lastSolveRequest.cpWatcher->setFuture( QtConcurrent::mapped( lastSolveRequest.keyframes, boost::bind(&TrackerContextPrivate::computeCornerPinParamsFromTracksAtTime, this, lastSolveRequest.refTime, _1, lastSolveRequest.jitterPeriod, lastSolveRequest.jitterAdd, lastSolveRequest.robustModel, lastSolveRequest.jitterCenters, lastSolveRequest.allMarkers) ) );
 #else
     NodePtr thisNode = node.lock();
     QList<CornerPinData> validResults;
@@ -2386,7 +2435,7 @@ TrackerContextPrivate::computeCornerParamsFromTracks()
         int nKeys = (int)lastSolveRequest.keyframes.size();
         int keyIndex = 0;
         for (std::set<double>::const_iterator it = lastSolveRequest.keyframes.begin(); it != lastSolveRequest.keyframes.end(); ++it, ++keyIndex) {
-            CornerPinData data = computeCornerPinParamsFromTracksAtTime(lastSolveRequest.refTime, *it, lastSolveRequest.jitterPeriod, lastSolveRequest.jitterAdd, lastSolveRequest.robustModel, lastSolveRequest.allMarkers);
+            CornerPinData data = computeCornerPinParamsFromTracksAtTime(lastSolveRequest.refTime, *it, lastSolveRequest.jitterPeriod, lastSolveRequest.jitterAdd, lastSolveRequest.robustModel, lastSolveRequest.jitterCenters, lastSolveRequest.allMarkers);
             if (data.valid) {
                 validResults.push_back(data);
             }
@@ -2555,7 +2604,7 @@ TrackerContextPrivate::computeTransformParamsFromTracks()
     lastSolveRequest.tWatcher.reset( new QFutureWatcher<TrackerContextPrivate::TransformData>() );
     QObject::connect( lastSolveRequest.tWatcher.get(), SIGNAL(finished()), this, SLOT(onTransformSolverWatcherFinished()) );
     QObject::connect( lastSolveRequest.tWatcher.get(), SIGNAL(progressValueChanged(int)), this, SLOT(onTransformSolverWatcherProgress(int)) );
-    lastSolveRequest.tWatcher->setFuture( QtConcurrent::mapped( lastSolveRequest.keyframes, boost::bind(&TrackerContextPrivate::computeTransformParamsFromTracksAtTime, this, lastSolveRequest.refTime, _1, lastSolveRequest.jitterPeriod, lastSolveRequest.jitterAdd, lastSolveRequest.robustModel, lastSolveRequest.allMarkers) ) );
+    lastSolveRequest.tWatcher->setFuture( QtConcurrent::mapped( lastSolveRequest.keyframes, boost::bind(&TrackerContextPrivate::computeTransformParamsFromTracksAtTime, this, lastSolveRequest.refTime, _1, lastSolveRequest.jitterPeriod, lastSolveRequest.jitterAdd, lastSolveRequest.robustModel, lastSolveRequest.jitterCenters, lastSolveRequest.allMarkers) ) );
 #else
     NodePtr thisNode = node.lock();
     QList<TransformData> validResults;
@@ -2563,7 +2612,7 @@ TrackerContextPrivate::computeTransformParamsFromTracks()
         int nKeys = lastSolveRequest.keyframes.size();
         int keyIndex = 0;
         for (std::set<double>::const_iterator it = lastSolveRequest.keyframes.begin(); it != lastSolveRequest.keyframes.end(); ++it, ++keyIndex) {
-            TransformData data = computeTransformParamsFromTracksAtTime(lastSolveRequest.refTime, *it, lastSolveRequest.jitterPeriod, lastSolveRequest.jitterAdd, lastSolveRequest.robustModel, lastSolveRequest.allMarkers);
+            TransformData data = computeTransformParamsFromTracksAtTime(lastSolveRequest.refTime, *it, lastSolveRequest.jitterPeriod, lastSolveRequest.jitterAdd, lastSolveRequest.robustModel, lastSolveRequest.jitterCenters, lastSolveRequest.allMarkers);
             if (data.valid) {
                 validResults.push_back(data);
             }
@@ -30,6 +30,9 @@
 #include "Engine/TrackerContext.h"
 
 #include <list>
+#include <map>
+#include <set>
+#include <vector>
 
 #include "Global/Macros.h"
 
@@ -48,6 +51,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QtConcurrentMap>
+#include <QtConcurrentRun> // QtCore on Qt4, QtConcurrent on Qt5
 
 #include <boost/bind.hpp>
 
@@ -69,6 +73,15 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 #define TRACKER_MAX_TRACKS_FOR_PARTIAL_VIEWER_UPDATE 8
 
+// Number of frames ahead of the tracker whose search windows are rendered in the background
+#define NATRON_TRACKER_PREFETCH_FRAMES 2
+
+// Number of samples drawn by Prosac before their hypotheses are scored concurrently
+#define NATRON_TRACKER_PROSAC_SAMPLES_PER_BATCH 16
+
+// Below this number of (hypothesis, correspondence) pairs, a batch is scored on the calling thread
+#define NATRON_TRACKER_PROSAC_MIN_PARALLEL_WORK 4096
+
 /// Parameters definitions
 
 //////// Global to all tracks
@@ -351,6 +364,45 @@ public:
 };
 
 
+/**
+ * @brief Scores a batch of Prosac hypotheses with one task per hypothesis on the global thread pool.
+ **/
+template <typename Kernel>
+class ProsacParallelEvaluator
+{
+public:
+
+    void operator()(const Kernel& kernel,
+                    const std::vector<typename Kernel::Model>& models,
+                    std::vector<openMVG::robust::InliersVec>* isInlier,
+                    std::vector<int>* nbInliers,
+                    std::vector<double>* RMS) const
+    {
+        if ( (models.size() < 2) || (models.size() * kernel.NumSamples() < NATRON_TRACKER_PROSAC_MIN_PARALLEL_WORK) ) {
+            openMVG::robust::ProsacSequentialEvaluator<Kernel>()(kernel, models, isInlier, nbInliers, RMS);
+
+            return;
+        }
+        std::vector<int> modelIndexes( models.size() );
+        for (std::size_t i = 0; i < modelIndexes.size(); ++i) {
+            modelIndexes[i] = (int)i;
+        }
+        QtConcurrent::blockingMap( modelIndexes, boost::bind(&ProsacParallelEvaluator::scoreModel, boost::cref(kernel), boost::cref(models), isInlier, nbInliers, RMS, _1) );
+    }
+
+private:
+
+    static void scoreModel(const Kernel& kernel,
+                           const std::vector<typename Kernel::Model>& models,
+                           std::vector<openMVG::robust::InliersVec>* isInlier,
+                           std::vector<int>* nbInliers,
+                           std::vector<double>* RMS,
+                           int modelIndex)
+    {
+        (*nbInliers)[modelIndex] = kernel.ComputeInliersForModel(models[modelIndex], &(*isInlier)[modelIndex], RMS ? &(*RMS)[modelIndex] : 0);
+    }
+};
+
 class TrackerContextPrivate
     : public QObject
 {
@@ -474,6 +526,15 @@ public:
     typedef boost::shared_ptr<QFutureWatcher<CornerPinData> > CornerPinSolverWatcher;
     typedef boost::shared_ptr<QFutureWatcher<TransformData> > TransformSolverWatcher;
 
+    /*
+     * @brief The center of each marker at the frames covered by the jitter period around the solved keyframes.
+     * The jitter periods of consecutive keyframes overlap: the centers are read once for the whole solve
+     * and shared by the solver of each keyframe.
+     */
+    typedef std::map<double, Point> CenterValues;
+    typedef std::map<const TrackMarker*, CenterValues> MarkersCenterValues;
+    typedef boost::shared_ptr<const MarkersCenterValues> MarkersCenterValuesPtr;
+
     struct SolveRequest
     {
         CornerPinSolverWatcher cpWatcher;
@@ -485,6 +546,7 @@ public:
         bool robustModel;
         double maxFittingError;
         std::vector<TrackMarkerPtr> allMarkers;
+        MarkersCenterValuesPtr jitterCenters;
     };
 
     SolveRequest lastSolveRequest;
@@ -632,15 +694,25 @@ public:
                                                const std::vector<TrackMarkerPtr>& markers,
                                                int jitterPeriod,
                                                bool jitterAdd,
+                                               const MarkersCenterValues* jitterCenters,
                                                std::vector<Point>* x1,
                                                std::vector<Point>* x2);
 
+    /**
+     * @brief Reads the center of the markers at all frames needed by extractSortedPointsFromMarkers
+     * to average them over jitterPeriod around each keyframe.
+     **/
+    static MarkersCenterValuesPtr getMarkersCentersForJitter(const std::set<double>& keyframes,
+                                                             const std::vector<TrackMarkerPtr>& markers,
+                                                             int jitterPeriod);
+
 
     TransformData computeTransformParamsFromTracksAtTime(double refTime,
                                                          double time,
                                                          int jitterPeriod,
                                                          bool jitterAdd,
                                                          bool robustModel,
+                                                         const MarkersCenterValuesPtr& jitterCenters,
                                                          const std::vector<TrackMarkerPtr>& allMarkers);
 
     CornerPinData computeCornerPinParamsFromTracksAtTime(double refTime,
@@ -648,6 +720,7 @@ public:
                                                          int jitterPeriod,
                                                          bool jitterAdd,
                                                          bool robustModel,
+                                                         const MarkersCenterValuesPtr& jitterCenters,
                                                          const std::vector<TrackMarkerPtr>& allMarkers);
 
 
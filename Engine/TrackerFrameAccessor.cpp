@@ -24,6 +24,8 @@
 
 #include "TrackerFrameAccessor.h"
 
+#include <list>
+
 GCC_DIAG_OFF(unused-function)
 GCC_DIAG_OFF(unused-parameter)
 #include <libmv/image/array_nd.h>
@@ -42,45 +44,12 @@ GCC_DIAG_ON(unused-parameter)
 #include "Engine/Image.h"
 #include "Engine/Node.h"
 #include "Engine/TrackerContext.h"
+#include "Engine/TrackerFrameAccessorCache.h"
+#include "Engine/TrackerImageConversion.h"
 
 NATRON_NAMESPACE_ENTER;
 
 namespace  {
-struct FrameAccessorCacheKey
-{
-    int frame;
-    int mipMapLevel;
-    mv::FrameAccessor::InputMode mode;
-};
-
-struct CacheKey_compare_less
-{
-    bool operator() (const FrameAccessorCacheKey & lhs,
-                     const FrameAccessorCacheKey & rhs) const
-    {
-        if (lhs.frame < rhs.frame) {
-            return true;
-        } else if (lhs.frame > rhs.frame) {
-            return false;
-        } else {
-            if (lhs.mipMapLevel < rhs.mipMapLevel) {
-                return true;
-            } else if (lhs.mipMapLevel > rhs.mipMapLevel) {
-                return false;
-            } else {
-                if ( (int)lhs.mode < (int)rhs.mode ) {
-                    return true;
-                } else if ( (int)lhs.mode > (int)rhs.mode ) {
-                    return false;
-                } else {
-                    return false;
-                }
-            }
-        }
-    }
-};
-
-
 class MvFloatImage
     : public libmv::Array3D<float>
 {
@@ -110,94 +79,42 @@ public:
 };
 
 
-struct FrameAccessorCacheEntry
+static void
+natronImageToLibMvFloatImage(bool enabledChannels[3],
+                             const Image* source,
+                             const RectI& roi,
+                             MvFloatImage& mvImg)
 {
-    boost::shared_ptr<MvFloatImage> image;
-
-    // If null, this is the full image
-    RectI bounds;
-    unsigned int referenceCount;
-};
-
-typedef std::multimap<FrameAccessorCacheKey, FrameAccessorCacheEntry, CacheKey_compare_less > FrameAccessorCache;
+    //mvImg is expected to have its bounds equal to roi
 
+    // It's important to rescale the resultappropriately so that e.g. if only
+    // blue is selected, it's not zeroed out.
+    float scale = (enabledChannels[0] ? 0.2126f : 0.0f) +
+                  (enabledChannels[1] ? 0.7152f : 0.0f) +
+                  (enabledChannels[2] ? 0.0722f : 0.0f);
+    TrackerImage::LuminanceWeights weights;
 
-template <bool doR, bool doG, bool doB>
-void
-natronImageToLibMvFloatImageForChannels(const Image* source,
-                                        const RectI& roi,
-                                        MvFloatImage& mvImg)
-{
-    //mvImg is expected to have its bounds equal to roi
+    weights.r = (enabledChannels[0] && scale > 0.f) ? 0.2126f / scale : 0.f;
+    weights.g = (enabledChannels[1] && scale > 0.f) ? 0.7152f / scale : 0.f;
+    weights.b = (enabledChannels[2] && scale > 0.f) ? 0.0722f / scale : 0.f;
 
     Image::ReadAccess racc(source);
-    unsigned int compsCount = source->getComponentsCount();
-
-    assert(compsCount == 3);
-    unsigned int srcRowElements = source->getRowElements();
+    const ImageBitDepthEnum bitDepth = source->getBitDepth();
+    const int nComps = (int)source->getComponentsCount();
+    const std::size_t srcRowBytes = source->getRowElements() * getSizeOfForBitDepth(bitDepth);
 
     assert( source->getBounds().contains(roi) );
-    const float* src_pixels = (const float*)racc.pixelAt(roi.x1, roi.y1);
+    const unsigned char* src_pixels = (const unsigned char*)racc.pixelAt(roi.x1, roi.y1);
     assert(src_pixels);
     float* dst_pixels = mvImg.Data();
     assert(dst_pixels);
     //LibMV images have their origin in the top left hand corner
 
-    // It's important to rescale the resultappropriately so that e.g. if only
-    // blue is selected, it's not zeroed out.
-    float scale = (doR ? 0.2126f : 0.0f) +
-                  (doG ? 0.7152f : 0.0f) +
-                  (doB ? 0.0722f : 0.0f);
+    const InstructionSetEnum instructionSet = getBestInstructionSet();
     int h = roi.height();
     int w = roi.width();
-    for ( int y = 0; y < h; ++y,
-          src_pixels += (srcRowElements - compsCount * w) ) {
-        for (int x = 0; x < w; ++x,
-             src_pixels += compsCount,
-             ++dst_pixels) {
-            /// Apply luminance conversion while we copy the image
-            /// This code is taken from DisableChannelsTransform::run in libmv/autotrack/autotrack.cc
-            *dst_pixels = ( 0.2126f * (doR ? src_pixels[0] : 0.0f) +
-                            0.7152f * (doG ? src_pixels[1] : 0.0f) +
-                            0.0722f * (doB ? src_pixels[2] : 0.0f) ) / scale;
-        }
-    }
-}
-
-static void
-natronImageToLibMvFloatImage(bool enabledChannels[3],
-                             const Image* source,
-                             const RectI& roi,
-                             MvFloatImage& mvImg)
-{
-    if (enabledChannels[0]) {
-        if (enabledChannels[1]) {
-            if (enabledChannels[2]) {
-                natronImageToLibMvFloatImageForChannels<true, true, true>(source, roi, mvImg);
-            } else {
-                natronImageToLibMvFloatImageForChannels<true, true, false>(source, roi, mvImg);
-            }
-        } else {
-            if (enabledChannels[2]) {
-                natronImageToLibMvFloatImageForChannels<true, false, true>(source, roi, mvImg);
-            } else {
-                natronImageToLibMvFloatImageForChannels<true, false, false>(source, roi, mvImg);
-            }
-        }
-    } else {
-        if (enabledChannels[1]) {
-            if (enabledChannels[2]) {
-                natronImageToLibMvFloatImageForChannels<false, true, true>(source, roi, mvImg);
-            } else {
-                natronImageToLibMvFloatImageForChannels<false, true, false>(source, roi, mvImg);
-            }
-        } else {
-            if (enabledChannels[2]) {
-                natronImageToLibMvFloatImageForChannels<false, false, true>(source, roi, mvImg);
-            } else {
-                natronImageToLibMvFloatImageForChannels<false, false, false>(source, roi, mvImg);
-            }
-        }
+    for (int y = 0; y < h; ++y, src_pixels += srcRowBytes, dst_pixels += w) {
+        TrackerImage::convertRowToMono(instructionSet, bitDepth, nComps, src_pixels, w, weights, dst_pixels);
     }
 }
 } // anon namespace
@@ -207,9 +124,9 @@ struct TrackerFrameAccessorPrivate
 {
     const TrackerContext* context;
     NodePtr trackerInput;
-    mutable QMutex cacheMutex;
-    FrameAccessorCache cache;
+    TrackerFrameAccessorCache cache;
     bool enabledChannels[3];
+    int channelsMask;
     int formatHeight;
 
     TrackerFrameAccessorPrivate(const TrackerContext* context,
@@ -217,124 +134,47 @@ struct TrackerFrameAccessorPrivate
                                 int formatHeight)
         : context(context)
         , trackerInput()
-        , cacheMutex()
         , cache()
         , enabledChannels()
+        , channelsMask(0)
         , formatHeight(formatHeight)
     {
         trackerInput = context->getNode()->getInput(0);
         assert(trackerInput);
         for (int i = 0; i < 3; ++i) {
             this->enabledChannels[i] = enabledChannels[i];
+            if (enabledChannels[i]) {
+                channelsMask |= (1 << i);
+            }
         }
     }
-};
-
-TrackerFrameAccessor::TrackerFrameAccessor(const TrackerContext* context,
-                                           bool enabledChannels[3],
-                                           int formatHeight)
-    : mv::FrameAccessor()
-    , _imp( new TrackerFrameAccessorPrivate(context, enabledChannels, formatHeight) )
-{
-}
 
-TrackerFrameAccessor::~TrackerFrameAccessor()
-{
-}
-
-void
-TrackerFrameAccessor::getEnabledChannels(bool* r,
-                                         bool* g,
-                                         bool* b) const
-{
-    *r = _imp->enabledChannels[0];
-    *g = _imp->enabledChannels[1];
-    *b = _imp->enabledChannels[2];
-}
-
-double
-TrackerFrameAccessor::invertYCoordinate(double yIn,
-                                        double formatHeight)
-{
-    return formatHeight - 1 - yIn;
-}
-
-void
-TrackerFrameAccessor::convertLibMVRegionToRectI(const mv::Region& region,
-                                                int /*formatHeight*/,
-                                                RectI* roi)
-{
-    roi->x1 = region.min(0);
-    roi->x2 = region.max(0);
-    roi->y1 = region.min(1);
-    //roi->y1 = invertYCoordinate(region.max(1), formatHeight);
-    roi->y2 = region.max(1);
-    //roi->y2 = invertYCoordinate(region.min(1), formatHeight);
-}
+    /**
+     * @brief Render the input of the tracker and convert it to a libmv mono image.
+     * If roi is NULL, the full image is rendered.
+     **/
+    boost::shared_ptr<MvFloatImage> renderImage(int frame, int downscale, const RectI* roi, RectI* bounds);
+};
 
-/*
- * @brief This is called by LibMV to retrieve an image either for reference or as search frame.
- */
-mv::FrameAccessor::Key
-TrackerFrameAccessor::GetImage(int /*clip*/,
-                               int frame,
-                               mv::FrameAccessor::InputMode input_mode,
-                               int downscale,            // Downscale by 2^downscale.
-                               const mv::Region* region,     // Get full image if NULL.
-                               const mv::FrameAccessor::Transform* /*transform*/, // May be NULL.
-                               mv::FloatImage** destination)
+boost::shared_ptr<MvFloatImage>
+TrackerFrameAccessorPrivate::renderImage(int frame,
+                                         int downscale,
+                                         const RectI* requestedRoI,
+                                         RectI* bounds)
 {
-    // Since libmv only uses MONO images for now we have only optimized for this case, remove and handle properly
-    // other case(s) when they get integrated into libmv.
-    assert(input_mode == mv::FrameAccessor::MONO);
-
-
-    FrameAccessorCacheKey key;
-    key.frame = frame;
-    key.mipMapLevel = downscale;
-    key.mode = input_mode;
-
-    /*
-       Check if a frame exists in the cache with matching key and bounds enclosing the given region
-     */
-    RectI roi;
-    if (region) {
-        convertLibMVRegionToRectI(*region, _imp->formatHeight, &roi);
-
-        QMutexLocker k(&_imp->cacheMutex);
-        std::pair<FrameAccessorCache::iterator, FrameAccessorCache::iterator> range = _imp->cache.equal_range(key);
-        for (FrameAccessorCache::iterator it = range.first; it != range.second; ++it) {
-            if ( (roi.x1 >= it->second.bounds.x1) && (roi.x2 <= it->second.bounds.x2) &&
-                 ( roi.y1 >= it->second.bounds.y1) && ( roi.y2 <= it->second.bounds.y2) ) {
-#ifdef TRACE_LIB_MV
-                qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Found cached image at frame" << frame << "with RoI x1="
-                         << region->min(0) << "y1=" << region->max(1) << "x2=" << region->max(0) << "y2=" << region->min(1);
-#endif
-                // LibMV is kinda dumb on this we must necessarily copy the data either via CopyFrom or the
-                // assignment constructor:
-                // EDIT: fixed libmv
-                *destination = it->second.image.get();
-                //destination->CopyFrom<float>(*it->second.image);
-                ++it->second.referenceCount;
-
-                return (mv::FrameAccessor::Key)it->second.image.get();
-            }
-        }
-    }
-
     EffectInstancePtr effect;
-    if (_imp->trackerInput) {
-        effect = _imp->trackerInput->getEffectInstance();
+
+    if (trackerInput) {
+        effect = trackerInput->getEffectInstance();
     }
     if (!effect) {
-        return (mv::FrameAccessor::Key)0;
+        return boost::shared_ptr<MvFloatImage>();
     }
 
-    // Not in accessor cache, call renderRoI
     RenderScale scale;
     scale.y = scale.x = Image::getScaleFromMipMapLevel( (unsigned int)downscale );
 
-    NodePtr node = _imp->context->getNode();
+    NodePtr node = context->getNode();
 
 
     const bool isRenderUserInteraction = true;
@@ -365,7 +205,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
     try {
         frameRenderArgs.reset(new ParallelRenderArgsSetter(tlsArgs));
     } catch (...) {
-        return (mv::FrameAccessor::Key)0;
+        return boost::shared_ptr<MvFloatImage>();
     }
 
     U64 effectHash;
@@ -374,11 +214,13 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
     (void)gotHash;
     double par = effect->getAspectRatio(-1);
     RectD precomputedRoD;
-    if (!region) {
-
+    RectI roi;
+    if (requestedRoI) {
+        roi = *requestedRoI;
+    } else {
         StatusEnum stat = effect->getRegionOfDefinition_public(effectHash, frame, scale, ViewIdx(0), &precomputedRoD);
         if (stat == eStatusFailed) {
-            return (mv::FrameAccessor::Key)0;
+            return boost::shared_ptr<MvFloatImage>();
         }
         precomputedRoD.toPixelEnclosing( (unsigned int)downscale, par, &roi );
     }
@@ -391,7 +233,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
     RectD canonicalRoi;
     roi.toCanonical(downscale, par, precomputedRoD, &canonicalRoi);
     if (frameRenderArgs->computeRequestPass(downscale, canonicalRoi) != eStatusOK) {
-        return (mv::FrameAccessor::Key)0;
+        return boost::shared_ptr<MvFloatImage>();
     }
 
     EffectInstance::RenderRoIArgs args( frame,
@@ -404,7 +246,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
                                         components,
                                         eImageBitDepthFloat,
                                         true,
-                                        _imp->context->getNode()->getEffectInstance(),
+                                        context->getNode()->getEffectInstance(),
                                         eStorageModeRAM /*returnOpenGLTex*/,
                                         frame);
     std::map<ImageComponents, ImagePtr> planes;
@@ -416,7 +258,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
                  << roi.x1 << "y1=" << roi.y1 << "x2=" << roi.x2 << "y2=" << roi.y2;
 #endif
 
-        return (mv::FrameAccessor::Key)0;
+        return boost::shared_ptr<MvFloatImage>();
     }
 
     assert( !planes.empty() );
@@ -429,7 +271,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
                  << roi.x1 << "y1=" << roi.y1 << "x2=" << roi.x2 << "y2=" << roi.y2 << ")";
 #endif
 
-        return (mv::FrameAccessor::Key)0;
+        return boost::shared_ptr<MvFloatImage>();
     }
 
 #ifdef TRACE_LIB_MV
@@ -440,47 +282,201 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
     /*
        Copy the Natron image to the LivMV float image
      */
-    FrameAccessorCacheEntry entry;
-    entry.image.reset( new MvFloatImage( intersectedRoI.height(), intersectedRoI.width() ) );
-    entry.bounds = intersectedRoI;
-    entry.referenceCount = 1;
-    natronImageToLibMvFloatImage(_imp->enabledChannels,
+    boost::shared_ptr<MvFloatImage> image( new MvFloatImage( intersectedRoI.height(), intersectedRoI.width() ) );
+    natronImageToLibMvFloatImage(enabledChannels,
                                  sourceImage.get(),
                                  intersectedRoI,
-                                 *entry.image);
+                                 *image);
     // we ignore the transform parameter and do it in natronImageToLibMvFloatImage instead
 
-    *destination = entry.image.get();
-    //destination->CopyFrom<float>(*entry.image);
+    *bounds = intersectedRoI;
+
+    return image;
+} // TrackerFrameAccessorPrivate::renderImage
+
+TrackerFrameAccessor::TrackerFrameAccessor(const TrackerContext* context,
+                                           bool enabledChannels[3],
+                                           int formatHeight)
+    : mv::FrameAccessor()
+    , _imp( new TrackerFrameAccessorPrivate(context, enabledChannels, formatHeight) )
+{
+}
+
+TrackerFrameAccessor::~TrackerFrameAccessor()
+{
+}
+
+void
+TrackerFrameAccessor::getEnabledChannels(bool* r,
+                                         bool* g,
+                                         bool* b) const
+{
+    *r = _imp->enabledChannels[0];
+    *g = _imp->enabledChannels[1];
+    *b = _imp->enabledChannels[2];
+}
+
+double
+TrackerFrameAccessor::invertYCoordinate(double yIn,
+                                        double formatHeight)
+{
+    return formatHeight - 1 - yIn;
+}
+
+void
+TrackerFrameAccessor::convertLibMVRegionToRectI(const mv::Region& region,
+                                                int /*formatHeight*/,
+                                                RectI* roi)
+{
+    roi->x1 = region.min(0);
+    roi->x2 = region.max(0);
+    roi->y1 = region.min(1);
+    //roi->y1 = invertYCoordinate(region.max(1), formatHeight);
+    roi->y2 = region.max(1);
+    //roi->y2 = invertYCoordinate(region.min(1), formatHeight);
+}
+
+void
+TrackerFrameAccessor::getPrefetchRoI(const RectD& searchWindow,
+                                     int framesAhead,
+                                     RectI* roi)
+{
+    // The track can not move by more than half its search window in a frame, but it rarely does:
+    // expand by a quarter of the search window per frame, renders of the input are cached anyway
+    // if libmv asks for a slightly different region.
+    double marginX = searchWindow.width() * 0.25 * framesAhead;
+    double marginY = searchWindow.height() * 0.25 * framesAhead;
+
+    // Same conversion as natronTrackerToLibMVTracker + convertLibMVRegionToRectI
+    roi->x1 = (int)(searchWindow.x1 - 0.5 - marginX);
+    roi->y1 = (int)(searchWindow.y1 - 0.5 - marginY);
+    roi->x2 = (int)(searchWindow.x2 - 0.5 + marginX);
+    roi->y2 = (int)(searchWindow.y2 - 0.5 + marginY);
+}
+
+/*
+ * @brief This is called by LibMV to retrieve an image either for reference or as search frame.
+ */
+mv::FrameAccessor::Key
+TrackerFrameAccessor::GetImage(int clip,
+                               int frame,
+                               mv::FrameAccessor::InputMode input_mode,
+                               int downscale,            // Downscale by 2^downscale.
+                               const mv::Region* region,     // Get full image if NULL.
+                               const mv::FrameAccessor::Transform* /*transform*/, // May be NULL.
+                               mv::FloatImage** destination)
+{
+    // Since libmv only uses MONO images for now we have only optimized for this case, remove and handle properly
+    // other case(s) when they get integrated into libmv.
+    assert(input_mode == mv::FrameAccessor::MONO);
+
+
+    FrameAccessorCacheKey key;
+    key.frame = frame;
+    key.mipMapLevel = downscale;
+    key.mode = input_mode;
+    key.channelsMask = _imp->channelsMask;
+
+    /*
+       Check if a frame exists in the cache with matching key and bounds enclosing the given region.
+       If another thread (e.g: the prefetcher) is rendering it, wait for it rather than rendering it twice.
+     */
+    RectI roi;
+    if (region) {
+        // The region is in full resolution coordinates
+        convertLibMVRegionToRectI(*region, _imp->formatHeight, &roi);
+        roi = roi.downscalePowerOfTwoSmallestEnclosing( (unsigned int)downscale );
+
+        mv::FloatImage* cached = _imp->cache.acquireImage(key, roi);
+        if (cached) {
+#ifdef TRACE_LIB_MV
+            qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Found cached image at frame" << frame << "with RoI x1="
+                     << region->min(0) << "y1=" << region->max(1) << "x2=" << region->max(0) << "y2=" << region->min(1);
+#endif
+            // LibMV is kinda dumb on this we must necessarily copy the data either via CopyFrom or the
+            // assignment constructor:
+            // EDIT: fixed libmv
+            *destination = cached;
+            //destination->CopyFrom<float>(*cached);
+
+            return (mv::FrameAccessor::Key)cached;
+        }
+    }
+
+    // From here on, the render of the roi is registered in the cache: end it whatever happens
+    TrackerFrameAccessorCache::EndPendingRender_RAII pendingRender(&_imp->cache, key, region ? &roi : 0);
+    TrackerFrameAccessorCache::FloatImagePtr image;
+    RectI bounds;
+    if (region && downscale > 0) {
+        // Build the pyramid level by box-filtering the full resolution image, which is likely to be cached already,
+        // instead of rendering the input at a lower mipmap level
+        mv::FloatImage* fullImage = 0;
+        mv::FrameAccessor::Key fullKey = GetImage(clip, frame, input_mode, 0, region, 0, &fullImage);
+        if (fullKey) {
+            const InstructionSetEnum instructionSet = getBestInstructionSet();
+            const mv::FloatImage* level = (const mv::FloatImage*)fullKey;
+            RectI levelBounds;
+            bool gotBounds = _imp->cache.getImageBounds(level, &levelBounds);
+            assert(gotBounds);
+            (void)gotBounds;
+            for (int i = 0; i < downscale; ++i) {
+                RectI dstBounds = levelBounds.downscalePowerOfTwoSmallestEnclosing(1);
+                boost::shared_ptr<MvFloatImage> dst( new MvFloatImage( dstBounds.height(), dstBounds.width() ) );
+                TrackerImage::downscaleMonoImage(instructionSet, level->Data(), levelBounds, dstBounds, dst->Data());
+                image = dst;
+                level = dst.get();
+                levelBounds = dstBounds;
+            }
+            bounds = levelBounds;
+            ReleaseImage(fullKey);
+        }
+    }
+    if (!image) {
+        // Not in accessor cache, call renderRoI
+        image = _imp->renderImage(frame, downscale, region ? &roi : 0, &bounds);
+    }
 
     //insert into the cache
-    {
-        QMutexLocker k(&_imp->cacheMutex);
-        _imp->cache.insert( std::make_pair(key, entry) );
+    pendingRender.insertImage(image, bounds, true);
+    if (!image) {
+        return (mv::FrameAccessor::Key)0;
     }
+
+    *destination = image.get();
+    //destination->CopyFrom<float>(*image);
 #ifdef TRACE_LIB_MV
     qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Rendered frame" << frame << "with RoI x1="
-             << intersectedRoI.x1 << "y1=" << intersectedRoI.y1 << "x2=" << intersectedRoI.x2 << "y2=" << intersectedRoI.y2;
+             << bounds.x1 << "y1=" << bounds.y1 << "x2=" << bounds.x2 << "y2=" << bounds.y2;
 #endif
 
-    return (mv::FrameAccessor::Key)entry.image.get();
+    return (mv::FrameAccessor::Key)image.get();
 } // TrackerFrameAccessor::GetImage
 
 void
 TrackerFrameAccessor::ReleaseImage(Key key)
 {
-    MvFloatImage* imgKey = (MvFloatImage*)key;
-    QMutexLocker k(&_imp->cacheMutex);
+    _imp->cache.releaseImage( (const mv::FloatImage*)key );
+}
 
-    for (FrameAccessorCache::iterator it = _imp->cache.begin(); it != _imp->cache.end(); ++it) {
-        if (it->second.image.get() == imgKey) {
-            --it->second.referenceCount;
-            if (!it->second.referenceCount) {
-                _imp->cache.erase(it);
+void
+TrackerFrameAccessor::prefetchImages(int frame,
+                                     const std::list<RectI>& rois)
+{
+    FrameAccessorCacheKey key;
 
-                return;
-            }
+    key.frame = frame;
+    key.mipMapLevel = 0;
+    key.mode = mv::FrameAccessor::MONO;
+    key.channelsMask = _imp->channelsMask;
+
+    for (std::list<RectI>::const_iterator it = rois.begin(); it != rois.end(); ++it) {
+        if ( !_imp->cache.beginPrefetch(key, *it) ) {
+            continue;
         }
+        TrackerFrameAccessorCache::EndPendingRender_RAII pendingRender(&_imp->cache, key, &*it);
+        RectI bounds;
+        boost::shared_ptr<MvFloatImage> image = _imp->renderImage(frame, 0, &*it, &bounds);
+        pendingRender.insertImage(image, bounds, false);
     }
 }
 
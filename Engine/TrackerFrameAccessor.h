@@ -27,6 +27,8 @@
 
 #include "Global/Macros.h"
 
+#include <list>
+
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/scoped_ptr.hpp>
 #endif
@@ -75,9 +77,23 @@ public:
     virtual bool GetClipDimensions(int clip, int* width, int* height) OVERRIDE FINAL;
     virtual int NumClips() OVERRIDE FINAL;
     virtual int NumFrames(int clip) OVERRIDE FINAL;
+    /**
+     * @brief Render the given regions (in pixel coordinates at full scale) of the input at the given frame
+     * and keep them in the cache so that a later call to GetImage does not have to wait for the render.
+     * Regions that are already cached or being rendered are skipped.
+     * This is meant to be called from another thread while the tracker is tracking the previous frame.
+     **/
+    void prefetchImages(int frame, const std::list<RectI>& rois);
+
     static double invertYCoordinate(double yIn, double formatHeight);
     static void convertLibMVRegionToRectI(const mv::Region& region, int formatHeight, RectI* roi);
 
+    /**
+     * @brief Returns the region to prefetch, in pixel coordinates, for a search window at the reference frame
+     * in canonical coordinates, expanded by a margin accounting for the motion of the track over framesAhead frames.
+     **/
+    static void getPrefetchRoI(const RectD& searchWindow, int framesAhead, RectI* roi);
+
 private:
 
     boost::scoped_ptr<TrackerFrameAccessorPrivate> _imp;
@@ -0,0 +1,279 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "TrackerFrameAccessorCache.h"
+
+#include <cassert>
+
+NATRON_NAMESPACE_ENTER;
+
+static bool
+enclosesRoI(const RectI& bounds,
+            const RectI& roi)
+{
+    return (roi.x1 >= bounds.x1) && (roi.x2 <= bounds.x2) &&
+           (roi.y1 >= bounds.y1) && (roi.y2 <= bounds.y2);
+}
+
+static bool
+isSameKey(const FrameAccessorCacheKey& lhs,
+          const FrameAccessorCacheKey& rhs)
+{
+    CacheKey_compare_less less;
+
+    return !less(lhs, rhs) && !less(rhs, lhs);
+}
+
+TrackerFrameAccessorCache::TrackerFrameAccessorCache(std::size_t maxRetainedBytes)
+    : _maxRetainedBytes(maxRetainedBytes)
+    , _lock()
+    , _entries()
+    , _pendingRenders()
+    , _pendingRendersCond()
+    , _retainedBytes(0)
+    , _useCounter(0)
+{
+}
+
+TrackerFrameAccessorCache::EntryMap::iterator
+TrackerFrameAccessorCache::findImage(const FrameAccessorCacheKey& key,
+                                     const RectI& roi)
+{
+    std::pair<EntryMap::iterator, EntryMap::iterator> range = _entries.equal_range(key);
+    for (EntryMap::iterator it = range.first; it != range.second; ++it) {
+        if ( enclosesRoI(it->second.bounds, roi) ) {
+            return it;
+        }
+    }
+
+    return _entries.end();
+}
+
+bool
+TrackerFrameAccessorCache::isRenderPending(const FrameAccessorCacheKey& key,
+                                           const RectI& roi) const
+{
+    for (PendingRenders::const_iterator it = _pendingRenders.begin(); it != _pendingRenders.end(); ++it) {
+        if ( isSameKey(key, it->key) && enclosesRoI(it->roi, roi) ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+TrackerFrameAccessorCache::addPendingRender(const FrameAccessorCacheKey& key,
+                                            const RectI& roi)
+{
+    PendingRender pending;
+
+    pending.key = key;
+    pending.roi = roi;
+    _pendingRenders.push_back(pending);
+}
+
+void
+TrackerFrameAccessorCache::evictUnreferencedImages()
+{
+    while (_retainedBytes > _maxRetainedBytes) {
+        EntryMap::iterator oldest = _entries.end();
+        for (EntryMap::iterator it = _entries.begin(); it != _entries.end(); ++it) {
+            if ( !it->second.referenceCount && ( ( oldest == _entries.end() ) || (it->second.lastUse < oldest->second.lastUse) ) ) {
+                oldest = it;
+            }
+        }
+        if ( oldest == _entries.end() ) {
+            assert(false);
+            _retainedBytes = 0;
+
+            return;
+        }
+        _retainedBytes -= getImageBytes(oldest->second.bounds);
+        _entries.erase(oldest);
+    }
+}
+
+mv::FloatImage*
+TrackerFrameAccessorCache::acquireImage(const FrameAccessorCacheKey& key,
+                                        const RectI& roi)
+{
+    QMutexLocker k(&_lock);
+
+    for (;;) {
+        EntryMap::iterator found = findImage(key, roi);
+        if ( found != _entries.end() ) {
+            if (!found->second.referenceCount) {
+                _retainedBytes -= getImageBytes(found->second.bounds);
+            }
+            ++found->second.referenceCount;
+            found->second.lastUse = ++_useCounter;
+
+            return found->second.image.get();
+        }
+        if ( !isRenderPending(key, roi) ) {
+            break;
+        }
+        _pendingRendersCond.wait(&_lock);
+    }
+
+    addPendingRender(key, roi);
+
+    return 0;
+}
+
+bool
+TrackerFrameAccessorCache::beginPrefetch(const FrameAccessorCacheKey& key,
+                                         const RectI& roi)
+{
+    QMutexLocker k(&_lock);
+
+    if ( ( findImage(key, roi) != _entries.end() ) || isRenderPending(key, roi) ) {
+        return false;
+    }
+    addPendingRender(key, roi);
+
+    return true;
+}
+
+void
+TrackerFrameAccessorCache::insertImage(const FrameAccessorCacheKey& key,
+                                       const RectI* roi,
+                                       const FloatImagePtr& image,
+                                       const RectI& bounds,
+                                       bool referenced)
+{
+    QMutexLocker k(&_lock);
+
+    if (roi) {
+        for (PendingRenders::iterator it = _pendingRenders.begin(); it != _pendingRenders.end(); ++it) {
+            if ( isSameKey(key, it->key) && (it->roi == *roi) ) {
+                _pendingRenders.erase(it);
+                break;
+            }
+        }
+        _pendingRendersCond.wakeAll();
+    }
+    if (!image) {
+        return;
+    }
+
+    Entry entry;
+    entry.image = image;
+    entry.bounds = bounds;
+    entry.referenceCount = referenced ? 1 : 0;
+    entry.lastUse = ++_useCounter;
+    _entries.insert( std::make_pair(key, entry) );
+    if (!referenced) {
+        _retainedBytes += getImageBytes(bounds);
+        evictUnreferencedImages();
+    }
+}
+
+void
+TrackerFrameAccessorCache::releaseImage(const mv::FloatImage* image)
+{
+    QMutexLocker k(&_lock);
+
+    for (EntryMap::iterator it = _entries.begin(); it != _entries.end(); ++it) {
+        if (it->second.image.get() == image) {
+            assert(it->second.referenceCount);
+            --it->second.referenceCount;
+            if (!it->second.referenceCount) {
+                // Keep the image around: it is likely to be the reference frame of the next track step
+                _retainedBytes += getImageBytes(it->second.bounds);
+                evictUnreferencedImages();
+            }
+
+            return;
+        }
+    }
+}
+
+bool
+TrackerFrameAccessorCache::getImageBounds(const mv::FloatImage* image,
+                                          RectI* bounds) const
+{
+    QMutexLocker k(&_lock);
+
+    for (EntryMap::const_iterator it = _entries.begin(); it != _entries.end(); ++it) {
+        if (it->second.image.get() == image) {
+            *bounds = it->second.bounds;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+TrackerFrameAccessorCache::EndPendingRender_RAII::EndPendingRender_RAII(TrackerFrameAccessorCache* cache,
+                                                                        const FrameAccessorCacheKey& key,
+                                                                        const RectI* roi)
+    : _cache(cache)
+    , _key(key)
+    , _roi()
+    , _hasRoI(roi != 0)
+    , _ended(false)
+{
+    if (roi) {
+        _roi = *roi;
+    }
+}
+
+TrackerFrameAccessorCache::EndPendingRender_RAII::~EndPendingRender_RAII()
+{
+    if (!_ended && _hasRoI) {
+        // Wake up the threads waiting for the render
+        _cache->insertImage( _key, &_roi, FloatImagePtr(), RectI(), false );
+    }
+}
+
+void
+TrackerFrameAccessorCache::EndPendingRender_RAII::insertImage(const FloatImagePtr& image,
+                                                              const RectI& bounds,
+                                                              bool referenced)
+{
+    assert(!_ended);
+    _ended = true;
+    _cache->insertImage(_key, _hasRoI ? &_roi : 0, image, bounds, referenced);
+}
+
+std::size_t
+TrackerFrameAccessorCache::getRetainedBytes() const
+{
+    QMutexLocker k(&_lock);
+
+    return _retainedBytes;
+}
+
+std::size_t
+TrackerFrameAccessorCache::getNumImages() const
+{
+    QMutexLocker k(&_lock);
+
+    return _entries.size();
+}
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,222 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_TrackerFrameAccessorCache_h
+#define Natron_Engine_TrackerFrameAccessorCache_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <list>
+#include <map>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/RectI.h"
+
+#include "Engine/EngineFwd.h"
+
+#include <libmv/autotrack/frame_accessor.h>
+
+// Maximum size of the images kept in the cache once libmv released them
+#define NATRON_TRACKER_FRAME_ACCESSOR_MAX_RETAINED_BYTES (256 * 1024 * 1024)
+
+NATRON_NAMESPACE_ENTER;
+
+struct FrameAccessorCacheKey
+{
+    int frame;
+    int mipMapLevel;
+    mv::FrameAccessor::InputMode mode;
+
+    // Bit i is set if channel i is used in the conversion to a mono image
+    int channelsMask;
+};
+
+struct CacheKey_compare_less
+{
+    bool operator() (const FrameAccessorCacheKey & lhs,
+                     const FrameAccessorCacheKey & rhs) const
+    {
+        if (lhs.frame < rhs.frame) {
+            return true;
+        } else if (lhs.frame > rhs.frame) {
+            return false;
+        } else {
+            if (lhs.mipMapLevel < rhs.mipMapLevel) {
+                return true;
+            } else if (lhs.mipMapLevel > rhs.mipMapLevel) {
+                return false;
+            } else {
+                if ( (int)lhs.mode < (int)rhs.mode ) {
+                    return true;
+                } else if ( (int)lhs.mode > (int)rhs.mode ) {
+                    return false;
+                } else {
+                    return lhs.channelsMask < rhs.channelsMask;
+                }
+            }
+        }
+    }
+};
+
+/**
+ * @brief The mono float images converted for libmv by the TrackerFrameAccessor, shared by the track steps and the
+ * thread prefetching the search windows of the next frames.
+ * An image is found for a key if its bounds enclose the requested region. Images released by libmv are retained,
+ * least recently used first out, up to a memory budget, so that the search frame of a step is found again as the
+ * reference frame of the next one. The regions being rendered are registered so that a thread requesting one of
+ * them waits for the render instead of rendering it a second time.
+ * All functions are thread-safe.
+ **/
+class TrackerFrameAccessorCache
+{
+public:
+
+    typedef boost::shared_ptr<mv::FloatImage> FloatImagePtr;
+
+    explicit TrackerFrameAccessorCache(std::size_t maxRetainedBytes = NATRON_TRACKER_FRAME_ACCESSOR_MAX_RETAINED_BYTES);
+
+    /**
+     * @brief Returns the cached image with the given key whose bounds enclose the roi and references it: it must be
+     * released with releaseImage(). If such an image is being rendered by another thread, waits for it.
+     * Otherwise returns NULL and registers the render of the roi: the caller must then call insertImage() with the
+     * same key and roi.
+     **/
+    mv::FloatImage* acquireImage(const FrameAccessorCacheKey& key, const RectI& roi);
+
+    /**
+     * @brief Returns false if an image with the given key enclosing the roi is cached or being rendered.
+     * Otherwise registers the render of the roi as acquireImage() does and returns true.
+     **/
+    bool beginPrefetch(const FrameAccessorCacheKey& key, const RectI& roi);
+
+    /**
+     * @brief Inserts a rendered image with the given bounds. If roi is not NULL, ends the render of the roi
+     * registered by acquireImage() or beginPrefetch(). If image is NULL (the render failed), only ends the render.
+     * If referenced is true the image must be released with releaseImage(), otherwise it is retained right away.
+     **/
+    void insertImage(const FrameAccessorCacheKey& key,
+                     const RectI* roi,
+                     const FloatImagePtr& image,
+                     const RectI& bounds,
+                     bool referenced);
+
+    /**
+     * @brief Dereferences an image returned by acquireImage() or inserted as referenced. Once no longer referenced,
+     * it is retained and the least recently used images are evicted if the retained images exceed the budget.
+     **/
+    void releaseImage(const mv::FloatImage* image);
+
+    /**
+     * @brief Ends the render of a roi registered by acquireImage() or beginPrefetch() when it goes out of scope, unless
+     * insertImage() was called: if the render throws, the threads waiting for the roi render it themselves instead of
+     * waiting forever. If roi is NULL, no render was registered and only insertImage() does something.
+     **/
+    class EndPendingRender_RAII
+    {
+        TrackerFrameAccessorCache* _cache;
+        FrameAccessorCacheKey _key;
+        RectI _roi;
+        bool _hasRoI;
+        bool _ended;
+
+public:
+
+        EndPendingRender_RAII(TrackerFrameAccessorCache* cache,
+                              const FrameAccessorCacheKey& key,
+                              const RectI* roi);
+
+        ~EndPendingRender_RAII();
+
+        // Same as TrackerFrameAccessorCache::insertImage() with the key and roi of the guard
+        void insertImage(const FloatImagePtr& image,
+                         const RectI& bounds,
+                         bool referenced);
+    };
+
+    bool getImageBounds(const mv::FloatImage* image, RectI* bounds) const;
+
+    // Size in bytes of the images that are no longer referenced
+    std::size_t getRetainedBytes() const;
+
+    std::size_t getNumImages() const;
+
+    static std::size_t getImageBytes(const RectI& bounds)
+    {
+        return bounds.area() * sizeof(float);
+    }
+
+private:
+
+    struct Entry
+    {
+        FloatImagePtr image;
+        RectI bounds;
+        unsigned int referenceCount;
+
+        // Increasing counter of the last access, to evict the least recently used images first
+        U64 lastUse;
+    };
+
+    typedef std::multimap<FrameAccessorCacheKey, Entry, CacheKey_compare_less > EntryMap;
+
+    struct PendingRender
+    {
+        FrameAccessorCacheKey key;
+        RectI roi;
+    };
+
+    typedef std::list<PendingRender> PendingRenders;
+
+    // The functions below expect the mutex to be locked
+    EntryMap::iterator findImage(const FrameAccessorCacheKey& key, const RectI& roi);
+
+    bool isRenderPending(const FrameAccessorCacheKey& key, const RectI& roi) const;
+
+    void addPendingRender(const FrameAccessorCacheKey& key, const RectI& roi);
+
+    void evictUnreferencedImages();
+
+    const std::size_t _maxRetainedBytes;
+
+    // Protects all fields below
+    mutable QMutex _lock;
+    EntryMap _entries;
+    PendingRenders _pendingRenders;
+    QWaitCondition _pendingRendersCond;
+    std::size_t _retainedBytes;
+    U64 _useCounter;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_TrackerFrameAccessorCache_h
@@ -0,0 +1,328 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "TrackerImageConversion.h"
+
+#include <cassert>
+#include <algorithm> // min, max
+
+#ifdef NATRON_HAS_SSE2
+#include <emmintrin.h>
+#include <xmmintrin.h> // _MM_TRANSPOSE4_PS
+#endif
+
+NATRON_NAMESPACE_ENTER;
+
+namespace TrackerImage {
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/////////////////////////// Scalar versions, these are the reference implementations
+
+template <typename PIX, int maxValue, int nComps>
+void
+convertRowToMono_scalar(const PIX* src,
+                        int w,
+                        const LuminanceWeights& weights,
+                        float* dst)
+{
+    // Normalize integer pixels to [0,1] in the same multiply
+    const float wR = weights.r / maxValue;
+    const float wG = weights.g / maxValue;
+    const float wB = weights.b / maxValue;
+
+    for (int x = 0; x < w; ++x, src += nComps) {
+        if (nComps == 1) {
+            dst[x] = src[0] * (wR + wG + wB);
+        } else {
+            dst[x] = src[0] * wR + src[1] * wG + src[2] * wB;
+        }
+    }
+}
+
+// Averages the pixels of src within srcBounds covered by the pixel (x,y) of the downscaled image
+inline float
+downscalePixel(const float* src,
+               const RectI& srcBounds,
+               int x,
+               int y)
+{
+    const int srcW = srcBounds.width();
+    const int sy1 = std::max(2 * y, srcBounds.y1);
+    const int sy2 = std::min(2 * y + 2, srcBounds.y2);
+    const int sx1 = std::max(2 * x, srcBounds.x1);
+    const int sx2 = std::min(2 * x + 2, srcBounds.x2);
+    float sum = 0.f;
+
+    for (int sy = sy1; sy < sy2; ++sy) {
+        const float* row = src + (sy - srcBounds.y1) * srcW - srcBounds.x1;
+        for (int sx = sx1; sx < sx2; ++sx) {
+            sum += row[sx];
+        }
+    }
+
+    return sum / ( (sy2 - sy1) * (sx2 - sx1) );
+}
+
+// Downscales the pixels [x1,x2) of the row y
+void
+downscaleRow_scalar(const float* src,
+                    const RectI& srcBounds,
+                    int y,
+                    int x1,
+                    int x2,
+                    float* dst)
+{
+    for (int x = x1; x < x2; ++x) {
+        dst[x - x1] = downscalePixel(src, srcBounds, x, y);
+    }
+}
+
+/////////////////////////// SSE2 versions, processing 4 pixels per register
+
+#ifdef NATRON_HAS_SSE2
+
+// Widens the 4 components starting at each of the 4 pixels of a block to floats, one pixel per register
+template <int nComps>
+void
+loadPixels_sse2(const float* src,
+                __m128* p)
+{
+    p[0] = _mm_loadu_ps(src);
+    p[1] = _mm_loadu_ps(src + nComps);
+    p[2] = _mm_loadu_ps(src + 2 * nComps);
+    p[3] = _mm_loadu_ps(src + 3 * nComps);
+}
+
+template <int nComps>
+void
+loadPixels_sse2(const unsigned short* src,
+                __m128* p)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    p[0] = _mm_cvtepi32_ps( _mm_unpacklo_epi16(_mm_loadl_epi64( (const __m128i*)src ), zero) );
+    p[1] = _mm_cvtepi32_ps( _mm_unpacklo_epi16(_mm_loadl_epi64( (const __m128i*)(src + nComps) ), zero) );
+    p[2] = _mm_cvtepi32_ps( _mm_unpacklo_epi16(_mm_loadl_epi64( (const __m128i*)(src + 2 * nComps) ), zero) );
+    p[3] = _mm_cvtepi32_ps( _mm_unpacklo_epi16(_mm_loadl_epi64( (const __m128i*)(src + 3 * nComps) ), zero) );
+}
+
+// Widens the 4 low bytes of v
+inline __m128
+widenBytes_sse2(__m128i v)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    return _mm_cvtepi32_ps( _mm_unpacklo_epi16(_mm_unpacklo_epi8(v, zero), zero) );
+}
+
+// A single load of 16 bytes, each pixel being shifted to the low bytes
+template <int nComps>
+void
+loadPixels_sse2(const unsigned char* src,
+                __m128* p)
+{
+    const __m128i v = _mm_loadu_si128( (const __m128i*)src );
+
+    p[0] = widenBytes_sse2(v);
+    p[1] = widenBytes_sse2( _mm_srli_si128(v, nComps) );
+    p[2] = widenBytes_sse2( _mm_srli_si128(v, 2 * nComps) );
+    p[3] = widenBytes_sse2( _mm_srli_si128(v, 3 * nComps) );
+}
+
+// Number of components read by loadPixels_sse2 from the first pixel of a block
+inline int
+getBlockReadSize(const float*,
+                 int nComps)
+{
+    return 3 * nComps + 4;
+}
+
+inline int
+getBlockReadSize(const unsigned short*,
+                 int nComps)
+{
+    return 3 * nComps + 4;
+}
+
+inline int
+getBlockReadSize(const unsigned char*,
+                 int /*nComps*/)
+{
+    return 16;
+}
+
+// RGB and RGBA pixels only
+template <typename PIX, int maxValue, int nComps>
+void
+convertRowToMono_sse2(const PIX* src,
+                      int w,
+                      const LuminanceWeights& weights,
+                      float* dst)
+{
+    assert(nComps == 3 || nComps == 4);
+    // Normalize integer pixels to [0,1] in the same multiply, as the scalar version
+    const __m128 vR = _mm_set1_ps(weights.r / maxValue);
+    const __m128 vG = _mm_set1_ps(weights.g / maxValue);
+    const __m128 vB = _mm_set1_ps(weights.b / maxValue);
+    const int blockReadSize = getBlockReadSize(src, nComps);
+    int x = 0;
+
+    // With RGB pixels (and with 8-bit pixels), the loads of a block read the components of the pixels
+    // following the block, which must be part of the row.
+    for (; (x + 4 <= w) && (x * nComps + blockReadSize <= w * nComps); x += 4, src += 4 * nComps) {
+        __m128 p[4];
+        loadPixels_sse2<nComps>(src, p);
+        _MM_TRANSPOSE4_PS(p[0], p[1], p[2], p[3]);
+        __m128 l = _mm_add_ps( _mm_add_ps( _mm_mul_ps(p[0], vR), _mm_mul_ps(p[1], vG) ), _mm_mul_ps(p[2], vB) );
+        _mm_storeu_ps(dst + x, l);
+    }
+    convertRowToMono_scalar<PIX, maxValue, nComps>(src, w - x, weights, dst + x);
+}
+
+// The pixels covering 2 full rows and 2 full columns of src are computed 4 at once, the others with the scalar version
+void
+downscaleRow_sse2(const float* src,
+                  const RectI& srcBounds,
+                  int y,
+                  int x1,
+                  int x2,
+                  float* dst)
+{
+    if ( (2 * y < srcBounds.y1) || (2 * y + 2 > srcBounds.y2) ) {
+        downscaleRow_scalar(src, srcBounds, y, x1, x2, dst);
+
+        return;
+    }
+    const int srcW = srcBounds.width();
+    const float* row0 = src + (2 * y - srcBounds.y1) * srcW - srcBounds.x1;
+    const float* row1 = row0 + srcW;
+    const __m128 quarter = _mm_set1_ps(0.25f);
+    int x = x1;
+
+    for (; x < x2 && 2 * x < srcBounds.x1; ++x) {
+        dst[x - x1] = downscalePixel(src, srcBounds, x, y);
+    }
+    for (; x + 4 <= x2 && 2 * x + 8 <= srcBounds.x2; x += 4) {
+        __m128 a = _mm_add_ps( _mm_loadu_ps(row0 + 2 * x), _mm_loadu_ps(row1 + 2 * x) );
+        __m128 b = _mm_add_ps( _mm_loadu_ps(row0 + 2 * x + 4), _mm_loadu_ps(row1 + 2 * x + 4) );
+        __m128 even = _mm_shuffle_ps( a, b, _MM_SHUFFLE(2, 0, 2, 0) );
+        __m128 odd = _mm_shuffle_ps( a, b, _MM_SHUFFLE(3, 1, 3, 1) );
+        _mm_storeu_ps( dst + x - x1, _mm_mul_ps(_mm_add_ps(even, odd), quarter) );
+    }
+    downscaleRow_scalar(src, srcBounds, y, x, x2, dst + x - x1);
+}
+
+#endif // NATRON_HAS_SSE2
+
+template <typename PIX, int maxValue>
+void
+convertRowToMonoForDepth(InstructionSetEnum instructionSet,
+                         int nComps,
+                         const PIX* src,
+                         int w,
+                         const LuminanceWeights& weights,
+                         float* dst)
+{
+#ifdef NATRON_HAS_SSE2
+    if ( (nComps >= 3) && (instructionSet >= eInstructionSetSSE2) ) {
+        if (nComps == 4) {
+            convertRowToMono_sse2<PIX, maxValue, 4>(src, w, weights, dst);
+        } else {
+            convertRowToMono_sse2<PIX, maxValue, 3>(src, w, weights, dst);
+        }
+
+        return;
+    }
+#else
+    Q_UNUSED(instructionSet);
+#endif
+    switch (nComps) {
+    case 1:
+        convertRowToMono_scalar<PIX, maxValue, 1>(src, w, weights, dst);
+        break;
+    case 3:
+        convertRowToMono_scalar<PIX, maxValue, 3>(src, w, weights, dst);
+        break;
+    case 4:
+        convertRowToMono_scalar<PIX, maxValue, 4>(src, w, weights, dst);
+        break;
+    default:
+        assert(false);
+        break;
+    }
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+convertRowToMono(InstructionSetEnum instructionSet,
+                 ImageBitDepthEnum bitDepth,
+                 int nComps,
+                 const void* src,
+                 int w,
+                 const LuminanceWeights& weights,
+                 float* dst)
+{
+    switch (bitDepth) {
+    case eImageBitDepthByte:
+        convertRowToMonoForDepth<unsigned char, 255>(instructionSet, nComps, (const unsigned char*)src, w, weights, dst);
+        break;
+    case eImageBitDepthShort:
+        convertRowToMonoForDepth<unsigned short, 65535>(instructionSet, nComps, (const unsigned short*)src, w, weights, dst);
+        break;
+    case eImageBitDepthFloat:
+        convertRowToMonoForDepth<float, 1>(instructionSet, nComps, (const float*)src, w, weights, dst);
+        break;
+    default:
+        assert(false);
+        break;
+    }
+}
+
+void
+downscaleMonoImage(InstructionSetEnum instructionSet,
+                   const float* src,
+                   const RectI& srcBounds,
+                   const RectI& dstBounds,
+                   float* dst)
+{
+    const int dstW = dstBounds.width();
+
+    for (int y = dstBounds.y1; y < dstBounds.y2; ++y, dst += dstW) {
+        switch (instructionSet) {
+#ifdef NATRON_HAS_SSE2
+        case eInstructionSetSSE2:
+        case eInstructionSetAVX2:
+            downscaleRow_sse2(src, srcBounds, y, dstBounds.x1, dstBounds.x2, dst);
+            break;
+#endif
+        default:
+            downscaleRow_scalar(src, srcBounds, y, dstBounds.x1, dstBounds.x2, dst);
+            break;
+        }
+    }
+}
+} // namespace TrackerImage
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,75 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_TrackerImageConversion_h
+#define Natron_Engine_TrackerImageConversion_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+#include "Global/Enums.h"
+#include "Global/CPUFeatures.h"
+
+#include "Engine/RectI.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief Kernels converting the images rendered for the tracker to the mono float images used by libmv, and building
+ * the downscaled levels of these images.
+ * Each kernel has a scalar version and a SSE2 version, the instruction set being selected at runtime by the caller.
+ **/
+namespace TrackerImage {
+// Luminance weights of the enabled channels, taken from DisableChannelsTransform::run in libmv/autotrack/autotrack.cc
+struct LuminanceWeights
+{
+    float r, g, b;
+};
+
+/**
+ * @brief Converts a row of w pixels of nComps (1, 3 or 4) components of the given bit depth to luminance,
+ * normalizing integer pixels to [0,1].
+ **/
+void convertRowToMono(InstructionSetEnum instructionSet,
+                      ImageBitDepthEnum bitDepth,
+                      int nComps,
+                      const void* src,
+                      int w,
+                      const LuminanceWeights& weights,
+                      float* dst);
+
+/**
+ * @brief Downscales a mono image by 2 with a box filter. The pixels outside of srcBounds are ignored.
+ * dstBounds must be srcBounds.downscalePowerOfTwoSmallestEnclosing(1). Rows are contiguous in both images.
+ **/
+void downscaleMonoImage(InstructionSetEnum instructionSet,
+                        const float* src,
+                        const RectI& srcBounds,
+                        const RectI& dstBounds,
+                        float* dst);
+} // namespace TrackerImage
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_TrackerImageConversion_h
@@ -73,6 +73,7 @@ CLANG_DIAG_ON(deprecated)
 #include "Engine/UpdateViewerParams.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/ViewerNode.h"
+#include "Engine/ViewerTextureConversion.h"
 
 
 #ifndef M_LN2
@@ -122,6 +123,7 @@ static void renderFunctor(const RectI& roi,
                           const RenderViewerArgs & args,
                           const ViewerInstancePtr& viewer,
                           UpdateViewerParams::CachedTile tile);
+static ImagePtr convertHalfImageToFloat(const ImagePtr& image);
 
 /**
  *@brief Actually converting to ARGB... but it is called BGRA by
@@ -663,6 +665,80 @@ ViewerInstance::getRenderViewerArgsAndCheckCache_public(SequenceTime time,
     return stat;
 }
 
+ViewerInstance::ViewerRenderRetCode
+ViewerInstance::renderSpeculatively(SequenceTime time,
+                                    ViewIdx view,
+                                    std::size_t* textureBytes)
+{
+    *textureBytes = 0;
+    if ( !getUiContext() ) {
+        return eViewerRenderRetCodeFail;
+    }
+
+    ViewerRenderRetCode ret = eViewerRenderRetCodeRedraw;
+    ViewerNodePtr viewerGroup = getViewerNodeGroup();
+    for (int i = 0; i < 2; ++i) {
+        if ( (i == 1) && (viewerGroup->getCurrentOperator() == eViewerCompositingOperatorNone) ) {
+            break;
+        }
+
+        // The age is taken from the same counter as other renders so that checkAgeNoUpdate() accepts it, but
+        // the display age is never updated: this render can not prevent a more recent render from being displayed
+        AbortableRenderInfoPtr abortInfo = _imp->createNewRenderRequest(i, true);
+        {
+            QMutexLocker k(&_imp->renderAgeMutex);
+            _imp->speculativeRenders.push_back(abortInfo);
+        }
+
+        ViewerArgs args;
+        ViewerRenderRetCode stat = eViewerRenderRetCodeFail;
+        try {
+            stat = getRenderViewerArgsAndCheckCache(time, true /*isSequential*/, view, i, NodePtr(), false, abortInfo, RenderStatsPtr(), &args);
+            if ( (stat == eViewerRenderRetCodeRender) && args.params && !args.params->isViewerPaused &&
+                 ( args.mustComputeRoDAndLookupCache || ( args.params->nbCachedTile < (int)args.params->tiles.size() ) ) ) {
+                stat = renderViewer_internal(view, false /*singleThreaded*/, true /*isSequential*/, NodePtr(), RotoStrokeItemPtr(), false,
+                                             boost::shared_ptr<ViewerCurrentFrameRequestSchedulerStartArgs>(), RenderStatsPtr(), args);
+            }
+        } catch (...) {
+            stat = eViewerRenderRetCodeFail;
+        }
+        args.isRenderingFlag.reset();
+
+        if ( abortInfo->isAborted() ) {
+            stat = eViewerRenderRetCodeRedraw;
+        } else if ( (stat == eViewerRenderRetCodeRender) && args.params && args.useViewerCache && !args.params->isViewerPaused ) {
+            for (std::list<UpdateViewerParams::CachedTile>::const_iterator it = args.params->tiles.begin(); it != args.params->tiles.end(); ++it) {
+                *textureBytes += it->bytesCount;
+            }
+        }
+
+        {
+            QMutexLocker k(&_imp->renderAgeMutex);
+            _imp->speculativeRenders.remove(abortInfo);
+        }
+
+        if (stat == eViewerRenderRetCodeFail) {
+            return eViewerRenderRetCodeFail;
+        } else if ( (stat == eViewerRenderRetCodeRender) && (*textureBytes > 0) ) {
+            ret = eViewerRenderRetCodeRender;
+        } else if ( abortInfo->isAborted() ) {
+            return eViewerRenderRetCodeRedraw;
+        }
+    }
+
+    return ret;
+} // ViewerInstance::renderSpeculatively
+
+void
+ViewerInstance::abortSpeculativeRenders()
+{
+    QMutexLocker k(&_imp->renderAgeMutex);
+
+    for (std::list<AbortableRenderInfoPtr>::iterator it = _imp->speculativeRenders.begin(); it != _imp->speculativeRenders.end(); ++it) {
+        (*it)->setAborted();
+    }
+}
+
 void
 ViewerInstance::setupMinimalUpdateViewerParams(const SequenceTime time,
                                                const ViewIdx view,
@@ -1370,6 +1446,14 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
                     }
                 }
                 assert(colorImage);
+                // The textures are filled from 8 bits, 16 bits and float images, half-float images are converted to float
+                if (colorImage->getBitDepth() == eImageBitDepthHalf) {
+                    bool alphaIsColor = alphaImage == colorImage;
+                    colorImage = convertHalfImageToFloat(colorImage);
+                    alphaImage = alphaIsColor ? colorImage : convertHalfImageToFloat(alphaImage);
+                } else if (alphaImage) {
+                    alphaImage = convertHalfImageToFloat(alphaImage);
+                }
                 inArgs.params->colorImage = colorImage;
             }
             if (!colorImage) {
@@ -1811,6 +1895,19 @@ renderFunctor(const RectI& roi,
     }
 }
 
+ImagePtr
+convertHalfImageToFloat(const ImagePtr& image)
+{
+    if ( !image || (image->getBitDepth() != eImageBitDepthHalf) ) {
+        return image;
+    }
+    ImagePtr floatImage( new Image( image->getComponents(), image->getRoD(), image->getBounds(), image->getMipMapLevel(), image->getPixelAspectRatio(),
+                                    eImageBitDepthFloat, image->getPremultiplication(), image->getFieldingOrder() ) );
+    image->convertToFormat(image->getBounds(), eViewerColorSpaceLinear, eViewerColorSpaceLinear, -1, false, false, floatImage.get() );
+
+    return floatImage;
+}
+
 inline
 MinMaxVal
 findAutoContrastVminVmax_generic(boost::shared_ptr<const Image> inputImage,
@@ -1969,12 +2066,28 @@ scaleToTexture8bits_generic(const RectI& roi,
         matteAcc.reset( new Image::ReadAccess( args.matteImage.get() ) );
     }
 
+    // The most common case, a RGBA float image in linear displayed with a gamma of 1, is converted with SIMD row kernels
+    const bool useRowKernel = (pixelSize == sizeof(float)) && (nComps == 4) && (rOffset == 0) && (gOffset == 1) && (bOffset == 2) &&
+                              !applyMatte && !luminance && !args.srcColorSpace && (args.gamma == 1.);
+    const InstructionSetEnum instructionSet = getBestInstructionSet();
+    std::vector<float> rowScratch;
+    if (useRowKernel && args.colorSpace) {
+        rowScratch.resize( (x2 - x1) * 4 );
+    }
+
     for (int y = y1; y < y2;
          ++y,
          dst_pixels += dstRowElements) {
         // coverity[dont_call]
         int start = (int)( rand() % (x2 - x1) );
 
+        if (useRowKernel && src_pixels) {
+            ViewerTexture::convertRGBAFloatRowTo8Bits(instructionSet, (const float*)src_pixels, x2 - x1, start, args.gain, args.offset, opaque,
+                                                      args.colorSpace, rowScratch.empty() ? 0 : &rowScratch[0], dst_pixels);
+            src_pixels += srcRowElements;
+            continue;
+        }
+
 
         for (int backward = 0; backward < 2; ++backward) {
             int index = backward ? start - 1 : start;
@@ -2348,6 +2461,11 @@ ViewerInstance::markAllOnGoingRendersAsAborted(bool keepOldestRender)
             (*it)->setAborted();
         }
     }
+
+    // Renders ahead of the current frame are never worth keeping when the user interacts
+    for (std::list<AbortableRenderInfoPtr>::iterator it = _imp->speculativeRenders.begin(); it != _imp->speculativeRenders.end(); ++it) {
+        (*it)->setAborted();
+    }
 }
 
 template <typename PIX, int maxValue, bool opaque, bool applyMatte, int rOffset, int gOffset, int bOffset>
@@ -2385,9 +2503,19 @@ scaleToTexture32bitsGeneric(const RectI& roi,
     const float* src_pixels = (const float*)acc.pixelAt(x1, y1);
     const int srcRowElements = (const int)args.inputImage->getRowElements();
 
+    // The most common case, a RGBA float image in linear, is converted with SIMD row kernels
+    const bool useRowKernel = (pixelSize == sizeof(float)) && (nComps == 4) && (rOffset == 0) && (gOffset == 1) && (bOffset == 2) &&
+                              !applyMatte && !luminance && !args.srcColorSpace;
+    const InstructionSetEnum instructionSet = getBestInstructionSet();
+
     for (int y = y1; y < y2;
          ++y,
          dst_pixels += dstRowElements) {
+        if (useRowKernel && src_pixels) {
+            ViewerTexture::convertRGBAFloatRowTo32Bits(instructionSet, src_pixels, x2 - x1, opaque, dst_pixels);
+            src_pixels += srcRowElements;
+            continue;
+        }
         for (int x = 0; x < (x2 - x1);
              ++x) {
             double r = 0.;
@@ -127,6 +127,23 @@ public:
                                                                 const RenderStatsPtr& stats,
                                                                 ViewerArgs* outArgs);
 
+    /**
+     * @brief Renders the given frame into the viewer cache (and the node caches upstream) without displaying it,
+     * with the same parameters as playback, so that a later playback of this frame does not need to render it.
+     * This is abortable with abortSpeculativeRenders() and never updates the display ages of the viewer textures.
+     * @param textureBytes[out] The size of the textures of the frame in the viewer cache, whether they were already cached or rendered
+     * @returns eViewerRenderRetCodeRender if the frame is now cached, eViewerRenderRetCodeFail if the render failed,
+     * eViewerRenderRetCodeRedraw if it was aborted or if there is nothing to cache.
+     **/
+    ViewerRenderRetCode renderSpeculatively(SequenceTime time,
+                                            ViewIdx view,
+                                            std::size_t* textureBytes);
+
+    /**
+     * @brief Aborts all renders started by renderSpeculatively(). This is not blocking.
+     **/
+    void abortSpeculativeRenders();
+
 private:
     /**
      * @brief Look-up the cache and try to find a matching texture for the portion to render.
@@ -142,6 +142,8 @@ public:
         , renderAgeMutex()
         , renderAge()
         , displayAge()
+        , currentRenderAges()
+        , speculativeRenders()
     {
         for (int i = 0; i < 2; ++i) {
             forceRender[i] = false;
@@ -382,6 +384,8 @@ public:
     //The purpose of this is to always at least keep 1 active render (non abortable) and abort more recent renders that do no longer make sense
     OnGoingRenders currentRenderAges[2];
 
+    // Renders started by renderSpeculatively(), protected by renderAgeMutex
+    std::list<AbortableRenderInfoPtr> speculativeRenders;
 };
 
 NATRON_NAMESPACE_EXIT;
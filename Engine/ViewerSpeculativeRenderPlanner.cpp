@@ -0,0 +1,155 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ViewerSpeculativeRenderPlanner.h"
+
+#include <algorithm> // max
+
+NATRON_NAMESPACE_ENTER;
+
+ViewerSpeculativeRenderFrames::ViewerSpeculativeRenderFrames(int time,
+                                                             bool forward,
+                                                             int firstFrame,
+                                                             int lastFrame,
+                                                             int maxFrames,
+                                                             std::size_t maxBytes)
+    : _firstStep(forward ? 1 : -1)
+    , _firstFrame(firstFrame)
+    , _lastFrame(lastFrame)
+    , _maxFrames(maxFrames)
+    , _maxBytes(maxBytes)
+    , _side(0)
+    , _nFrames(0)
+    , _bytes(0)
+    , _aborted()
+{
+    _nextFrame[0] = time + _firstStep;
+    _nextFrame[1] = time - _firstStep;
+    _sideDone[0] = _sideDone[1] = false;
+}
+
+bool
+ViewerSpeculativeRenderFrames::getNextFrame(int* frame)
+{
+    while ( !isAborted() && (_nFrames < _maxFrames) && (_bytes < _maxBytes) && ( !_sideDone[0] || !_sideDone[1] ) ) {
+        if (_sideDone[_side]) {
+            _side = 1 - _side;
+            continue;
+        }
+        const int next = _nextFrame[_side];
+        _nextFrame[_side] += _side == 0 ? _firstStep : -_firstStep;
+        if ( (next < _firstFrame) || (next > _lastFrame) ) {
+            _sideDone[_side] = true;
+            continue;
+        }
+        _side = 1 - _side;
+        *frame = next;
+
+        return true;
+    }
+
+    return false;
+}
+
+void
+ViewerSpeculativeRenderFrames::notifyFrameRendered(std::size_t bytes)
+{
+    ++_nFrames;
+    _bytes += bytes;
+}
+
+void
+ViewerSpeculativeRenderFrames::abort()
+{
+    _aborted.fetchAndStoreRelaxed(1);
+}
+
+bool
+ViewerSpeculativeRenderFrames::isAborted() const
+{
+    return (int)_aborted != 0;
+}
+
+ViewerSpeculativeRenderPlanner::ViewerSpeculativeRenderPlanner()
+    : _lock()
+    , _frameDisplayed(false)
+    , _frameDisplayTime(0.)
+    , _current()
+{
+}
+
+void
+ViewerSpeculativeRenderPlanner::notifyFrameDisplayed(double time)
+{
+    QMutexLocker k(&_lock);
+
+    _frameDisplayed = true;
+    _frameDisplayTime = time;
+}
+
+void
+ViewerSpeculativeRenderPlanner::notifyUserInteraction()
+{
+    QMutexLocker k(&_lock);
+
+    _frameDisplayed = false;
+    if (_current) {
+        _current->abort();
+        _current.reset();
+    }
+}
+
+double
+ViewerSpeculativeRenderPlanner::getRemainingIdleTime(double time) const
+{
+    QMutexLocker k(&_lock);
+
+    if (!_frameDisplayed) {
+        return -1.;
+    }
+
+    return std::max(0., _frameDisplayTime + NATRON_VIEWER_SPECULATIVE_RENDER_IDLE_DELAY_MS / 1000. - time);
+}
+
+ViewerSpeculativeRenderFramesPtr
+ViewerSpeculativeRenderPlanner::start(int time,
+                                      bool forward,
+                                      int firstFrame,
+                                      int lastFrame,
+                                      int maxFrames,
+                                      std::size_t maxBytes)
+{
+    QMutexLocker k(&_lock);
+
+    if (_current) {
+        _current->abort();
+    }
+    _current.reset( new ViewerSpeculativeRenderFrames(time, forward, firstFrame, lastFrame, maxFrames, maxBytes) );
+    // Render ahead once per displayed frame
+    _frameDisplayed = false;
+
+    return _current;
+}
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,160 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_ViewerSpeculativeRenderPlanner_h
+#define Natron_Engine_ViewerSpeculativeRenderPlanner_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+
+// How long the viewer must stay idle after displaying a frame before frames around it are rendered ahead
+#define NATRON_VIEWER_SPECULATIVE_RENDER_IDLE_DELAY_MS 300
+
+// Fraction of the viewer cache that frames rendered ahead may fill
+#define NATRON_VIEWER_SPECULATIVE_RENDER_CACHE_FRACTION 0.5
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief The frames rendered ahead by one speculative render of the viewer: the frames on both sides of the current
+ * frame, alternately, starting in the direction of the last playback. A side is abandoned as soon as it reaches the
+ * timeline bounds. No frame is returned anymore once the maximum number of frames is rendered, once the rendered
+ * textures fill the cache budget or once aborted.
+ * Only abort() and isAborted() may be called from another thread than the one rendering the frames.
+ **/
+class ViewerSpeculativeRenderFrames
+{
+public:
+
+    ViewerSpeculativeRenderFrames(int time,
+                                  bool forward,
+                                  int firstFrame,
+                                  int lastFrame,
+                                  int maxFrames,
+                                  std::size_t maxBytes);
+
+    /**
+     * @brief Returns false if there is no frame to render anymore
+     **/
+    bool getNextFrame(int* frame);
+
+    /**
+     * @brief Call once a frame returned by getNextFrame() is rendered, with the size of its texture in the viewer cache
+     **/
+    void notifyFrameRendered(std::size_t bytes);
+
+    void abort();
+
+    bool isAborted() const;
+
+    int getNFramesRendered() const
+    {
+        return _nFrames;
+    }
+
+    std::size_t getBytesRendered() const
+    {
+        return _bytes;
+    }
+
+private:
+
+    const int _firstStep;
+    const int _firstFrame, _lastFrame;
+    const int _maxFrames;
+    const std::size_t _maxBytes;
+
+    // The next frame of each side, the first side being the direction of the last playback
+    int _nextFrame[2];
+    bool _sideDone[2];
+    int _side;
+    int _nFrames;
+    std::size_t _bytes;
+    QAtomicInt _aborted;
+};
+
+typedef boost::shared_ptr<ViewerSpeculativeRenderFrames> ViewerSpeculativeRenderFramesPtr;
+
+/**
+ * @brief Decides when the viewer is idle enough to render frames ahead: once it displayed a frame and the user did not
+ * interact for NATRON_VIEWER_SPECULATIVE_RENDER_IDLE_DELAY_MS. Frames are rendered ahead once per displayed frame, and
+ * any user interaction aborts the frames being rendered ahead.
+ * Times are in seconds since any origin.
+ **/
+class ViewerSpeculativeRenderPlanner
+{
+public:
+
+    ViewerSpeculativeRenderPlanner();
+
+    /**
+     * @brief Call when the viewer displayed a frame it rendered for the user
+     **/
+    void notifyFrameDisplayed(double time);
+
+    /**
+     * @brief Call when the user interacts with the viewer or starts a render: aborts the frames being rendered ahead
+     * and waits for the next displayed frame.
+     **/
+    void notifyUserInteraction();
+
+    /**
+     * @brief Returns how long in seconds the viewer must still stay idle before frames can be rendered ahead:
+     * 0 if they can be rendered now, a negative value if no frame was displayed since the last interaction or
+     * since frames were last rendered ahead.
+     **/
+    double getRemainingIdleTime(double time) const;
+
+    /**
+     * @brief Starts rendering frames ahead, aborting the previous ones. The viewer must be idle.
+     **/
+    ViewerSpeculativeRenderFramesPtr start(int time,
+                                           bool forward,
+                                           int firstFrame,
+                                           int lastFrame,
+                                           int maxFrames,
+                                           std::size_t maxBytes);
+
+private:
+
+    // Protects all fields below
+    mutable QMutex _lock;
+
+    // Whether a frame was displayed since the last interaction or speculative render
+    bool _frameDisplayed;
+    double _frameDisplayTime;
+    ViewerSpeculativeRenderFramesPtr _current;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_ViewerSpeculativeRenderPlanner_h
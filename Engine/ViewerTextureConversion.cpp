@@ -0,0 +1,414 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ViewerTextureConversion.h"
+
+#include <cassert>
+#include <algorithm> // min, max
+
+#include "Global/CPUFeatures.h"
+
+#ifdef NATRON_HAS_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef NATRON_HAS_AVX2
+#include <immintrin.h>
+#endif
+
+#include "Engine/Lut.h"
+
+NATRON_NAMESPACE_ENTER;
+
+namespace ViewerTexture {
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/**
+ *@brief Actually converting to ARGB... but it is called BGRA by
+   the texture format GL_UNSIGNED_INT_8_8_8_8_REV
+ **/
+inline U32
+toBGRA(unsigned char r,
+       unsigned char g,
+       unsigned char b,
+       unsigned char a)
+{
+    return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+/////////////////////////// Scalar versions, these are the reference implementations
+
+void
+scaleRGBARow_scalar(const float* src,
+                    int W,
+                    double gain,
+                    double offset,
+                    bool opaque,
+                    float* dst)
+{
+    for (int x = 0; x < W; ++x, src += 4, dst += 4) {
+        dst[0] = src[0] * gain + offset;
+        dst[1] = src[1] * gain + offset;
+        dst[2] = src[2] * gain + offset;
+        dst[3] = opaque ? 1.f : src[3];
+    }
+}
+
+void
+quantizeRGBARow_scalar(const float* src,
+                       int W,
+                       double gain,
+                       double offset,
+                       bool opaque,
+                       U32* dst)
+{
+    for (int x = 0; x < W; ++x, src += 4) {
+        U8 uR = Color::floatToInt<256>(src[0] * gain + offset);
+        U8 uG = Color::floatToInt<256>(src[1] * gain + offset);
+        U8 uB = Color::floatToInt<256>(src[2] * gain + offset);
+        U8 uA = opaque ? 255 : Color::floatToInt<256>(src[3]);
+        dst[x] = toBGRA(uR, uG, uB, uA);
+    }
+}
+
+void
+clampRGBARow_scalar(const float* src,
+                    int W,
+                    bool opaque,
+                    float* dst)
+{
+    for (int x = 0; x < W; ++x, src += 4, dst += 4) {
+        for (int c = 0; c < 3; ++c) {
+            dst[c] = std::max( 0.f, std::min(src[c], 1.f) );
+        }
+        dst[3] = opaque ? 1.f : std::max( 0.f, std::min(src[3], 1.f) );
+    }
+}
+
+/////////////////////////// SSE2 versions, processing one pixel per register
+
+#ifdef NATRON_HAS_SSE2
+
+void
+scaleRGBARow_sse2(const float* src,
+                  int W,
+                  double gain,
+                  double offset,
+                  bool opaque,
+                  float* dst)
+{
+    const __m128 vGain = _mm_setr_ps( (float)gain, (float)gain, (float)gain, 1.f );
+    const __m128 vOffset = _mm_setr_ps( (float)offset, (float)offset, (float)offset, 0.f );
+    const __m128 vOpaque = opaque ? _mm_setr_ps(0.f, 0.f, 0.f, 1.f) : _mm_setzero_ps();
+    const __m128 keepMask = opaque ? _mm_castsi128_ps( _mm_setr_epi32(-1, -1, -1, 0) ) : _mm_castsi128_ps( _mm_set1_epi32(-1) );
+
+    for (int x = 0; x < W; ++x, src += 4, dst += 4) {
+        __m128 p = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src), vGain), vOffset);
+        p = _mm_or_ps(_mm_and_ps(p, keepMask), vOpaque);
+        _mm_storeu_ps(dst, p);
+    }
+}
+
+// Returns the 4 channels of one pixel converted with Color::floatToInt<256>() and reordered as BGRA
+inline __m128i
+quantizeToBGRA_sse2(__m128 p)
+{
+    // max() returns its second operand if one of them is NaN
+    p = _mm_min_ps(_mm_max_ps( p, _mm_setzero_ps() ), _mm_set1_ps(1.f) );
+    p = _mm_add_ps( _mm_mul_ps( p, _mm_set1_ps(255.f) ), _mm_set1_ps(0.5f) );
+    p = _mm_shuffle_ps( p, p, _MM_SHUFFLE(3, 0, 1, 2) );
+
+    return _mm_cvttps_epi32(p);
+}
+
+void
+quantizeRGBARow_sse2(const float* src,
+                     int W,
+                     double gain,
+                     double offset,
+                     bool opaque,
+                     U32* dst)
+{
+    const __m128 vGain = _mm_setr_ps( (float)gain, (float)gain, (float)gain, 1.f );
+    const __m128 vOffset = _mm_setr_ps( (float)offset, (float)offset, (float)offset, 0.f );
+    const __m128 vOpaque = opaque ? _mm_setr_ps(0.f, 0.f, 0.f, 1.f) : _mm_setzero_ps();
+    const __m128 keepMask = opaque ? _mm_castsi128_ps( _mm_setr_epi32(-1, -1, -1, 0) ) : _mm_castsi128_ps( _mm_set1_epi32(-1) );
+    int x = 0;
+
+    for (; x + 4 <= W; x += 4, src += 16) {
+        __m128i q[4];
+        for (int i = 0; i < 4; ++i) {
+            __m128 p = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i * 4), vGain), vOffset);
+            p = _mm_or_ps(_mm_and_ps(p, keepMask), vOpaque);
+            q[i] = quantizeToBGRA_sse2(p);
+        }
+        __m128i packed = _mm_packus_epi16( _mm_packs_epi32(q[0], q[1]), _mm_packs_epi32(q[2], q[3]) );
+        _mm_storeu_si128( (__m128i*)(dst + x), packed );
+    }
+    quantizeRGBARow_scalar(src, W - x, gain, offset, opaque, dst + x);
+}
+
+void
+clampRGBARow_sse2(const float* src,
+                  int W,
+                  bool opaque,
+                  float* dst)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 vOpaque = opaque ? _mm_setr_ps(0.f, 0.f, 0.f, 1.f) : _mm_setzero_ps();
+    const __m128 keepMask = opaque ? _mm_castsi128_ps( _mm_setr_epi32(-1, -1, -1, 0) ) : _mm_castsi128_ps( _mm_set1_epi32(-1) );
+
+    for (int x = 0; x < W; ++x, src += 4, dst += 4) {
+        __m128 p = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src), zero), one);
+        p = _mm_or_ps(_mm_and_ps(p, keepMask), vOpaque);
+        _mm_storeu_ps(dst, p);
+    }
+}
+
+#endif // NATRON_HAS_SSE2
+
+/////////////////////////// AVX2 versions, processing two pixels per register
+
+#ifdef NATRON_HAS_AVX2
+
+NATRON_TARGET_AVX2
+void
+scaleRGBARow_avx2(const float* src,
+                  int W,
+                  double gain,
+                  double offset,
+                  bool opaque,
+                  float* dst)
+{
+    const float g = (float)gain;
+    const float o = (float)offset;
+    const __m256 vGain = _mm256_setr_ps(g, g, g, 1.f, g, g, g, 1.f);
+    const __m256 vOffset = _mm256_setr_ps(o, o, o, 0.f, o, o, o, 0.f);
+    const __m256 vOpaque = opaque ? _mm256_setr_ps(0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f) : _mm256_setzero_ps();
+    const __m256 keepMask = opaque ? _mm256_castsi256_ps( _mm256_setr_epi32(-1, -1, -1, 0, -1, -1, -1, 0) ) : _mm256_castsi256_ps( _mm256_set1_epi32(-1) );
+    int x = 0;
+
+    for (; x + 2 <= W; x += 2, src += 8, dst += 8) {
+        __m256 p = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src), vGain), vOffset);
+        p = _mm256_or_ps(_mm256_and_ps(p, keepMask), vOpaque);
+        _mm256_storeu_ps(dst, p);
+    }
+    scaleRGBARow_sse2(src, W - x, gain, offset, opaque, dst);
+}
+
+NATRON_TARGET_AVX2
+void
+quantizeRGBARow_avx2(const float* src,
+                     int W,
+                     double gain,
+                     double offset,
+                     bool opaque,
+                     U32* dst)
+{
+    const float g = (float)gain;
+    const float o = (float)offset;
+    const __m256 vGain = _mm256_setr_ps(g, g, g, 1.f, g, g, g, 1.f);
+    const __m256 vOffset = _mm256_setr_ps(o, o, o, 0.f, o, o, o, 0.f);
+    const __m256 vOpaque = opaque ? _mm256_setr_ps(0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f) : _mm256_setzero_ps();
+    const __m256 keepMask = opaque ? _mm256_castsi256_ps( _mm256_setr_epi32(-1, -1, -1, 0, -1, -1, -1, 0) ) : _mm256_castsi256_ps( _mm256_set1_epi32(-1) );
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.f);
+    const __m256 scale = _mm256_set1_ps(255.f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    // The packs below interleave the 128-bit lanes: the first lane holds pixels 0,2,4,6 and the second one pixels 1,3,5,7
+    const __m256i unshuffle = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    int x = 0;
+
+    for (; x + 8 <= W; x += 8, src += 32) {
+        __m256i q[4];
+        for (int i = 0; i < 4; ++i) {
+            __m256 p = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i * 8), vGain), vOffset);
+            p = _mm256_or_ps(_mm256_and_ps(p, keepMask), vOpaque);
+            p = _mm256_min_ps(_mm256_max_ps(p, zero), one);
+            p = _mm256_add_ps(_mm256_mul_ps(p, scale), half);
+            p = _mm256_permute_ps( p, _MM_SHUFFLE(3, 0, 1, 2) );
+            q[i] = _mm256_cvttps_epi32(p);
+        }
+        __m256i packed = _mm256_packus_epi16( _mm256_packs_epi32(q[0], q[1]), _mm256_packs_epi32(q[2], q[3]) );
+        packed = _mm256_permutevar8x32_epi32(packed, unshuffle);
+        _mm256_storeu_si256( (__m256i*)(dst + x), packed );
+    }
+    quantizeRGBARow_sse2(src, W - x, gain, offset, opaque, dst + x);
+}
+
+NATRON_TARGET_AVX2
+void
+clampRGBARow_avx2(const float* src,
+                  int W,
+                  bool opaque,
+                  float* dst)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.f);
+    const __m256 vOpaque = opaque ? _mm256_setr_ps(0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f) : _mm256_setzero_ps();
+    const __m256 keepMask = opaque ? _mm256_castsi256_ps( _mm256_setr_epi32(-1, -1, -1, 0, -1, -1, -1, 0) ) : _mm256_castsi256_ps( _mm256_set1_epi32(-1) );
+    int x = 0;
+
+    for (; x + 2 <= W; x += 2, src += 8, dst += 8) {
+        __m256 p = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src), zero), one);
+        p = _mm256_or_ps(_mm256_and_ps(p, keepMask), vOpaque);
+        _mm256_storeu_ps(dst, p);
+    }
+    clampRGBARow_sse2(src, W - x, opaque, dst);
+}
+
+#endif // NATRON_HAS_AVX2
+
+void
+scaleRGBARow(InstructionSetEnum instructionSet,
+             const float* src,
+             int W,
+             double gain,
+             double offset,
+             bool opaque,
+             float* dst)
+{
+    switch (instructionSet) {
+#ifdef NATRON_HAS_AVX2
+    case eInstructionSetAVX2:
+        scaleRGBARow_avx2(src, W, gain, offset, opaque, dst);
+        break;
+#endif
+#ifdef NATRON_HAS_SSE2
+    case eInstructionSetSSE2:
+        scaleRGBARow_sse2(src, W, gain, offset, opaque, dst);
+        break;
+#endif
+    default:
+        scaleRGBARow_scalar(src, W, gain, offset, opaque, dst);
+        break;
+    }
+}
+
+void
+quantizeRGBARow(InstructionSetEnum instructionSet,
+                const float* src,
+                int W,
+                double gain,
+                double offset,
+                bool opaque,
+                U32* dst)
+{
+    switch (instructionSet) {
+#ifdef NATRON_HAS_AVX2
+    case eInstructionSetAVX2:
+        quantizeRGBARow_avx2(src, W, gain, offset, opaque, dst);
+        break;
+#endif
+#ifdef NATRON_HAS_SSE2
+    case eInstructionSetSSE2:
+        quantizeRGBARow_sse2(src, W, gain, offset, opaque, dst);
+        break;
+#endif
+    default:
+        quantizeRGBARow_scalar(src, W, gain, offset, opaque, dst);
+        break;
+    }
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+void
+convertRGBAFloatRowTo8Bits(InstructionSetEnum instructionSet,
+                           const float* src,
+                           int W,
+                           int ditherStart,
+                           double gain,
+                           double offset,
+                           bool opaque,
+                           const Color::Lut* colorSpace,
+                           float* scratch,
+                           U32* dst)
+{
+    if (W <= 0) {
+        return;
+    }
+    if (!colorSpace) {
+        quantizeRGBARow(instructionSet, src, W, gain, offset, opaque, dst);
+
+        return;
+    }
+
+    // The color-space conversion is a table look-up and the error diffusion is sequential:
+    // only apply the gain and offset with SIMD, then look-up and dither the row.
+    // With SSE2 the extra pass over the row costs more than it saves: use the scalar version.
+    assert(scratch);
+    assert(ditherStart >= 0 && ditherStart < W);
+    scaleRGBARow(instructionSet == eInstructionSetSSE2 ? eInstructionSetScalar : instructionSet, src, W, gain, offset, opaque, scratch);
+
+    for (int backward = 0; backward < 2; ++backward) {
+        int index = backward ? ditherStart - 1 : ditherStart;
+        unsigned error_r = 0x80;
+        unsigned error_g = 0x80;
+        unsigned error_b = 0x80;
+
+        while (index < W && index >= 0) {
+            const float* p = scratch + index * 4;
+            error_r = (error_r & 0xff) + colorSpace->toColorSpaceUint8xxFromLinearFloatFast(p[0]);
+            error_g = (error_g & 0xff) + colorSpace->toColorSpaceUint8xxFromLinearFloatFast(p[1]);
+            error_b = (error_b & 0xff) + colorSpace->toColorSpaceUint8xxFromLinearFloatFast(p[2]);
+            assert(error_r < 0x10000 && error_g < 0x10000 && error_b < 0x10000);
+            U8 uA = opaque ? 255 : Color::floatToInt<256>(p[3]);
+            dst[index] = toBGRA( (U8)(error_r >> 8), (U8)(error_g >> 8), (U8)(error_b >> 8), uA );
+
+            if (backward) {
+                --index;
+            } else {
+                ++index;
+            }
+        }
+    }
+}
+
+void
+convertRGBAFloatRowTo32Bits(InstructionSetEnum instructionSet,
+                            const float* src,
+                            int W,
+                            bool opaque,
+                            float* dst)
+{
+    switch (instructionSet) {
+#ifdef NATRON_HAS_AVX2
+    case eInstructionSetAVX2:
+        clampRGBARow_avx2(src, W, opaque, dst);
+        break;
+#endif
+#ifdef NATRON_HAS_SSE2
+    case eInstructionSetSSE2:
+        clampRGBARow_sse2(src, W, opaque, dst);
+        break;
+#endif
+    default:
+        clampRGBARow_scalar(src, W, opaque, dst);
+        break;
+    }
+}
+} // namespace ViewerTexture
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,75 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef Natron_Engine_ViewerTextureConversion_h
+#define Natron_Engine_ViewerTextureConversion_h
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+#include "Global/CPUFeatures.h"
+
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief Row kernels converting RGBA float images to the textures uploaded by the viewer, for the most common case
+ * handled by scaleToTexture8bits and scaleToTexture32bits in ViewerInstance.cpp: a 4-components float image in
+ * linear, displaying the RGB channels with a gamma of 1.
+ * Each kernel has a scalar version and SIMD versions, the best one supported by the CPU being selected at runtime.
+ **/
+namespace ViewerTexture {
+/**
+ * @brief Converts a row of W packed RGBA float pixels to 8-bit BGRA texels (GL_UNSIGNED_INT_8_8_8_8_REV), applying
+ * gain * x + offset to the R, G and B channels, then converting them to the given color-space.
+ * If colorSpace is NULL, values are only clamped and quantized. Otherwise the quantization error is diffused along the row,
+ * starting at ditherStart and going right, then left, exactly like scaleToTexture8bits_generic.
+ * If opaque is true, the alpha channel of the source is ignored and the texels are opaque.
+ * @param scratch A buffer of at least 4 * W floats, only used if colorSpace is not NULL
+ **/
+void convertRGBAFloatRowTo8Bits(InstructionSetEnum instructionSet,
+                                const float* src,
+                                int W,
+                                int ditherStart,
+                                double gain,
+                                double offset,
+                                bool opaque,
+                                const Color::Lut* colorSpace,
+                                float* scratch,
+                                U32* dst);
+
+/**
+ * @brief Converts a row of W packed RGBA float pixels to RGBA float texels clamped to [0,1].
+ * If opaque is true, the alpha channel of the source is ignored and the texels are opaque.
+ **/
+void convertRGBAFloatRowTo32Bits(InstructionSetEnum instructionSet,
+                                 const float* src,
+                                 int W,
+                                 bool opaque,
+                                 float* dst);
+} // namespace ViewerTexture
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // Natron_Engine_ViewerTextureConversion_h
@@ -0,0 +1,175 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_GLOBAL_CPUFEATURES_H
+#define NATRON_GLOBAL_CPUFEATURES_H
+
+// CPU features detection, used to select SIMD code paths at runtime
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#  define NATRON_CPU_X86
+#endif
+
+// SSE2 is part of the x86-64 baseline, so code using it may be compiled unconditionally on these targets
+#if defined(NATRON_CPU_X86) && ( defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) )
+#  define NATRON_HAS_SSE2
+#endif
+
+// AVX2 functions are compiled with a target attribute and must only be called if cpuHasAVX2() returns true
+#if defined(NATRON_HAS_SSE2) && ( defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER) )
+#  define NATRON_HAS_AVX2
+#  if defined(__GNUC__) || defined(__clang__)
+#    define NATRON_TARGET_AVX2 __attribute__( ( target("avx2") ) )
+#    define NATRON_TARGET_F16C __attribute__( ( target("avx2,f16c") ) )
+#  else
+#    define NATRON_TARGET_AVX2
+#    define NATRON_TARGET_F16C
+#  endif
+#endif
+
+#if defined(NATRON_HAS_AVX2) && defined(_MSC_VER)
+#  include <intrin.h>
+#  include <immintrin.h>
+#elif defined(NATRON_HAS_AVX2)
+#  include <cpuid.h>
+#endif
+
+#include "Global/Macros.h"
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief Returns true if the CPU and the OS support AVX2 instructions.
+ **/
+inline bool
+cpuHasAVX2()
+{
+#if !defined(NATRON_HAS_AVX2)
+
+    return false;
+#elif defined(_MSC_VER)
+    static int hasAVX2 = -1;
+    if (hasAVX2 == -1) {
+        int info[4];
+        __cpuid(info, 0);
+        bool ok = info[0] >= 7;
+        if (ok) {
+            __cpuid(info, 1);
+            // OSXSAVE and AVX, then check that the OS saves the YMM registers
+            ok = ( (info[2] & (1 << 27)) != 0 ) && ( (info[2] & (1 << 28)) != 0 ) && ( (_xgetbv(0) & 6) == 6 );
+        }
+        if (ok) {
+            __cpuidex(info, 7, 0);
+            ok = (info[1] & (1 << 5)) != 0;
+        }
+        hasAVX2 = ok ? 1 : 0;
+    }
+
+    return hasAVX2 == 1;
+#else
+    static int hasAVX2 = -1;
+    if (hasAVX2 == -1) {
+        __builtin_cpu_init();
+        hasAVX2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+
+    return hasAVX2 == 1;
+#endif
+}
+
+/**
+ * @brief Returns true if the CPU supports the F16C half-float conversion instructions in addition to AVX2.
+ * Functions marked with NATRON_TARGET_F16C must only be called if this returns true.
+ **/
+inline bool
+cpuHasF16C()
+{
+#if !defined(NATRON_HAS_AVX2)
+
+    return false;
+#else
+    static int hasF16C = -1;
+    if (hasF16C == -1) {
+        bool ok = cpuHasAVX2();
+        if (ok) {
+#  if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            ok = (info[2] & (1 << 29)) != 0;
+#  else
+            unsigned int eax, ebx, ecx, edx;
+            ok = __get_cpuid(1, &eax, &ebx, &ecx, &edx) && ( (ecx & (1 << 29)) != 0 );
+#  endif
+        }
+        hasF16C = ok ? 1 : 0;
+    }
+
+    return hasF16C == 1;
+#endif
+}
+
+/**
+ * @brief The instruction sets for which SIMD code paths are written, from the narrowest to the widest.
+ **/
+enum InstructionSetEnum
+{
+    eInstructionSetScalar = 0,
+    eInstructionSetSSE2,
+    eInstructionSetAVX2
+};
+
+/**
+ * @brief Returns the widest instruction set supported by both the build and the CPU.
+ **/
+inline InstructionSetEnum
+getBestInstructionSet()
+{
+#ifdef NATRON_HAS_AVX2
+    if ( cpuHasAVX2() ) {
+        return eInstructionSetAVX2;
+    }
+#endif
+#ifdef NATRON_HAS_SSE2
+
+    return eInstructionSetSSE2;
+#else
+
+    return eInstructionSetScalar;
+#endif
+}
+
+inline const char*
+getInstructionSetName(InstructionSetEnum instructionSet)
+{
+    switch (instructionSet) {
+    case eInstructionSetAVX2:
+
+        return "AVX2";
+    case eInstructionSetSSE2:
+
+        return "SSE2";
+    case eInstructionSetScalar:
+    default:
+
+        return "Scalar";
+    }
+}
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_GLOBAL_CPUFEATURES_H
@@ -98,6 +98,8 @@ namespace NATRON_PYTHON_NAMESPACE { }
 #define NATRON_PROJECT_FILE_MIME_TYPE "application/vnd.natron.project"
 #define NATRON_PROJECT_UNTITLED "Untitled." NATRON_PROJECT_FILE_EXT
 #define NATRON_CACHE_FILE_EXT "ntc"
+#define NATRON_CACHE_TOC_FILE_EXT "toc"
+#define NATRON_CACHE_TOC_HEAP_FILE_EXT "tocheap"
 #define NATRON_LAYOUT_FILE_EXT "nl"
 #define NATRON_LAYOUT_FILE_MIME_TYPE "application/vnd.natron.layout"
 #define NATRON_PRESETS_FILE_EXT "nps"
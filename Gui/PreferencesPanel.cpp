@@ -44,6 +44,7 @@ CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
 
 #include "Engine/KnobTypes.h"
+#include "Engine/Plugin.h"
 #include "Engine/Settings.h"
 #include "Engine/Utils.h" // convertFromPlainText
 
@@ -65,7 +66,8 @@ CLANG_DIAG_ON(uninitialized)
 #define COL_ENABLED COL_VERSION + 1
 #define COL_RS_ENABLED COL_ENABLED + 1
 #define COL_MT_ENABLED COL_RS_ENABLED + 1
-#define COL_GL_ENABLED COL_MT_ENABLED + 1
+#define COL_WP_ENABLED COL_MT_ENABLED + 1
+#define COL_GL_ENABLED COL_WP_ENABLED + 1
 
 NATRON_NAMESPACE_ENTER;
 
@@ -82,6 +84,7 @@ struct PluginTreeNode
     AnimatedCheckBox* enabledCheckbox;
     AnimatedCheckBox* rsCheckbox;
     AnimatedCheckBox* mtCheckbox;
+    AnimatedCheckBox* wpCheckbox;
     AnimatedCheckBox* glCheckbox;
     PluginWPtr plugin;
 };
@@ -475,6 +478,10 @@ PreferencesPanel::createPluginsView(QGridLayout* pluginsFrameLayout)
     treeHeader->setText( COL_RS_ENABLED, tr("R-S") );
     treeHeader->setToolTip(COL_MT_ENABLED, tr("If unchecked, there can only be a single render issued at a time for a node of this plug-in. This can alter performances a lot."));
     treeHeader->setText( COL_MT_ENABLED, tr("M-T") );
+    treeHeader->setToolTip(COL_WP_ENABLED, tr("If checked, the threads used by this plug-in for its processing are kept alive and re-used across renders, "
+                                              "which suppresses the overhead of creating new threads. Uncheck it for plug-ins that crash or render incorrectly "
+                                              "when their threads are re-used."));
+    treeHeader->setText( COL_WP_ENABLED, tr("Pool") );
     treeHeader->setToolTip(COL_GL_ENABLED, tr("If unchecked, OpenGL rendering is disabled for any node with this plug-in. If the checkbox is disabled, the plug-in does not support OpenGL rendering"));
     treeHeader->setText( COL_GL_ENABLED, tr("OpenGL") );
     _imp->pluginsView->setHeaderItem(treeHeader);
@@ -555,6 +562,19 @@ PreferencesPanel::createPluginsView(QGridLayout* pluginsFrameLayout)
                 _imp->pluginsView->setItemWidget(node.item, COL_MT_ENABLED, checkbox);
                 node.mtCheckbox = checkbox;
             }
+            {
+                QWidget *checkboxContainer = new QWidget(0);
+                QHBoxLayout* checkboxLayout = new QHBoxLayout(checkboxContainer);
+                AnimatedCheckBox* checkbox = new AnimatedCheckBox(checkboxContainer);
+                checkboxLayout->addWidget(checkbox, Qt::AlignLeft | Qt::AlignVCenter);
+                checkboxLayout->setContentsMargins(0, 0, 0, 0);
+                checkboxLayout->setSpacing(0);
+                checkbox->setFixedSize( TO_DPIX(NATRON_SMALL_BUTTON_SIZE), TO_DPIY(NATRON_SMALL_BUTTON_SIZE) );
+                checkbox->setChecked( plugin->isWorkerPoolEnabled() );
+                QObject::connect( checkbox, SIGNAL(clicked(bool)), this, SLOT(onWPEnabledCheckBoxChecked(bool)) );
+                _imp->pluginsView->setItemWidget(node.item, COL_WP_ENABLED, checkbox);
+                node.wpCheckbox = checkbox;
+            }
             {
                 QWidget *checkboxContainer = new QWidget(0);
                 QHBoxLayout* checkboxLayout = new QHBoxLayout(checkboxContainer);
@@ -860,6 +880,23 @@ PreferencesPanel::onMTEnabledCheckBoxChecked(bool checked)
     }
 }
 
+void
+PreferencesPanel::onWPEnabledCheckBoxChecked(bool checked)
+{
+    AnimatedCheckBox* cb = qobject_cast<AnimatedCheckBox*>( sender() );
+
+    if (!cb) {
+        return;
+    }
+    for (PluginTreeNodeList::iterator it = _imp->pluginsList.begin(); it != _imp->pluginsList.end(); ++it) {
+        if (it->wpCheckbox == cb) {
+            it->plugin.lock()->setWorkerPoolEnabled(checked);
+            _imp->pluginSettingsChanged = true;
+            break;
+        }
+    }
+}
+
 void
 PreferencesPanel::onGLEnabledCheckBoxChecked(bool checked)
 {
@@ -1131,6 +1168,10 @@ PreferencesPanel::restoreDefaults()
             if (it->mtCheckbox) {
                 it->mtCheckbox->setChecked(true);
             }
+            if (it->wpCheckbox) {
+                PluginPtr plugin = it->plugin.lock();
+                it->wpCheckbox->setChecked( plugin && !Plugin::isPluginRequiringFreshThreads( plugin->getPluginID() ) );
+            }
         }
     }
 }
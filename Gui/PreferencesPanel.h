@@ -87,6 +87,7 @@ public Q_SLOTS:
     void onItemEnabledCheckBoxChecked(bool);
     void onRSEnabledCheckBoxChecked(bool);
     void onMTEnabledCheckBoxChecked(bool);
+    void onWPEnabledCheckBoxChecked(bool);
     void onGLEnabledCheckBoxChecked(bool);
 
     void filterPlugins(const QString & txt);
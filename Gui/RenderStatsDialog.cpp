@@ -64,8 +64,9 @@
 #define COL_NB_CACHE_HIT 13
 #define COL_NB_CACHE_HIT_DOWNSCALED 14
 #define COL_NB_CACHE_MISS 15
+#define COL_THREADS_SPAWNED 16
 
-#define NUM_COLS 16
+#define NUM_COLS 17
 
 NATRON_NAMESPACE_ENTER;
 
@@ -76,6 +77,8 @@ enum ItemsRoleEnum
     eItemsRoleIdentityTilesInfo = 102,
     eItemsRoleRenderedTilesNb = 103,
     eItemsRoleRenderedTilesInfo = 104,
+    eItemsRoleThreadsSpawnedNb = 105,
+    eItemsRoleThreadsSpawnedTime = 106,
 };
 
 struct RowInfo
@@ -110,6 +113,9 @@ struct StatRowsCompare
         case COL_TIME:
 
             return lhs.item->data( (int)eItemsRoleTime ).toDouble() < rhs.item->data( (int)eItemsRoleTime ).toDouble();
+        case COL_THREADS_SPAWNED:
+
+            return lhs.item->data( (int)eItemsRoleThreadsSpawnedTime ).toDouble() < rhs.item->data( (int)eItemsRoleThreadsSpawnedTime ).toDouble();
         default:
 
             return lhs.item->text() < rhs.item->text();
@@ -645,6 +651,45 @@ public:
                 }
             }
         }
+        {
+            TableItem* item = 0;
+            int nb = 0;
+            double timeSpent = 0;
+            if (exists) {
+                item = view->item(row, COL_THREADS_SPAWNED);
+                if (item) {
+                    nb = item->data( (int)eItemsRoleThreadsSpawnedNb ).toInt();
+                    timeSpent = item->data( (int)eItemsRoleThreadsSpawnedTime ).toDouble();
+                }
+            } else {
+                item = new TableItem;
+                QString tt = NATRON_NAMESPACE::convertFromPlainText(tr("The number of threads created by the multi-thread suite for this node "
+                                                               "and the time spent creating them. Threads re-used from the worker pool "
+                                                               "are not counted."), NATRON_NAMESPACE::WhiteSpaceNormal);
+                item->setToolTip(tt);
+                item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+            }
+            assert(item);
+            if (item) {
+                int nbSpawned;
+                double spawnTime;
+                stats.getThreadsSpawnedInfos(&nbSpawned, &spawnTime);
+                nb += nbSpawned;
+                timeSpent += spawnTime;
+                item->setData( (int)eItemsRoleThreadsSpawnedNb, nb );
+                item->setData( (int)eItemsRoleThreadsSpawnedTime, timeSpent );
+
+                QString str = QString::number(nb) + QString::fromUtf8(" (") + Timer::printAsTime(timeSpent, false) + QLatin1Char(')');
+                if (nodeUi) {
+                    item->setTextColor(Qt::black);
+                    item->setBackgroundColor(c);
+                }
+                item->setText(str);
+                if (!exists) {
+                    view->setItem(row, COL_THREADS_SPAWNED, item);
+                }
+            }
+        }
         if (!exists) {
             rows.push_back(node);
         }
@@ -890,7 +935,8 @@ RenderStatsDialog::RenderStatsDialog(Gui* gui)
         << tr("Rendered Planes")
         << tr("Cache Hits")
         << tr("Cache Hits Higher Scale")
-        << tr("Cache Misses");
+        << tr("Cache Misses")
+        << tr("Threads Spawned");
 
     _imp->view->setColumnCount( dimensionNames.size() );
     _imp->view->setHorizontalHeaderLabels(dimensionNames);
@@ -964,6 +1010,7 @@ RenderStatsDialog::refreshAdvancedColsVisibility()
     _imp->view->setColumnHidden(COL_NB_CACHE_HIT, !checked);
     _imp->view->setColumnHidden(COL_NB_CACHE_HIT_DOWNSCALED, !checked);
     _imp->view->setColumnHidden(COL_NB_CACHE_MISS, !checked);
+    _imp->view->setColumnHidden(COL_THREADS_SPAWNED, !checked);
 }
 
 void
@@ -290,6 +290,42 @@ TEST_F(BaseTest, SetValues)
     }
 }
 
+TEST_F(BaseTest, ExpressionResultsCache)
+{
+    NodePtr source = createNode(_generatorPluginID);
+    NodePtr target = createNode(_generatorPluginID);
+
+    ASSERT_TRUE(source && target);
+    KnobDoublePtr sourceKnob = toKnobDouble( source->getKnobByName("noiseZSlope") );
+    KnobDoublePtr targetKnob = toKnobDouble( target->getKnobByName("noiseZSlope") );
+    ASSERT_TRUE(sourceKnob && targetKnob);
+    sourceKnob->setValue(0.25);
+    targetKnob->setExpression(0, source->getScriptName_mt_safe() + ".noiseZSlope.get() * 2", false, true);
+    targetKnob->resetExpressionsResultsStats(0);
+
+    // The expression is evaluated once per time
+    U64 hits, misses;
+    EXPECT_DOUBLE_EQ( 0.5, targetKnob->getValueAtTime(10) );
+    EXPECT_DOUBLE_EQ( 0.5, targetKnob->getValueAtTime(10) );
+    EXPECT_DOUBLE_EQ( 0.5, targetKnob->getValueAtTime(20) );
+    targetKnob->getExpressionsResultsStats(0, &hits, &misses);
+    EXPECT_EQ(1U, hits);
+    EXPECT_EQ(2U, misses);
+
+    // Changing the value the expression depends on invalidates the results
+    sourceKnob->setValue(1.);
+    EXPECT_DOUBLE_EQ( 2., targetKnob->getValueAtTime(10) );
+    EXPECT_DOUBLE_EQ( 2., targetKnob->getValueAtTime(10) );
+    targetKnob->getExpressionsResultsStats(0, &hits, &misses);
+    EXPECT_EQ(2U, hits);
+    EXPECT_EQ(3U, misses);
+
+    targetKnob->resetExpressionsResultsStats(0);
+    targetKnob->getExpressionsResultsStats(0, &hits, &misses);
+    EXPECT_EQ(0U, hits);
+    EXPECT_EQ(0U, misses);
+}
+
 ///High level test: simple node connections test
 TEST_F(BaseTest, SimpleNodeConnections) {
     ///create the generator
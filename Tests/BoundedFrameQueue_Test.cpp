@@ -0,0 +1,187 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QThread>
+
+#include "Engine/BoundedFrameQueue.h"
+
+NATRON_NAMESPACE_USING
+
+typedef BoundedFrameQueue<int> IntFrameQueue;
+
+// Pushes a frame from another thread, to test the calls that wait
+class PushThread
+    : public QThread
+{
+public:
+
+    PushThread(IntFrameQueue* queue,
+               int index)
+        : QThread()
+        , _queue(queue)
+        , _index(index)
+        , _pushed(false)
+    {
+    }
+
+    bool isPushed() const
+    {
+        return _pushed;
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        _pushed = _queue->push(_index, _index);
+    }
+
+    IntFrameQueue* _queue;
+    int _index;
+    bool _pushed;
+};
+
+TEST(BoundedFrameQueue,
+     UnorderedPopsLowestIndexFirst)
+{
+    IntFrameQueue queue(4, false);
+
+    ASSERT_TRUE( queue.push(3, 3) );
+    ASSERT_TRUE( queue.push(1, 1) );
+    ASSERT_TRUE( queue.push(2, 2) );
+
+    int frame, queueDepth;
+    double stallTime;
+    ASSERT_TRUE( queue.pop(&frame, &queueDepth, &stallTime) );
+    EXPECT_EQ(1, frame);
+    EXPECT_EQ(2, queueDepth);
+    EXPECT_EQ(0., stallTime);
+    ASSERT_TRUE( queue.pop(&frame, 0, 0) );
+    EXPECT_EQ(2, frame);
+
+    // Frame 0 was never pushed: frames are not waited for
+    ASSERT_TRUE( queue.push(0, 0) );
+    ASSERT_TRUE( queue.pop(&frame, 0, 0) );
+    EXPECT_EQ(0, frame);
+    ASSERT_TRUE( queue.pop(&frame, 0, 0) );
+    EXPECT_EQ(3, frame);
+    EXPECT_EQ( 0, queue.getNFrames() );
+}
+
+TEST(BoundedFrameQueue,
+     OrderedPopsInIndexOrder)
+{
+    IntFrameQueue queue(2, true);
+
+    ASSERT_TRUE( queue.push(2, 2) );
+    ASSERT_TRUE( queue.push(1, 1) );
+
+    // The queue is full but frame 0 must be accepted, otherwise the consumer would wait for it forever
+    ASSERT_TRUE( queue.push(0, 0) );
+    EXPECT_EQ( 3, queue.getNFrames() );
+
+    int frame;
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE( queue.pop(&frame, 0, 0) );
+        EXPECT_EQ(i, frame);
+    }
+
+    // Frame 4 cannot be popped before frame 3, even once quit
+    ASSERT_TRUE( queue.push(4, 4) );
+    queue.quit();
+    EXPECT_FALSE( queue.pop(&frame, 0, 0) );
+    EXPECT_FALSE( queue.push(3, 3) );
+}
+
+TEST(BoundedFrameQueue,
+     PushWaitsWhileFull)
+{
+    IntFrameQueue queue(2, false);
+
+    ASSERT_TRUE( queue.push(0, 0) );
+    ASSERT_TRUE( queue.push(1, 1) );
+
+    PushThread thread(&queue, 2);
+    thread.start();
+    QThread::msleep(100);
+    EXPECT_FALSE( thread.isPushed() );
+    EXPECT_EQ( 2, queue.getNFrames() );
+
+    int frame, queueDepth;
+    double stallTime;
+    ASSERT_TRUE( queue.pop(&frame, 0, 0) );
+    EXPECT_EQ(0, frame);
+    thread.wait();
+    EXPECT_TRUE( thread.isPushed() );
+
+    ASSERT_TRUE( queue.pop(&frame, 0, 0) );
+    EXPECT_EQ(1, frame);
+    ASSERT_TRUE( queue.pop(&frame, &queueDepth, &stallTime) );
+    EXPECT_EQ(2, frame);
+    EXPECT_EQ(2, queueDepth);
+    EXPECT_GT(stallTime, 0.05);
+}
+
+TEST(BoundedFrameQueue,
+     QuitDrainsQueuedFrames)
+{
+    IntFrameQueue queue(4, false);
+
+    ASSERT_TRUE( queue.push(0, 0) );
+    ASSERT_TRUE( queue.push(1, 1) );
+    queue.quit();
+    EXPECT_FALSE( queue.push(2, 2) );
+
+    int frame;
+    ASSERT_TRUE( queue.pop(&frame, 0, 0) );
+    EXPECT_EQ(0, frame);
+    ASSERT_TRUE( queue.pop(&frame, 0, 0) );
+    EXPECT_EQ(1, frame);
+    EXPECT_FALSE( queue.pop(&frame, 0, 0) );
+}
+
+TEST(BoundedFrameQueue,
+     AbortWakesWaitingPush)
+{
+    IntFrameQueue queue(1, false);
+
+    ASSERT_TRUE( queue.push(0, 0) );
+
+    PushThread thread(&queue, 1);
+    thread.start();
+    QThread::msleep(50);
+    queue.abort();
+    thread.wait();
+    EXPECT_FALSE( thread.isPushed() );
+
+    // The queued frames are dropped
+    EXPECT_EQ( 0, queue.getNFrames() );
+    int frame;
+    EXPECT_FALSE( queue.pop(&frame, 0, 0) );
+    EXPECT_FALSE( queue.push(2, 2) );
+}
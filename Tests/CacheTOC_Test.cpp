@@ -0,0 +1,392 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QString>
+
+#include "Engine/CacheTOC.h"
+#include "Engine/FStreamsSupport.h"
+#include "Engine/Image.h"
+#include "Engine/StandardPaths.h"
+
+NATRON_NAMESPACE_USING
+
+typedef SERIALIZATION_NAMESPACE::CacheSerialization<Image> ImageCacheSerialization;
+typedef SERIALIZATION_NAMESPACE::SerializedEntry<Image> SerializedImageEntry;
+
+namespace {
+// The TOC files of a test, removed when the test ends
+class CacheTOCFiles
+{
+public:
+
+    CacheTOCFiles()
+    {
+        QDir dir( StandardPaths::writableLocation(StandardPaths::eStandardLocationTemp) );
+
+        dir.mkpath( QString::fromUtf8("NatronUnitTest") );
+        dir.cd( QString::fromUtf8("NatronUnitTest") );
+        tocFilePath = dir.absoluteFilePath( QString::fromUtf8("restoreFile." NATRON_CACHE_TOC_FILE_EXT) ).toStdString();
+        heapFilePath = dir.absoluteFilePath( QString::fromUtf8("restoreFile." NATRON_CACHE_TOC_HEAP_FILE_EXT) ).toStdString();
+        legacyFilePath = dir.absoluteFilePath( QString::fromUtf8("restoreFile." NATRON_CACHE_FILE_EXT) ).toStdString();
+        removeAll();
+    }
+
+    ~CacheTOCFiles()
+    {
+        removeAll();
+    }
+
+    void removeAll()
+    {
+        QFile::remove( QString::fromUtf8( tocFilePath.c_str() ) );
+        QFile::remove( QString::fromUtf8( heapFilePath.c_str() ) );
+        QFile::remove( QString::fromUtf8( legacyFilePath.c_str() ) );
+    }
+
+    std::string tocFilePath, heapFilePath, legacyFilePath;
+};
+
+// An entry of a tiled cache: several entries share the same file and plug-in ID
+SerializedImageEntry
+makeEntry(int i)
+{
+    SerializedImageEntry e;
+
+    e.hash = 1000 + i;
+    e.size = 4096;
+    e.filePath = i % 2 ? "/cache/TileCacheFile1" : "/cache/TileCacheFile0";
+    e.dataOffsetInFile = (i / 2) * e.size;
+    e.pluginID = "net.sf.openfx.Blur";
+    e.key.nodeHashKey = 5000 + i;
+    e.key.time = i * 0.5;
+    e.key.view = i % 2;
+    e.key.draft = i % 3 == 0;
+    e.params.dataTypeSize = sizeof(float);
+    e.params.nComps = 4;
+    e.params.bounds.x1 = -i;
+    e.params.bounds.y1 = 0;
+    e.params.bounds.x2 = 32;
+    e.params.bounds.y2 = 32 + i;
+    e.params.rod.x1 = -i;
+    e.params.rod.y1 = 0.;
+    e.params.rod.x2 = 32.;
+    e.params.rod.y2 = 32. + i;
+    e.params.par = 1.;
+    e.params.components.layerName = "RGBA";
+    e.params.components.globalCompsName = "RGBA";
+    e.params.components.channelNames.push_back("R");
+    e.params.components.channelNames.push_back("G");
+    e.params.components.channelNames.push_back("B");
+    e.params.components.channelNames.push_back("A");
+    e.params.bitdepth = (int)eImageBitDepthFloat;
+    e.params.fielding = (int)eImageFieldingOrderNone;
+    e.params.premult = (int)eImagePremultiplicationPremultiplied;
+    e.params.mipMapLevel = i % 3;
+
+    return e;
+}
+
+ImageCacheSerialization
+makeTOC(int cacheVersion,
+        int nEntries)
+{
+    ImageCacheSerialization toc;
+
+    toc.cacheVersion = cacheVersion;
+    for (int i = 0; i < nEntries; ++i) {
+        toc.entries.push_back( makeEntry(i) );
+    }
+
+    return toc;
+}
+
+void
+expectSameEntries(const ImageCacheSerialization& expected,
+                  const ImageCacheSerialization& toc)
+{
+    EXPECT_EQ(expected.cacheVersion, toc.cacheVersion);
+    ASSERT_EQ( expected.entries.size(), toc.entries.size() );
+    std::list<SerializedImageEntry>::const_iterator it = toc.entries.begin();
+    for (std::list<SerializedImageEntry>::const_iterator e = expected.entries.begin(); e != expected.entries.end(); ++e, ++it) {
+        EXPECT_EQ(e->hash, it->hash);
+        EXPECT_EQ(e->size, it->size);
+        EXPECT_EQ(e->filePath, it->filePath);
+        EXPECT_EQ(e->dataOffsetInFile, it->dataOffsetInFile);
+        EXPECT_EQ(e->pluginID, it->pluginID);
+        EXPECT_EQ(e->key.nodeHashKey, it->key.nodeHashKey);
+        EXPECT_EQ(e->key.time, it->key.time);
+        EXPECT_EQ(e->key.view, it->key.view);
+        EXPECT_EQ(e->key.draft, it->key.draft);
+        EXPECT_EQ(e->params.dataTypeSize, it->params.dataTypeSize);
+        EXPECT_EQ(e->params.nComps, it->params.nComps);
+        EXPECT_EQ(e->params.bounds.x1, it->params.bounds.x1);
+        EXPECT_EQ(e->params.bounds.y2, it->params.bounds.y2);
+        EXPECT_EQ(e->params.rod.x1, it->params.rod.x1);
+        EXPECT_EQ(e->params.rod.y2, it->params.rod.y2);
+        EXPECT_EQ(e->params.par, it->params.par);
+        EXPECT_EQ(e->params.components.layerName, it->params.components.layerName);
+        EXPECT_EQ(e->params.components.globalCompsName, it->params.components.globalCompsName);
+        EXPECT_TRUE(e->params.components.channelNames == it->params.components.channelNames);
+        EXPECT_EQ(e->params.bitdepth, it->params.bitdepth);
+        EXPECT_EQ(e->params.fielding, it->params.fielding);
+        EXPECT_EQ(e->params.premult, it->params.premult);
+        EXPECT_EQ(e->params.mipMapLevel, it->params.mipMapLevel);
+    }
+}
+
+void
+writeLegacyTOC(const std::string& filePath,
+               const ImageCacheSerialization& toc)
+{
+    FStreamsSupport::ofstream ofile;
+
+    FStreamsSupport::open(&ofile, filePath);
+    ASSERT_TRUE(ofile);
+    SERIALIZATION_NAMESPACE::write(ofile, toc);
+}
+
+void
+writeGarbage(const std::string& filePath)
+{
+    QFile file( QString::fromUtf8( filePath.c_str() ) );
+
+    ASSERT_TRUE( file.open(QIODevice::WriteOnly) );
+    QByteArray garbage(4096, 'x');
+    file.write(garbage);
+}
+} // anon namespace
+
+TEST(CacheTOC,
+     RoundTrip)
+{
+    CacheTOCFiles files;
+    const ImageCacheSerialization saved = makeTOC(3, 10);
+
+    {
+        CacheTOC tocFile(files.tocFilePath, files.heapFilePath);
+        ASSERT_TRUE( tocFile.open(true) );
+        tocFile.update<Image>(saved.cacheVersion, saved.entries, false);
+        EXPECT_EQ( (std::size_t)10, tocFile.getNumEntries() );
+    }
+
+    CacheTOC tocFile(files.tocFilePath, files.heapFilePath);
+    ASSERT_TRUE( tocFile.open(false) );
+    EXPECT_FALSE( tocFile.isDirty() );
+    EXPECT_EQ( 3, tocFile.getCacheVersion() );
+    ImageCacheSerialization restored;
+    tocFile.read<Image>(&restored);
+    expectSameEntries(saved, restored);
+
+    // Saving the same entries again appends nothing
+    tocFile.update<Image>(saved.cacheVersion, saved.entries, false);
+    EXPECT_EQ( (std::size_t)10, tocFile.getNumRecords() );
+
+    // A changed entry is appended and its previous record removed
+    ImageCacheSerialization changed = saved;
+    changed.entries.front().size = 8192;
+    tocFile.update<Image>(changed.cacheVersion, changed.entries, false);
+    EXPECT_EQ( (std::size_t)10, tocFile.getNumEntries() );
+    EXPECT_EQ( (std::size_t)11, tocFile.getNumRecords() );
+    restored.entries.clear();
+    tocFile.read<Image>(&restored);
+    ASSERT_EQ( (std::size_t)10, restored.entries.size() );
+    EXPECT_EQ( (std::size_t)8192, restored.entries.back().size );
+}
+
+TEST(CacheTOC,
+     SameHashInSeveralRecords)
+{
+    CacheTOCFiles files;
+    ImageCacheSerialization saved = makeTOC(3, 4);
+
+    // The hash does not identify an entry alone: it may be the same for entries of different files and offsets
+    for (std::list<SerializedImageEntry>::iterator it = saved.entries.begin(); it != saved.entries.end(); ++it) {
+        it->hash = 1000;
+    }
+    CacheTOC tocFile(files.tocFilePath, files.heapFilePath);
+    ASSERT_TRUE( tocFile.open(true) );
+    tocFile.update<Image>(saved.cacheVersion, saved.entries, false);
+    EXPECT_EQ( (std::size_t)4, tocFile.getNumEntries() );
+
+    // Saving the same entries again appends nothing
+    tocFile.update<Image>(saved.cacheVersion, saved.entries, false);
+    EXPECT_EQ( (std::size_t)4, tocFile.getNumRecords() );
+
+    // Removing an entry only removes its own record
+    ImageCacheSerialization kept = saved;
+    kept.entries.pop_front();
+    tocFile.update<Image>(kept.cacheVersion, kept.entries, false);
+    EXPECT_EQ( (std::size_t)3, tocFile.getNumEntries() );
+    EXPECT_EQ( (std::size_t)4, tocFile.getNumRecords() );
+
+    CacheTOC reopened(files.tocFilePath, files.heapFilePath);
+    ASSERT_TRUE( reopened.open(false) );
+    ImageCacheSerialization restored;
+    reopened.read<Image>(&restored);
+    expectSameEntries(kept, restored);
+}
+
+TEST(CacheTOC,
+     Compaction)
+{
+    CacheTOCFiles files;
+    const ImageCacheSerialization saved = makeTOC(3, 10);
+    CacheTOC tocFile(files.tocFilePath, files.heapFilePath);
+
+    ASSERT_TRUE( tocFile.open(true) );
+    tocFile.update<Image>(saved.cacheVersion, saved.entries, false);
+
+    // Removing less than half of the entries only flags their records
+    ImageCacheSerialization kept = makeTOC(3, 6);
+    tocFile.update<Image>(kept.cacheVersion, kept.entries, false);
+    EXPECT_EQ( (std::size_t)6, tocFile.getNumEntries() );
+    EXPECT_EQ( (std::size_t)10, tocFile.getNumRecords() );
+
+    // Once more than half of the records are removed, the TOC is rewritten with the live entries only
+    kept = makeTOC(3, 2);
+    tocFile.update<Image>(kept.cacheVersion, kept.entries, false);
+    EXPECT_EQ( (std::size_t)2, tocFile.getNumEntries() );
+    EXPECT_EQ( (std::size_t)2, tocFile.getNumRecords() );
+
+    ImageCacheSerialization restored;
+    tocFile.read<Image>(&restored);
+    expectSameEntries(kept, restored);
+
+    // A new cache version also rewrites everything
+    kept.cacheVersion = 4;
+    tocFile.update<Image>(kept.cacheVersion, kept.entries, false);
+    EXPECT_EQ( 4, tocFile.getCacheVersion() );
+    EXPECT_EQ( (std::size_t)2, tocFile.getNumRecords() );
+}
+
+TEST(CacheTOC,
+     FallbackToLegacyTOC)
+{
+    CacheTOCFiles files;
+    const ImageCacheSerialization saved = makeTOC(3, 5);
+
+    // No TOC at all
+    {
+        ImageCacheSerialization restored;
+        boost::shared_ptr<CacheTOC> tocFile;
+        EXPECT_FALSE( readCacheTOC<Image>(files.tocFilePath, files.heapFilePath, files.legacyFilePath, &restored, &tocFile) );
+    }
+
+    // Binary TOC missing: the YAML one is read, then removed
+    writeLegacyTOC(files.legacyFilePath, saved);
+    {
+        ImageCacheSerialization restored;
+        boost::shared_ptr<CacheTOC> tocFile;
+        ASSERT_TRUE( readCacheTOC<Image>(files.tocFilePath, files.heapFilePath, files.legacyFilePath, &restored, &tocFile) );
+        EXPECT_FALSE(tocFile);
+        expectSameEntries(saved, restored);
+        EXPECT_FALSE( QFile::exists( QString::fromUtf8( files.legacyFilePath.c_str() ) ) );
+    }
+
+    // Binary TOC corrupted: the YAML one is read
+    writeGarbage(files.tocFilePath);
+    writeGarbage(files.heapFilePath);
+    writeLegacyTOC(files.legacyFilePath, saved);
+    {
+        ImageCacheSerialization restored;
+        boost::shared_ptr<CacheTOC> tocFile;
+        ASSERT_TRUE( readCacheTOC<Image>(files.tocFilePath, files.heapFilePath, files.legacyFilePath, &restored, &tocFile) );
+        EXPECT_FALSE(tocFile);
+        expectSameEntries(saved, restored);
+    }
+
+    // Binary TOC corrupted and no YAML TOC: the cache must be wiped
+    {
+        ImageCacheSerialization restored;
+        boost::shared_ptr<CacheTOC> tocFile;
+        EXPECT_FALSE( readCacheTOC<Image>(files.tocFilePath, files.heapFilePath, files.legacyFilePath, &restored, &tocFile) );
+    }
+    files.removeAll();
+
+    // A valid binary TOC takes precedence over the YAML one
+    {
+        CacheTOC binaryTOC(files.tocFilePath, files.heapFilePath);
+        ASSERT_TRUE( binaryTOC.open(true) );
+        binaryTOC.update<Image>(saved.cacheVersion, saved.entries, false);
+    }
+    writeLegacyTOC( files.legacyFilePath, makeTOC(3, 1) );
+    {
+        ImageCacheSerialization restored;
+        boost::shared_ptr<CacheTOC> tocFile;
+        ASSERT_TRUE( readCacheTOC<Image>(files.tocFilePath, files.heapFilePath, files.legacyFilePath, &restored, &tocFile) );
+        ASSERT_TRUE(tocFile);
+        expectSameEntries(saved, restored);
+
+        // Once restored, the TOC is dirty until the next save: if the application does not exit cleanly, the cache is wiped
+        tocFile->setDirty(true);
+    }
+    {
+        ImageCacheSerialization restored;
+        boost::shared_ptr<CacheTOC> tocFile;
+        EXPECT_FALSE( readCacheTOC<Image>(files.tocFilePath, files.heapFilePath, files.legacyFilePath, &restored, &tocFile) );
+    }
+}
+
+TEST(CacheTOC,
+     StaysDirtyUntilShutdown)
+{
+    CacheTOCFiles files;
+    const ImageCacheSerialization saved = makeTOC(3, 5);
+
+    // A save while the application runs (e.g: when saving the project) leaves the TOC dirty
+    {
+        CacheTOC tocFile(files.tocFilePath, files.heapFilePath);
+        ASSERT_TRUE( tocFile.open(true) );
+        tocFile.update<Image>(saved.cacheVersion, saved.entries, true);
+        EXPECT_TRUE( tocFile.isDirty() );
+    }
+    {
+        ImageCacheSerialization restored;
+        boost::shared_ptr<CacheTOC> tocFile;
+        EXPECT_FALSE( readCacheTOC<Image>(files.tocFilePath, files.heapFilePath, files.legacyFilePath, &restored, &tocFile) );
+    }
+
+    // Only the save at shutdown flags it clean
+    {
+        CacheTOC tocFile(files.tocFilePath, files.heapFilePath);
+        ASSERT_TRUE( tocFile.open(true) );
+        tocFile.update<Image>(saved.cacheVersion, saved.entries, false);
+        EXPECT_FALSE( tocFile.isDirty() );
+    }
+    {
+        ImageCacheSerialization restored;
+        boost::shared_ptr<CacheTOC> tocFile;
+        ASSERT_TRUE( readCacheTOC<Image>(files.tocFilePath, files.heapFilePath, files.legacyFilePath, &restored, &tocFile) );
+        expectSameEntries(saved, restored);
+    }
+}
@@ -0,0 +1,584 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm>
+#include <list>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <QtCore/QThread>
+
+#include "BaseTest.h"
+
+#include "Engine/Cache.h"
+#include "Engine/CacheEntry.h"
+#include "Engine/Image.h"
+#include "Engine/LRUHashTable.h"
+#include "Engine/RamBufferPool.h"
+#include "Engine/ViewIdx.h"
+
+NATRON_NAMESPACE_USING
+
+namespace {
+// An entry of the simulated cache: only what the eviction policies look at
+class FakeEntry
+{
+public:
+
+    FakeEntry(std::size_t size,
+              double renderCost)
+        : _size(size)
+        , _renderCost(renderCost)
+        , _priorityBase(0.)
+    {
+    }
+
+    std::size_t size() const { return _size; }
+
+    double getRenderCost() const { return _renderCost; }
+
+    double getEvictionPriorityBase() const { return _priorityBase; }
+
+    void setEvictionPriorityBase(double base) { _priorityBase = base; }
+
+private:
+    std::size_t _size;
+    double _renderCost;
+    double _priorityBase;
+};
+
+typedef boost::shared_ptr<FakeEntry> FakeEntryPtr;
+typedef BoostLRUHashTable<U64, FakeEntryPtr> FakeCacheContainer;
+
+struct ReplayResults
+{
+    int hits;
+    int misses;
+    double renderTime; // seconds spent re-rendering missed entries
+};
+
+const std::size_t kEntrySize = 8 * 1024 * 1024;
+const U64 kNumExpensiveEntries = 40;
+const U64 kNumCheapEntries = 200;
+const double kExpensiveRenderCost = 2.;
+const double kCheapRenderCost = 0.05;
+
+// Replays a deterministic access trace where half of the accesses go to a small set of entries that
+// are expensive to render and the other half go to a larger set of cheap entries, in a cache that
+// can only hold a fraction of them.
+ReplayResults
+replayTrace(bool costAware,
+            std::size_t budget,
+            int nAccesses)
+{
+    FakeCacheContainer container;
+    std::size_t used = 0;
+    double inflation = 0.;
+    U64 seed = 12345;
+    ReplayResults res = { 0, 0, 0. };
+
+    for (int i = 0; i < nAccesses; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        U64 r = seed >> 33;
+        bool expensive = (r & 1) == 0;
+        U64 key = expensive ? ( (r >> 1) % kNumExpensiveEntries ) : kNumExpensiveEntries + ( (r >> 1) % kNumCheapEntries );
+        double cost = expensive ? kExpensiveRenderCost : kCheapRenderCost;
+        FakeCacheContainer::container_type::left_iterator found = container(key);
+        if ( found != container.end() ) {
+            ++res.hits;
+            found->second.front()->setEvictionPriorityBase(inflation);
+            continue;
+        }
+
+        ++res.misses;
+        res.renderTime += cost;
+        FakeEntryPtr entry( new FakeEntry(kEntrySize, cost) );
+        entry->setEvictionPriorityBase(inflation);
+        container.insert(key, entry);
+        used += entry->size();
+        entry.reset();
+
+        while (used > budget) {
+            std::pair<U64, FakeEntryPtr> evicted;
+            if (costAware) {
+                GreedyDualSizePriority priority;
+                evicted = container.evictLowestPriority(priority, 16);
+                if (evicted.second) {
+                    inflation = std::max( inflation, priority(evicted.second) );
+                }
+            } else {
+                evicted = container.evict();
+            }
+            if (!evicted.second) {
+                break;
+            }
+            used -= evicted.second->size();
+        }
+    }
+
+    return res;
+}
+} // anon namespace
+
+// Replays a long access trace: disabled by default, run with --gtest_also_run_disabled_tests
+TEST(Cache,
+     DISABLED_CostAwareEvictionLowersRenderTime)
+{
+    const std::size_t budget = 100 * kEntrySize;
+    const int nAccesses = 200000;
+    ReplayResults lru = replayTrace(false, budget, nAccesses);
+    ReplayResults gds = replayTrace(true, budget, nAccesses);
+
+    EXPECT_EQ(nAccesses, lru.hits + lru.misses);
+    EXPECT_EQ(nAccesses, gds.hits + gds.misses);
+    EXPECT_LT(gds.renderTime, lru.renderTime);
+}
+
+TEST(Cache,
+     CostAwareEvictionSkipsEntriesInUse)
+{
+    FakeCacheContainer container;
+    FakeEntryPtr cheapInUse( new FakeEntry(kEntrySize, kCheapRenderCost) );
+    FakeEntryPtr expensive( new FakeEntry(kEntrySize, kExpensiveRenderCost) );
+    FakeEntryPtr cheap( new FakeEntry(kEntrySize, kCheapRenderCost) );
+
+    container.insert(0, cheapInUse);
+    container.insert(1, expensive);
+    container.insert(2, cheap);
+    expensive.reset();
+    cheap.reset();
+
+    GreedyDualSizePriority priority;
+    std::pair<U64, FakeEntryPtr> evicted = container.evictLowestPriority(priority, 16);
+    // The cheapest entry not referenced elsewhere goes first, even though it is the most recently used
+    EXPECT_EQ(2U, evicted.first);
+    evicted = container.evictLowestPriority(priority, 16);
+    EXPECT_EQ(1U, evicted.first);
+    evicted = container.evictLowestPriority(priority, 16);
+    EXPECT_FALSE(evicted.second);
+}
+
+TEST(TileBitmap,
+     AllocFreeReuse)
+{
+    // More tiles than a word of the second level covers, and not a multiple of 64
+    const std::size_t nTiles = 64 * 64 + 70;
+    TileBitmap bitmap;
+
+    bitmap.resize(nTiles);
+    EXPECT_EQ( nTiles, bitmap.size() );
+    EXPECT_EQ( (std::size_t)0, bitmap.getNumUsedTiles() );
+    EXPECT_FALSE( bitmap.isFull() );
+
+    // Tiles are allocated in order
+    for (std::size_t i = 0; i < nTiles; ++i) {
+        int index = bitmap.findFirstFree();
+        ASSERT_EQ( (int)i, index );
+        bitmap.setUsed(index, true);
+        EXPECT_TRUE( bitmap.isUsed(index) );
+    }
+    EXPECT_EQ( nTiles, bitmap.getNumUsedTiles() );
+    EXPECT_TRUE( bitmap.isFull() );
+    // The padding bits of the last word are never returned
+    EXPECT_EQ( -1, bitmap.findFirstFree() );
+
+    // Freed tiles are reused lowest index first
+    bitmap.setUsed(64 * 64 + 3, false);
+    bitmap.setUsed(65, false);
+    bitmap.setUsed(nTiles - 1, false);
+    EXPECT_EQ( nTiles - 3, bitmap.getNumUsedTiles() );
+    EXPECT_FALSE( bitmap.isFull() );
+    EXPECT_FALSE( bitmap.isUsed(65) );
+
+    EXPECT_EQ( 65, bitmap.findFirstFree() );
+    bitmap.setUsed(65, true);
+    EXPECT_EQ( 64 * 64 + 3, bitmap.findFirstFree() );
+    bitmap.setUsed(64 * 64 + 3, true);
+    EXPECT_EQ( (int)nTiles - 1, bitmap.findFirstFree() );
+    bitmap.setUsed(nTiles - 1, true);
+    EXPECT_EQ( -1, bitmap.findFirstFree() );
+    EXPECT_EQ( nTiles, bitmap.getNumUsedTiles() );
+
+    // Resizing frees all the tiles
+    bitmap.resize(10);
+    EXPECT_EQ( (std::size_t)0, bitmap.getNumUsedTiles() );
+    EXPECT_EQ( 0, bitmap.findFirstFree() );
+}
+
+TEST(RamBufferPool,
+     SizeClasses)
+{
+    // Small buffers are not rounded
+    EXPECT_EQ( (std::size_t)100, RamBufferPool::getCapacity(100) );
+
+    std::size_t previous = 0;
+    for (std::size_t bytes = NATRON_RAM_BUFFER_POOL_MIN_POOLED_SIZE; bytes < 256 * 1024 * 1024; bytes = bytes * 9 / 8 + 4093) {
+        std::size_t capacity = RamBufferPool::getCapacity(bytes);
+        EXPECT_GE(capacity, bytes);
+        EXPECT_LE(capacity - bytes, bytes / NATRON_RAM_BUFFER_POOL_CLASSES_PER_OCTAVE);
+        EXPECT_EQ( (std::size_t)0, capacity % 4096 );
+        EXPECT_EQ( capacity, RamBufferPool::getCapacity(capacity) );
+        EXPECT_GE(capacity, previous);
+        previous = capacity;
+    }
+    // A 1080p RGBA float frame fits in the 32MiB class
+    const std::size_t frameBytes = 1920 * 1080 * 4 * sizeof(float);
+    EXPECT_EQ( (std::size_t)32 * 1024 * 1024, RamBufferPool::getCapacity(frameBytes) );
+}
+
+TEST(RamBufferPool,
+     ReusesFreedBuffersWithinBudget)
+{
+    RamBufferPool pool;
+    const std::size_t bytes = 1024 * 1024 + 10;
+    const std::size_t capacity = RamBufferPool::getCapacity(bytes);
+
+    pool.setMaxRetainedBytes(2 * capacity);
+
+    void* a = pool.allocate(bytes);
+    void* b = pool.allocate(bytes);
+    void* c = pool.allocate(bytes);
+    void* small = pool.allocate(100);
+    EXPECT_EQ( (std::size_t)0, (std::size_t)a % NATRON_RAM_BUFFER_POOL_ALIGNMENT );
+    EXPECT_EQ( (std::size_t)0, (std::size_t)small % NATRON_RAM_BUFFER_POOL_ALIGNMENT );
+
+    pool.deallocate(a, bytes);
+    pool.deallocate(b, bytes);
+    // Above the budget: given back to the system
+    pool.deallocate(c, bytes);
+    pool.deallocate(small, 100);
+
+    RamBufferPoolStats stats;
+    pool.getStats(&stats);
+    EXPECT_EQ( (U64)0, stats.inUseBytes );
+    EXPECT_EQ( (U64)(2 * capacity), stats.retainedBytes );
+    EXPECT_EQ( (U64)2, stats.nRetainedBuffers );
+    EXPECT_EQ( (U64)1, stats.nReleasedToSystem );
+    EXPECT_EQ( (U64)3, stats.nMisses );
+    EXPECT_EQ( (U64)1, stats.nUnpooled );
+
+    // Any size in the same class reuses a retained buffer
+    void* d = pool.allocate(capacity - 100);
+    EXPECT_TRUE(d == a || d == b);
+    // Another class does not
+    void* e = pool.allocate(4 * capacity);
+    pool.getStats(&stats);
+    EXPECT_EQ( (U64)1, stats.nHits );
+    EXPECT_EQ( (U64)4, stats.nMisses );
+    EXPECT_EQ( (U64)( capacity + RamBufferPool::getCapacity(4 * capacity) ), stats.inUseBytes );
+
+    pool.deallocate(d, capacity - 100);
+    pool.deallocate(e, 4 * capacity);
+
+    // Lowering the budget trims the pool
+    pool.setMaxRetainedBytes(capacity);
+    pool.getStats(&stats);
+    EXPECT_LE(stats.retainedBytes, (U64)capacity);
+    pool.trim();
+    pool.getStats(&stats);
+    EXPECT_EQ( (U64)0, stats.retainedBytes );
+    EXPECT_EQ( (U64)0, stats.nRetainedBuffers );
+}
+
+namespace {
+ImageKey
+makeImageKey(U64 nodeHash)
+{
+    return ImageKey(std::string(), nodeHash, 0., ViewIdx(0), false);
+}
+
+// Returns the key of the next tree version whose entry lives in the given shard
+ImageKey
+makeImageKeyInShard(int shard,
+                    int nShards,
+                    U64* nodeHash)
+{
+    for (;; ) {
+        ImageKey key = makeImageKey( (*nodeHash)++ );
+        if ( (int)( key.getHash() % (U64)nShards ) == shard ) {
+            return key;
+        }
+    }
+}
+
+// A small RGBA float image
+ImageParamsPtr
+makeImageParams()
+{
+    return Image::makeParams( RectD(0., 0., 64., 64.), 1., 0, ImageComponents::getRGBAComponents(), eImageBitDepthFloat,
+                              eImagePremultiplicationPremultiplied, eImageFieldingOrderNone );
+}
+
+std::size_t
+getImageSize(const ImageParamsPtr& params)
+{
+    return params->getBounds().area() * 4 * sizeof(float);
+}
+
+// Looks-up the image of the key or creates and allocates it, as a render does
+ImagePtr
+getOrCreateImage(const ImageCache& cache,
+                 const ImageKey& key,
+                 const ImageParamsPtr& params,
+                 bool allocate = true)
+{
+    ImagePtr image;
+
+    cache.getOrCreate(key, params, 0, &image);
+    if (image && allocate) {
+        image->allocateMemory();
+    }
+
+    return image;
+}
+
+bool
+isCached(const ImageCache& cache,
+         const ImageKey& key)
+{
+    std::list<ImagePtr> found;
+
+    return cache.get(key, &found);
+}
+
+std::size_t
+getNumEntries(const ImageCache& cache)
+{
+    std::list<ImagePtr> entries;
+
+    cache.getCopy(&entries);
+
+    return entries.size();
+}
+
+// Looks-up or creates images among a set of keys spread over all the shards, and evicts entries from time to time
+class CacheAccessThread
+    : public QThread
+{
+public:
+
+    CacheAccessThread(const ImageCache* cache,
+                      const std::vector<ImageKey>* keys,
+                      const ImageParamsPtr& params,
+                      unsigned int seed)
+        : QThread()
+        , _cache(cache)
+        , _keys(keys)
+        , _params(params)
+        , _seed(seed)
+        , _nErrors(0)
+    {
+    }
+
+    int getNErrors() const
+    {
+        return _nErrors;
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        // rand() is not thread-safe
+        unsigned int state = _seed;
+
+        for (int i = 0; i < 2000; ++i) {
+            state = state * 1103515245 + 12345;
+            const ImageKey& key = (*_keys)[(state >> 16) % _keys->size()];
+            ImagePtr image = getOrCreateImage(*_cache, key, _params);
+            if ( !image || !(image->getKey() == key) ) {
+                ++_nErrors;
+            }
+            if (i % 16 == 0) {
+                _cache->evictLRUInMemoryEntry();
+            }
+        }
+    }
+
+    const ImageCache* _cache;
+    const std::vector<ImageKey>* _keys;
+    ImageParamsPtr _params;
+    unsigned int _seed;
+    int _nErrors;
+};
+} // anon namespace
+
+TEST_F(BaseTest, ShardedCacheConcurrentAccess)
+{
+    const int nShards = 8;
+    const int nThreads = 8;
+    ImageParamsPtr params = makeImageParams();
+    const std::size_t imageSize = getImageSize(params);
+    // The cache can hold a quarter of the images: lookups, insertions and evictions run concurrently
+    const std::size_t maxSize = 16 * imageSize;
+    ImageCache cache("ShardedTestCache", NATRON_CACHE_VERSION, maxSize, 1., nShards);
+
+    ASSERT_EQ( nShards, cache.getNumShards() );
+    std::vector<ImageKey> keys;
+    for (U64 i = 0; i < 64; ++i) {
+        keys.push_back( makeImageKey(i + 1) );
+    }
+
+    std::vector<boost::shared_ptr<CacheAccessThread> > threads;
+    for (int i = 0; i < nThreads; ++i) {
+        threads.push_back( boost::shared_ptr<CacheAccessThread>( new CacheAccessThread(&cache, &keys, params, i + 1) ) );
+        threads.back()->start();
+    }
+    for (int i = 0; i < nThreads; ++i) {
+        threads[i]->wait();
+        EXPECT_EQ( 0, threads[i]->getNErrors() );
+    }
+
+    // Wait for the evicted entries to be destroyed
+    cache.waitForDeleterThread();
+
+    // Concurrent look-ups of the same key never create the entry twice
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        std::list<ImagePtr> found;
+        if ( cache.get(keys[i], &found) ) {
+            EXPECT_EQ( (std::size_t)1, found.size() );
+        }
+    }
+
+    // The size shared by all shards accounts exactly for the entries left, which exceed the budget by at most
+    // one image per thread allocated after its eviction check
+    std::list<ImagePtr> entries;
+    cache.getCopy(&entries);
+    std::size_t entriesSize = 0;
+    for (std::list<ImagePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+        entriesSize += (*it)->size();
+    }
+    entries.clear();
+    EXPECT_EQ( entriesSize, cache.getMemoryCacheSize() );
+    EXPECT_LE( cache.getMemoryCacheSize(), maxSize + nThreads * imageSize );
+
+    cache.clear();
+    cache.waitForDeleterThread();
+    EXPECT_EQ( (std::size_t)0, getNumEntries(cache) );
+    EXPECT_EQ( (std::size_t)0, cache.getMemoryCacheSize() );
+}
+
+TEST_F(BaseTest, ShardedCacheBudget)
+{
+    const int nShards = 4;
+    ImageParamsPtr params = makeImageParams();
+    const std::size_t imageSize = getImageSize(params);
+    ImageCache cache("ShardedBudgetTestCache", NATRON_CACHE_VERSION, 8 * imageSize, 1., nShards);
+
+    // Only evict once the cache is full
+    cache.setEvictionWatermarks(1., 1.);
+    U64 nodeHash = 1;
+
+    // Shards share the budget of the cache: a single shard may fill it
+    std::vector<ImageKey> shard0Keys;
+    for (int i = 0; i < 8; ++i) {
+        shard0Keys.push_back( makeImageKeyInShard(0, nShards, &nodeHash) );
+        ImagePtr image = getOrCreateImage(cache, shard0Keys.back(), params);
+        ASSERT_TRUE(image);
+        EXPECT_EQ( imageSize, image->size() );
+    }
+    EXPECT_EQ( (std::size_t)8, getNumEntries(cache) );
+    EXPECT_EQ( 8 * imageSize, cache.getMemoryCacheSize() );
+
+    {
+        // Entries of another shard, in use: the cache is full, so they are only allocated once the background threads
+        // are stopped to control when the eviction happens
+        std::vector<ImagePtr> shard1Images;
+        for (int i = 0; i < 4; ++i) {
+            shard1Images.push_back( getOrCreateImage(cache, makeImageKeyInShard(1, nShards, &nodeHash), params, false) );
+            ASSERT_TRUE( shard1Images.back() );
+        }
+        cache.waitForDeleterThread();
+        for (std::size_t i = 0; i < shard1Images.size(); ++i) {
+            shard1Images[i]->allocateMemory();
+        }
+        EXPECT_EQ( 12 * imageSize, cache.getMemoryCacheSize() );
+
+        // The shard of the entries over budget has nothing it can evict: the least recently used entries of the
+        // other shard go instead, and the cache is back within its budget
+        cache.evictToLowWatermark();
+        cache.waitForDeleterThread();
+        EXPECT_EQ( 8 * imageSize, cache.getMemoryCacheSize() );
+        for (std::size_t i = 0; i < shard1Images.size(); ++i) {
+            EXPECT_TRUE( isCached( cache, shard1Images[i]->getKey() ) );
+        }
+        for (std::size_t i = 0; i < shard0Keys.size(); ++i) {
+            EXPECT_EQ( i >= 4, isCached(cache, shard0Keys[i]) ) << "entry " << i;
+        }
+    }
+
+    cache.clear();
+    cache.waitForDeleterThread();
+}
+
+TEST_F(BaseTest, CacheEvictionWatermarks)
+{
+    ImageParamsPtr params = makeImageParams();
+    const std::size_t imageSize = getImageSize(params);
+    ImageCache cache("WatermarksTestCache", NATRON_CACHE_VERSION, 10 * imageSize, 1.);
+
+    cache.setEvictionWatermarks(0.8, 0.5);
+    std::vector<ImageKey> keys;
+    for (U64 i = 0; i < 9; ++i) {
+        keys.push_back( makeImageKey(i + 1) );
+    }
+
+    // Up to the high watermark, nothing is evicted
+    for (std::size_t i = 0; i < 8; ++i) {
+        ASSERT_TRUE( getOrCreateImage(cache, keys[i], params) );
+    }
+    cache.waitForDeleterThread();
+    cache.evictToLowWatermark();
+    cache.waitForDeleterThread();
+    EXPECT_EQ( (std::size_t)8, getNumEntries(cache) );
+    EXPECT_EQ( 8 * imageSize, cache.getMemoryCacheSize() );
+
+    // Beyond it, the least recently used entries are evicted down to the low watermark, either by the evictor thread
+    // or by the call below if the thread did not run yet
+    ASSERT_TRUE( getOrCreateImage(cache, keys[8], params) );
+    cache.waitForDeleterThread();
+    cache.evictToLowWatermark();
+    cache.waitForDeleterThread();
+    EXPECT_EQ( (std::size_t)5, getNumEntries(cache) );
+    EXPECT_EQ( 5 * imageSize, cache.getMemoryCacheSize() );
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        EXPECT_EQ( i >= 4, isCached(cache, keys[i]) ) << "entry " << i;
+    }
+
+    // Creating entries never evicts under the high watermark
+    cache.setEvictionWatermarks(1., 0.);
+    for (U64 i = 0; i < 5; ++i) {
+        ASSERT_TRUE( getOrCreateImage(cache, makeImageKey(100 + i), params) );
+    }
+    cache.waitForDeleterThread();
+    EXPECT_EQ( (std::size_t)10, getNumEntries(cache) );
+
+    cache.clear();
+    cache.waitForDeleterThread();
+}
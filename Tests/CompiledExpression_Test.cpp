@@ -0,0 +1,390 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+
+#include "BaseTest.h"
+
+#include "Engine/AppInstance.h"
+#include "Engine/CompiledExpression.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/Node.h"
+#include "Engine/Project.h"
+#include "Engine/PyExprUtils.h"
+#include "Engine/Timer.h"
+
+NATRON_NAMESPACE_USING
+
+namespace {
+// Parameters are not available in these tests: expressions referencing them are not compiled
+class NullResolver
+    : public CompiledExpression::Resolver
+{
+public:
+
+    virtual KnobIPtr resolveParam(const std::vector<std::string>& /*names*/) const OVERRIDE FINAL
+    {
+        return KnobIPtr();
+    }
+};
+
+CompiledExpressionPtr
+compile(const std::string& expr)
+{
+    NullResolver resolver;
+
+    return CompiledExpression::compile(expr, resolver);
+}
+
+bool
+evaluate(const std::string& expr,
+         double time,
+         CompiledExpression::Value* v)
+{
+    CompiledExpressionPtr compiled = compile(expr);
+
+    if (!compiled) {
+        return false;
+    }
+
+    return compiled->evaluate( time, ViewIdx(0), 0, v );
+}
+}
+
+TEST(CompiledExpression, Arithmetic)
+{
+    CompiledExpression::Value v;
+
+    ASSERT_TRUE( evaluate("frame * 2 + 1", 10., &v) );
+    EXPECT_TRUE(v.isInt);
+    EXPECT_EQ(21., v.value);
+
+    ASSERT_TRUE( evaluate("frame * 2", 10.5, &v) );
+    EXPECT_FALSE(v.isInt);
+    EXPECT_EQ(21., v.value);
+
+    ASSERT_TRUE( evaluate("frame / 4", 10., &v) );
+#if PY_MAJOR_VERSION >= 3
+    EXPECT_FALSE(v.isInt);
+    EXPECT_EQ(2.5, v.value);
+#else
+    EXPECT_TRUE(v.isInt);
+    EXPECT_EQ(2., v.value);
+#endif
+
+    // Python rounds integer divisions and modulos towards negative infinity
+    ASSERT_TRUE( evaluate("-7 // 2", 0., &v) );
+    EXPECT_EQ(-4., v.value);
+    ASSERT_TRUE( evaluate("-7 % 3", 0., &v) );
+    EXPECT_EQ(2., v.value);
+    ASSERT_TRUE( evaluate("7.5 % -2", 0., &v) );
+    EXPECT_EQ(-0.5, v.value);
+
+    // ** is right-associative and binds tighter than the unary minus
+    ASSERT_TRUE( evaluate("-2 ** 3 ** 2", 0., &v) );
+    EXPECT_TRUE(v.isInt);
+    EXPECT_EQ(-512., v.value);
+    ASSERT_TRUE( evaluate("2 ** -1", 0., &v) );
+    EXPECT_FALSE(v.isInt);
+    EXPECT_EQ(0.5, v.value);
+
+    ASSERT_TRUE( evaluate("(dimension + 1) * (view + 2)", 0., &v) );
+    EXPECT_EQ(2., v.value);
+}
+
+TEST(CompiledExpression, Functions)
+{
+    CompiledExpression::Value v;
+
+    ASSERT_TRUE( evaluate("sin(frame) * 10 + cos(pi)", 3., &v) );
+    EXPECT_DOUBLE_EQ(std::sin(3.) * 10 - 1., v.value);
+
+    ASSERT_TRUE( evaluate("max(1, frame, 2.5)", 2., &v) );
+    EXPECT_FALSE(v.isInt);
+    EXPECT_EQ(2.5, v.value);
+
+    ASSERT_TRUE( evaluate("abs(-3) + int(2.7)", 0., &v) );
+    EXPECT_TRUE(v.isInt);
+    EXPECT_EQ(5., v.value);
+
+    ASSERT_TRUE( evaluate("log(8, 2)", 0., &v) );
+    EXPECT_DOUBLE_EQ(3., v.value);
+
+    ASSERT_TRUE( evaluate("ExprUtils.smoothstep(frame, 0, 20)", 5., &v) );
+    EXPECT_DOUBLE_EQ(NATRON_NAMESPACE::NATRON_PYTHON_NAMESPACE::ExprUtils::smoothstep(5., 0., 20.), v.value);
+    ASSERT_TRUE( evaluate("NatronEngine.ExprUtils.mix(1, 3, 0.25)", 0., &v) );
+    EXPECT_DOUBLE_EQ(1.5, v.value);
+}
+
+TEST(CompiledExpression, FallbackToPython)
+{
+    // Would raise an exception in Python: the interpreter must handle it
+    CompiledExpression::Value v;
+
+    EXPECT_FALSE( evaluate("1 / (frame - 10)", 10., &v) );
+    EXPECT_TRUE( evaluate("1 / (frame - 10)", 11., &v) );
+    EXPECT_FALSE( evaluate("sqrt(frame)", -1., &v) );
+    EXPECT_FALSE( evaluate("2 ** 60", 0., &v) );
+
+    // Not supported
+    EXPECT_FALSE( compile("") );
+    EXPECT_FALSE( compile("random()") );
+    EXPECT_FALSE( compile("frame > 1") );
+    EXPECT_FALSE( compile("'a'") );
+    EXPECT_FALSE( compile("010") );
+    EXPECT_FALSE( compile("0x10") );
+    EXPECT_FALSE( compile("1j") );
+    EXPECT_FALSE( compile("min(frame)") );
+    EXPECT_FALSE( compile("frame +") );
+    EXPECT_FALSE( compile("(frame") );
+    EXPECT_FALSE( compile("unknown * 2") );
+    EXPECT_FALSE( compile("ret = frame") );
+    EXPECT_FALSE( compile("ExprUtils.fbm(frame)") );
+
+    // Parameters which can not be resolved
+    EXPECT_FALSE( compile("Blur1.size.get()[0] * 2") );
+    EXPECT_FALSE( compile("thisNode.mix.getValueAtTime(frame - 1)") );
+}
+
+namespace {
+class ExpressionThread
+    : public QThread
+{
+public:
+
+    ExpressionThread(const CompiledExpressionPtr& expr,
+                     int nEvaluations,
+                     QMutex* gil)
+        : QThread()
+        , _expr(expr)
+        , _nEvaluations(nEvaluations)
+        , _gil(gil)
+        , _sum(0.)
+    {
+    }
+
+    double getSum() const
+    {
+        return _sum;
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        CompiledExpression::Value v;
+
+        for (int i = 0; i < _nEvaluations; ++i) {
+            if (_gil) {
+                QMutexLocker k(_gil);
+                if ( _expr->evaluate( i % 100, ViewIdx(0), 0, &v ) ) {
+                    _sum += v.value;
+                }
+            } else if ( _expr->evaluate( i % 100, ViewIdx(0), 0, &v ) ) {
+                _sum += v.value;
+            }
+        }
+    }
+
+    CompiledExpressionPtr _expr;
+    int _nEvaluations;
+    QMutex* _gil;
+    double _sum;
+};
+}
+
+// Micro-benchmark: evaluates an expression from 1 and 32 threads, concurrently and serialized by a lock like the GIL.
+// Disabled by default, run with --gtest_also_run_disabled_tests
+TEST(CompiledExpression, DISABLED_ThreadsBenchmark)
+{
+    CompiledExpressionPtr expr = compile("ExprUtils.smoothstep(frame, 0, 100) * sin(frame * pi / 50) + 2");
+
+    ASSERT_TRUE(expr);
+    const int nEvaluations = 3200000;
+    const int threadCounts[2] = { 1, 32 };
+    for (int t = 0; t < 2; ++t) {
+        const int nThreads = threadCounts[t];
+        double times[2];
+        double sums[2];
+        for (int serialized = 0; serialized < 2; ++serialized) {
+            QMutex gil;
+            std::vector<ExpressionThread*> threads;
+            for (int i = 0; i < nThreads; ++i) {
+                threads.push_back( new ExpressionThread(expr, nEvaluations / nThreads, serialized ? &gil : 0) );
+            }
+            TimeLapse timer;
+            for (int i = 0; i < nThreads; ++i) {
+                threads[i]->start();
+            }
+            sums[serialized] = 0.;
+            for (int i = 0; i < nThreads; ++i) {
+                threads[i]->wait();
+                sums[serialized] += threads[i]->getSum();
+                delete threads[i];
+            }
+            times[serialized] = timer.getTimeSinceCreation() * 1000.;
+        }
+        EXPECT_DOUBLE_EQ(sums[0], sums[1]);
+        std::cout << nEvaluations << " evaluations on " << nThreads << " threads: concurrent " << times[0]
+                  << "ms, serialized " << times[1] << "ms" << std::endl;
+    }
+}
+
+namespace {
+// Resolves <node>.<param> to the parameters of the top-level nodes of the project
+class ProjectResolver
+    : public CompiledExpression::Resolver
+{
+public:
+
+    ProjectResolver(const AppInstancePtr& app)
+        : _app(app)
+    {
+    }
+
+    virtual KnobIPtr resolveParam(const std::vector<std::string>& names) const OVERRIDE FINAL
+    {
+        if (names.size() != 2) {
+            return KnobIPtr();
+        }
+        NodePtr node = _app->getProject()->getNodeByName(names[0]);
+
+        return node ? node->getKnobByName(names[1]) : KnobIPtr();
+    }
+
+private:
+
+    AppInstancePtr _app;
+};
+}
+
+TEST_F(BaseTest, CompiledExpressionParams)
+{
+    NodePtr node = createNode(_generatorPluginID);
+
+    ASSERT_TRUE(node);
+    KnobDoublePtr slope = toKnobDouble( node->getKnobByName("noiseZSlope") );
+    ASSERT_TRUE(slope);
+    slope->setValueAtTime(0, 0., ViewSpec::all(), 0);
+    slope->setValueAtTime(100, 1., ViewSpec::all(), 0);
+
+    const std::string name = node->getScriptName_mt_safe();
+    ProjectResolver resolver( getApp() );
+    CompiledExpression::Value v;
+
+    CompiledExpressionPtr expr = CompiledExpression::compile(name + ".noiseZSlope.getValueAtTime(frame) * 2", resolver);
+    ASSERT_TRUE(expr);
+    ASSERT_TRUE( expr->evaluate( 50., ViewIdx(0), 0, &v ) );
+    EXPECT_FALSE(v.isInt);
+    EXPECT_DOUBLE_EQ(1., v.value);
+
+    expr = CompiledExpression::compile(name + ".noiseZSlope.get(frame - 10)", resolver);
+    ASSERT_TRUE(expr);
+    ASSERT_TRUE( expr->evaluate( 60., ViewIdx(0), 0, &v ) );
+    EXPECT_DOUBLE_EQ(0.5, v.value);
+
+    // Unknown nodes and parameters are left to Python
+    EXPECT_FALSE( CompiledExpression::compile("Unknown1.noiseZSlope.get()", resolver) );
+    EXPECT_FALSE( CompiledExpression::compile(name + ".unknown.get()", resolver) );
+}
+
+// The compiled expressions must evaluate to the same values as the interpreter, which evaluates the expressions
+// declaring a ret variable as these are never compiled
+TEST_F(BaseTest, CompiledExpressionMatchesPython)
+{
+    NodePtr source = createNode(_generatorPluginID);
+    NodePtr constant = createNode(_generatorPluginID);
+    NodePtr target = createNode(_generatorPluginID);
+
+    ASSERT_TRUE(source && constant && target);
+    KnobDoublePtr sourceSlope = toKnobDouble( source->getKnobByName("noiseZSlope") );
+    KnobDoublePtr constantSlope = toKnobDouble( constant->getKnobByName("noiseZSlope") );
+    KnobDoublePtr targetSlope = toKnobDouble( target->getKnobByName("noiseZSlope") );
+    ASSERT_TRUE(sourceSlope && constantSlope && targetSlope);
+    sourceSlope->setValueAtTime(0, 0., ViewSpec::all(), 0);
+    sourceSlope->setValueAtTime(100, 1., ViewSpec::all(), 0);
+    constantSlope->setValue(0.75);
+
+    const std::string sourceParam = source->getScriptName_mt_safe() + ".noiseZSlope";
+    const std::string constantParam = constant->getScriptName_mt_safe() + ".noiseZSlope";
+    const std::string exprs[] = {
+        "frame * 2 + 1",
+        "frame / 4 + frame // 3 - frame % 7",
+        "-frame ** 2 / 1000.",
+        "sin(frame) * 10 + cos(pi) + sqrt(frame + 1)",
+        "max(1, frame, 2.5) + min(frame, 3) + abs(5 - frame)",
+        "ExprUtils.smoothstep(frame, 0, 20) + ExprUtils.mix(1, 3, 0.25)",
+        sourceParam + ".getValueAtTime(frame) * 2",
+        sourceParam + ".get(frame - 10) + " + constantParam + ".get()",
+        constantParam + ".getValue(0) * frame",
+    };
+    ProjectResolver resolver( getApp() );
+
+    for (std::size_t i = 0; i < sizeof(exprs) / sizeof(exprs[0]); ++i) {
+        CompiledExpressionPtr compiled = CompiledExpression::compile(exprs[i], resolver);
+        ASSERT_TRUE(compiled) << exprs[i];
+        targetSlope->setExpression(0, "ret = " + exprs[i], true, true);
+        for (int frame = 1; frame <= 31; frame += 5) {
+            CompiledExpression::Value v;
+            ASSERT_TRUE( compiled->evaluate( frame, ViewIdx(0), 0, &v ) ) << exprs[i];
+            EXPECT_NEAR(targetSlope->getValueAtTime(frame, 0, ViewSpec::current(), false), v.value, 1e-9) << exprs[i] << " at frame " << frame;
+        }
+    }
+}
+
+// Expressions which can not be compiled are still evaluated by Python
+TEST_F(BaseTest, CompiledExpressionFallbackToPython)
+{
+    NodePtr source = createNode(_generatorPluginID);
+    NodePtr target = createNode(_generatorPluginID);
+
+    ASSERT_TRUE(source && target);
+    KnobDoublePtr sourceSlope = toKnobDouble( source->getKnobByName("noiseZSlope") );
+    KnobDoublePtr targetSlope = toKnobDouble( target->getKnobByName("noiseZSlope") );
+    ASSERT_TRUE(sourceSlope && targetSlope);
+    sourceSlope->setValue(0.5);
+
+    const std::string sourceParam = source->getScriptName_mt_safe() + ".noiseZSlope";
+    ProjectResolver resolver( getApp() );
+
+    const std::string conditional = "frame if frame > 10 else " + sourceParam + ".get()";
+    EXPECT_FALSE( CompiledExpression::compile(conditional, resolver) );
+    targetSlope->setExpression(0, conditional, false, true);
+    EXPECT_DOUBLE_EQ( 0.5, targetSlope->getValueAtTime(5, 0, ViewSpec::current(), false) );
+    EXPECT_DOUBLE_EQ( 20., targetSlope->getValueAtTime(20, 0, ViewSpec::current(), false) );
+
+    const std::string list = "[frame, 2 * frame][1]";
+    EXPECT_FALSE( CompiledExpression::compile(list, resolver) );
+    targetSlope->setExpression(0, list, false, true);
+    EXPECT_DOUBLE_EQ( 14., targetSlope->getValueAtTime(7, 0, ViewSpec::current(), false) );
+}
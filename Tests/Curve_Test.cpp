@@ -24,6 +24,8 @@
 
 #include "Global/Macros.h"
 
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include <QtCore/QString>
@@ -124,3 +126,71 @@ TEST(Curve, Basic)
 }
 
 
+
+TEST(Curve, KeyFramesHash)
+{
+    Curve c;
+    Curve c2;
+
+    EXPECT_EQ( c.getKeyFramesHash(), c2.getKeyFramesHash() );
+
+    KeyFrame k0(0., 0.);
+    KeyFrame k1(10., 1.);
+    k1.setLeftDerivative(0.5);
+    k1.setRightDerivative(0.5);
+    k1.setInterpolation(eKeyframeTypeFree);
+    k0.setInterpolation(eKeyframeTypeFree);
+    c.addKeyFrame(k0);
+    U64 oneKeyHash = c.getKeyFramesHash();
+    EXPECT_NE( oneKeyHash, c2.getKeyFramesHash() );
+
+    // the cached hash must be invalidated when the curve changes
+    c.addKeyFrame(k1);
+    EXPECT_NE( oneKeyHash, c.getKeyFramesHash() );
+    // the hash of the keyframes must be stable across sessions, since it is part of the hash of cached images
+    EXPECT_EQ( 0xe85dc6cbbe860f56ULL, c.getKeyFramesHash() );
+
+    c2.addKeyFrame(k1);
+    c2.addKeyFrame(k0);
+    EXPECT_EQ( c.getKeyFramesHash(), c2.getKeyFramesHash() );
+
+    c.removeKeyFrameWithTime(10.);
+    EXPECT_EQ( oneKeyHash, c.getKeyFramesHash() );
+
+    c.clearKeyFrames();
+    EXPECT_EQ( Curve().getKeyFramesHash(), c.getKeyFramesHash() );
+}
+
+// getValueAt caches the values and the last keyframe segment per thread: the order of the evaluations must not
+// change the results, and changing the curve must invalidate them
+TEST(Curve, ValueCacheAndSegmentHint)
+{
+    Curve c;
+
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_TRUE( c.addKeyFrame( KeyFrame(i * 5., (i * 37) % 11) ) );
+    }
+
+    std::vector<double> forward;
+    for (int t = -10; t <= 110; ++t) {
+        forward.push_back( c.getValueAt(t * 1.) );
+    }
+    for (int t = 110; t >= -10; --t) {
+        EXPECT_EQ( forward[t + 10], c.getValueAt(t * 1.) ) << "time " << t;
+    }
+    for (int i = 0; i < 500; ++i) {
+        int t = (i * 7919) % 121 - 10;
+        EXPECT_EQ( forward[t + 10], c.getValueAt(t * 1.) ) << "time " << t;
+    }
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_EQ( (double)( (i * 37) % 11 ), c.getValueAt(i * 5.) );
+    }
+
+    // the cached values are invalidated by a change of the curve
+    EXPECT_FALSE( c.addKeyFrame( KeyFrame(50., 100.) ) );
+    EXPECT_EQ( 100., c.getValueAt(50.) );
+    EXPECT_NE( forward[51 + 10], c.getValueAt(51.) );
+    c.removeKeyFrameWithTime(50.);
+    EXPECT_EQ( forward[45 + 10], c.getValueAt(45.) );
+    EXPECT_NE( 100., c.getValueAt(50.) );
+}
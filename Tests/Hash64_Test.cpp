@@ -90,3 +90,59 @@ TEST(Hash64,
     EXPECT_NE(hash1, hash2);
 } // TEST
 
+
+// Adding values after computing the hash, then computing it again, gives the hash of all values
+TEST(Hash64,
+     Streaming)
+{
+    for (int n = 1; n < 20; ++n) {
+        Hash64 whole;
+        for (int i = 0; i < n; ++i) {
+            whole.append<int>(i);
+        }
+        whole.computeHash();
+
+        for (int split = 0; split <= n; ++split) {
+            Hash64 streamed;
+            for (int i = 0; i < split; ++i) {
+                streamed.append<int>(i);
+            }
+            streamed.computeHash();
+            for (int i = split; i < n; ++i) {
+                streamed.append<int>(i);
+            }
+            streamed.computeHash();
+            EXPECT_EQ( whole.value(), streamed.value() ) << n << " values split at " << split;
+        }
+    }
+}
+
+// The disk cache identifies entries by their hash across sessions and versions: these values must never change
+// unless NATRON_CACHE_VERSION is incremented. They are the XXH64 (seed 0) of the values as 8 little-endian bytes.
+TEST(Hash64,
+     StableAcrossSessions)
+{
+    Hash64 hash;
+
+    hash.append<int>(3);
+    hash.computeHash();
+    EXPECT_EQ(0x87b8166da7ec4841ULL, hash.value());
+
+    hash.reset();
+    for (int i = 0; i < 10; ++i) {
+        hash.append<int>(i);
+    }
+    hash.computeHash();
+    EXPECT_EQ(0x04673d65c892b5baULL, hash.value());
+
+    hash.reset();
+    hash.append<int>(42);
+    hash.append<double>(1.5);
+    hash.append<bool>(true);
+    hash.append<unsigned short>('N');
+    hash.append<U64>(0xdeadbeefcafebabeULL);
+    hash.append<double>(-0.25);
+    hash.append<float>(2.f);
+    hash.computeHash();
+    EXPECT_EQ(0x0247e71b967242f0ULL, hash.value());
+}
@@ -25,9 +25,16 @@
 #include "Global/Macros.h"
 
 #include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <iostream>
+
 #include <gtest/gtest.h>
 
 #include "Engine/Image.h"
+#include "Engine/ImageDownscale.h"
+#include "Engine/Timer.h"
 #include "Engine/ViewIdx.h"
 
 NATRON_NAMESPACE_USING
@@ -153,3 +160,240 @@ TEST(ImageKeyTest, Difference) {
     ASSERT_TRUE(keyHash1 != keyHash2);
 }
 
+namespace {
+template <typename PIX>
+std::vector<PIX>
+makeImage(const RectI& bounds,
+          int nComps,
+          int maxValue)
+{
+    std::vector<PIX> img(bounds.area() * nComps);
+
+    for (std::size_t i = 0; i < img.size(); ++i) {
+        // coverity[dont_call]
+        img[i] = maxValue == 1 ? PIX( (std::rand() % 1000) / 1000. ) : PIX(std::rand() % (maxValue + 1));
+    }
+
+    return img;
+}
+
+// Reference: the exact average of the source pixels covered by each destination pixel, computed in double
+template <typename PIX>
+void
+checkDownscale(const RectI& srcBounds,
+               const RectI& srcRoI,
+               int nComps,
+               unsigned int levels,
+               int maxValue,
+               ImageBitDepthEnum depth)
+{
+    const std::vector<PIX> src = makeImage<PIX>(srcBounds, nComps, maxValue);
+    const RectI dstRoI = srcRoI.downscalePowerOfTwoSmallestEnclosing(levels);
+    std::vector<PIX> ref(dstRoI.area() * nComps);
+    const int blockSize = 1 << levels;
+
+    for (int y = dstRoI.y1; y < dstRoI.y2; ++y) {
+        for (int x = dstRoI.x1; x < dstRoI.x2; ++x) {
+            for (int k = 0; k < nComps; ++k) {
+                double sum = 0.;
+                int count = 0;
+                for (int sy = std::max(y * blockSize, srcRoI.y1); sy < std::min( (y + 1) * blockSize, srcRoI.y2 ); ++sy) {
+                    for (int sx = std::max(x * blockSize, srcRoI.x1); sx < std::min( (x + 1) * blockSize, srcRoI.x2 ); ++sx) {
+                        sum += src[( (sy - srcBounds.y1) * srcBounds.width() + sx - srcBounds.x1 ) * nComps + k];
+                        ++count;
+                    }
+                }
+                ref[( (y - dstRoI.y1) * dstRoI.width() + x - dstRoI.x1 ) * nComps + k] = maxValue == 1 ? PIX(sum / count) : PIX( std::floor(sum / count) );
+            }
+        }
+    }
+
+    std::vector<PIX> scalarRes;
+    for (int is = eInstructionSetScalar; is <= (int)getBestInstructionSet(); ++is) {
+        for (int mt = 0; mt < 2; ++mt) {
+            std::vector<PIX> res(ref.size(), PIX(0));
+            ImageDownscale::downscaleRoI( (InstructionSetEnum)is, depth, nComps, levels, srcRoI, &src[0], 0, srcBounds, &res[0], 0, dstRoI, mt );
+            for (std::size_t i = 0; i < ref.size(); ++i) {
+                if (maxValue == 1) {
+                    // half results may differ from the reference by one unit in the last place
+                    EXPECT_NEAR(ref[i], res[i], depth == eImageBitDepthHalf ? 1e-3 : 1e-5) << getInstructionSetName( (InstructionSetEnum)is ) << " element " << i;
+                } else {
+                    EXPECT_EQ(ref[i], res[i]) << getInstructionSetName( (InstructionSetEnum)is ) << " element " << i;
+                }
+            }
+            // All instruction sets and threading modes give the same result
+            if ( scalarRes.empty() ) {
+                scalarRes = res;
+            } else {
+                EXPECT_TRUE(scalarRes == res);
+            }
+        }
+    }
+}
+} // anon namespace
+
+TEST(ImageDownscale,
+     MatchesBoxFilter)
+{
+    // RoIs which are not aligned on the block size, with negative coordinates and 1D cases
+    const RectI srcBounds(-37, -21, 300, 260);
+    const RectI rois[] = {
+        RectI(-37, -21, 300, 260),
+        RectI(-33, -15, 211, 197),
+        RectI(5, 7, 6, 200),
+        RectI(-20, 40, 250, 41)
+    };
+
+    for (std::size_t r = 0; r < sizeof(rois) / sizeof(rois[0]); ++r) {
+        for (unsigned int levels = 1; levels <= NATRON_IMAGE_DOWNSCALE_MAX_FUSED_LEVELS; ++levels) {
+            for (int nComps = 1; nComps <= 4; ++nComps) {
+                checkDownscale<float>(srcBounds, rois[r], nComps, levels, 1, eImageBitDepthFloat);
+                checkDownscale<Half>(srcBounds, rois[r], nComps, levels, 1, eImageBitDepthHalf);
+                checkDownscale<unsigned short>(srcBounds, rois[r], nComps, levels, 65535, eImageBitDepthShort);
+                checkDownscale<unsigned char>(srcBounds, rois[r], nComps, levels, 255, eImageBitDepthByte);
+            }
+        }
+    }
+}
+
+TEST(ImageDownscale,
+     Bitmap)
+{
+    const RectI bounds(0, 0, 16, 16);
+    std::vector<float> src(bounds.area(), 1.f), dst(4 * 4);
+    std::vector<char> srcBm(bounds.area(), 1), dstBm(4 * 4, 0);
+
+    // One pixel not rendered and one being rendered
+    srcBm[5 * 16 + 5] = 0;
+    srcBm[13 * 16 + 2] = 2;
+    ImageDownscale::downscaleRoI(eInstructionSetScalar, eImageBitDepthFloat, 1, 2, bounds, &src[0], &srcBm[0], bounds, &dst[0], &dstBm[0], RectI(0, 0, 4, 4), false);
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            bool notRendered = (x == 1 && y == 1) || (x == 0 && y == 3);
+            EXPECT_EQ(notRendered ? 0 : 1, dstBm[y * 4 + x]);
+        }
+    }
+}
+
+// Micro-benchmark: building the level 3 mipmap of a UHD RGBA image, one level at a time as was done before,
+// in a single pass, then with threads.
+// Disabled by default, run with --gtest_also_run_disabled_tests
+TEST(ImageDownscale,
+     DISABLED_Benchmark)
+{
+    const RectI bounds(0, 0, 3840, 2160);
+    const int nComps = 4;
+    const unsigned int levels = 3;
+    const std::vector<float> srcFloat = makeImage<float>(bounds, nComps, 1);
+    const std::vector<unsigned char> srcByte = makeImage<unsigned char>(bounds, nComps, 255);
+
+    for (int is = eInstructionSetScalar; is <= (int)getBestInstructionSet(); ++is) {
+        for (int d = 0; d < 2; ++d) {
+            const ImageBitDepthEnum depth = d == 0 ? eImageBitDepthFloat : eImageBitDepthByte;
+            const std::size_t pixSize = d == 0 ? sizeof(float) : sizeof(unsigned char);
+            const void* src = d == 0 ? (const void*)&srcFloat[0] : (const void*)&srcByte[0];
+            double times[3];
+            for (int mode = 0; mode < 3; ++mode) {
+                std::vector<unsigned char> level1(bounds.area() * nComps * pixSize), level2( level1.size() ), dst( level1.size() );
+                TimeLapse timer;
+                if (mode == 0) {
+                    RectI roi = bounds;
+                    const void* levelSrc = src;
+                    unsigned char* levelDst[3] = { &level1[0], &level2[0], &dst[0] };
+                    for (unsigned int i = 0; i < levels; ++i) {
+                        RectI halved = roi.downscalePowerOfTwoSmallestEnclosing(1);
+                        ImageDownscale::downscaleRoI( (InstructionSetEnum)is, depth, nComps, 1, roi, levelSrc, 0, roi, levelDst[i], 0, halved, false );
+                        levelSrc = levelDst[i];
+                        roi = halved;
+                    }
+                } else {
+                    ImageDownscale::downscaleRoI( (InstructionSetEnum)is, depth, nComps, levels, bounds, src, 0, bounds, &dst[0], 0, bounds.downscalePowerOfTwoSmallestEnclosing(levels), mode == 2 );
+                }
+                times[mode] = timer.getTimeSinceCreation() * 1000.;
+            }
+            std::cout << "3840x2160 RGBA " << (d == 0 ? "float " : "byte ") << getInstructionSetName( (InstructionSetEnum)is ) << ": level by level "
+                      << times[0] << "ms, fused " << times[1] << "ms, fused multi-threaded " << times[2] << "ms" << std::endl;
+        }
+    }
+}
+
+TEST(HalfTest,
+     Conversions)
+{
+    // Every half value converts to float and back exactly, with the same result for all instruction sets
+    std::vector<Half> halves(65536);
+    for (int i = 0; i < 65536; ++i) {
+        halves[i] = Half::fromBits( (unsigned short)i );
+    }
+    std::vector<float> scalarFloats(65536), floats(65536);
+    HalfConversion::halfToFloatRow(eInstructionSetScalar, &halves[0], 65536, &scalarFloats[0]);
+    HalfConversion::halfToFloatRow(getBestInstructionSet(), &halves[0], 65536, &floats[0]);
+    ASSERT_EQ( 0, std::memcmp( &scalarFloats[0], &floats[0], floats.size() * sizeof(float) ) );
+    for (int i = 0; i < 65536; ++i) {
+        const bool isNaN = (i & 0x7fff) > 0x7c00;
+        if (!isNaN) {
+            EXPECT_EQ( i, Half(floats[i]).bits() );
+        }
+    }
+
+    EXPECT_EQ( 1.f, float( Half(1.f) ) );
+    EXPECT_EQ( -0.5f, float( Half(-0.5f) ) );
+    EXPECT_EQ( 65504.f, float( Half(65504.f) ) );
+    EXPECT_EQ( 0x7c00, Half(65520.f).bits() ); // rounds to infinity
+    EXPECT_EQ( 0x3c00, Half(1.f + 1.f / 2048).bits() ); // ties round to even
+    EXPECT_EQ( 0x3c02, Half(1.f + 3.f / 2048).bits() );
+    EXPECT_EQ( 0x0001, Half(5.96046448e-8f).bits() ); // smallest denormalized half
+    EXPECT_EQ( 0, Half(2.9e-8f).bits() );
+
+    // Floats, including denormalized halves and values out of range, convert to the same half with all instruction sets
+    const int n = 100000;
+    std::vector<float> src(n);
+    for (int i = 0; i < n; ++i) {
+        // coverity[dont_call]
+        src[i] = (std::rand() % 2 ? 1.f : -1.f) * std::pow( 2.f, (std::rand() % 50) - 30.f ) * (1.f + (std::rand() % 100000) / 100000.f);
+    }
+    std::vector<Half> scalarHalves(n), bestHalves(n);
+    HalfConversion::floatToHalfRow(eInstructionSetScalar, &src[0], n, &scalarHalves[0]);
+    HalfConversion::floatToHalfRow(getBestInstructionSet(), &src[0], n, &bestHalves[0]);
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ( scalarHalves[i].bits(), bestHalves[i].bits() ) << src[i];
+    }
+}
+
+TEST(HalfTest,
+     ImageConversion)
+{
+    const RectI bounds(-3, 2, 61, 37);
+    const RectD rod(-3, 2, 61, 37);
+    Image floatImg(ImageComponents::getRGBAComponents(), rod, bounds, 0, 1., eImageBitDepthFloat, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone);
+    Image halfImg(ImageComponents::getRGBAComponents(), rod, bounds, 0, 1., eImageBitDepthHalf, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone);
+    Image roundTrip(ImageComponents::getRGBAComponents(), rod, bounds, 0, 1., eImageBitDepthFloat, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone);
+    const std::vector<float> pixels = makeImage<float>(bounds, 4, 1);
+
+    std::memcpy( floatImg.pixelAt(bounds.x1, bounds.y1), &pixels[0], pixels.size() * sizeof(float) );
+    floatImg.convertToFormat(bounds, eViewerColorSpaceLinear, eViewerColorSpaceLinear, -1, false, false, &halfImg);
+    halfImg.convertToFormat(bounds, eViewerColorSpaceLinear, eViewerColorSpaceLinear, -1, false, false, &roundTrip);
+    const float* roundTripPixels = (const float*)roundTrip.pixelAt(bounds.x1, bounds.y1);
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+        EXPECT_NEAR(pixels[i], roundTripPixels[i], 1e-3);
+    }
+
+    // Other conversions go through float: converting the half image to 8-bit sRGB alpha gives the same result as converting
+    // its float version
+    Image halfAlpha(ImageComponents::getAlphaComponents(), rod, bounds, 0, 1., eImageBitDepthByte, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone);
+    Image floatAlpha(ImageComponents::getAlphaComponents(), rod, bounds, 0, 1., eImageBitDepthByte, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone);
+    halfImg.convertToFormat(bounds, eViewerColorSpaceLinear, eViewerColorSpaceSRGB, -1, false, false, &halfAlpha);
+    roundTrip.convertToFormat(bounds, eViewerColorSpaceLinear, eViewerColorSpaceSRGB, -1, false, false, &floatAlpha);
+    EXPECT_EQ( 0, std::memcmp( halfAlpha.pixelAt(bounds.x1, bounds.y1), floatAlpha.pixelAt(bounds.x1, bounds.y1), bounds.area() ) );
+
+    // Fill and premultiplication work on half images
+    halfImg.fill(bounds, 0.5f, 0.25f, 1.f, 0.5f);
+    halfImg.premultImage(bounds);
+    const Half* halfPixels = (const Half*)halfImg.pixelAt(bounds.x1, bounds.y1);
+    for (int i = 0; i < bounds.area(); ++i) {
+        EXPECT_EQ( 0.25f, float(halfPixels[i * 4]) );
+        EXPECT_EQ( 0.125f, float(halfPixels[i * 4 + 1]) );
+        EXPECT_EQ( 0.5f, float(halfPixels[i * 4 + 2]) );
+        EXPECT_EQ( 0.5f, float(halfPixels[i * 4 + 3]) );
+    }
+}
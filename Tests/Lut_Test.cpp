@@ -25,8 +25,13 @@
 #include "Global/Macros.h"
 
 #include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <iostream>
 #include <gtest/gtest.h>
 #include "Engine/Lut.h"
+#include "Engine/Timer.h"
 
 NATRON_NAMESPACE_USING
 using namespace NATRON_NAMESPACE::Color;
@@ -51,3 +56,120 @@ TEST(Lut, IntConversions) {
         EXPECT_EQ( i, uint8xxToChar( charToUint8xx(i) ) );
     }
 }
+
+namespace {
+std::vector<const Lut*>
+getTestedLuts()
+{
+    std::vector<const Lut*> luts;
+
+    luts.push_back( LutManager::sRGBLut() );
+    luts.push_back( LutManager::Rec709Lut() );
+    luts.push_back( LutManager::CineonLut() );
+    luts.push_back( LutManager::Gamma2_2Lut() );
+    for (std::size_t i = 0; i < luts.size(); ++i) {
+        luts[i]->validate();
+    }
+
+    return luts;
+}
+
+// Linear values mostly in [0,1], with out of range values, denormals, infinities and NaNs
+std::vector<float>
+makeLinearValues(int n)
+{
+    std::vector<float> values(n);
+
+    for (int i = 0; i < n; ++i) {
+        values[i] = (std::rand() % 1300) / 1000.f - 0.15f;
+    }
+    values[0] = 0.f;
+    values[1] = -0.f;
+    values[2] = std::numeric_limits<float>::denorm_min();
+    values[3] = std::numeric_limits<float>::infinity();
+    values[4] = -std::numeric_limits<float>::infinity();
+    values[5] = std::numeric_limits<float>::quiet_NaN();
+    values[6] = std::numeric_limits<float>::max();
+    values[7] = 1.f;
+    // A NaN with all bits set looks up the last entry of the tables
+    const unsigned int allBits = 0xffffffff;
+    std::memcpy( &values[8], &allBits, sizeof(float) );
+
+    return values;
+}
+} // anon namespace
+
+// The row functions must give exactly the same results as the per-value functions, with every instruction set
+TEST(Lut, RowConversionsMatchScalar) {
+    const std::vector<const Lut*> luts = getTestedLuts();
+    const int n = 0x10000 + 3; // not a multiple of the SIMD width, to exercise the tails
+    const std::vector<float> linear = makeLinearValues(n);
+    std::vector<unsigned char> bytes(n);
+    std::vector<unsigned short> shorts(n);
+
+    for (int i = 0; i < n; ++i) {
+        bytes[i] = (unsigned char)(i & 0xff);
+        shorts[i] = (unsigned short)(i & 0xffff);
+    }
+
+    std::vector<unsigned short> uint8xxRes(n);
+    std::vector<float> floatRes(n);
+    for (std::size_t l = 0; l < luts.size(); ++l) {
+        const Lut* lut = luts[l];
+        for (int is = eInstructionSetScalar; is <= (int)getBestInstructionSet(); ++is) {
+            const InstructionSetEnum instructionSet = (InstructionSetEnum)is;
+            lut->toColorSpaceUint8xxFromLinearFloatFast(&linear[0], n, &uint8xxRes[0], instructionSet);
+            for (int i = 0; i < n; ++i) {
+                EXPECT_EQ( lut->toColorSpaceUint8xxFromLinearFloatFast(linear[i]), uint8xxRes[i] ) << lut->getName() << " " << getInstructionSetName(instructionSet) << " value " << linear[i];
+            }
+            lut->fromColorSpaceUint8ToLinearFloatFast(&bytes[0], n, &floatRes[0], instructionSet);
+            for (int i = 0; i < n; ++i) {
+                EXPECT_EQ( lut->fromColorSpaceUint8ToLinearFloatFast(bytes[i]), floatRes[i] ) << lut->getName() << " " << getInstructionSetName(instructionSet) << " value " << (int)bytes[i];
+            }
+            lut->fromColorSpaceUint16ToLinearFloatFast(&shorts[0], n, &floatRes[0], instructionSet);
+            for (int i = 0; i < n; ++i) {
+                EXPECT_EQ( lut->fromColorSpaceUint16ToLinearFloatFast(shorts[i]), floatRes[i] ) << lut->getName() << " " << getInstructionSetName(instructionSet) << " value " << shorts[i];
+            }
+        }
+    }
+}
+
+// Micro-benchmark: converts a UHD RGBA frame with each instruction set.
+// Disabled by default, run it with --gtest_also_run_disabled_tests
+TEST(Lut, DISABLED_RowConversionsBenchmark) {
+    const Lut* lut = LutManager::sRGBLut();
+    const int n = 3840 * 2160 * 4;
+    const std::vector<float> linear = makeLinearValues(n);
+    std::vector<unsigned char> bytes(n);
+    std::vector<unsigned short> shorts(n);
+
+    lut->validate();
+    for (int i = 0; i < n; ++i) {
+        bytes[i] = (unsigned char)(std::rand() & 0xff);
+        shorts[i] = (unsigned short)(std::rand() & 0xffff);
+    }
+
+    std::vector<unsigned short> uint8xxRes(n);
+    std::vector<float> floatRes(n);
+    for (int is = eInstructionSetScalar; is <= (int)getBestInstructionSet(); ++is) {
+        const InstructionSetEnum instructionSet = (InstructionSetEnum)is;
+        double times[3];
+        for (int mode = 0; mode < 3; ++mode) {
+            TimeLapse timer;
+            switch (mode) {
+            case 0:
+                lut->toColorSpaceUint8xxFromLinearFloatFast(&linear[0], n, &uint8xxRes[0], instructionSet);
+                break;
+            case 1:
+                lut->fromColorSpaceUint8ToLinearFloatFast(&bytes[0], n, &floatRes[0], instructionSet);
+                break;
+            default:
+                lut->fromColorSpaceUint16ToLinearFloatFast(&shorts[0], n, &floatRes[0], instructionSet);
+                break;
+            }
+            times[mode] = timer.getTimeSinceCreation() * 1000.;
+        }
+        std::cout << "3840x2160 RGBA " << getInstructionSetName(instructionSet) << ": linear to sRGB 8-bit " << times[0]
+                  << "ms, sRGB 8-bit to linear " << times[1] << "ms, sRGB 16-bit to linear " << times[2] << "ms" << std::endl;
+    }
+}
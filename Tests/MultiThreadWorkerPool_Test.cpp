@@ -0,0 +1,325 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <map>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+
+#include "Engine/MultiThreadWorkerPool.h"
+
+NATRON_NAMESPACE_USING
+
+namespace {
+// Counts how many times each thread index was executed
+struct CallCounts
+{
+    QMutex lock;
+    std::vector<int> counts;
+    int failingIndex;
+    int sleepMs;
+
+    CallCounts(unsigned int nThreads,
+               int sleepMs)
+        : lock()
+        , counts(nThreads, 0)
+        , failingIndex(-1)
+        , sleepMs(sleepMs)
+    {
+    }
+};
+
+void
+countCall(unsigned int threadIndex,
+          unsigned int /*nThreads*/,
+          void *customArg)
+{
+    CallCounts* calls = (CallCounts*)customArg;
+
+    if (calls->sleepMs > 0) {
+        QThread::msleep(calls->sleepMs);
+    }
+    QMutexLocker k(&calls->lock);
+    ++calls->counts[threadIndex];
+}
+
+class TestWorkerPool
+    : public MultiThreadWorkerPool
+{
+public:
+
+    TestWorkerPool(int maxWorkers)
+        : MultiThreadWorkerPool(maxWorkers)
+    {
+    }
+
+private:
+
+    virtual int executeThreadIndex(ThreadFunction* func,
+                                   unsigned int threadIndex,
+                                   unsigned int nThreads,
+                                   void *customArg) OVERRIDE FINAL
+    {
+        func(threadIndex, nThreads, customArg);
+
+        return (int)threadIndex == ( (CallCounts*)customArg )->failingIndex ? 1 : 0;
+    }
+};
+
+// Keeps a state per thread, as the TLS: the calling thread modifies its state in each thread index it executes,
+// while the helpers must start from the state it had when it called run()
+class StateWorkerPool
+    : public MultiThreadWorkerPool
+{
+public:
+
+    QMutex lock;
+    std::map<const QThread*, int> states;
+    std::vector<int> seenStates;
+    std::vector<bool> executedBySpawner;
+    int nJobsFinished;
+
+    StateWorkerPool(int maxWorkers,
+                    unsigned int nThreads)
+        : MultiThreadWorkerPool(maxWorkers)
+        , lock()
+        , states()
+        , seenStates(nThreads, -1)
+        , executedBySpawner(nThreads, false)
+        , nJobsFinished(0)
+    {
+    }
+
+private:
+
+    virtual void onJobStarted(QThread* spawnerThread,
+                              QThread* snapshot) OVERRIDE FINAL
+    {
+        QMutexLocker k(&lock);
+
+        states[snapshot] = states[spawnerThread];
+    }
+
+    virtual void onJobFinished(QThread* snapshot) OVERRIDE FINAL
+    {
+        QMutexLocker k(&lock);
+
+        states.erase(snapshot);
+        ++nJobsFinished;
+    }
+
+    virtual void onHelperStarted(QThread* /*spawnerThread*/,
+                                 QThread* snapshot,
+                                 QThread* worker) OVERRIDE FINAL
+    {
+        QMutexLocker k(&lock);
+
+        EXPECT_TRUE( states.find(snapshot) != states.end() );
+        states[worker] = states[snapshot];
+    }
+
+    virtual void onHelperFinished() OVERRIDE FINAL
+    {
+        QMutexLocker k(&lock);
+
+        states.erase( QThread::currentThread() );
+    }
+
+    virtual int executeThreadIndex(ThreadFunction* /*func*/,
+                                   unsigned int threadIndex,
+                                   unsigned int /*nThreads*/,
+                                   void *customArg) OVERRIDE FINAL
+    {
+        QThread* spawnerThread = (QThread*)customArg;
+        QThread* curThread = QThread::currentThread();
+        int state;
+        {
+            QMutexLocker k(&lock);
+            state = states[curThread];
+            seenStates[threadIndex] = state;
+            executedBySpawner[threadIndex] = (curThread == spawnerThread);
+            if (curThread == spawnerThread) {
+                states[curThread] = state + 1;
+            }
+        }
+        QThread::msleep(5);
+
+        return 0;
+    }
+};
+
+// Calls the pool several times from another thread, as concurrent renders would
+class CallerThread
+    : public QThread
+{
+public:
+
+    CallerThread(TestWorkerPool* pool,
+                 CallCounts* calls,
+                 int nCalls)
+        : QThread()
+        , _pool(pool)
+        , _calls(calls)
+        , _nCalls(nCalls)
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        for (int i = 0; i < _nCalls; ++i) {
+            int nThreadsSpawned;
+            double spawnTime;
+            _pool->run(countCall, _calls->counts.size(), _calls, 8, &nThreadsSpawned, &spawnTime);
+        }
+    }
+
+    TestWorkerPool* _pool;
+    CallCounts* _calls;
+    int _nCalls;
+};
+} // anon namespace
+
+TEST(MultiThreadWorkerPool,
+     ExecutesEachThreadIndexOnce)
+{
+    TestWorkerPool pool(4);
+    CallCounts calls(100, 0);
+    int nThreadsSpawned;
+    double spawnTime;
+
+    EXPECT_EQ( 0, pool.run(countCall, 100, &calls, 4, &nThreadsSpawned, &spawnTime) );
+    for (std::size_t i = 0; i < calls.counts.size(); ++i) {
+        EXPECT_EQ(1, calls.counts[i]) << "thread index " << i;
+    }
+    EXPECT_LE(nThreadsSpawned, 3);
+
+    // A single thread index is executed by the calling thread
+    CallCounts single(1, 0);
+    EXPECT_EQ( 0, pool.run(countCall, 1, &single, 4, &nThreadsSpawned, &spawnTime) );
+    EXPECT_EQ(1, single.counts[0]);
+    EXPECT_EQ(0, nThreadsSpawned);
+}
+
+TEST(MultiThreadWorkerPool,
+     ReusesWorkers)
+{
+    TestWorkerPool pool(8);
+    int nThreadsSpawned;
+    double spawnTime;
+
+    CallCounts calls(8, 10);
+    EXPECT_EQ( 0, pool.run(countCall, 8, &calls, 4, &nThreadsSpawned, &spawnTime) );
+    EXPECT_EQ(3, nThreadsSpawned);
+    EXPECT_EQ( 3, pool.getNWorkers() );
+
+    // Let the workers go back to waiting for a job
+    QThread::msleep(50);
+    for (int i = 0; i < 5; ++i) {
+        CallCounts again(8, 10);
+        EXPECT_EQ( 0, pool.run(countCall, 8, &again, 4, &nThreadsSpawned, &spawnTime) );
+        EXPECT_EQ(0, nThreadsSpawned);
+    }
+    EXPECT_EQ( 3, pool.getNWorkers() );
+}
+
+TEST(MultiThreadWorkerPool,
+     NumberOfWorkersIsCapped)
+{
+    const int maxWorkers = 3;
+    const int nCallers = 6;
+    const int nCalls = 10;
+    TestWorkerPool pool(maxWorkers);
+
+    // Each call asks for 7 helpers: without the cap, concurrent calls would create many more threads
+    std::vector<CallCounts*> calls;
+    std::vector<CallerThread*> callers;
+    for (int i = 0; i < nCallers; ++i) {
+        calls.push_back( new CallCounts(16, 1) );
+        callers.push_back( new CallerThread(&pool, calls.back(), nCalls) );
+    }
+    for (int i = 0; i < nCallers; ++i) {
+        callers[i]->start();
+    }
+    for (int i = 0; i < nCallers; ++i) {
+        callers[i]->wait();
+        for (std::size_t j = 0; j < calls[i]->counts.size(); ++j) {
+            EXPECT_EQ(nCalls, calls[i]->counts[j]);
+        }
+        delete callers[i];
+        delete calls[i];
+    }
+    EXPECT_LE(pool.getNWorkers(), maxWorkers);
+}
+
+TEST(MultiThreadWorkerPool,
+     ReturnsError)
+{
+    TestWorkerPool pool(4);
+    CallCounts calls(20, 0);
+    int nThreadsSpawned;
+    double spawnTime;
+
+    calls.failingIndex = 5;
+    EXPECT_EQ( 1, pool.run(countCall, 20, &calls, 4, &nThreadsSpawned, &spawnTime) );
+    // The other thread indexes are still executed
+    for (std::size_t i = 0; i < calls.counts.size(); ++i) {
+        EXPECT_EQ(1, calls.counts[i]);
+    }
+}
+
+TEST(MultiThreadWorkerPool,
+     HelpersStartFromSnapshot)
+{
+    const unsigned int nThreads = 32;
+    StateWorkerPool pool(4, nThreads);
+    QThread* curThread = QThread::currentThread();
+    int nThreadsSpawned;
+    double spawnTime;
+
+    pool.states[curThread] = 1;
+    // The workers are created by this call, so most of them start after this thread modified its state
+    EXPECT_EQ( 0, pool.run(countCall, nThreads, curThread, 4, &nThreadsSpawned, &spawnTime) );
+    for (unsigned int i = 0; i < nThreads; ++i) {
+        if (!pool.executedBySpawner[i]) {
+            EXPECT_EQ(1, pool.seenStates[i]) << "thread index " << i;
+        }
+    }
+    EXPECT_EQ(1, pool.nJobsFinished);
+
+    // The snapshot and the helpers states were cleaned up
+    EXPECT_EQ( (std::size_t)1, pool.states.size() );
+    EXPECT_TRUE( pool.states.find(curThread) != pool.states.end() );
+
+    // A call executed by this thread alone does not take a snapshot
+    StateWorkerPool single(4, 1);
+    EXPECT_EQ( 0, single.run(countCall, 1, curThread, 4, &nThreadsSpawned, &spawnTime) );
+    EXPECT_EQ(0, single.nJobsFinished);
+}
@@ -0,0 +1,126 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <gtest/gtest.h>
+
+#include "Engine/ParallelRenderTuner.h"
+
+NATRON_NAMESPACE_USING
+
+// Throughput of a comp which scales linearly up to optimalRenders parallel renders, then slows down
+static double
+getSimulatedFramesPerSecond(int nRenders,
+                            int optimalRenders)
+{
+    if (nRenders <= optimalRenders) {
+        return nRenders;
+    }
+
+    return (double)optimalRenders * optimalRenders / nRenders;
+}
+
+TEST(ParallelRenderTuner,
+     ConvergesToBestThroughput)
+{
+    const int maxRenders = 16;
+
+    for (int optimalRenders = 1; optimalRenders <= maxRenders; ++optimalRenders) {
+        ParallelRenderTuner tuner;
+        tuner.reset(maxRenders / 2, maxRenders);
+
+        double time = 0.;
+        int nRenders = tuner.getNRenders();
+        int nFramesAtOptimum = 0;
+        for (int i = 0; i < 2000; ++i) {
+            time += 1. / getSimulatedFramesPerSecond(nRenders, optimalRenders);
+            tuner.notifyFrameRendered(time);
+            nRenders = tuner.update(0.);
+            ASSERT_GE(nRenders, 1);
+            ASSERT_LE(nRenders, maxRenders);
+            if ( (i >= 1000) && (nRenders == optimalRenders) ) {
+                ++nFramesAtOptimum;
+            }
+        }
+
+        int bestRenders;
+        double bestFramesPerSecond;
+        ASSERT_TRUE( tuner.getBestConfiguration(&bestRenders, &bestFramesPerSecond) );
+        EXPECT_EQ(optimalRenders, bestRenders);
+        EXPECT_NEAR(optimalRenders, bestFramesPerSecond, 1e-6);
+        // The rest of the time is spent probing the neighbours
+        EXPECT_GT(nFramesAtOptimum, 700) << "optimal renders: " << optimalRenders;
+    }
+}
+
+TEST(ParallelRenderTuner,
+     MemoryPressure)
+{
+    const int maxRenders = 16;
+    ParallelRenderTuner tuner;
+
+    tuner.reset(8, maxRenders);
+
+    // Memory usage grows with the number of parallel renders, the comp would be faster with more of them
+    double time = 0.;
+    int nRenders = tuner.getNRenders();
+    for (int i = 0; i < 500; ++i) {
+        time += 1. / getSimulatedFramesPerSecond(nRenders, maxRenders);
+        tuner.notifyFrameRendered(time);
+        double memoryPressure = nRenders > 4 ? 0.9 : 0.8;
+        nRenders = tuner.update(memoryPressure);
+        if (i >= 200) {
+            EXPECT_LE(nRenders, 4);
+        }
+    }
+
+    int nChanges, nMemoryPressureChanges;
+    tuner.getNumberOfChanges(&nChanges, &nMemoryPressureChanges);
+    EXPECT_EQ(4, nMemoryPressureChanges);
+
+    // Once the memory pressure is low again, the number of parallel renders increases
+    for (int i = 0; i < 500; ++i) {
+        time += 1. / getSimulatedFramesPerSecond(nRenders, maxRenders);
+        tuner.notifyFrameRendered(time);
+        nRenders = tuner.update(0.5);
+    }
+    EXPECT_GT(nRenders, 4);
+}
+
+TEST(ParallelRenderTuner,
+     SingleRender)
+{
+    ParallelRenderTuner tuner;
+
+    tuner.reset(4, 1);
+    EXPECT_EQ(1, tuner.getNRenders());
+
+    double time = 0.;
+    for (int i = 0; i < 100; ++i) {
+        time += 1.;
+        tuner.notifyFrameRendered(time);
+        EXPECT_EQ( 1, tuner.update(0.95) );
+    }
+}
@@ -0,0 +1,486 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#ifdef ROTO_SHAPE_RENDER_ENABLE_CAIRO
+#include <cairo/cairo.h>
+#endif
+
+#include "Engine/RotoBezierTriangulation.h"
+#include "Engine/RotoShapeRenderCairo.h"
+#include "Engine/RotoShapeRenderCPU.h"
+
+NATRON_NAMESPACE_USING
+
+#ifndef M_PI
+#define M_PI        3.14159265358979323846264338327950288   /* pi             */
+#endif
+
+static std::vector<ParametricPoint>
+makeStar(double cx,
+         double cy,
+         double radius,
+         int nBranches)
+{
+    // Self-intersecting polygon: the center has a winding number of 2
+    std::vector<ParametricPoint> ret;
+
+    for (int i = 0; i < nBranches; ++i) {
+        double a = i * 2. * M_PI * (nBranches / 2) / nBranches;
+        ParametricPoint p;
+        p.x = cx + radius * std::cos(a);
+        p.y = cy + radius * std::sin(a);
+        p.t = 0;
+        ret.push_back(p);
+    }
+
+    return ret;
+}
+
+static std::vector<ParametricPoint>
+makeEllipse(double cx,
+            double cy,
+            double rx,
+            double ry,
+            int nPoints)
+{
+    std::vector<ParametricPoint> ret;
+
+    for (int i = 0; i < nPoints; ++i) {
+        double a = i * 2. * M_PI / nPoints;
+        ParametricPoint p;
+        p.x = cx + rx * std::cos(a);
+        p.y = cy + ry * std::sin(a);
+        p.t = 0;
+        ret.push_back(p);
+    }
+
+    return ret;
+}
+
+TEST(RotoShapeRenderCPU, PolygonCoverageInteriorAndExterior)
+{
+    std::vector<ParametricPoint> poly = makeEllipse(50, 50, 30, 20, 128);
+    RectI tile(0, 0, 100, 100);
+    std::vector<float> coverage( tile.area() );
+
+    RotoShapeRenderCPU::renderPolygonCoverage_cpu(poly, poly.size(), tile, &coverage[0]);
+
+    EXPECT_FLOAT_EQ(1.f, coverage[50 * 100 + 50]);
+    EXPECT_FLOAT_EQ(0.f, coverage[5 * 100 + 5]);
+    EXPECT_FLOAT_EQ(0.f, coverage[50 * 100 + 95]);
+
+    // The total coverage is the area of the polygon
+    double sum = 0.;
+    for (std::size_t i = 0; i < coverage.size(); ++i) {
+        EXPECT_TRUE(coverage[i] >= 0.f && coverage[i] <= 1.f);
+        sum += coverage[i];
+    }
+    EXPECT_NEAR(M_PI * 30 * 20, sum, 2.);
+}
+
+TEST(RotoShapeRenderCPU, TiledRenderMatchesFullRender)
+{
+    // Shape partially outside of the RoI
+    std::vector<ParametricPoint> poly = makeEllipse(40, 55, 70, 30, 64);
+    RectI roi(0, 0, 100, 100);
+    std::vector<float> full( roi.area() );
+
+    RotoShapeRenderCPU::renderPolygonCoverage_cpu(poly, poly.size(), roi, &full[0]);
+
+    for (int y = 0; y < roi.y2; y += 7) {
+        RectI tile( 13, y, 97, std::min(y + 7, roi.y2) );
+        std::vector<float> coverage( tile.area() );
+        RotoShapeRenderCPU::renderPolygonCoverage_cpu(poly, poly.size(), tile, &coverage[0]);
+        for (int ty = tile.y1; ty < tile.y2; ++ty) {
+            for (int tx = tile.x1; tx < tile.x2; ++tx) {
+                EXPECT_NEAR(full[ty * roi.width() + tx], coverage[(ty - tile.y1) * tile.width() + tx - tile.x1], 1e-5);
+            }
+        }
+    }
+}
+
+TEST(RotoShapeRenderCPU, FeatherRamp)
+{
+    // A quad from x = 10 (inner) to x = 30 (outer), made of 2 triangles
+    std::vector<RotoBezierTriangulation::RotoFeatherVertex> mesh;
+    RotoBezierTriangulation::RotoFeatherVertex v;
+
+    v.x = 10; v.y = 0; v.isInner = true; mesh.push_back(v);
+    v.x = 30; v.y = 0; v.isInner = false; mesh.push_back(v);
+    v.x = 30; v.y = 10; v.isInner = false; mesh.push_back(v);
+    v.x = 10; v.y = 0; v.isInner = true; mesh.push_back(v);
+    v.x = 30; v.y = 10; v.isInner = false; mesh.push_back(v);
+    v.x = 10; v.y = 10; v.isInner = true; mesh.push_back(v);
+
+    RectI tile(0, 0, 40, 10);
+    std::vector<float> ramp(tile.area(), 0.f);
+    RotoShapeRenderCPU::renderFeatherRamp_cpu(mesh, eRampTypeLinear, 1., tile, &ramp[0]);
+
+    for (int y = 0; y < 10; ++y) {
+        EXPECT_FLOAT_EQ(0.f, ramp[y * 40 + 5]);
+        EXPECT_FLOAT_EQ(0.f, ramp[y * 40 + 35]);
+        for (int x = 10; x < 30; ++x) {
+            EXPECT_NEAR(1. - (x + 0.5 - 10.) / 20., ramp[y * 40 + x], 1e-5);
+        }
+    }
+
+    // With a fall-off the ramp follows the parametrization of the cairo patches: the relative distance
+    // to the inner edge is the bezier of control points c1, c2 evaluated at 1 - ramp
+    std::fill(ramp.begin(), ramp.end(), 0.f);
+    RotoShapeRenderCPU::renderFeatherRamp_cpu(mesh, eRampTypeLinear, 2., tile, &ramp[0]);
+    const double c1 = 1. / 9., c2 = 1. / 3.; // renderFeather_cairo control points for a fall-off of 2
+    for (int x = 10; x < 30; ++x) {
+        const double u = 1. - ramp[5 * 40 + x];
+        const double v = 1. - u;
+        EXPECT_NEAR( (x + 0.5 - 10.) / 20., 3. * v * v * u * c1 + 3. * v * u * u * c2 + u * u * u, 1e-5 );
+        if (x > 10) {
+            EXPECT_LT(ramp[5 * 40 + x], ramp[5 * 40 + x - 1]);
+        }
+    }
+}
+
+static Point
+makePoint(double x,
+          double y)
+{
+    Point p;
+
+    p.x = x;
+    p.y = y;
+
+    return p;
+}
+
+TEST(RotoShapeRenderCPU, DotCompositing)
+{
+    const std::vector<std::pair<double, double> > noStops;
+    RectI tile(0, 0, 40, 20);
+    std::vector<float> over(tile.area(), 0.f);
+    std::vector<float> lighten(tile.area(), 0.f);
+
+    // Two dots overlapping around x = 20, the second one more opaque
+    RotoShapeRenderCPU::renderDot_cpu(makePoint(15, 10), 0., 8., noStops, 0.5, true, tile, &over[0]);
+    RotoShapeRenderCPU::renderDot_cpu(makePoint(25, 10), 0., 8., noStops, 0.8, true, tile, &over[0]);
+    RotoShapeRenderCPU::renderDot_cpu(makePoint(15, 10), 0., 8., noStops, 0.5, false, tile, &lighten[0]);
+    RotoShapeRenderCPU::renderDot_cpu(makePoint(25, 10), 0., 8., noStops, 0.8, false, tile, &lighten[0]);
+
+    EXPECT_FLOAT_EQ(0.5f, over[10 * 40 + 10]);
+    EXPECT_FLOAT_EQ(0.8f, over[10 * 40 + 30]);
+    EXPECT_FLOAT_EQ(0.f, over[10 * 40 + 38]);
+    // OVER accumulates
+    EXPECT_FLOAT_EQ(0.9f, over[10 * 40 + 20]);
+    // LIGHTEN keeps the most opaque dot
+    EXPECT_FLOAT_EQ(0.5f, lighten[10 * 40 + 10]);
+    EXPECT_FLOAT_EQ(0.8f, lighten[10 * 40 + 20]);
+
+    // A less opaque dot does not lower the mask with LIGHTEN, but still adds up with OVER
+    RotoShapeRenderCPU::renderDot_cpu(makePoint(20, 10), 0., 8., noStops, 0.25, true, tile, &over[0]);
+    RotoShapeRenderCPU::renderDot_cpu(makePoint(20, 10), 0., 8., noStops, 0.25, false, tile, &lighten[0]);
+    EXPECT_FLOAT_EQ(0.925f, over[10 * 40 + 20]);
+    EXPECT_FLOAT_EQ(0.8f, lighten[10 * 40 + 20]);
+
+    // With opacity stops, the opacity decreases from the internal to the external radius
+    std::vector<std::pair<double, double> > stops;
+    stops.push_back( std::make_pair(0., 1.) );
+    stops.push_back( std::make_pair(1., 0.) );
+    std::vector<float> ramp(tile.area(), 0.f);
+    RotoShapeRenderCPU::renderDot_cpu(makePoint(20, 10), 2., 10., stops, 1., false, tile, &ramp[0]);
+    EXPECT_FLOAT_EQ(1.f, ramp[10 * 40 + 20]);
+    EXPECT_NEAR(1. - (std::sqrt(5.5 * 5.5 + 0.5 * 0.5) - 2.) / 8., ramp[10 * 40 + 25], 1e-5);
+    EXPECT_FLOAT_EQ(0.f, ramp[10 * 40 + 31]);
+}
+
+TEST(RotoShapeRenderCPU, StrokeDotsBinnedAcrossTileBorders)
+{
+    const int tileSize = NATRON_ROTO_CPU_RENDER_TILE_SIZE;
+    const RectI renderWindow(0, 0, 100, 3 * tileSize);
+
+    // Dots in stroke order, some of them overlapping tile borders or outside of the render window
+    std::vector<std::pair<Point, double> > dots;
+    dots.push_back( std::make_pair(makePoint(50, tileSize - 2), 5.) ); // first and second tiles
+    dots.push_back( std::make_pair(makePoint(52, tileSize / 2), 4.) ); // first tile
+    dots.push_back( std::make_pair(makePoint(48, 2 * tileSize + 1), 6.) ); // second and third tiles
+    dots.push_back( std::make_pair(makePoint(-20, tileSize), 5.) ); // left of the window
+    dots.push_back( std::make_pair(makePoint(30, 1.5 * tileSize), 1.2 * tileSize) ); // all tiles
+    dots.push_back( std::make_pair(makePoint(55, tileSize + 3), 5.) ); // first and second tiles
+
+    std::vector<RectI> tiles;
+    std::vector<std::vector<std::size_t> > tileDots;
+    RotoShapeRenderCPU::binDotsByTile_cpu(dots, renderWindow, &tiles, &tileDots);
+
+    ASSERT_EQ( 3, (int)tiles.size() );
+    ASSERT_EQ( 3, (int)tileDots.size() );
+    for (int t = 0; t < 3; ++t) {
+        EXPECT_EQ( RectI(0, t * tileSize, 100, (t + 1) * tileSize), tiles[t] );
+    }
+    const std::size_t expected0[] = {0, 1, 4, 5};
+    const std::size_t expected1[] = {0, 2, 4, 5};
+    const std::size_t expected2[] = {2, 4};
+    EXPECT_EQ( std::vector<std::size_t>(expected0, expected0 + 4), tileDots[0] );
+    EXPECT_EQ( std::vector<std::size_t>(expected1, expected1 + 4), tileDots[1] );
+    EXPECT_EQ( std::vector<std::size_t>(expected2, expected2 + 2), tileDots[2] );
+
+    // Compositing each tile with its dots gives the same mask as compositing all dots over the whole window
+    const std::vector<std::pair<double, double> > noStops;
+    for (int buildUp = 0; buildUp < 2; ++buildUp) {
+        std::vector<float> full(renderWindow.area(), 0.f);
+        for (std::size_t i = 0; i < dots.size(); ++i) {
+            RotoShapeRenderCPU::renderDot_cpu(dots[i].first, 0., dots[i].second, noStops, 0.1 + 0.15 * i, buildUp, renderWindow, &full[0]);
+        }
+        for (std::size_t t = 0; t < tiles.size(); ++t) {
+            std::vector<float> mask(tiles[t].area(), 0.f);
+            for (std::size_t i = 0; i < tileDots[t].size(); ++i) {
+                const std::size_t d = tileDots[t][i];
+                RotoShapeRenderCPU::renderDot_cpu(dots[d].first, 0., dots[d].second, noStops, 0.1 + 0.15 * d, buildUp, tiles[t], &mask[0]);
+            }
+            for (int y = tiles[t].y1; y < tiles[t].y2; ++y) {
+                for (int x = tiles[t].x1; x < tiles[t].x2; ++x) {
+                    ASSERT_EQ(full[y * renderWindow.width() + x], mask[(y - tiles[t].y1) * tiles[t].width() + x - tiles[t].x1]) << "pixel " << x << "," << y;
+                }
+            }
+        }
+    }
+}
+
+static RotoBezierTessellationCache::Key
+makeTessellationKey(double time,
+                    U64 geometryHash)
+{
+    RotoBezierTessellationCache::Key key;
+
+    key.time = time;
+    key.mipmapLevel = 0;
+    key.featherDist = 10.;
+    key.geometryHash = geometryHash;
+
+    return key;
+}
+
+TEST(RotoBezierTessellationCache, HitsAndKeyChanges)
+{
+    RotoBezierTessellationCache cache;
+    RotoBezierTessellationCache::Key key = makeTessellationKey(1., 42);
+    RotoBezierTriangulation::PolygonDataConstPtr data(new RotoBezierTriangulation::PolygonData);
+
+    EXPECT_FALSE( cache.get(key) );
+    cache.insert(key, data);
+    EXPECT_EQ( data, cache.get(key) );
+    EXPECT_EQ( data, cache.get( makeTessellationKey(1., 42) ) );
+
+    // Any change of the time, the geometry, the mipmap level or the feather distance is a miss
+    EXPECT_FALSE( cache.get( makeTessellationKey(2., 42) ) );
+    EXPECT_FALSE( cache.get( makeTessellationKey(1., 43) ) );
+    RotoBezierTessellationCache::Key other = key;
+    other.mipmapLevel = 1;
+    EXPECT_FALSE( cache.get(other) );
+    other = key;
+    other.featherDist = 5.;
+    EXPECT_FALSE( cache.get(other) );
+
+    // A tessellation computed concurrently replaces the previous one
+    RotoBezierTriangulation::PolygonDataConstPtr newData(new RotoBezierTriangulation::PolygonData);
+    cache.insert(key, newData);
+    EXPECT_EQ( newData, cache.get(key) );
+
+    // Modifying the curves clears the cache
+    cache.clear();
+    EXPECT_FALSE( cache.get(key) );
+}
+
+TEST(RotoBezierTessellationCache, EvictsLeastRecentlyUsed)
+{
+    RotoBezierTessellationCache cache;
+    std::vector<RotoBezierTriangulation::PolygonDataConstPtr> data;
+
+    for (int i = 0; i < NATRON_ROTO_TESSELLATION_CACHE_MAX_ENTRIES; ++i) {
+        data.push_back( RotoBezierTriangulation::PolygonDataConstPtr(new RotoBezierTriangulation::PolygonData) );
+        cache.insert(makeTessellationKey(i, 0), data.back());
+    }
+
+    // Frame 0 becomes the most recently used, frame 1 is now the least recently used
+    EXPECT_EQ( data[0], cache.get( makeTessellationKey(0, 0) ) );
+    cache.insert(makeTessellationKey(NATRON_ROTO_TESSELLATION_CACHE_MAX_ENTRIES, 0), RotoBezierTriangulation::PolygonDataConstPtr(new RotoBezierTriangulation::PolygonData));
+
+    EXPECT_FALSE( cache.get( makeTessellationKey(1, 0) ) );
+    for (int i = 0; i < NATRON_ROTO_TESSELLATION_CACHE_MAX_ENTRIES; ++i) {
+        if (i != 1) {
+            EXPECT_EQ( data[i], cache.get( makeTessellationKey(i, 0) ) ) << "time " << i;
+        }
+    }
+}
+
+#ifdef ROTO_SHAPE_RENDER_ENABLE_CAIRO
+
+static void
+renderPolygonCoverageCairo(const std::vector<ParametricPoint>& poly,
+                           const RectI& roi,
+                           std::vector<float>* coverage)
+{
+    cairo_surface_t* surface = cairo_image_surface_create( CAIRO_FORMAT_A8, roi.width(), roi.height() );
+    ASSERT_EQ(CAIRO_STATUS_SUCCESS, cairo_surface_status(surface));
+    cairo_surface_set_device_offset(surface, -roi.x1, -roi.y1);
+    cairo_t* cr = cairo_create(surface);
+    cairo_set_fill_rule(cr, CAIRO_FILL_RULE_WINDING);
+    cairo_set_antialias(cr, CAIRO_ANTIALIAS_DEFAULT);
+    cairo_new_path(cr);
+    cairo_move_to(cr, poly[0].x, poly[0].y);
+    for (std::size_t i = 1; i < poly.size(); ++i) {
+        cairo_line_to(cr, poly[i].x, poly[i].y);
+    }
+    cairo_close_path(cr);
+    cairo_set_source_rgba(cr, 1, 1, 1, 1);
+    cairo_fill(cr);
+    cairo_surface_flush(surface);
+
+    const unsigned char* data = cairo_image_surface_get_data(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+    coverage->resize( roi.area() );
+    for (int y = 0; y < roi.height(); ++y) {
+        for (int x = 0; x < roi.width(); ++x) {
+            (*coverage)[y * roi.width() + x] = data[y * stride + x] / 255.f;
+        }
+    }
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+}
+
+static void
+compareWithCairo(const std::vector<ParametricPoint>& poly,
+                 const RectI& roi)
+{
+    std::vector<float> cairoCoverage;
+    renderPolygonCoverageCairo(poly, roi, &cairoCoverage);
+
+    std::vector<float> coverage( roi.area() );
+    RotoShapeRenderCPU::renderPolygonCoverage_cpu(poly, poly.size(), roi, &coverage[0]);
+
+    // Cairo samples coverage on a finite grid whereas the native rasterizer computes the exact area:
+    // edge pixels may slightly differ, but on average the masks must be the same
+    double maxDiff = 0., sumDiff = 0.;
+    for (std::size_t i = 0; i < coverage.size(); ++i) {
+        double diff = std::abs(coverage[i] - cairoCoverage[i]);
+        maxDiff = std::max(maxDiff, diff);
+        sumDiff += diff;
+    }
+    EXPECT_LT(maxDiff, 0.2);
+    EXPECT_LT(sumDiff / coverage.size(), 0.005);
+}
+
+TEST(RotoShapeRenderCPU, PolygonCoverageMatchesCairo)
+{
+    compareWithCairo( makeEllipse(50, 50, 30, 20, 128), RectI(0, 0, 100, 100) );
+    compareWithCairo( makeEllipse(-3.3, 40.7, 60.2, 25.1, 37), RectI(-10, 10, 90, 80) );
+    compareWithCairo( makeStar(64, 64, 50, 5), RectI(0, 0, 128, 128) );
+}
+
+static void
+renderFeatherRampCairo(const std::vector<RotoBezierTriangulation::RotoFeatherVertex>& featherMesh,
+                       double fallOff,
+                       const RectI& roi,
+                       std::vector<float>* ramp)
+{
+    RotoBezierTriangulation::PolygonData data;
+    data.featherMesh = featherMesh;
+    double shapeColor[3] = {1., 1., 1.};
+    cairo_pattern_t* mesh = cairo_pattern_create_mesh();
+    RotoShapeRenderCairo::renderFeather_cairo(data, shapeColor, fallOff, mesh);
+
+    cairo_surface_t* surface = cairo_image_surface_create( CAIRO_FORMAT_A8, roi.width(), roi.height() );
+    ASSERT_EQ(CAIRO_STATUS_SUCCESS, cairo_surface_status(surface));
+    cairo_surface_set_device_offset(surface, -roi.x1, -roi.y1);
+    cairo_t* cr = cairo_create(surface);
+    cairo_set_source(cr, mesh);
+    cairo_paint(cr);
+    cairo_surface_flush(surface);
+
+    const unsigned char* pixels = cairo_image_surface_get_data(surface);
+    int stride = cairo_image_surface_get_stride(surface);
+    ramp->resize( roi.area() );
+    for (int y = 0; y < roi.height(); ++y) {
+        for (int x = 0; x < roi.width(); ++x) {
+            (*ramp)[y * roi.width() + x] = pixels[y * stride + x] / 255.f;
+        }
+    }
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+    cairo_pattern_destroy(mesh);
+}
+
+TEST(RotoShapeRenderCPU, FeatherRampMatchesCairo)
+{
+    // A feather band around a square, with triangles having either 2 inner or 2 outer vertices as in
+    // RotoBezierTriangulation
+    std::vector<RotoBezierTriangulation::RotoFeatherVertex> mesh;
+    const double inner[4][2] = { {30, 30}, {70, 30}, {70, 70}, {30, 70} };
+    const double outer[4][2] = { {10, 10}, {90, 10}, {90, 90}, {10, 90} };
+    for (int i = 0; i < 4; ++i) {
+        const int j = (i + 1) % 4;
+        RotoBezierTriangulation::RotoFeatherVertex a, b, c, d;
+        a.x = inner[i][0]; a.y = inner[i][1]; a.isInner = true;
+        b.x = inner[j][0]; b.y = inner[j][1]; b.isInner = true;
+        c.x = outer[i][0]; c.y = outer[i][1]; c.isInner = false;
+        d.x = outer[j][0]; d.y = outer[j][1]; d.isInner = false;
+        mesh.push_back(a); mesh.push_back(c); mesh.push_back(b);
+        mesh.push_back(b); mesh.push_back(c); mesh.push_back(d);
+    }
+
+    const RectI roi(0, 0, 100, 100);
+    const double fallOffs[3] = {1., 0.5, 2.5};
+    for (int f = 0; f < 3; ++f) {
+        std::vector<float> cairoRamp;
+        renderFeatherRampCairo(mesh, fallOffs[f], roi, &cairoRamp);
+
+        std::vector<float> ramp(roi.area(), 0.f);
+        RotoShapeRenderCPU::renderFeatherRamp_cpu(mesh, eRampTypeLinear, fallOffs[f], roi, &ramp[0]);
+
+        // Cairo subdivides the patches and quantizes to 8 bits, and anti-aliases the outline of the mesh whereas
+        // the ramp is sampled at the center of the pixels: compare only the pixels which are not on the outline
+        double maxDiff = 0., sumDiff = 0.;
+        int n = 0;
+        for (int y = 0; y < roi.height(); ++y) {
+            for (int x = 0; x < roi.width(); ++x) {
+                const bool inBand = (x >= 11 && x < 89 && y >= 11 && y < 89) && !(x >= 29 && x < 71 && y >= 29 && y < 71);
+                if (!inBand) {
+                    continue;
+                }
+                double diff = std::abs(ramp[y * roi.width() + x] - cairoRamp[y * roi.width() + x]);
+                maxDiff = std::max(maxDiff, diff);
+                sumDiff += diff;
+                ++n;
+            }
+        }
+        EXPECT_LT(maxDiff, 0.05) << "fallOff " << fallOffs[f];
+        EXPECT_LT(sumDiff / n, 0.01) << "fallOff " << fallOffs[f];
+    }
+}
+
+#endif // ROTO_SHAPE_RENDER_ENABLE_CAIRO
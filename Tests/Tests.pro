@@ -49,12 +49,24 @@ SOURCES += \
     google-test/src/gtest_main.cc \
     google-mock/src/gmock-all.cc \
     BaseTest.cpp \
+    BoundedFrameQueue_Test.cpp \
+    Cache_Test.cpp \
+    CacheTOC_Test.cpp \
     Hash64_Test.cpp \
     Image_Test.cpp \
     Lut_Test.cpp \
+    MultiThreadWorkerPool_Test.cpp \
+    ParallelRenderTuner_Test.cpp \
     KnobFile_Test.cpp \
+    CompiledExpression_Test.cpp \
     Curve_Test.cpp \
-    Tracker_Test.cpp
+    RotoShapeRenderCPU_Test.cpp \
+    Tracker_Test.cpp \
+    ThreadPoolTaskGroup_Test.cpp \
+    TrackerFrameAccessorCache_Test.cpp \
+    TrackerImageConversion_Test.cpp \
+    ViewerSpeculativeRenderPlanner_Test.cpp \
+    ViewerTextureConversion_Test.cpp
 
 HEADERS += \
     BaseTest.h
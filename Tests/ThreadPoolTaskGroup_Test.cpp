@@ -0,0 +1,220 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
+#include <boost/bind.hpp>
+#endif
+
+#include <QtCore/QMutex>
+#include <QtCore/QRunnable>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QWaitCondition>
+
+#include "BaseTest.h"
+
+#include "Engine/EffectInstance.h"
+#include "Engine/ThreadPool.h"
+#include "Engine/TLSHolder.h"
+
+NATRON_NAMESPACE_USING
+
+typedef TLSHolder<EffectInstance::EffectTLSData> EffectTLSHolder;
+
+namespace {
+// Records the thread executing each task and the value of its TLS at that time
+struct TaskRecords
+{
+    QThread* callingThread;
+    std::vector<QThread*> threads;
+    std::vector<int> tlsValues;
+    boost::shared_ptr<EffectTLSHolder> tls;
+    int failingTask;
+
+    TaskRecords(int nTasks)
+        : callingThread( QThread::currentThread() )
+        , threads(nTasks, (QThread*)0)
+        , tlsValues(nTasks, -1)
+        , tls()
+        , failingTask(-1)
+    {
+    }
+};
+
+bool
+recordTask(TaskRecords* records,
+           int i)
+{
+    QThread::msleep(5);
+    records->threads[i] = QThread::currentThread();
+    if (records->tls) {
+        boost::shared_ptr<EffectInstance::EffectTLSData> data = records->tls->getTLSData();
+        if (data) {
+            records->tlsValues[i] = data->viewerTextureIndex;
+            // The calling thread modifies its TLS while the helpers may be copying it
+            if (records->threads[i] == records->callingThread) {
+                data->viewerTextureIndex = 100 + i;
+            }
+        }
+    }
+
+    return i != records->failingTask;
+}
+
+// Keeps a thread of the global pool busy until released
+class BlockingRunnable
+    : public QRunnable
+{
+public:
+
+    BlockingRunnable(QMutex* lock,
+                     QWaitCondition* cond,
+                     bool* released,
+                     int* nStarted)
+        : QRunnable()
+        , _lock(lock)
+        , _cond(cond)
+        , _released(released)
+        , _nStarted(nStarted)
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        QMutexLocker k(_lock);
+
+        ++*_nStarted;
+        _cond->wakeAll();
+        while (!*_released) {
+            _cond->wait(_lock);
+        }
+        --*_nStarted;
+        _cond->wakeAll();
+    }
+
+    QMutex* _lock;
+    QWaitCondition* _cond;
+    bool* _released;
+    int* _nStarted;
+};
+} // anon namespace
+
+TEST_F(BaseTest,
+       ThreadPoolTaskGroupCallerHelps)
+{
+    const int nTasks = 8 * QThread::idealThreadCount();
+    TaskRecords records(nTasks);
+    ThreadPoolTaskGroup group;
+
+    EXPECT_TRUE( group.run( nTasks, boost::bind(&recordTask, &records, _1) ) );
+
+    // Every task ran, and the calling thread executed some of them instead of waiting
+    int nCallerTasks = 0;
+    for (int i = 0; i < nTasks; ++i) {
+        ASSERT_TRUE(records.threads[i]) << "task " << i;
+        if (records.threads[i] == records.callingThread) {
+            ++nCallerTasks;
+        }
+    }
+    EXPECT_GT(nCallerTasks, 0);
+
+    // A failing task cancels the tasks that are not started yet
+    TaskRecords failing(nTasks);
+    failing.failingTask = 0;
+    ThreadPoolTaskGroup failingGroup;
+    EXPECT_FALSE( failingGroup.run( nTasks, boost::bind(&recordTask, &failing, _1) ) );
+    EXPECT_FALSE(failing.threads[nTasks - 1]);
+}
+
+TEST_F(BaseTest,
+       ThreadPoolTaskGroupBusyPool)
+{
+    // Occupy all the threads of the pool: the calling thread executes all the tasks
+    QThreadPool* pool = QThreadPool::globalInstance();
+    QMutex lock;
+    QWaitCondition cond;
+    bool released = false;
+    int nStarted = 0;
+    int nBlocking = 0;
+
+    while ( pool->tryStart( new BlockingRunnable(&lock, &cond, &released, &nStarted) ) ) {
+        ++nBlocking;
+    }
+    {
+        QMutexLocker k(&lock);
+        while (nStarted < nBlocking) {
+            cond.wait(&lock);
+        }
+    }
+
+    const int nTasks = 16;
+    TaskRecords records(nTasks);
+    ThreadPoolTaskGroup group;
+    EXPECT_TRUE( group.run( nTasks, boost::bind(&recordTask, &records, _1) ) );
+    for (int i = 0; i < nTasks; ++i) {
+        EXPECT_EQ(records.callingThread, records.threads[i]) << "task " << i;
+    }
+
+    QMutexLocker k(&lock);
+    released = true;
+    cond.wakeAll();
+    while (nStarted > 0) {
+        cond.wait(&lock);
+    }
+}
+
+TEST_F(BaseTest,
+       ThreadPoolTaskGroupCopiesTLS)
+{
+    const int nTasks = 8 * QThread::idealThreadCount();
+    TaskRecords records(nTasks);
+
+    records.tls.reset( new EffectTLSHolder() );
+    records.tls->getOrCreateTLSData()->viewerTextureIndex = 1;
+
+    ThreadPoolTaskGroup group;
+    EXPECT_TRUE( group.run( nTasks, boost::bind(&recordTask, &records, _1) ) );
+
+    // The helpers get the TLS of the calling thread as it was when run() was called,
+    // not the values it set while executing tasks
+    for (int i = 0; i < nTasks; ++i) {
+        if (records.threads[i] != records.callingThread) {
+            EXPECT_EQ(1, records.tlsValues[i]) << "task " << i;
+        } else {
+            EXPECT_GE(records.tlsValues[i], 1) << "task " << i;
+        }
+    }
+
+    // The TLS of the calling thread is left as it was modified by its tasks
+    EXPECT_NE( 1, records.tls->getTLSData()->viewerTextureIndex );
+    appPTR->getAppTLS()->cleanupTLSForThread();
+}
@@ -0,0 +1,292 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QThread>
+
+#include "Engine/RectD.h"
+#include "Engine/TrackerFrameAccessor.h"
+#include "Engine/TrackerFrameAccessorCache.h"
+
+NATRON_NAMESPACE_USING
+
+// Size of the 10x10 images of the tests
+static const std::size_t kImageBytes = 10 * 10 * sizeof(float);
+
+static FrameAccessorCacheKey
+makeKey(int frame,
+        int mipMapLevel = 0,
+        int channelsMask = 7)
+{
+    FrameAccessorCacheKey key;
+
+    key.frame = frame;
+    key.mipMapLevel = mipMapLevel;
+    key.mode = mv::FrameAccessor::MONO;
+    key.channelsMask = channelsMask;
+
+    return key;
+}
+
+static TrackerFrameAccessorCache::FloatImagePtr
+makeImage()
+{
+    return TrackerFrameAccessorCache::FloatImagePtr( new mv::FloatImage(10, 10) );
+}
+
+// Renders the 10x10 image at the origin of the given frame in the background, as TrackerFrameAccessor::prefetchImages does
+static mv::FloatImage*
+prefetch(TrackerFrameAccessorCache* cache,
+         int frame)
+{
+    const RectI roi(0, 0, 10, 10);
+    const FrameAccessorCacheKey key = makeKey(frame);
+
+    if ( !cache->beginPrefetch(key, roi) ) {
+        return 0;
+    }
+    TrackerFrameAccessorCache::FloatImagePtr image = makeImage();
+    cache->insertImage(key, &roi, image, roi, false);
+
+    return image.get();
+}
+
+static bool
+isCached(TrackerFrameAccessorCache* cache,
+         int frame)
+{
+    const RectI roi(0, 0, 10, 10);
+    const FrameAccessorCacheKey key = makeKey(frame);
+
+    if ( cache->beginPrefetch(key, roi) ) {
+        // End the render registered by beginPrefetch
+        cache->insertImage( key, &roi, TrackerFrameAccessorCache::FloatImagePtr(), RectI(), false );
+
+        return false;
+    }
+
+    return true;
+}
+
+class AcquireImageThread
+    : public QThread
+{
+public:
+
+    AcquireImageThread(TrackerFrameAccessorCache* cache,
+                       const FrameAccessorCacheKey& key,
+                       const RectI& roi)
+        : QThread()
+        , cache(cache)
+        , key(key)
+        , roi(roi)
+        , image(0)
+    {
+    }
+
+    TrackerFrameAccessorCache* cache;
+    FrameAccessorCacheKey key;
+    RectI roi;
+    mv::FloatImage* image;
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        image = cache->acquireImage(key, roi);
+    }
+};
+
+TEST(TrackerFrameAccessorCache,
+     Hits)
+{
+    TrackerFrameAccessorCache cache(3 * kImageBytes);
+    const FrameAccessorCacheKey key = makeKey(1);
+    const RectI bounds(0, 0, 10, 10);
+
+    // A miss registers the render of the region
+    ASSERT_EQ( (mv::FloatImage*)0, cache.acquireImage(key, bounds) );
+    TrackerFrameAccessorCache::FloatImagePtr image = makeImage();
+    cache.insertImage(key, &bounds, image, bounds, true);
+    EXPECT_EQ( (std::size_t)0, cache.getRetainedBytes() );
+
+    // Any region enclosed in the bounds of the image is a hit
+    EXPECT_EQ( image.get(), cache.acquireImage( key, RectI(2, 2, 8, 8) ) );
+    EXPECT_EQ( image.get(), cache.acquireImage(key, bounds) );
+    RectI cachedBounds;
+    ASSERT_TRUE( cache.getImageBounds(image.get(), &cachedBounds) );
+    EXPECT_TRUE(cachedBounds == bounds);
+
+    // The image is retained only once released by all its users
+    cache.releaseImage( image.get() );
+    cache.releaseImage( image.get() );
+    EXPECT_EQ( (std::size_t)0, cache.getRetainedBytes() );
+    cache.releaseImage( image.get() );
+    EXPECT_EQ( kImageBytes, cache.getRetainedBytes() );
+
+    // A region outside of the bounds, another mipmap level or other channels are misses
+    const RectI larger(5, 5, 15, 15);
+    EXPECT_EQ( (mv::FloatImage*)0, cache.acquireImage(key, larger) );
+    cache.insertImage( key, &larger, TrackerFrameAccessorCache::FloatImagePtr(), RectI(), true );
+    EXPECT_EQ( (mv::FloatImage*)0, cache.acquireImage(makeKey(1, 1), bounds) );
+    cache.insertImage( makeKey(1, 1), &bounds, TrackerFrameAccessorCache::FloatImagePtr(), RectI(), true );
+    EXPECT_EQ( (mv::FloatImage*)0, cache.acquireImage(makeKey(1, 0, 1), bounds) );
+    cache.insertImage( makeKey(1, 0, 1), &bounds, TrackerFrameAccessorCache::FloatImagePtr(), RectI(), true );
+    EXPECT_EQ( (std::size_t)1, cache.getNumImages() );
+
+    // A prefetched image is retained right away and found by the tracker
+    mv::FloatImage* prefetched = prefetch(&cache, 2);
+    ASSERT_TRUE(prefetched);
+    EXPECT_EQ( 2 * kImageBytes, cache.getRetainedBytes() );
+    EXPECT_EQ( (mv::FloatImage*)0, prefetch(&cache, 2) );
+    EXPECT_EQ( prefetched, cache.acquireImage(makeKey(2), bounds) );
+    EXPECT_EQ( kImageBytes, cache.getRetainedBytes() );
+    cache.releaseImage(prefetched);
+}
+
+TEST(TrackerFrameAccessorCache,
+     WaitsForPendingRender)
+{
+    TrackerFrameAccessorCache cache(3 * kImageBytes);
+    const FrameAccessorCacheKey key = makeKey(1);
+    const RectI bounds(0, 0, 10, 10);
+
+    ASSERT_TRUE( cache.beginPrefetch(key, bounds) );
+    // The region is already being rendered, but not a region outside of it
+    EXPECT_FALSE( cache.beginPrefetch( key, RectI(2, 2, 8, 8) ) );
+    const RectI larger(0, 0, 20, 20);
+    ASSERT_TRUE( cache.beginPrefetch(key, larger) );
+    cache.insertImage( key, &larger, TrackerFrameAccessorCache::FloatImagePtr(), RectI(), false );
+
+    // The tracker waits for the image being prefetched instead of rendering it again
+    AcquireImageThread thread( &cache, key, RectI(2, 2, 8, 8) );
+    thread.start();
+    QThread::msleep(50);
+    TrackerFrameAccessorCache::FloatImagePtr image = makeImage();
+    cache.insertImage(key, &bounds, image, bounds, false);
+    thread.wait();
+    EXPECT_EQ(image.get(), thread.image);
+    EXPECT_EQ( (std::size_t)0, cache.getRetainedBytes() );
+    EXPECT_EQ( (std::size_t)1, cache.getNumImages() );
+    cache.releaseImage( image.get() );
+}
+
+TEST(TrackerFrameAccessorCache,
+     FailedRenderWakesWaiters)
+{
+    TrackerFrameAccessorCache cache(3 * kImageBytes);
+    const FrameAccessorCacheKey key = makeKey(1);
+    const RectI bounds(0, 0, 10, 10);
+
+    ASSERT_EQ( (mv::FloatImage*)0, cache.acquireImage(key, bounds) );
+    AcquireImageThread thread(&cache, key, bounds);
+    thread.start();
+    QThread::msleep(50);
+
+    // The render throws before inserting the image: the waiting thread registers the render itself
+    bool thrown = false;
+    try {
+        TrackerFrameAccessorCache::EndPendingRender_RAII pendingRender(&cache, key, &bounds);
+        throw std::runtime_error("render failed");
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    EXPECT_TRUE(thrown);
+    thread.wait();
+    EXPECT_EQ( (mv::FloatImage*)0, thread.image );
+    EXPECT_FALSE( cache.beginPrefetch(key, bounds) );
+
+    // Once inserted through the guard, the image is not ended a second time when the guard goes out of scope
+    {
+        TrackerFrameAccessorCache::EndPendingRender_RAII pendingRender(&cache, key, &bounds);
+        pendingRender.insertImage(makeImage(), bounds, false);
+    }
+    EXPECT_EQ( (std::size_t)1, cache.getNumImages() );
+    EXPECT_EQ( kImageBytes, cache.getRetainedBytes() );
+    EXPECT_FALSE( cache.beginPrefetch(key, bounds) );
+}
+
+TEST(TrackerFrameAccessorCache,
+     LRUEviction)
+{
+    TrackerFrameAccessorCache cache(3 * kImageBytes);
+    const RectI bounds(0, 0, 10, 10);
+
+    ASSERT_TRUE( prefetch(&cache, 1) );
+    ASSERT_TRUE( prefetch(&cache, 2) );
+    ASSERT_TRUE( prefetch(&cache, 3) );
+    EXPECT_EQ( 3 * kImageBytes, cache.getRetainedBytes() );
+
+    // Using frame 1 makes frame 2 the least recently used one
+    cache.releaseImage( cache.acquireImage(makeKey(1), bounds) );
+    ASSERT_TRUE( prefetch(&cache, 4) );
+    EXPECT_EQ( 3 * kImageBytes, cache.getRetainedBytes() );
+    EXPECT_TRUE( isCached(&cache, 1) );
+    EXPECT_FALSE( isCached(&cache, 2) );
+    EXPECT_TRUE( isCached(&cache, 3) );
+    EXPECT_TRUE( isCached(&cache, 4) );
+
+    // Images used by the tracker are not evicted and do not count in the budget
+    mv::FloatImage* held = cache.acquireImage(makeKey(3), bounds);
+    ASSERT_TRUE(held);
+    ASSERT_TRUE( prefetch(&cache, 5) );
+    ASSERT_TRUE( prefetch(&cache, 6) );
+    ASSERT_TRUE( prefetch(&cache, 7) );
+    EXPECT_EQ( 3 * kImageBytes, cache.getRetainedBytes() );
+    EXPECT_EQ( (std::size_t)4, cache.getNumImages() );
+    EXPECT_FALSE( isCached(&cache, 1) );
+    EXPECT_TRUE( isCached(&cache, 3) );
+    EXPECT_FALSE( isCached(&cache, 4) );
+    EXPECT_TRUE( isCached(&cache, 5) );
+
+    // Once released, frame 3 is the least recently used image
+    cache.releaseImage(held);
+    EXPECT_EQ( 3 * kImageBytes, cache.getRetainedBytes() );
+    EXPECT_FALSE( isCached(&cache, 3) );
+    EXPECT_TRUE( isCached(&cache, 5) );
+    EXPECT_TRUE( isCached(&cache, 6) );
+    EXPECT_TRUE( isCached(&cache, 7) );
+}
+
+TEST(TrackerFrameAccessor,
+     PrefetchRoI)
+{
+    const RectD searchWindow(100., 200., 140., 260.);
+    RectI roi;
+
+    // At the tracked frame, the region given to libmv
+    TrackerFrameAccessor::getPrefetchRoI(searchWindow, 0, &roi);
+    EXPECT_TRUE( roi == RectI(99, 199, 139, 259) );
+
+    // Expanded by a quarter of the search window per frame ahead, for the motion of the track
+    TrackerFrameAccessor::getPrefetchRoI(searchWindow, 1, &roi);
+    EXPECT_TRUE( roi == RectI(89, 184, 149, 274) );
+    TrackerFrameAccessor::getPrefetchRoI(searchWindow, 2, &roi);
+    EXPECT_TRUE( roi == RectI(79, 169, 159, 289) );
+}
@@ -0,0 +1,166 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <vector>
+#include <cstdlib>
+
+#include <gtest/gtest.h>
+
+#include "Engine/TrackerImageConversion.h"
+
+NATRON_NAMESPACE_USING
+using namespace NATRON_NAMESPACE::TrackerImage;
+
+namespace {
+// Returns values mostly in [0,1], with some values out of range as produced by renders
+std::vector<float>
+makeFloats(std::size_t n)
+{
+    std::vector<float> ret(n);
+
+    for (std::size_t i = 0; i < ret.size(); ++i) {
+        ret[i] = (std::rand() % 1200) / 1000.f - 0.1f;
+    }
+
+    return ret;
+}
+} // anon namespace
+
+// The SSE2 kernels compute the same operations as the scalar reference, possibly in a different order
+TEST(TrackerImage,
+     ConvertRowToMonoSIMDMatchesScalar)
+{
+    const int w = 1003; // not a multiple of the SIMD width, to exercise the tails
+    const std::vector<float> src = makeFloats(w * 4);
+    LuminanceWeights weights;
+
+    weights.r = 0.2126f;
+    weights.g = 0.7152f;
+    weights.b = 0.0722f;
+
+    std::vector<float> ref(w), res(w);
+    for (int is = eInstructionSetSSE2; is <= (int)getBestInstructionSet(); ++is) {
+        const int nComps[] = { 1, 3, 4 };
+        for (int c = 0; c < 3; ++c) {
+            convertRowToMono(eInstructionSetScalar, eImageBitDepthFloat, nComps[c], &src[0], w, weights, &ref[0]);
+            convertRowToMono( (InstructionSetEnum)is, eImageBitDepthFloat, nComps[c], &src[0], w, weights, &res[0] );
+            for (int x = 0; x < w; ++x) {
+                EXPECT_NEAR(ref[x], res[x], 1e-6) << getInstructionSetName( (InstructionSetEnum)is ) << " " << nComps[c] << " components, pixel " << x;
+            }
+        }
+    }
+}
+
+// Same for 8-bit and 16-bit pixels, over the whole range of values
+template <typename PIX, int maxValue>
+void
+convertIntegerRowToMonoSIMDMatchesScalar(ImageBitDepthEnum bitDepth)
+{
+    const int w = 1003;
+    std::vector<PIX> src(w * 4);
+    for (std::size_t i = 0; i < src.size(); ++i) {
+        src[i] = (PIX)(std::rand() % (maxValue + 1));
+    }
+    src[0] = maxValue;
+    LuminanceWeights weights;
+
+    weights.r = 0.2126f;
+    weights.g = 0.7152f;
+    weights.b = 0.0722f;
+
+    std::vector<float> ref(w), res(w);
+    for (int is = eInstructionSetSSE2; is <= (int)getBestInstructionSet(); ++is) {
+        const int nComps[] = { 1, 3, 4 };
+        for (int c = 0; c < 3; ++c) {
+            // Also convert rows ending right after a block, where the loads must not read past the row
+            const int widths[] = { w, 4, 5, 6 };
+            for (int i = 0; i < 4; ++i) {
+                const std::vector<PIX> row( src.begin(), src.begin() + widths[i] * nComps[c] );
+                convertRowToMono(eInstructionSetScalar, bitDepth, nComps[c], &row[0], widths[i], weights, &ref[0]);
+                convertRowToMono( (InstructionSetEnum)is, bitDepth, nComps[c], &row[0], widths[i], weights, &res[0] );
+                for (int x = 0; x < widths[i]; ++x) {
+                    EXPECT_NEAR(ref[x], res[x], 1e-6) << getInstructionSetName( (InstructionSetEnum)is ) << " " << nComps[c] << " components, pixel " << x;
+                }
+            }
+        }
+    }
+}
+
+TEST(TrackerImage,
+     ConvertIntegerRowToMonoSIMDMatchesScalar)
+{
+    convertIntegerRowToMonoSIMDMatchesScalar<unsigned char, 255>(eImageBitDepthByte);
+    convertIntegerRowToMonoSIMDMatchesScalar<unsigned short, 65535>(eImageBitDepthShort);
+}
+
+TEST(TrackerImage,
+     ConvertRowToMonoNormalizesIntegers)
+{
+    const unsigned char bytes[] = { 255, 0, 0, 0, 255, 0, 0, 0, 255 };
+    const unsigned short shorts[] = { 65535, 65535, 65535 };
+    LuminanceWeights weights;
+
+    weights.r = 0.2126f;
+    weights.g = 0.7152f;
+    weights.b = 0.0722f;
+
+    float res[3];
+    convertRowToMono(getBestInstructionSet(), eImageBitDepthByte, 3, bytes, 3, weights, res);
+    EXPECT_FLOAT_EQ(weights.r, res[0]);
+    EXPECT_FLOAT_EQ(weights.g, res[1]);
+    EXPECT_FLOAT_EQ(weights.b, res[2]);
+
+    convertRowToMono(getBestInstructionSet(), eImageBitDepthShort, 3, shorts, 1, weights, res);
+    EXPECT_FLOAT_EQ(1.f, res[0]);
+}
+
+TEST(TrackerImage,
+     DownscaleSIMDMatchesScalar)
+{
+    // Odd and negative bounds, so that the borders cover a single row or column of the source
+    RectI bounds[2];
+    bounds[0].set(0, 0, 203, 101);
+    bounds[1].set(-37, -11, 150, 64);
+
+    for (int b = 0; b < 2; ++b) {
+        const RectI& srcBounds = bounds[b];
+        const RectI dstBounds = srcBounds.downscalePowerOfTwoSmallestEnclosing(1);
+        const std::vector<float> src = makeFloats( (std::size_t)srcBounds.area() );
+        std::vector<float> ref( (std::size_t)dstBounds.area() ), res( (std::size_t)dstBounds.area() );
+
+        downscaleMonoImage(eInstructionSetScalar, &src[0], srcBounds, dstBounds, &ref[0]);
+        // A pixel covering 2x2 source pixels is their average
+        const float* srcPixel = &src[0] + (2 * dstBounds.y1 + 2 - srcBounds.y1) * srcBounds.width() + 2 * dstBounds.x1 + 2 - srcBounds.x1;
+        EXPECT_FLOAT_EQ( (srcPixel[0] + srcPixel[1] + srcPixel[srcBounds.width()] + srcPixel[srcBounds.width() + 1]) / 4, ref[dstBounds.width() + 1] );
+
+        for (int is = eInstructionSetSSE2; is <= (int)getBestInstructionSet(); ++is) {
+            downscaleMonoImage( (InstructionSetEnum)is, &src[0], srcBounds, dstBounds, &res[0] );
+            for (std::size_t i = 0; i < ref.size(); ++i) {
+                EXPECT_NEAR(ref[i], res[i], 1e-6) << getInstructionSetName( (InstructionSetEnum)is ) << " pixel " << i;
+            }
+        }
+    }
+}
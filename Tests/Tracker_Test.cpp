@@ -27,6 +27,7 @@
 #include <vector>
 #include <cmath>
 #include <cstdlib>
+#include <iostream>
 
 #include <gtest/gtest.h>
 
@@ -35,6 +36,8 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 #include "Engine/EngineFwd.h"
+#include "Engine/Timer.h"
+#include "Engine/TrackerContextPrivate.h"
 #include "Engine/Transform.h"
 #include "Global/GlobalDefines.h"
 
@@ -464,3 +467,105 @@ TEST(ModelSearch, HomographyNPoints)
     }
     testHomography(x1);
 }
+
+typedef ProsacKernelAdaptor<openMVG::robust::Homography2DSolver> HomographyKernel;
+
+// Correspondences of n points spread uniformly in a w x h image through H, 40% of them being outliers
+static void
+makeHomographyCorrespondences(const openMVG::Mat3& H,
+                              int w,
+                              int h,
+                              int n,
+                              openMVG::Mat* M1,
+                              openMVG::Mat* M2)
+{
+    std::srand(2016);
+    M1->resize(2, n);
+    M2->resize(2, n);
+    for (int i = 0; i < n; ++i) {
+        openMVG::Vec3 v;
+        v(0) = std::rand() % w + 1;
+        v(1) = std::rand() % h + 1;
+        v(2) = 1.;
+        openMVG::Vec3 u = H * v;
+        (*M1)(0, i) = v(0);
+        (*M1)(1, i) = v(1);
+        if (std::rand() % 100 < 40) {
+            (*M2)(0, i) = std::rand() % w + 1;
+            (*M2)(1, i) = std::rand() % h + 1;
+        } else {
+            (*M2)(0, i) = u(0) / u(2);
+            (*M2)(1, i) = u(1) / u(2);
+        }
+    }
+}
+
+// Solves the homography sequentially or scoring batches of samples on the thread pool, and checks the model found
+static void
+solveHomography(const HomographyKernel& kernel,
+                const openMVG::Mat3& H,
+                bool parallel)
+{
+    openMVG::Mat3 model;
+    ProsacReturnCodeEnum ret;
+
+    if (parallel) {
+        ret = prosac( kernel, &model, 0, 0, ProsacParallelEvaluator<HomographyKernel>(), NATRON_TRACKER_PROSAC_SAMPLES_PER_BATCH );
+    } else {
+        ret = prosac(kernel, &model);
+    }
+    ASSERT_TRUE(ret == eProsacReturnCodeFoundModel || ret == eProsacReturnCodeMaxIterationsFromProportionParamReached);
+    model /= model(2, 2);
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            EXPECT_NEAR(H(r, c), model(r, c), 1e-3);
+        }
+    }
+}
+
+TEST(ModelSearch, HomographyParallelHypotheses)
+{
+    const int w = 1000;
+    const int h = 1000;
+    openMVG::Mat3 H;
+    H << 1.1, 0.05, -4,
+        -0.02, 0.95,  5,
+        0, 0,  1;
+
+    openMVG::Mat M1, M2;
+    makeHomographyCorrespondences(H, w, h, 1000, &M1, &M2);
+    HomographyKernel kernel(M1, w, h, M2, w, h);
+
+    std::srand(2000);
+    solveHomography(kernel, H, true);
+}
+
+// Micro-benchmark: solves a homography from many correspondences with uniformly spread outliers,
+// scoring one sample at a time on the calling thread and batches of samples on the thread pool.
+// Disabled by default, run with --gtest_also_run_disabled_tests
+TEST(ModelSearch, DISABLED_HomographyParallelHypothesesBenchmark)
+{
+    const int w = 1000;
+    const int h = 1000;
+    const int n = 5000;
+    openMVG::Mat3 H;
+    H << 1.1, 0.05, -4,
+        -0.02, 0.95,  5,
+        0, 0,  1;
+
+    openMVG::Mat M1, M2;
+    makeHomographyCorrespondences(H, w, h, n, &M1, &M2);
+    HomographyKernel kernel(M1, w, h, M2, w, h);
+
+    const int nSolves = 10;
+    for (int parallel = 0; parallel < 2; ++parallel) {
+        std::srand(2000);
+        TimeLapse timer;
+        for (int i = 0; i < nSolves; ++i) {
+            solveHomography(kernel, H, parallel);
+        }
+        double elapsed = timer.getTimeSinceCreation();
+        std::cout << "Homography from " << n << " correspondences, " << (parallel ? "parallel batches" : "sequential")
+                  << ": " << nSolves / elapsed << " solves/s" << std::endl;
+    }
+}
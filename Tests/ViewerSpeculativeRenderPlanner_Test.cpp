@@ -0,0 +1,142 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Engine/ViewerSpeculativeRenderPlanner.h"
+
+NATRON_NAMESPACE_USING
+
+static const double kIdleDelay = NATRON_VIEWER_SPECULATIVE_RENDER_IDLE_DELAY_MS / 1000.;
+
+// Renders all the frames, each frame taking frameBytes of the cache
+static std::vector<int>
+renderAll(ViewerSpeculativeRenderFrames* frames,
+          std::size_t frameBytes)
+{
+    std::vector<int> ret;
+    int frame;
+
+    while ( frames->getNextFrame(&frame) ) {
+        ret.push_back(frame);
+        frames->notifyFrameRendered(frameBytes);
+    }
+
+    return ret;
+}
+
+TEST(ViewerSpeculativeRenderPlanner,
+     IdleTrigger)
+{
+    ViewerSpeculativeRenderPlanner planner;
+
+    // Nothing was displayed yet
+    EXPECT_LT(planner.getRemainingIdleTime(10.), 0.);
+
+    planner.notifyFrameDisplayed(10.);
+    EXPECT_NEAR(kIdleDelay, planner.getRemainingIdleTime(10.), 1e-9);
+    EXPECT_NEAR(kIdleDelay / 2, planner.getRemainingIdleTime(10. + kIdleDelay / 2), 1e-9);
+
+    // A new frame displayed restarts the delay
+    planner.notifyFrameDisplayed(11.);
+    EXPECT_NEAR(kIdleDelay, planner.getRemainingIdleTime(11.), 1e-9);
+    EXPECT_EQ( 0., planner.getRemainingIdleTime(11. + kIdleDelay) );
+    EXPECT_EQ( 0., planner.getRemainingIdleTime(100.) );
+
+    // Frames are rendered ahead once per displayed frame
+    ViewerSpeculativeRenderFramesPtr frames = planner.start(1, true, 1, 100, 10, 1000);
+    ASSERT_TRUE(frames);
+    EXPECT_LT(planner.getRemainingIdleTime(100.), 0.);
+    planner.notifyFrameDisplayed(101.);
+    EXPECT_EQ( 0., planner.getRemainingIdleTime(101. + kIdleDelay) );
+}
+
+TEST(ViewerSpeculativeRenderPlanner,
+     FramesAroundCurrentFrameWithinBounds)
+{
+    // Forward: the next frame first, alternating with the previous ones, then only the side still within the bounds
+    ViewerSpeculativeRenderFrames forward(10, true, 8, 14, 100, 1000);
+    int expectedForward[] = { 11, 9, 12, 8, 13, 14 };
+    EXPECT_EQ( std::vector<int>( expectedForward, expectedForward + 6 ), renderAll(&forward, 1) );
+    EXPECT_EQ( 6, forward.getNFramesRendered() );
+
+    ViewerSpeculativeRenderFrames backward(10, false, 8, 14, 100, 1000);
+    int expectedBackward[] = { 9, 11, 8, 12, 13, 14 };
+    EXPECT_EQ( std::vector<int>( expectedBackward, expectedBackward + 6 ), renderAll(&backward, 1) );
+
+    // A single frame timeline has nothing to render ahead
+    ViewerSpeculativeRenderFrames single(1, true, 1, 1, 100, 1000);
+    EXPECT_TRUE( renderAll(&single, 1).empty() );
+}
+
+TEST(ViewerSpeculativeRenderPlanner,
+     Budget)
+{
+    // At most maxFrames frames
+    ViewerSpeculativeRenderFrames maxFrames(50, true, 1, 100, 5, 1000);
+    EXPECT_EQ( (std::size_t)5, renderAll(&maxFrames, 1).size() );
+
+    // Stops once the rendered frames fill the cache budget: the last frame may exceed it
+    ViewerSpeculativeRenderFrames maxBytes(50, true, 1, 100, 100, 1000);
+    EXPECT_EQ( (std::size_t)4, renderAll(&maxBytes, 300).size() );
+    EXPECT_EQ( (std::size_t)1200, maxBytes.getBytesRendered() );
+
+    // Frames already in the cache take no room
+    ViewerSpeculativeRenderFrames cached(50, true, 1, 100, 10, 1000);
+    EXPECT_EQ( (std::size_t)10, renderAll(&cached, 0).size() );
+}
+
+TEST(ViewerSpeculativeRenderPlanner,
+     UserInteractionAborts)
+{
+    ViewerSpeculativeRenderPlanner planner;
+
+    planner.notifyFrameDisplayed(0.);
+    ViewerSpeculativeRenderFramesPtr frames = planner.start(10, true, 1, 100, 50, 1000);
+    int frame;
+    ASSERT_TRUE( frames->getNextFrame(&frame) );
+    frames->notifyFrameRendered(1);
+
+    planner.notifyUserInteraction();
+    EXPECT_TRUE( frames->isAborted() );
+    EXPECT_FALSE( frames->getNextFrame(&frame) );
+    EXPECT_EQ( 1, frames->getNFramesRendered() );
+
+    // The viewer is not idle until a frame is displayed again
+    EXPECT_LT(planner.getRemainingIdleTime(100.), 0.);
+    planner.notifyFrameDisplayed(100.);
+    EXPECT_EQ( 0., planner.getRemainingIdleTime(100. + kIdleDelay) );
+
+    // Starting again aborts the previous frames
+    ViewerSpeculativeRenderFramesPtr first = planner.start(10, true, 1, 100, 50, 1000);
+    ViewerSpeculativeRenderFramesPtr second = planner.start(20, true, 1, 100, 50, 1000);
+    EXPECT_TRUE( first->isAborted() );
+    EXPECT_FALSE( second->isAborted() );
+    ASSERT_TRUE( second->getNextFrame(&frame) );
+    EXPECT_EQ(21, frame);
+}
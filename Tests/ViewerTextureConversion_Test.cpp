@@ -0,0 +1,153 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <vector>
+#include <cstdlib>
+#include <iostream>
+
+#include <gtest/gtest.h>
+
+#include "Engine/Lut.h"
+#include "Engine/Timer.h"
+#include "Engine/ViewerTextureConversion.h"
+
+NATRON_NAMESPACE_USING
+using namespace NATRON_NAMESPACE::ViewerTexture;
+
+namespace {
+// Returns pixels mostly in [0,1], with some values out of range as produced by renders
+std::vector<float>
+makeRow(int W)
+{
+    std::vector<float> row(W * 4);
+
+    for (std::size_t i = 0; i < row.size(); ++i) {
+        row[i] = (std::rand() % 1200) / 1000.f - 0.1f;
+    }
+
+    return row;
+}
+
+bool
+bytesAreClose(U32 a,
+              U32 b)
+{
+    for (int c = 0; c < 4; ++c) {
+        int ca = (a >> (c * 8)) & 0xff;
+        int cb = (b >> (c * 8)) & 0xff;
+        if ( (ca - cb > 1) || (cb - ca > 1) ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+} // anon namespace
+
+// The SIMD kernels compute in single precision, so they may round differently from the scalar reference by 1.
+TEST(ViewerTexture,
+     SIMDMatchesScalar)
+{
+    const int W = 1003; // not a multiple of the SIMD width, to exercise the tails
+    const std::vector<float> src = makeRow(W);
+    const Color::Lut* srgb = Color::LutManager::sRGBLut();
+
+    srgb->validate();
+
+    std::vector<float> scratch(W * 4);
+    std::vector<U32> ref8(W), res8(W);
+    std::vector<float> ref32(W * 4), res32(W * 4);
+
+    for (int is = eInstructionSetSSE2; is <= (int)getBestInstructionSet(); ++is) {
+        for (int opaque = 0; opaque < 2; ++opaque) {
+            for (int useLut = 0; useLut < 2; ++useLut) {
+                const Color::Lut* lut = useLut ? srgb : 0;
+                convertRGBAFloatRowTo8Bits(eInstructionSetScalar, &src[0], W, W / 3, 1.5, 0.01, opaque, lut, &scratch[0], &ref8[0]);
+                convertRGBAFloatRowTo8Bits( (InstructionSetEnum)is, &src[0], W, W / 3, 1.5, 0.01, opaque, lut, &scratch[0], &res8[0] );
+                for (int x = 0; x < W; ++x) {
+                    EXPECT_TRUE( bytesAreClose(ref8[x], res8[x]) ) << getInstructionSetName( (InstructionSetEnum)is ) << " pixel " << x;
+                }
+            }
+            convertRGBAFloatRowTo32Bits(eInstructionSetScalar, &src[0], W, opaque, &ref32[0]);
+            convertRGBAFloatRowTo32Bits( (InstructionSetEnum)is, &src[0], W, opaque, &res32[0] );
+            for (int i = 0; i < W * 4; ++i) {
+                EXPECT_EQ(ref32[i], res32[i]) << getInstructionSetName( (InstructionSetEnum)is ) << " element " << i;
+            }
+        }
+    }
+}
+
+// Micro-benchmark: converts representative regions (a viewer tile, an HD frame and a UHD frame) with each instruction set.
+// Disabled by default, run with --gtest_also_run_disabled_tests
+TEST(ViewerTexture,
+     DISABLED_Benchmark)
+{
+    struct Roi
+    {
+        const char* name;
+        int width;
+        int height;
+    };
+    const Roi rois[] = {
+        { "256x256 tile", 256, 256 },
+        { "1920x1080", 1920, 1080 },
+        { "3840x2160", 3840, 2160 }
+    };
+    const Color::Lut* srgb = Color::LutManager::sRGBLut();
+
+    srgb->validate();
+
+    for (std::size_t r = 0; r < sizeof(rois) / sizeof(rois[0]); ++r) {
+        const int W = rois[r].width;
+        const std::vector<float> src = makeRow(W);
+        std::vector<float> scratch(W * 4);
+        std::vector<U32> dst8(W);
+        std::vector<float> dst32(W * 4);
+
+        for (int is = eInstructionSetScalar; is <= (int)getBestInstructionSet(); ++is) {
+            double times[3];
+            for (int mode = 0; mode < 3; ++mode) {
+                TimeLapse timer;
+                for (int y = 0; y < rois[r].height; ++y) {
+                    switch (mode) {
+                    case 0:
+                        convertRGBAFloatRowTo8Bits( (InstructionSetEnum)is, &src[0], W, y % W, 1., 0., false, 0, &scratch[0], &dst8[0] );
+                        break;
+                    case 1:
+                        convertRGBAFloatRowTo8Bits( (InstructionSetEnum)is, &src[0], W, y % W, 1., 0., false, srgb, &scratch[0], &dst8[0] );
+                        break;
+                    default:
+                        convertRGBAFloatRowTo32Bits( (InstructionSetEnum)is, &src[0], W, false, &dst32[0] );
+                        break;
+                    }
+                }
+                times[mode] = timer.getTimeSinceCreation() * 1000.;
+            }
+            std::cout << rois[r].name << " " << getInstructionSetName( (InstructionSetEnum)is ) << ": 8-bit linear "
+                      << times[0] << "ms, 8-bit sRGB " << times[1] << "ms, 32-bit " << times[2] << "ms" << std::endl;
+        }
+    }
+}
@@ -152,13 +152,38 @@ bool searchModel_minimalSamples(const Kernel &kernel,
 }
 
 
+/// Computes the support of each model of a batch of hypotheses, one after the other.
+/// An evaluator may score the models concurrently: the kernel is only used through its const methods,
+/// and each model has its own inliers vector.
 template<typename Kernel>
+struct ProsacSequentialEvaluator
+{
+  void operator()(const Kernel &kernel,
+                  const std::vector<typename Kernel::Model>& models,
+                  std::vector<InliersVec>* isInlier, // one vector of kernel.NumSamples() elements per model
+                  std::vector<int>* nbInliers,
+                  std::vector<double>* RMS) const // may be NULL
+  {
+    for (std::size_t i = 0; i < models.size(); ++i) {
+      (*nbInliers)[i] = kernel.ComputeInliersForModel(models[i], &(*isInlier)[i], RMS ? &(*RMS)[i] : 0);
+    }
+  }
+};
+
+/// PROSAC, where the hypotheses are drawn by batches of nbSamplesPerBatch samples whose models are scored
+/// together by the evaluator, then processed in the order they were drawn.
+/// With nbSamplesPerBatch = 1, this is the original algorithm. With larger batches, a few more samples than
+/// needed may be drawn, since the termination criterion is only updated after each batch.
+template<typename Kernel, typename Evaluator>
 ProsacReturnCodeEnum prosac(const Kernel &kernel,
                             typename Kernel::Model* bestModel,
-                            InliersVec *bestInliers = 0,
-                            double *bestRMS = 0)
+                            InliersVec *bestInliers,
+                            double *bestRMS,
+                            const Evaluator& evaluator,
+                            int nbSamplesPerBatch)
 {
   assert(bestModel);
+  assert(nbSamplesPerBatch >= 1);
 
   const int N = (int)std::min(kernel.NumSamples(), (std::size_t)RAND_MAX);
 
@@ -225,52 +250,65 @@ ProsacReturnCodeEnum prosac(const Kernel &kernel,
   bool bestModelFound = false;
 
   std::vector<std::size_t> sample(m);
+  std::vector<typename Kernel::Model> possibleModels;
+  std::vector<InliersVec> possibleModelsIsInlier;
+  std::vector<int> possibleModelsNbInliers;
+  std::vector<double> possibleModelsRMS;
 
   // Note: the condition (I_N_best < I_N_min) was not in the original paper, but it is reasonable:
   // we sholdn't stop if we haven't found the expected number of inliers
   while (((I_N_best < I_N_min) || t <= k_n_star) && t < T_N && t <= t_max) {
     int I_N; // total number of inliers for that sample
 
-    // Choice of the hypothesis generation set
-    t = t + 1;
-
-    // from the paper, eq. (5) (not Algorithm1):
-    // "The growth function is then deﬁned as
-    //  g(t) = min {n : T′n ≥ t}"
-    // Thus n should be incremented if t > T'n, not if t = T'n as written in the algorithm 1
-    if ((t > T_n_prime) && (n < n_star)) {
-      double T_nplus1 = (T_n * (n+1)) / (n+1-m);
-      n = n+1;
-      T_n_prime = T_n_prime + std::ceil(T_nplus1 - T_n);
-      T_n = T_nplus1;
-    }
-
-    // Draw semi-random sample (note that the test condition from Algorithm1 in the paper is reversed):
-    if (t > T_n_prime) {
-      // during the finishing stage (n== n_star && t > T_n_prime), draw a standard RANSAC sample
-      // The sample contains m points selected from U_n at random
-      deal(n, m, sample);
-    }  else {
-      // The sample contains m-1 points selected from U_{n−1} at random and u_n
-      deal(n - 1, m - 1, sample);
-      sample[m - 1] = n - 1;
-    }
-
-    // INSERT Compute model parameters p_t from the sample M_t
-    std::vector<typename Kernel::Model> possibleModels;
-    kernel.ComputeModelFromMinimumSamples(sample, &possibleModels);
+    possibleModels.clear();
+    int nbSamplesDrawn = 0;
+    do {
+      // Choice of the hypothesis generation set
+      t = t + 1;
+
+      // from the paper, eq. (5) (not Algorithm1):
+      // "The growth function is then deﬁned as
+      //  g(t) = min {n : T′n ≥ t}"
+      // Thus n should be incremented if t > T'n, not if t = T'n as written in the algorithm 1
+      if ((t > T_n_prime) && (n < n_star)) {
+        double T_nplus1 = (T_n * (n+1)) / (n+1-m);
+        n = n+1;
+        T_n_prime = T_n_prime + std::ceil(T_nplus1 - T_n);
+        T_n = T_nplus1;
+      }
 
-    for (std::size_t modelNb = 0; modelNb < possibleModels.size(); ++modelNb) {
+      // Draw semi-random sample (note that the test condition from Algorithm1 in the paper is reversed):
+      if (t > T_n_prime) {
+        // during the finishing stage (n== n_star && t > T_n_prime), draw a standard RANSAC sample
+        // The sample contains m points selected from U_n at random
+        deal(n, m, sample);
+      }  else {
+        // The sample contains m-1 points selected from U_{n−1} at random and u_n
+        deal(n - 1, m - 1, sample);
+        sample[m - 1] = n - 1;
+      }
 
+      // INSERT Compute model parameters p_t from the sample M_t
+      std::vector<typename Kernel::Model> sampleModels;
+      kernel.ComputeModelFromMinimumSamples(sample, &sampleModels);
+      possibleModels.insert(possibleModels.end(), sampleModels.begin(), sampleModels.end());
+      ++nbSamplesDrawn;
+    } while (nbSamplesDrawn < nbSamplesPerBatch && ((I_N_best < I_N_min) || t <= k_n_star) && t < T_N && t <= t_max);
 
-      // Find support of the model with parameters p_t
-      // From first paragraph of section 2: "The hypotheses are veriﬁed against all data"
+    // Find support of the models with parameters p_t
+    // From first paragraph of section 2: "The hypotheses are veriﬁed against all data"
+    possibleModelsIsInlier.resize(possibleModels.size(), InliersVec(N));
+    possibleModelsNbInliers.resize(possibleModels.size());
+    possibleModelsRMS.resize(possibleModels.size());
+    evaluator(kernel, possibleModels, &possibleModelsIsInlier, &possibleModelsNbInliers, bestRMS ? &possibleModelsRMS : 0);
 
-      double RMS;
-      I_N = kernel.ComputeInliersForModel(possibleModels[modelNb], &isInlier, bestRMS ? &RMS : 0);
+    for (std::size_t modelNb = 0; modelNb < possibleModels.size(); ++modelNb) {
 
+      I_N = possibleModelsNbInliers[modelNb];
 
       if (I_N > I_N_best) {
+        const double RMS = possibleModelsRMS[modelNb];
+        isInlier = possibleModelsIsInlier[modelNb];
         int n_best; // best value found so far in terms of inliers ratio
         int I_n_best; // number of inliers for n_best
         int I_N_draw; // number of inliers withing the N_draw first data
@@ -419,6 +457,15 @@ ProsacReturnCodeEnum prosac(const Kernel &kernel,
   return eProsacReturnCodeFoundModel;
 } // prosac
 
+template<typename Kernel>
+ProsacReturnCodeEnum prosac(const Kernel &kernel,
+                            typename Kernel::Model* bestModel,
+                            InliersVec *bestInliers = 0,
+                            double *bestRMS = 0)
+{
+  return prosac(kernel, bestModel, bestInliers, bestRMS, ProsacSequentialEvaluator<Kernel>(), 1);
+}
+
 
 /*
   Computes a model from N correspondences when we know the number of outliers is to be lower than 10%